@@ -0,0 +1,191 @@
+﻿#include "Animation.h"
+#include <algorithm>
+#include <cmath>
+#include "EntityManager.h"
+#include "Profiler.h"
+
+//The image scaled in its cell, its bottom stays on the cell's bottom unless it rises
+struct AnimationLibrary::SpritePose
+{
+    //of the cell
+    float m_width;
+    float m_height;
+    float m_rise;
+    bool m_isFlipped;
+};
+
+static constexpr int s_coinCellSize = 64;
+static constexpr int s_coinFrames = 8;
+static constexpr int s_playerCellWidth = 64;
+static constexpr int s_playerCellHeight = 128;
+//idle, run and jump one after the other in the players' atlas
+static constexpr int s_idleFrames = 3;
+static constexpr int s_runFrames = 4;
+static constexpr int s_jumpFrames = 3;
+
+Uint16 AnimationLibrary::addClip(const std::string& p_name, SDL_Texture* p_atlas, const Uint16 p_atlasId,
+                                 const Uint16 p_sourceTextureId, const int p_atlasWidth, const int p_atlasHeight,
+                                 const AnimationFrame* p_frames, const size_t p_frameCount,
+                                 const AnimationLoopMode_e p_loopMode)
+{
+    AnimationClip clip;
+    clip.m_name = p_name;
+    clip.m_atlas = p_atlas;
+    clip.m_atlasId = p_atlasId;
+    clip.m_sourceTextureId = p_sourceTextureId;
+    clip.m_loopMode = p_loopMode;
+    const float width = static_cast<float>(std::max(p_atlasWidth, 1));
+    const float height = static_cast<float>(std::max(p_atlasHeight, 1));
+    float end = 0.f;
+    for (size_t i = 0; i < p_frameCount; ++i)
+    {
+        const SDL_Rect& source = p_frames[i].m_source;
+        clip.m_textureRects.push_back({
+            static_cast<float>(source.x) / width, static_cast<float>(source.y) / height,
+            static_cast<float>(source.w) / width, static_cast<float>(source.h) / height
+        });
+        end += p_frames[i].m_duration;
+        clip.m_frameEnds.push_back(end);
+    }
+    m_clips.push_back(clip);
+    return static_cast<Uint16>(m_clips.size() - 1);
+}
+
+void AnimationLibrary::addDefaultClips(EntityManager& p_entityManager, SDL_Renderer* p_renderer)
+{
+    Uint16 coinId = s_noTexture;
+    Uint16 playerId = s_noTexture;
+    SDL_Texture* coin = p_renderer ? p_entityManager.loadTexture(BASE_COLLECTIBLE_TEXTURE, coinId) : nullptr;
+    SDL_Texture* player = p_renderer ? p_entityManager.loadTexture(BASE_PLAYER_TEXTURE, playerId) : nullptr;
+
+    //a turn around the vertical axis, the back is the mirrored front
+    SpritePose coinPoses[s_coinFrames];
+    for (int i = 0; i < s_coinFrames; ++i)
+    {
+        const float turn = std::cos(2.f * g_pi * static_cast<float>(i) / s_coinFrames);
+        coinPoses[i] = {std::max(std::fabs(turn), 0.08f), 1.f, 0.f, turn < 0.f};
+    }
+    SDL_Texture* coinAtlas = bakeAtlas(p_renderer, coin, s_coinCellSize, s_coinCellSize, coinPoses, s_coinFrames);
+    const Uint16 coinAtlasId = coinAtlas ? p_entityManager.addTexture("coin spin atlas", coinAtlas) : s_noTexture;
+    addStripClip("Coin spin", coinAtlas, coinAtlasId, coinId, s_coinCellSize, s_coinCellSize, s_coinFrames, 0,
+        s_coinFrames, 0.08f, ANIMATION_LOOP);
+
+    //breathing, a stride bobbing up and down, then the take off's crouch and stretch
+    static const SpritePose playerPoses[s_idleFrames + s_runFrames + s_jumpFrames] = {
+        {0.96f, 1.f, 0.f, false}, {0.98f, 0.97f, 0.f, false}, {1.f, 0.94f, 0.f, false},
+        {1.f, 0.94f, 0.f, false}, {0.94f, 0.92f, 0.06f, false}, {1.f, 0.94f, 0.f, false},
+        {0.92f, 0.96f, 0.03f, false},
+        {1.f, 0.86f, 0.f, false}, {0.86f, 1.f, 0.f, false}, {0.94f, 0.96f, 0.02f, false}
+    };
+    constexpr int playerCells = SDL_arraysize(playerPoses);
+    SDL_Texture* playerAtlas = bakeAtlas(p_renderer, player, s_playerCellWidth, s_playerCellHeight, playerPoses,
+        playerCells);
+    const Uint16 playerAtlasId = playerAtlas ? p_entityManager.addTexture("player atlas", playerAtlas) : s_noTexture;
+    addStripClip("Player idle", playerAtlas, playerAtlasId, playerId, s_playerCellWidth, s_playerCellHeight,
+        playerCells, 0, s_idleFrames, 0.3f, ANIMATION_PING_PONG);
+    addStripClip("Player run", playerAtlas, playerAtlasId, playerId, s_playerCellWidth, s_playerCellHeight,
+        playerCells, s_idleFrames, s_runFrames, 0.1f, ANIMATION_LOOP);
+    addStripClip("Player jump", playerAtlas, playerAtlasId, playerId, s_playerCellWidth, s_playerCellHeight,
+        playerCells, s_idleFrames + s_runFrames, s_jumpFrames, 0.08f, ANIMATION_ONCE);
+}
+
+size_t AnimationLibrary::update(EcsWorld& p_world, const float p_deltaTime) const
+{
+    PROFILE_SCOPE("UpdateAnimations");
+    size_t animationCount = 0;
+    p_world.forEachChunk<SpriteAnimation>(
+        [this, p_deltaTime, &animationCount](const size_t p_count, const EcsEntity*, SpriteAnimation* p_animations)
+        {
+            animationCount += p_count;
+            for (size_t i = 0; i < p_count; ++i)
+            {
+                SpriteAnimation& animation = p_animations[i];
+                const AnimationClip& clip = m_clips[animation.m_clip];
+                const float duration = clip.m_frameEnds.back();
+                animation.m_time += p_deltaTime;
+                if (clip.m_loopMode == ANIMATION_ONCE)
+                    animation.m_time = std::min(animation.m_time, duration);
+                else
+                {
+                    const float period = clip.m_loopMode == ANIMATION_PING_PONG ? 2.f * duration : duration;
+                    if (animation.m_time >= period)
+                        animation.m_time = std::fmod(animation.m_time, period);
+                }
+                const Uint16 frame = getFrameAt(clip, animation.m_time);
+
+                //a collected coin has no texture, an entity given another image keeps it
+                Entity* entity = animation.m_entity;
+                SDL_Texture* texture = entity->getTexture();
+                if (!texture || !clip.m_atlas || (texture == clip.m_atlas && frame == animation.m_frame))
+                    continue;
+                if (texture != clip.m_atlas && entity->getTextureId() != clip.m_sourceTextureId)
+                    continue;
+                FRect textureRect = clip.m_textureRects[frame];
+                if (animation.m_isMirrored)
+                {
+                    textureRect.x += textureRect.w;
+                    textureRect.w = -textureRect.w;
+                }
+                entity->setTextureFrame(clip.m_atlas, clip.m_atlasId, textureRect);
+                animation.m_frame = frame;
+            }
+        });
+    return animationCount;
+}
+
+Uint16 AnimationLibrary::getFrameAt(const AnimationClip& p_clip, float p_time)
+{
+    const float duration = p_clip.m_frameEnds.back();
+    //the way back of a ping pong is the way there reversed
+    if (p_clip.m_loopMode == ANIMATION_PING_PONG && p_time > duration)
+        p_time = 2.f * duration - p_time;
+    const size_t frame = std::upper_bound(p_clip.m_frameEnds.begin(), p_clip.m_frameEnds.end(), p_time) -
+        p_clip.m_frameEnds.begin();
+    return static_cast<Uint16>(std::min(frame, p_clip.m_frameEnds.size() - 1));
+}
+
+SDL_Texture* AnimationLibrary::bakeAtlas(SDL_Renderer* p_renderer, SDL_Texture* p_source, const int p_cellWidth,
+                                         const int p_cellHeight, const SpritePose* p_poses, const int p_poseCount)
+{
+    if (!p_renderer || !p_source)
+        return nullptr;
+    SDL_Texture* atlas = SDL_CreateTexture(p_renderer, SDL_PIXELFORMAT_RGBA8888, SDL_TEXTUREACCESS_TARGET,
+        p_cellWidth * p_poseCount, p_cellHeight);
+    if (!atlas)
+        return nullptr;
+    SDL_SetTextureBlendMode(atlas, SDL_BLENDMODE_BLEND);
+
+    SDL_Texture* previousTarget = SDL_GetRenderTarget(p_renderer);
+    Uint8 red, green, blue, alpha;
+    SDL_GetRenderDrawColor(p_renderer, &red, &green, &blue, &alpha);
+    SDL_SetRenderTarget(p_renderer, atlas);
+    SDL_SetRenderDrawColor(p_renderer, 0, 0, 0, 0);
+    SDL_RenderClear(p_renderer);
+    for (int i = 0; i < p_poseCount; ++i)
+    {
+        const SpritePose& pose = p_poses[i];
+        const int width = static_cast<int>(static_cast<float>(p_cellWidth) * pose.m_width + 0.5f);
+        const int height = static_cast<int>(static_cast<float>(p_cellHeight) * pose.m_height + 0.5f);
+        const int rise = static_cast<int>(static_cast<float>(p_cellHeight) * pose.m_rise + 0.5f);
+        const SDL_Rect destination = {
+            i * p_cellWidth + (p_cellWidth - width) / 2, p_cellHeight - height - rise, width, height
+        };
+        SDL_RenderCopyEx(p_renderer, p_source, nullptr, &destination, 0., nullptr,
+            pose.m_isFlipped ? SDL_FLIP_HORIZONTAL : SDL_FLIP_NONE);
+    }
+    SDL_SetRenderTarget(p_renderer, previousTarget);
+    SDL_SetRenderDrawColor(p_renderer, red, green, blue, alpha);
+    return atlas;
+}
+
+Uint16 AnimationLibrary::addStripClip(const std::string& p_name, SDL_Texture* p_atlas, const Uint16 p_atlasId,
+                                      const Uint16 p_sourceTextureId, const int p_cellWidth, const int p_cellHeight,
+                                      const int p_cellCount, const int p_firstCell, const int p_frameCount,
+                                      const float p_frameDuration, const AnimationLoopMode_e p_loopMode)
+{
+    std::vector<AnimationFrame> frames;
+    for (int i = 0; i < p_frameCount; ++i)
+        frames.push_back({{(p_firstCell + i) * p_cellWidth, 0, p_cellWidth, p_cellHeight}, p_frameDuration});
+    return addClip(p_name, p_atlas, p_atlasId, p_sourceTextureId, p_cellWidth * p_cellCount, p_cellHeight,
+        frames.data(), frames.size(), p_loopMode);
+}
@@ -0,0 +1,106 @@
+﻿#pragma once
+#include <SDL_render.h>
+#include <string>
+#include <vector>
+#include "Ecs.h"
+#include "utils.h"
+
+class Entity;
+class EntityManager;
+
+enum AnimationLoopMode_e
+{
+    //starts again from the first frame
+    ANIMATION_LOOP,
+    //stays on the last frame
+    ANIMATION_ONCE,
+    //plays backwards to the first frame, then forwards again
+    ANIMATION_PING_PONG,
+
+    //LEAVE THIS AT THE END FOR AUTOMATIC INCREMENT
+    ANIMATION_LOOP_MODES_NUMBER
+};
+
+//the clips every entity manager has, in this order
+enum DefaultAnimationClip_e
+{
+    CLIP_COIN_SPIN,
+    CLIP_PLAYER_IDLE,
+    CLIP_PLAYER_RUN,
+    CLIP_PLAYER_JUMP,
+
+    //LEAVE THIS AT THE END FOR AUTOMATIC INCREMENT
+    DEFAULT_CLIPS_NUMBER
+};
+
+struct AnimationFrame
+{
+    //in pixels of the atlas
+    SDL_Rect m_source;
+    //in seconds
+    float m_duration;
+};
+
+//Frames of one atlas, shared by every entity playing the clip. The entities showing another image than the one
+//the atlas was baked from keep it
+struct AnimationClip
+{
+    std::string m_name;
+    //nullptr without a renderer, the clip still plays but nothing is shown
+    SDL_Texture* m_atlas;
+    Uint16 m_atlasId;
+    //of the image the atlas was baked from
+    Uint16 m_sourceTextureId;
+    //the frames' sources in texture coordinates
+    std::vector<FRect> m_textureRects;
+    //the time each frame ends at, from the start of the clip
+    std::vector<float> m_frameEnds;
+    AnimationLoopMode_e m_loopMode;
+};
+
+//The per entity state of the players and the collectibles, the clip they play and how far they are in it
+struct SpriteAnimation
+{
+    Entity* m_entity;
+    //wrapped in the clip's period
+    float m_time;
+    Uint16 m_clip;
+    //the last one shown, the entity is only written when it changes
+    Uint16 m_frame;
+    //shown mirrored, the players facing left
+    bool m_isMirrored;
+};
+
+class AnimationLibrary
+{
+public:
+    static constexpr Uint16 s_noTexture = 0xFFFF;
+    static constexpr Uint16 s_noFrame = 0xFFFF;
+
+    //p_frames are in pixels of p_atlas, p_atlasWidth by p_atlasHeight
+    Uint16 addClip(const std::string& p_name, SDL_Texture* p_atlas, Uint16 p_atlasId, Uint16 p_sourceTextureId,
+                   int p_atlasWidth, int p_atlasHeight, const AnimationFrame* p_frames, size_t p_frameCount,
+                   AnimationLoopMode_e p_loopMode);
+    //the coin's spin and the player's idle, run and jump, baked from their images. The player's clips share
+    //one atlas so a clip change keeps its sprites in the same batch. Without a renderer the clips have no atlas
+    void addDefaultClips(EntityManager& p_entityManager, SDL_Renderer* p_renderer);
+    const AnimationClip& getClip(const Uint16 p_clip) const { return m_clips[p_clip]; }
+    size_t getClipCount() const { return m_clips.size(); }
+    //one pass over the world's animations: their times move on by p_deltaTime and the entities show the frame
+    //they are on. Returns the number of animations
+    size_t update(EcsWorld& p_world, float p_deltaTime) const;
+    //the frame shown p_time seconds into the clip
+    static Uint16 getFrameAt(const AnimationClip& p_clip, float p_time);
+private:
+    struct SpritePose;
+
+    //the image drawn once per pose in cells side by side, nullptr without a renderer or an image
+    static SDL_Texture* bakeAtlas(SDL_Renderer* p_renderer, SDL_Texture* p_source, int p_cellWidth,
+                                  int p_cellHeight, const SpritePose* p_poses, int p_poseCount);
+    //the clip's frames are p_frameCount cells of the atlas from p_firstCell, they all last p_frameDuration
+    Uint16 addStripClip(const std::string& p_name, SDL_Texture* p_atlas, Uint16 p_atlasId,
+                        Uint16 p_sourceTextureId, int p_cellWidth, int p_cellHeight, int p_cellCount,
+                        int p_firstCell, int p_frameCount, float p_frameDuration, AnimationLoopMode_e p_loopMode);
+
+    std::vector<AnimationClip> m_clips;
+};
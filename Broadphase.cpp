@@ -0,0 +1,483 @@
+﻿#include "Broadphase.h"
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include "Entity.h"
+
+Broadphase::Broadphase(const float p_cellSize) : m_cellSize(p_cellSize), m_inverseCellSize(1.f / p_cellSize),
+                                                 m_bucketStarts(s_bucketNumber + 1, 0)
+{
+}
+
+void Broadphase::clear()
+{
+    m_proxies.clear();
+    m_pairs.clear();
+    m_cellEntries.clear();
+    m_candidates.clear();
+    m_vertices.clear();
+    m_normals.clear();
+    m_pairTestCount = 0;
+}
+
+void Broadphase::addProxy(Collider* p_collider, const FRect& p_aabb, const bool p_isDynamic, Entity* p_entity,
+                          const Uint8 p_uses)
+{
+    p_collider->setProxyId(static_cast<int>(m_proxies.size()));
+    BroadphaseProxy proxy;
+    proxy.m_aabb = p_aabb;
+    proxy.m_collider = p_collider;
+    proxy.m_layer = p_collider->getLayer();
+    proxy.m_mask = p_collider->getMask();
+    proxy.m_isDynamic = p_isDynamic;
+    proxy.m_isTrigger = p_collider->isTrigger();
+    proxy.m_uses = p_uses;
+    proxy.m_entity = p_entity ? p_entity : p_collider->getParent();
+    proxy.m_entityId = proxy.m_entity->getId();
+    proxy.m_shape = p_collider->getShape();
+    proxy.m_bounds = p_collider->getAABB();
+    proxy.m_center = p_collider->getCenter();
+    proxy.m_halfSize = p_collider->getHalfSize();
+    proxy.m_cos = p_collider->getCos();
+    proxy.m_sin = p_collider->getSin();
+    proxy.m_radius = 0.f;
+    proxy.m_firstVertex = static_cast<int>(m_vertices.size());
+    proxy.m_vertexCount = 0;
+    if (proxy.m_shape == CIRCLE)
+        proxy.m_radius = static_cast<const CircleCollider*>(p_collider)->getRadius();
+    else if (proxy.m_shape == CONVEX_POLYGON)
+    {
+        const auto* polygon = static_cast<const ConvexPolygonCollider*>(p_collider);
+        proxy.m_vertexCount = polygon->getVertexCount();
+        m_vertices.insert(m_vertices.end(), polygon->getWorldVertices(),
+            polygon->getWorldVertices() + proxy.m_vertexCount);
+        m_normals.insert(m_normals.end(), polygon->getWorldNormals(), polygon->getWorldNormals() + proxy.m_vertexCount);
+    }
+    m_proxies.push_back(proxy);
+}
+
+void Broadphase::build()
+{
+    bucketProxies();
+    generatePairs();
+    buildCandidates();
+}
+
+CandidateRange Broadphase::getCandidates(const int p_proxyId) const
+{
+    if (p_proxyId < 0 || p_proxyId >= static_cast<int>(m_proxies.size()) || m_candidates.empty())
+        return {nullptr, nullptr};
+    const BroadphaseProxy* const* candidates = m_candidates.data();
+    return {candidates + m_candidateStarts[p_proxyId], candidates + m_candidateStarts[p_proxyId + 1]};
+}
+
+int Broadphase::getCellCoordinate(const float p_position) const
+{
+    return static_cast<int>(std::floor(p_position * m_inverseCellSize));
+}
+
+int Broadphase::getBucket(const int p_cellX, const int p_cellY) const
+{
+    const unsigned int hash = static_cast<unsigned int>(p_cellX) * 73856093u ^ static_cast<unsigned int>(p_cellY) *
+        19349663u;
+    return static_cast<int>(hash & (s_bucketNumber - 1));
+}
+
+void Broadphase::bucketProxies()
+{
+    //counting sort of the (proxy, cell) entries by bucket
+    std::fill(m_bucketStarts.begin(), m_bucketStarts.end(), 0);
+    size_t entryNumber = 0;
+    for (const BroadphaseProxy& proxy : m_proxies)
+    {
+        const int minX = getCellCoordinate(proxy.m_aabb.x);
+        const int maxX = getCellCoordinate(proxy.m_aabb.x + proxy.m_aabb.w);
+        const int minY = getCellCoordinate(proxy.m_aabb.y);
+        const int maxY = getCellCoordinate(proxy.m_aabb.y + proxy.m_aabb.h);
+        for (int cellY = minY; cellY <= maxY; ++cellY)
+            for (int cellX = minX; cellX <= maxX; ++cellX)
+            {
+                ++m_bucketStarts[getBucket(cellX, cellY) + 1];
+                ++entryNumber;
+            }
+    }
+    for (int bucket = 0; bucket < s_bucketNumber; ++bucket)
+        m_bucketStarts[bucket + 1] += m_bucketStarts[bucket];
+
+    m_cellEntries.resize(entryNumber);
+    m_fillPositions.assign(m_bucketStarts.begin(), m_bucketStarts.end() - 1);
+    for (int proxyId = 0; proxyId < static_cast<int>(m_proxies.size()); ++proxyId)
+    {
+        const FRect& aabb = m_proxies[proxyId].m_aabb;
+        const int minX = getCellCoordinate(aabb.x);
+        const int maxX = getCellCoordinate(aabb.x + aabb.w);
+        const int minY = getCellCoordinate(aabb.y);
+        const int maxY = getCellCoordinate(aabb.y + aabb.h);
+        for (int cellY = minY; cellY <= maxY; ++cellY)
+            for (int cellX = minX; cellX <= maxX; ++cellX)
+                m_cellEntries[m_fillPositions[getBucket(cellX, cellY)]++] = {proxyId, cellX, cellY};
+    }
+}
+
+void Broadphase::generatePairs()
+{
+    for (int bucket = 0; bucket < s_bucketNumber; ++bucket)
+    {
+        const int bucketEnd = m_bucketStarts[bucket + 1];
+        for (int i = m_bucketStarts[bucket]; i < bucketEnd; ++i)
+        {
+            const CellEntry& entry = m_cellEntries[i];
+            const BroadphaseProxy& proxy = m_proxies[entry.m_proxyId];
+            for (int j = i + 1; j < bucketEnd; ++j)
+            {
+                const CellEntry& otherEntry = m_cellEntries[j];
+                //different cells hashed in the same bucket
+                if (otherEntry.m_cellX != entry.m_cellX || otherEntry.m_cellY != entry.m_cellY)
+                    continue;
+                const BroadphaseProxy& otherProxy = m_proxies[otherEntry.m_proxyId];
+
+                //pairs that can never interact are dropped before touching any geometry
+                if ((!proxy.m_isDynamic && !otherProxy.m_isDynamic) ||
+                    !(proxy.m_uses & otherProxy.m_uses & PROXY_COLLIDES) || !layersMatch(proxy, otherProxy))
+                    continue;
+
+                ++m_pairTestCount;
+                const FRect& aabb = proxy.m_aabb;
+                const FRect& otherAabb = otherProxy.m_aabb;
+                if (aabb.x > otherAabb.x + otherAabb.w || otherAabb.x > aabb.x + aabb.w ||
+                    aabb.y > otherAabb.y + otherAabb.h || otherAabb.y > aabb.y + aabb.h)
+                    continue;
+
+                //the pair is only reported by the cell holding the top left corner of the overlap
+                if (getCellCoordinate(std::max(aabb.x, otherAabb.x)) != entry.m_cellX ||
+                    getCellCoordinate(std::max(aabb.y, otherAabb.y)) != entry.m_cellY)
+                    continue;
+                m_pairs.push_back({&proxy, &otherProxy});
+            }
+        }
+    }
+}
+
+void Broadphase::buildCandidates()
+{
+    //every dynamic proxy gets the list of proxies it is paired with
+    m_candidateStarts.assign(m_proxies.size() + 1, 0);
+    for (const ColliderPair& pair : m_pairs)
+    {
+        if (pair.m_first->m_isDynamic)
+            ++m_candidateStarts[pair.m_first - m_proxies.data() + 1];
+        if (pair.m_second->m_isDynamic)
+            ++m_candidateStarts[pair.m_second - m_proxies.data() + 1];
+    }
+    for (size_t proxyId = 0; proxyId < m_proxies.size(); ++proxyId)
+        m_candidateStarts[proxyId + 1] += m_candidateStarts[proxyId];
+
+    m_candidates.resize(m_candidateStarts.back());
+    m_fillPositions.assign(m_candidateStarts.begin(), m_candidateStarts.end());
+    for (const ColliderPair& pair : m_pairs)
+    {
+        if (pair.m_first->m_isDynamic)
+            m_candidates[m_fillPositions[pair.m_first - m_proxies.data()]++] = pair.m_second;
+        if (pair.m_second->m_isDynamic)
+            m_candidates[m_fillPositions[pair.m_second - m_proxies.data()]++] = pair.m_first;
+    }
+}
+
+bool Broadphase::containsPoint(const BroadphaseProxy& p_proxy, const Vec2<float>& p_point) const
+{
+    const FRect& bounds = p_proxy.m_bounds;
+    if (p_point.x < bounds.x || p_point.x > bounds.x + bounds.w || p_point.y < bounds.y ||
+        p_point.y > bounds.y + bounds.h)
+        return false;
+
+    const Vec2<float> delta = p_point - p_proxy.m_center;
+    switch (p_proxy.m_shape)
+    {
+    case CIRCLE:
+        return dot(delta, delta) <= p_proxy.m_radius * p_proxy.m_radius;
+    case CONVEX_POLYGON:
+        for (int i = p_proxy.m_firstVertex; i < p_proxy.m_firstVertex + p_proxy.m_vertexCount; ++i)
+            if (dot(m_normals[i], p_point - m_vertices[i]) > 0.f)
+                return false;
+        return true;
+    default:
+        return std::abs(delta.x * p_proxy.m_cos + delta.y * p_proxy.m_sin) <= p_proxy.m_halfSize.x &&
+            std::abs(-delta.x * p_proxy.m_sin + delta.y * p_proxy.m_cos) <= p_proxy.m_halfSize.y;
+    }
+}
+
+int Broadphase::queryPoint(const Vec2<float>& p_point, const Uint32 p_mask, QueryHit* p_hits,
+                           const int p_maxHits) const
+{
+    if (m_cellEntries.empty())
+        return 0;
+    const int cellX = getCellCoordinate(p_point.x);
+    const int cellY = getCellCoordinate(p_point.y);
+    const int bucket = getBucket(cellX, cellY);
+    int hitNumber = 0;
+    for (int i = m_bucketStarts[bucket]; i < m_bucketStarts[bucket + 1] && hitNumber < p_maxHits; ++i)
+    {
+        const CellEntry& entry = m_cellEntries[i];
+        const BroadphaseProxy& proxy = m_proxies[entry.m_proxyId];
+        if (entry.m_cellX != cellX || entry.m_cellY != cellY || (proxy.m_layer & p_mask) == 0 ||
+            !(proxy.m_uses & PROXY_QUERIED) || !containsPoint(proxy, p_point))
+            continue;
+        p_hits[hitNumber++] = {proxy.m_entity, proxy.m_entityId};
+    }
+    return hitNumber;
+}
+
+int Broadphase::queryAABB(const FRect& p_rect, const Uint32 p_mask, QueryHit* p_hits, const int p_maxHits) const
+{
+    if (m_cellEntries.empty())
+        return 0;
+    const int minX = getCellCoordinate(p_rect.x);
+    const int maxX = getCellCoordinate(p_rect.x + p_rect.w);
+    const int minY = getCellCoordinate(p_rect.y);
+    const int maxY = getCellCoordinate(p_rect.y + p_rect.h);
+    int hitNumber = 0;
+    for (int cellY = minY; cellY <= maxY; ++cellY)
+        for (int cellX = minX; cellX <= maxX; ++cellX)
+        {
+            const int bucket = getBucket(cellX, cellY);
+            for (int i = m_bucketStarts[bucket]; i < m_bucketStarts[bucket + 1]; ++i)
+            {
+                const CellEntry& entry = m_cellEntries[i];
+                const BroadphaseProxy& proxy = m_proxies[entry.m_proxyId];
+                const FRect& bounds = proxy.m_bounds;
+                if (entry.m_cellX != cellX || entry.m_cellY != cellY || (proxy.m_layer & p_mask) == 0 ||
+                    !(proxy.m_uses & PROXY_QUERIED) || bounds.x > p_rect.x + p_rect.w ||
+                    p_rect.x > bounds.x + bounds.w || bounds.y > p_rect.y + p_rect.h || p_rect.y > bounds.y + bounds.h)
+                    continue;
+                //a proxy spanning several cells is only reported by the first one it shares with the query
+                if (getCellCoordinate(std::max(bounds.x, p_rect.x)) != cellX ||
+                    getCellCoordinate(std::max(bounds.y, p_rect.y)) != cellY)
+                    continue;
+                if (hitNumber == p_maxHits)
+                    return hitNumber;
+                p_hits[hitNumber++] = {proxy.m_entity, proxy.m_entityId};
+            }
+        }
+    return hitNumber;
+}
+
+//clips the ray between two parallel planes (the slab), p_normal gets the entering side
+static bool clipSlab(const float p_start, const float p_delta, const float p_min, const float p_max, float& p_enter,
+                     float& p_exit, float& p_enterSign)
+{
+    if (p_delta == 0.f)
+        return p_start >= p_min && p_start <= p_max;
+    const float inverseDelta = 1.f / p_delta;
+    float near = (p_min - p_start) * inverseDelta;
+    float far = (p_max - p_start) * inverseDelta;
+    float sign = -1.f;
+    if (near > far)
+    {
+        std::swap(near, far);
+        sign = 1.f;
+    }
+    if (near > p_enter)
+    {
+        p_enter = near;
+        p_enterSign = sign;
+    }
+    p_exit = std::min(p_exit, far);
+    return p_enter <= p_exit;
+}
+
+bool Broadphase::raycastProxy(const BroadphaseProxy& p_proxy, const Vec2<float>& p_start, const Vec2<float>& p_delta,
+                              float& p_fraction, Vec2<float>& p_normal) const
+{
+    switch (p_proxy.m_shape)
+    {
+    case CIRCLE:
+        {
+            const Vec2<float> offset = p_start - p_proxy.m_center;
+            const float a = dot(p_delta, p_delta);
+            const float b = dot(offset, p_delta);
+            const float c = dot(offset, offset) - p_proxy.m_radius * p_proxy.m_radius;
+            if (c <= 0.f)
+            {
+                p_fraction = 0.f;
+                p_normal = {0.f, 0.f};
+                return true;
+            }
+            const float discriminant = b * b - a * c;
+            if (a == 0.f || discriminant < 0.f)
+                return false;
+            p_fraction = (-b - std::sqrt(discriminant)) / a;
+            if (p_fraction < 0.f || p_fraction > 1.f)
+                return false;
+            p_normal = (offset + p_delta * p_fraction) / p_proxy.m_radius;
+            return true;
+        }
+    case CONVEX_POLYGON:
+        {
+            float enter = 0.f;
+            float exit = 1.f;
+            Vec2<float> normal = {0.f, 0.f};
+            for (int i = p_proxy.m_firstVertex; i < p_proxy.m_firstVertex + p_proxy.m_vertexCount; ++i)
+            {
+                const float denominator = dot(m_normals[i], p_delta);
+                const float numerator = dot(m_normals[i], m_vertices[i] - p_start);
+                if (denominator == 0.f)
+                {
+                    if (numerator < 0.f)
+                        return false;
+                    continue;
+                }
+                const float t = numerator / denominator;
+                if (denominator < 0.f && t > enter)
+                {
+                    enter = t;
+                    normal = m_normals[i];
+                }
+                else if (denominator > 0.f && t < exit)
+                    exit = t;
+                if (enter > exit)
+                    return false;
+            }
+            p_fraction = enter;
+            p_normal = normal;
+            return true;
+        }
+    default:
+        {
+            //in the box's own frame the test is a plain slab test
+            const Vec2<float> offset = p_start - p_proxy.m_center;
+            const float cos = p_proxy.m_cos;
+            const float sin = p_proxy.m_sin;
+            const Vec2<float> localStart = {offset.x * cos + offset.y * sin, -offset.x * sin + offset.y * cos};
+            const Vec2<float> localDelta = {p_delta.x * cos + p_delta.y * sin, -p_delta.x * sin + p_delta.y * cos};
+            float enter = 0.f;
+            float exit = 1.f;
+            float xSign = 0.f;
+            float ySign = 0.f;
+            if (!clipSlab(localStart.x, localDelta.x, -p_proxy.m_halfSize.x, p_proxy.m_halfSize.x, enter, exit, xSign))
+                return false;
+            const float xEnter = enter;
+            if (!clipSlab(localStart.y, localDelta.y, -p_proxy.m_halfSize.y, p_proxy.m_halfSize.y, enter, exit, ySign))
+                return false;
+            const Vec2<float> localNormal = enter > xEnter ? Vec2<float>{0.f, ySign} : Vec2<float>{xSign, 0.f};
+            p_fraction = enter;
+            p_normal = {localNormal.x * cos - localNormal.y * sin, localNormal.x * sin + localNormal.y * cos};
+            return true;
+        }
+    }
+}
+
+bool Broadphase::raycast(const Vec2<float>& p_start, const Vec2<float>& p_end, const Uint32 p_mask,
+                         RaycastHit& p_hit, const Collider* p_ignored) const
+{
+    p_hit = RaycastHit();
+    if (m_cellEntries.empty())
+        return false;
+    const Vec2<float> delta = p_end - p_start;
+    int cellX = getCellCoordinate(p_start.x);
+    int cellY = getCellCoordinate(p_start.y);
+    const int endCellX = getCellCoordinate(p_end.x);
+    const int endCellY = getCellCoordinate(p_end.y);
+
+    //walks the grid cell by cell along the ray (Amanatides & Woo)
+    const int stepX = delta.x > 0.f ? 1 : (delta.x < 0.f ? -1 : 0);
+    const int stepY = delta.y > 0.f ? 1 : (delta.y < 0.f ? -1 : 0);
+    const float tDeltaX = stepX != 0 ? m_cellSize / std::abs(delta.x) : FLT_MAX;
+    const float tDeltaY = stepY != 0 ? m_cellSize / std::abs(delta.y) : FLT_MAX;
+    float tMaxX = stepX != 0
+                      ? ((static_cast<float>(cellX + (stepX > 0 ? 1 : 0)) * m_cellSize) - p_start.x) / delta.x
+                      : FLT_MAX;
+    float tMaxY = stepY != 0
+                      ? ((static_cast<float>(cellY + (stepY > 0 ? 1 : 0)) * m_cellSize) - p_start.y) / delta.y
+                      : FLT_MAX;
+
+    bool hasHit = false;
+    const int maxSteps = std::abs(endCellX - cellX) + std::abs(endCellY - cellY) + 1;
+    for (int step = 0; step < maxSteps; ++step)
+    {
+        const int bucket = getBucket(cellX, cellY);
+        for (int i = m_bucketStarts[bucket]; i < m_bucketStarts[bucket + 1]; ++i)
+        {
+            const CellEntry& entry = m_cellEntries[i];
+            const BroadphaseProxy& proxy = m_proxies[entry.m_proxyId];
+            if (entry.m_cellX != cellX || entry.m_cellY != cellY || (proxy.m_layer & p_mask) == 0 ||
+                !(proxy.m_uses & PROXY_QUERIED) || proxy.m_collider == p_ignored)
+                continue;
+            float fraction;
+            Vec2<float> normal;
+            if (!raycastProxy(proxy, p_start, delta, fraction, normal) || fraction >= p_hit.m_fraction)
+                continue;
+            p_hit = {proxy.m_entity, proxy.m_entityId, fraction, p_start + delta * fraction, normal};
+            hasHit = true;
+        }
+        //nothing in the next cells can be closer than what this one gave
+        if (hasHit && p_hit.m_fraction <= std::min(tMaxX, tMaxY))
+            break;
+        if (tMaxX < tMaxY)
+        {
+            cellX += stepX;
+            tMaxX += tDeltaX;
+        }
+        else
+        {
+            cellY += stepY;
+            tMaxY += tDeltaY;
+        }
+    }
+    return hasHit;
+}
+
+bool Broadphase::sweepBox(const FRect& p_box, const Vec2<float>& p_move, const Uint32 p_mask, RaycastHit& p_hit,
+                          const Collider* p_ignored) const
+{
+    p_hit = RaycastHit();
+    if (m_cellEntries.empty())
+        return false;
+    const FRect sweptBox = {
+        std::min(p_box.x, p_box.x + p_move.x), std::min(p_box.y, p_box.y + p_move.y),
+        p_box.w + std::abs(p_move.x), p_box.h + std::abs(p_move.y)
+    };
+    const Vec2<float> halfSize = {p_box.w / 2.f, p_box.h / 2.f};
+    const Vec2<float> center = {p_box.x + halfSize.x, p_box.y + halfSize.y};
+    const int minX = getCellCoordinate(sweptBox.x);
+    const int maxX = getCellCoordinate(sweptBox.x + sweptBox.w);
+    const int minY = getCellCoordinate(sweptBox.y);
+    const int maxY = getCellCoordinate(sweptBox.y + sweptBox.h);
+
+    bool hasHit = false;
+    for (int cellY = minY; cellY <= maxY; ++cellY)
+        for (int cellX = minX; cellX <= maxX; ++cellX)
+        {
+            const int bucket = getBucket(cellX, cellY);
+            for (int i = m_bucketStarts[bucket]; i < m_bucketStarts[bucket + 1]; ++i)
+            {
+                const CellEntry& entry = m_cellEntries[i];
+                const BroadphaseProxy& proxy = m_proxies[entry.m_proxyId];
+                const FRect& bounds = proxy.m_bounds;
+                if (entry.m_cellX != cellX || entry.m_cellY != cellY || (proxy.m_layer & p_mask) == 0 ||
+                    !(proxy.m_uses & PROXY_QUERIED) || proxy.m_collider == p_ignored ||
+                    bounds.x > sweptBox.x + sweptBox.w || sweptBox.x > bounds.x + bounds.w ||
+                    bounds.y > sweptBox.y + sweptBox.h || sweptBox.y > bounds.y + bounds.h)
+                    continue;
+                if (getCellCoordinate(std::max(bounds.x, sweptBox.x)) != cellX ||
+                    getCellCoordinate(std::max(bounds.y, sweptBox.y)) != cellY)
+                    continue;
+
+                //the box against the bounds is the box's center against the bounds grown by its half size
+                float enter = 0.f;
+                float exit = 1.f;
+                float xSign = 0.f;
+                float ySign = 0.f;
+                if (!clipSlab(center.x, p_move.x, bounds.x - halfSize.x, bounds.x + bounds.w + halfSize.x, enter, exit,
+                    xSign))
+                    continue;
+                const float xEnter = enter;
+                if (!clipSlab(center.y, p_move.y, bounds.y - halfSize.y, bounds.y + bounds.h + halfSize.y, enter, exit,
+                    ySign) || enter >= p_hit.m_fraction)
+                    continue;
+                const Vec2<float> normal = enter > xEnter ? Vec2<float>{0.f, ySign} : Vec2<float>{xSign, 0.f};
+                p_hit = {proxy.m_entity, proxy.m_entityId, enter, center + p_move * enter, normal};
+                hasHit = true;
+            }
+        }
+    return hasHit;
+}
@@ -0,0 +1,128 @@
+﻿#pragma once
+#include <vector>
+#include "Collider.h"
+
+enum ProxyUse_e : Uint8
+{
+    PROXY_COLLIDES = 1 << 0,
+    PROXY_QUERIED = 1 << 1,
+    PROXY_ALL_USES = PROXY_COLLIDES | PROXY_QUERIED
+};
+
+struct BroadphaseProxy
+{
+    //fattened by the next move for dynamic bodies, used for the pairs
+    FRect m_aabb;
+    Collider* m_collider;
+    Uint32 m_layer;
+    Uint32 m_mask;
+    bool m_isDynamic;
+    bool m_isTrigger;
+    //ProxyUse_e flags, the pairs are only made of colliding proxies and the queries only see queried ones
+    Uint8 m_uses;
+
+    //copy of the shape when the broadphase was built, queries never read the live collider
+    Entity* m_entity;
+    Uint16 m_entityId;
+    ColliderShape_e m_shape;
+    FRect m_bounds;
+    Vec2<float> m_center;
+    Vec2<float> m_halfSize;
+    float m_cos;
+    float m_sin;
+    float m_radius;
+    int m_firstVertex;
+    int m_vertexCount;
+};
+
+struct QueryHit
+{
+    Entity* m_entity;
+    Uint16 m_entityId;
+};
+
+struct RaycastHit
+{
+    Entity* m_entity = nullptr;
+    Uint16 m_entityId = 0;
+    //between 0 (start) and 1 (end)
+    float m_fraction = 1.f;
+    Vec2<float> m_point = {0.f, 0.f};
+    Vec2<float> m_normal = {0.f, 0.f};
+};
+
+struct ColliderPair
+{
+    const BroadphaseProxy* m_first;
+    const BroadphaseProxy* m_second;
+};
+
+//proxies one body may touch during the tick, a range over the broadphase's candidate list
+struct CandidateRange
+{
+    const BroadphaseProxy* const* m_begin;
+    const BroadphaseProxy* const* m_end;
+    const BroadphaseProxy* const* begin() const { return m_begin; }
+    const BroadphaseProxy* const* end() const { return m_end; }
+};
+
+//Uniform grid rebuilt every fixed tick, its buffers are kept between ticks so it doesn't allocate once warmed up
+class Broadphase
+{
+public:
+    explicit Broadphase(float p_cellSize = 64.f);
+    void clear();
+    //p_entity is the one the queries report, the collider's parent by default
+    void addProxy(Collider* p_collider, const FRect& p_aabb, bool p_isDynamic, Entity* p_entity = nullptr,
+                  Uint8 p_uses = PROXY_ALL_USES);
+    void build();
+    const std::vector<ColliderPair>& getPairs() const { return m_pairs; }
+    CandidateRange getCandidates(int p_proxyId) const;
+    size_t getProxyCount() const { return m_proxies.size(); }
+
+    //Queries only read the built grid, several threads can run them at the same time.
+    //The hits are written in p_hits (at most p_maxHits) and the number of hits is returned.
+    int queryPoint(const Vec2<float>& p_point, Uint32 p_mask, QueryHit* p_hits, int p_maxHits) const;
+    int queryAABB(const FRect& p_rect, Uint32 p_mask, QueryHit* p_hits, int p_maxHits) const;
+    //closest hit between p_start and p_end, p_ignored is skipped (usually the caster's own collider)
+    bool raycast(const Vec2<float>& p_start, const Vec2<float>& p_end, Uint32 p_mask, RaycastHit& p_hit,
+                 const Collider* p_ignored = nullptr) const;
+    //first hit of p_box moved by p_move, tested against the bounds of the other shapes
+    bool sweepBox(const FRect& p_box, const Vec2<float>& p_move, Uint32 p_mask, RaycastHit& p_hit,
+                  const Collider* p_ignored = nullptr) const;
+    size_t getPairTestCount() const { return m_pairTestCount; }
+    static bool layersMatch(const BroadphaseProxy& p_first, const BroadphaseProxy& p_second)
+    {
+        return (p_first.m_layer & p_second.m_mask) != 0 && (p_second.m_layer & p_first.m_mask) != 0;
+    }
+private:
+    struct CellEntry
+    {
+        int m_proxyId;
+        int m_cellX;
+        int m_cellY;
+    };
+
+    int getCellCoordinate(float p_position) const;
+    bool containsPoint(const BroadphaseProxy& p_proxy, const Vec2<float>& p_point) const;
+    bool raycastProxy(const BroadphaseProxy& p_proxy, const Vec2<float>& p_start, const Vec2<float>& p_delta,
+                      float& p_fraction, Vec2<float>& p_normal) const;
+    int getBucket(int p_cellX, int p_cellY) const;
+    void bucketProxies();
+    void generatePairs();
+    void buildCandidates();
+
+    static constexpr int s_bucketNumber = 4096;
+    float m_cellSize;
+    float m_inverseCellSize;
+    std::vector<BroadphaseProxy> m_proxies;
+    std::vector<int> m_bucketStarts;
+    std::vector<CellEntry> m_cellEntries;
+    std::vector<ColliderPair> m_pairs;
+    std::vector<int> m_candidateStarts;
+    std::vector<const BroadphaseProxy*> m_candidates;
+    std::vector<int> m_fillPositions;
+    std::vector<Vec2<float>> m_vertices;
+    std::vector<Vec2<float>> m_normals;
+    size_t m_pairTestCount = 0;
+};
@@ -1,7 +1,15 @@
 ﻿#include "Collider.h"
+#include <algorithm>
+#include <cmath>
 #include "Entity.h"
+#include "Narrowphase.h"
 
-BoxCollider::BoxCollider(Entity* p_parent, const FRect& p_rect) : Collider(p_parent, p_rect)
+BoxCollider::BoxCollider(Entity* p_parent, const FRect& p_rect) : BoxCollider(p_parent, p_rect, ORIENTED_BOX)
+{
+}
+
+BoxCollider::BoxCollider(Entity* p_parent, const FRect& p_rect, const ColliderShape_e p_shape) : Collider(p_parent,
+    p_rect, p_shape)
 {
     BoxCollider::updateDeltaPos();
 }
@@ -11,6 +19,7 @@ void BoxCollider::setPosition(const float p_x, const float p_y)
     m_rect.x = p_x;
     m_rect.y = p_y;
     updateDeltaPos();
+    updateBounds();
 }
 
 void BoxCollider::updatePosition()
@@ -18,6 +27,7 @@ void BoxCollider::updatePosition()
     const Vec2<float> parentPos = m_parent->getPosition();
     m_rect.x = parentPos.x + m_parentDeltaPos.x;
     m_rect.y = parentPos.y + m_parentDeltaPos.y;
+    updateBounds();
 }
 
 void BoxCollider::updateDeltaPos()
@@ -31,60 +41,175 @@ void BoxCollider::setDimensions(const float p_width, const float p_height)
 {
     m_rect.w = p_width;
     m_rect.h = p_height;
+    updateBounds();
 }
 
 void BoxCollider::setRotation(const float p_rotationAngle) { m_rotation = p_rotationAngle; }
 
-bool BoxCollider::checkGroundCollision(const Entity* p_otherEntity, const float p_deltaTime)
+bool Collider::checkGroundCollision(const Collider& p_other, const PhysicsScalar p_nextMove) const
 {
-    const FRect& otherColliderRect = p_otherEntity->getCollider()->getColliderRect();
-    const float nextYMove = reinterpret_cast<MoveableEntity*>(m_parent)->getVelocity().y * p_deltaTime;
-    if (m_rect.y + m_rect.h + nextYMove + g_epsilonValue >= otherColliderRect.y &&
-        m_rect.y + m_rect.h - g_epsilonValue <= otherColliderRect.y + otherColliderRect.h &&
-        m_rect.x + m_rect.w - g_epsilonValue > otherColliderRect.x + g_epsilonValue &&
-        m_rect.x + g_epsilonValue < otherColliderRect.x + otherColliderRect.w - g_epsilonValue)
+    if (!isAxisAlignedBox() || !p_other.isAxisAlignedBox())
+    {
+        ContactManifold manifold;
+        if (!Narrowphase::collide(*this, p_other, manifold, {0.f, toFloat(p_nextMove + g_physicsEpsilon)}))
+            return false;
+        //only surfaces under us and not too steep are considered as ground
+        return manifold.m_normal.y > 0.5f;
+    }
+
+    const Rect<PhysicsScalar> aabb = toPhysicsRect(m_collisionShape->m_aabb);
+    const Rect<PhysicsScalar> otherColliderRect = toPhysicsRect(p_other.getAABB());
+    if (aabb.y + aabb.h + p_nextMove + g_physicsEpsilon >= otherColliderRect.y &&
+        aabb.y + aabb.h - g_physicsEpsilon <= otherColliderRect.y + otherColliderRect.h &&
+        aabb.x + aabb.w - g_physicsEpsilon > otherColliderRect.x + g_physicsEpsilon &&
+        aabb.x + g_physicsEpsilon < otherColliderRect.x + otherColliderRect.w - g_physicsEpsilon)
         return true;
     return false;
 }
 
-bool BoxCollider::checkUpperCollisions(const Entity* p_otherEntity, const float p_deltaTime)
+bool Collider::checkUpperCollisions(const Collider& p_other, const PhysicsScalar p_nextMove) const
 {
-    const FRect& otherColliderRect = p_otherEntity->getCollider()->getColliderRect();
-    const float nextYMove = reinterpret_cast<MoveableEntity*>(m_parent)->getVelocity().y * p_deltaTime;
+    const Rect<PhysicsScalar> aabb = toPhysicsRect(m_collisionShape->m_aabb);
+    const Rect<PhysicsScalar> otherColliderRect = toPhysicsRect(p_other.getAABB());
 
     //from down to up
-    if (m_rect.y + nextYMove - g_epsilonValue <= otherColliderRect.y + otherColliderRect.h &&
-        m_rect.y + g_epsilonValue >= otherColliderRect.y &&
-        m_rect.x + m_rect.w - g_epsilonValue > otherColliderRect.x + g_epsilonValue &&
-        m_rect.x + g_epsilonValue < otherColliderRect.x + otherColliderRect.w - g_epsilonValue)
+    if (aabb.y + p_nextMove - g_physicsEpsilon <= otherColliderRect.y + otherColliderRect.h &&
+        aabb.y + g_physicsEpsilon >= otherColliderRect.y &&
+        aabb.x + aabb.w - g_physicsEpsilon > otherColliderRect.x + g_physicsEpsilon &&
+        aabb.x + g_physicsEpsilon < otherColliderRect.x + otherColliderRect.w - g_physicsEpsilon)
         return true;
     return false;
 }
 
-bool BoxCollider::checkLeftCollisions(const Entity* p_otherEntity, const float p_deltaTime)
+bool Collider::checkLeftCollisions(const Collider& p_other, const PhysicsScalar p_nextMove) const
 {
-    const FRect& otherColliderRect = p_otherEntity->getCollider()->getColliderRect();
-    const float nextXMove = reinterpret_cast<MoveableEntity*>(m_parent)->getVelocity().x * p_deltaTime;
+    const Rect<PhysicsScalar> aabb = toPhysicsRect(m_collisionShape->m_aabb);
+    const Rect<PhysicsScalar> otherColliderRect = toPhysicsRect(p_other.getAABB());
 
     //from the right to the left
-    if (m_rect.x + nextXMove - g_epsilonValue <= otherColliderRect.x + otherColliderRect.w &&
-        m_rect.x + g_epsilonValue >= otherColliderRect.x &&
-        m_rect.y + m_rect.h - g_epsilonValue > otherColliderRect.y + g_epsilonValue &&
-        m_rect.y + g_epsilonValue < otherColliderRect.y + otherColliderRect.h - g_epsilonValue)
+    if (aabb.x + p_nextMove - g_physicsEpsilon <= otherColliderRect.x + otherColliderRect.w &&
+        aabb.x + g_physicsEpsilon >= otherColliderRect.x &&
+        aabb.y + aabb.h - g_physicsEpsilon > otherColliderRect.y + g_physicsEpsilon &&
+        aabb.y + g_physicsEpsilon < otherColliderRect.y + otherColliderRect.h - g_physicsEpsilon)
         return true;
     return false;
 }
 
-bool BoxCollider::checkRightCollisions(const Entity* p_otherEntity, const float p_deltaTime)
+bool Collider::checkRightCollisions(const Collider& p_other, const PhysicsScalar p_nextMove) const
 {
-    const FRect& otherColliderRect = p_otherEntity->getCollider()->getColliderRect();
-    const float nextXMove = reinterpret_cast<MoveableEntity*>(m_parent)->getVelocity().x * p_deltaTime;
+    const Rect<PhysicsScalar> aabb = toPhysicsRect(m_collisionShape->m_aabb);
+    const Rect<PhysicsScalar> otherColliderRect = toPhysicsRect(p_other.getAABB());
 
     //From the left to the right
-    if (m_rect.x + m_rect.w + nextXMove + g_epsilonValue >= otherColliderRect.x &&
-        m_rect.x + m_rect.w - g_epsilonValue <= otherColliderRect.x + otherColliderRect.w &&
-        m_rect.y + m_rect.h - g_epsilonValue >= otherColliderRect.y + g_epsilonValue &&
-        m_rect.y + g_epsilonValue <= otherColliderRect.y + otherColliderRect.h - g_epsilonValue)
+    if (aabb.x + aabb.w + p_nextMove + g_physicsEpsilon >= otherColliderRect.x &&
+        aabb.x + aabb.w - g_physicsEpsilon <= otherColliderRect.x + otherColliderRect.w &&
+        aabb.y + aabb.h - g_physicsEpsilon >= otherColliderRect.y + g_physicsEpsilon &&
+        aabb.y + g_physicsEpsilon <= otherColliderRect.y + otherColliderRect.h - g_physicsEpsilon)
         return true;
     return false;
 }
+
+OrientedBoxCollider::OrientedBoxCollider(Entity* p_parent, const FRect& p_rect) : OrientedBoxCollider(p_parent,
+    p_rect, ORIENTED_BOX)
+{
+}
+
+OrientedBoxCollider::OrientedBoxCollider(Entity* p_parent, const FRect& p_rect,
+                                         const ColliderShape_e p_shape) : BoxCollider(p_parent, p_rect, p_shape)
+{
+    OrientedBoxCollider::updateBounds();
+}
+
+void OrientedBoxCollider::setRotation(const float p_rotationAngle)
+{
+    //trigonometry is only done here so the narrowphase never has to
+    if (p_rotationAngle == m_rotation)
+        return;
+    m_rotation = p_rotationAngle;
+    const float radians = m_rotation * g_pi / 180.f;
+    m_cos = std::cos(radians);
+    m_sin = std::sin(radians);
+    if (std::abs(m_sin) < 1e-6f)
+        m_sin = 0.f;
+    updateBounds();
+}
+
+void OrientedBoxCollider::updateBounds()
+{
+    const Vec2<float> center = getCenter();
+    const float halfWidth = m_rect.w / 2.f;
+    const float halfHeight = m_rect.h / 2.f;
+    const float xExtent = std::abs(m_cos) * halfWidth + std::abs(m_sin) * halfHeight;
+    const float yExtent = std::abs(m_sin) * halfWidth + std::abs(m_cos) * halfHeight;
+    m_collisionShape->m_aabb = {center.x - xExtent, center.y - yExtent, 2.f * xExtent, 2.f * yExtent};
+}
+
+CircleCollider::CircleCollider(Entity* p_parent, const FRect& p_rect) : BoxCollider(p_parent, p_rect, CIRCLE)
+{
+    CircleCollider::updateBounds();
+}
+
+void CircleCollider::updateBounds()
+{
+    const Vec2<float> center = getCenter();
+    m_radius = std::min(m_rect.w, m_rect.h) / 2.f;
+    m_collisionShape->m_aabb = {center.x - m_radius, center.y - m_radius, 2.f * m_radius, 2.f * m_radius};
+}
+
+ConvexPolygonCollider::ConvexPolygonCollider(Entity* p_parent, const FRect& p_rect, const Vec2<float>* p_vertices,
+                                             const int p_vertexCount) : OrientedBoxCollider(p_parent, p_rect,
+                                                                            CONVEX_POLYGON),
+                                                                        m_vertexCount(std::min(p_vertexCount,
+                                                                            g_maxPolygonVertices))
+{
+    for (int i = 0; i < m_vertexCount; ++i)
+        m_localVertices[i] = p_vertices[i];
+    for (int i = 0; i < m_vertexCount; ++i)
+    {
+        const Vec2<float> edge = m_localVertices[(i + 1) % m_vertexCount] - m_localVertices[i];
+        const float length = std::sqrt(edge.x * edge.x + edge.y * edge.y);
+        m_localNormals[i] = length > 0.f ? Vec2<float>{edge.y / length, -edge.x / length} : Vec2<float>{0.f, 0.f};
+    }
+    ConvexPolygonCollider::updateBounds();
+}
+
+ConvexPolygonCollider* ConvexPolygonCollider::createSlope(Entity* p_parent, const FRect& p_rect,
+                                                          const bool p_risingToTheRight)
+{
+    const float halfWidth = p_rect.w / 2.f;
+    const float halfHeight = p_rect.h / 2.f;
+    if (p_risingToTheRight)
+    {
+        const Vec2<float> vertices[3] = {{halfWidth, -halfHeight}, {halfWidth, halfHeight}, {-halfWidth, halfHeight}};
+        return new ConvexPolygonCollider(p_parent, p_rect, vertices, 3);
+    }
+    const Vec2<float> vertices[3] = {{-halfWidth, -halfHeight}, {halfWidth, halfHeight}, {-halfWidth, halfHeight}};
+    return new ConvexPolygonCollider(p_parent, p_rect, vertices, 3);
+}
+
+void ConvexPolygonCollider::updateBounds()
+{
+    if (m_vertexCount == 0)
+    {
+        OrientedBoxCollider::updateBounds();
+        return;
+    }
+    const Vec2<float> center = getCenter();
+    for (int i = 0; i < m_vertexCount; ++i)
+    {
+        const Vec2<float>& local = m_localVertices[i];
+        const Vec2<float>& localNormal = m_localNormals[i];
+        m_worldVertices[i] = {
+            center.x + m_cos * local.x - m_sin * local.y, center.y + m_sin * local.x + m_cos * local.y
+        };
+        m_worldNormals[i] = {m_cos * localNormal.x - m_sin * localNormal.y, m_sin * localNormal.x + m_cos * localNormal.y};
+    }
+    Vec2<float> min = m_worldVertices[0];
+    Vec2<float> max = m_worldVertices[0];
+    for (int i = 1; i < m_vertexCount; ++i)
+    {
+        min = {std::min(min.x, m_worldVertices[i].x), std::min(min.y, m_worldVertices[i].y)};
+        max = {std::max(max.x, m_worldVertices[i].x), std::max(max.y, m_worldVertices[i].y)};
+    }
+    m_collisionShape->m_aabb = {min.x, min.y, max.x - min.x, max.y - min.y};
+}
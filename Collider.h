@@ -1,15 +1,72 @@
 ﻿#pragma once
+#include "Fixed.h"
 #include "utils.h"
 
 class Entity;
 
+enum ColliderShape_e
+{
+    ORIENTED_BOX,
+    CIRCLE,
+    CONVEX_POLYGON,
+
+    //LEAVE THIS AT THE END FOR AUTOMATIC INCREMENT
+    COLLIDER_SHAPES_NUMBER
+};
+
+//a collider only meets colliders whose layer is in its mask (and the other way around)
+enum CollisionLayer_e : Uint32
+{
+    LAYER_DEFAULT = 1u << 0,
+    LAYER_PLAYER = 1u << 1,
+    LAYER_CRATE = 1u << 2,
+    LAYER_STATIC = 1u << 3,
+    LAYER_PICKUP = 1u << 4,
+    LAYER_TRIGGER = 1u << 5,
+    LAYER_ALL = 0xFFFFFFFFu
+};
+
+constexpr int g_maxPolygonVertices = 8;
+
+struct ContactManifold
+{
+    //from the first collider towards the second one
+    Vec2<float> m_normal = {0.f, 0.f};
+    float m_depth = 0.f;
+    Vec2<float> m_points[2] = {{0.f, 0.f}, {0.f, 0.f}};
+    int m_pointCount = 0;
+};
+
+class Collider;
+
+//What the broadphase and the physics systems read of a collider, a component of the spawned entities.
+//The collider keeps it up to date wherever it is stored, see Collider::bindCollisionShape
+struct CollisionShape
+{
+    //bounds of the collider once rotated
+    FRect m_aabb;
+    Uint32 m_layer;
+    Uint32 m_mask;
+    bool m_isTrigger;
+    //collides without being pushed or pushing out of what it overlaps
+    bool m_isKinematic;
+    //set by the static geometry, the entity only answers the queries and its group's bodies collide instead
+    bool m_isMerged;
+    Collider* m_collider;
+};
+
 class Collider
 {
 public:
-    Collider(Entity* p_parent, const FRect& p_rect) : m_parent(p_parent), m_rect(p_rect)
+    Collider(Entity* p_parent, const FRect& p_rect, const ColliderShape_e p_shape) : m_parent(p_parent),
+        m_rect(p_rect), m_collisionShape(&m_stagedCollisionShape), m_shape(p_shape)
     {
+        m_stagedCollisionShape = {p_rect, LAYER_DEFAULT, LAYER_ALL, false, false, false, this};
     }
     virtual ~Collider() = default;
+    //the shape would point at the copy's own
+    Collider(const Collider&) = delete;
+    Collider& operator=(const Collider&) = delete;
     virtual void setPosition(const float p_x, const float p_y)
     {
     }
@@ -25,19 +82,78 @@ public:
     virtual void setRotation(float p_rotationAngle)
     {
     }
-    virtual bool checkLeftCollisions(const Entity* p_otherEntity, float p_deltaTime) { return {}; }
-    virtual bool checkRightCollisions(const Entity* p_otherEntity, float p_deltaTime) { return {}; }
-    virtual bool checkUpperCollisions(const Entity* p_otherEntity, float p_deltaTime) { return {}; }
-    virtual bool checkGroundCollision(const Entity* p_otherEntity, float p_deltaTime) { return {}; }
+    //shape agnostic, they go through the AABB or the narrowphase table, never through a virtual call.
+    //p_nextMove is this collider's move along the tested axis over the tick.
+    //The AABB tests run on the physics scalar, the narrowphase stays in float.
+    bool checkLeftCollisions(const Collider& p_other, PhysicsScalar p_nextMove) const;
+    bool checkRightCollisions(const Collider& p_other, PhysicsScalar p_nextMove) const;
+    bool checkUpperCollisions(const Collider& p_other, PhysicsScalar p_nextMove) const;
+    bool checkGroundCollision(const Collider& p_other, PhysicsScalar p_nextMove) const;
     FRect& getColliderRect() { return m_rect; }
+    const FRect& getColliderRect() const { return m_rect; }
+    //bounds of the collider once rotated, kept up to date for the broadphase
+    const FRect& getAABB() const { return m_collisionShape->m_aabb; }
+    CollisionShape& getCollisionShape() { return *m_collisionShape; }
+    const CollisionShape& getCollisionShape() const { return *m_collisionShape; }
+    //p_collisionShape is the one in the world's chunks, nullptr goes back to the collider's own copy.
+    //Nothing is copied, the chunks already hold the values when they move
+    void bindCollisionShape(CollisionShape* p_collisionShape)
+    {
+        m_collisionShape = p_collisionShape ? p_collisionShape : &m_stagedCollisionShape;
+    }
+    //p_collisionShape takes this collider's values then is bound to it, it replaces another collider
+    void moveCollisionShapeTo(CollisionShape& p_collisionShape)
+    {
+        p_collisionShape = *m_collisionShape;
+        p_collisionShape.m_collider = this;
+        m_collisionShape = &p_collisionShape;
+    }
+    bool isCollisionShapeBound() const { return m_collisionShape != &m_stagedCollisionShape; }
+    ColliderShape_e getShape() const { return m_shape; }
+    Entity* getParent() const { return m_parent; }
+    float getRotation() const { return m_rotation; }
+    bool isRotated() const { return m_sin != 0.f; }
+    //true when the AABB is the exact shape, the cheap rect tests are then enough
+    bool isAxisAlignedBox() const { return m_shape == ORIENTED_BOX && m_sin == 0.f; }
+    Vec2<float> getCenter() const { return {m_rect.x + m_rect.w / 2.f, m_rect.y + m_rect.h / 2.f}; }
+    Vec2<float> getHalfSize() const { return {m_rect.w / 2.f, m_rect.h / 2.f}; }
+    float getCos() const { return m_cos; }
+    float getSin() const { return m_sin; }
+    Uint32 getLayer() const { return m_collisionShape->m_layer; }
+    void setLayer(const Uint32 p_layer) { m_collisionShape->m_layer = p_layer; }
+    Uint32 getMask() const { return m_collisionShape->m_mask; }
+    void setMask(const Uint32 p_mask) { m_collisionShape->m_mask = p_mask; }
+    void setLayerAndMask(const Uint32 p_layer, const Uint32 p_mask)
+    {
+        m_collisionShape->m_layer = p_layer;
+        m_collisionShape->m_mask = p_mask;
+    }
+    bool canCollideWith(const Collider& p_other) const
+    {
+        return (getLayer() & p_other.getMask()) != 0 && (p_other.getLayer() & getMask()) != 0;
+    }
+    //triggers are never solid, they only report overlaps to the TriggerSystem
+    bool isTrigger() const { return m_collisionShape->m_isTrigger; }
+    void setTrigger(const bool p_isTrigger) { m_collisionShape->m_isTrigger = p_isTrigger; }
+    bool isKinematic() const { return m_collisionShape->m_isKinematic; }
+    void setKinematic(const bool p_isKinematic) { m_collisionShape->m_isKinematic = p_isKinematic; }
+    //index in the broadphase built during the last fixed tick, -1 until then
+    int getProxyId() const { return m_proxyId; }
+    void setProxyId(const int p_proxyId) { m_proxyId = p_proxyId; }
 protected:
     Entity* m_parent;
     FRect m_rect = {0, 0, 0, 0};
+    CollisionShape* m_collisionShape;
+    CollisionShape m_stagedCollisionShape;
     Vec2<float> m_parentDeltaPos = {0, 0};
     float m_rotation = 0.f;
-
+    float m_cos = 1.f;
+    float m_sin = 0.f;
+    ColliderShape_e m_shape;
+    int m_proxyId = -1;
 };
 
+//follows its parent with an offset, the shape is the (unrotated) rect
 class BoxCollider : public Collider
 {
 public:
@@ -47,8 +163,48 @@ public:
     void updateDeltaPos() override;
     void setDimensions(float p_width, float p_height) override;
     void setRotation(float p_rotationAngle) override;
-    bool checkLeftCollisions(const Entity* p_otherEntity, float p_deltaTime) override;
-    bool checkRightCollisions(const Entity* p_otherEntity, float p_deltaTime) override;
-    bool checkGroundCollision(const Entity* p_otherEntity, float p_deltaTime) override;
-    bool checkUpperCollisions(const Entity* p_otherEntity, float p_deltaTime) override;
+protected:
+    BoxCollider(Entity* p_parent, const FRect& p_rect, ColliderShape_e p_shape);
+    virtual void updateBounds() { m_collisionShape->m_aabb = m_rect; }
+};
+
+class OrientedBoxCollider : public BoxCollider
+{
+public:
+    OrientedBoxCollider(Entity* p_parent, const FRect& p_rect);
+    void setRotation(float p_rotationAngle) override;
+protected:
+    OrientedBoxCollider(Entity* p_parent, const FRect& p_rect, ColliderShape_e p_shape);
+    void updateBounds() override;
+};
+
+//inscribed in the collider rect
+class CircleCollider : public BoxCollider
+{
+public:
+    CircleCollider(Entity* p_parent, const FRect& p_rect);
+    float getRadius() const { return m_radius; }
+protected:
+    void updateBounds() override;
+private:
+    float m_radius = 0.f;
+};
+
+//vertices are given relative to the collider rect's center, in clockwise order on screen
+class ConvexPolygonCollider : public OrientedBoxCollider
+{
+public:
+    ConvexPolygonCollider(Entity* p_parent, const FRect& p_rect, const Vec2<float>* p_vertices, int p_vertexCount);
+    static ConvexPolygonCollider* createSlope(Entity* p_parent, const FRect& p_rect, bool p_risingToTheRight);
+    int getVertexCount() const { return m_vertexCount; }
+    const Vec2<float>* getWorldVertices() const { return m_worldVertices; }
+    const Vec2<float>* getWorldNormals() const { return m_worldNormals; }
+protected:
+    void updateBounds() override;
+private:
+    int m_vertexCount;
+    Vec2<float> m_localVertices[g_maxPolygonVertices];
+    Vec2<float> m_localNormals[g_maxPolygonVertices];
+    Vec2<float> m_worldVertices[g_maxPolygonVertices];
+    Vec2<float> m_worldNormals[g_maxPolygonVertices];
 };
@@ -0,0 +1,277 @@
+﻿#include "Ecs.h"
+#include <algorithm>
+#include <cassert>
+#include <chrono>
+#include <mutex>
+
+struct ComponentInfo
+{
+    size_t m_size;
+    size_t m_alignment;
+};
+
+static std::mutex s_componentsMutex;
+static std::vector<ComponentInfo> s_components;
+
+int EcsWorld::registerComponent(const size_t p_size, const size_t p_alignment)
+{
+    const std::lock_guard<std::mutex> componentsGuard(s_componentsMutex);
+    assert(s_components.size() < s_maxComponents);
+    s_components.push_back({p_size, p_alignment});
+    return static_cast<int>(s_components.size() - 1);
+}
+
+void EcsWorld::destroy(const EcsEntity p_entity)
+{
+    if (!isAlive(p_entity))
+        return;
+    Record& record = m_records[p_entity.m_index];
+    freeRow(record);
+    record.m_isAlive = false;
+    ++record.m_generation;
+    m_freeIndices.push_back(p_entity.m_index);
+    --m_entityCount;
+    ++m_structureVersion;
+}
+
+size_t EcsWorld::getChunkMemory() const
+{
+    size_t chunkCount = 0;
+    for (const Archetype& archetype : m_archetypes)
+        chunkCount += archetype.m_chunks.size();
+    return chunkCount * s_chunkSize;
+}
+
+void EcsWorld::clear()
+{
+    m_archetypes.clear();
+    m_records.clear();
+    m_freeIndices.clear();
+    m_entityCount = 0;
+    ++m_structureVersion;
+}
+
+Uint32 EcsWorld::findArchetype(const ComponentMask p_mask)
+{
+    for (size_t i = 0; i < m_archetypes.size(); ++i)
+        if (m_archetypes[i].m_mask == p_mask)
+            return static_cast<Uint32>(i);
+
+    Archetype archetype;
+    archetype.m_mask = p_mask;
+    ComponentInfo components[s_maxComponents];
+    size_t rowSize = sizeof(EcsEntity);
+    size_t alignmentPadding = 0;
+    {
+        const std::lock_guard<std::mutex> componentsGuard(s_componentsMutex);
+        for (size_t id = 0; id < s_components.size(); ++id)
+        {
+            components[id] = s_components[id];
+            if (p_mask & 1u << id)
+            {
+                rowSize += components[id].m_size;
+                alignmentPadding += components[id].m_alignment;
+            }
+        }
+    }
+    archetype.m_capacity = static_cast<Uint32>(std::max<size_t>((s_chunkSize - alignmentPadding) / rowSize, 1));
+
+    size_t offset = archetype.m_capacity * sizeof(EcsEntity);
+    for (int id = 0; id < s_maxComponents; ++id)
+    {
+        if ((p_mask & 1u << id) == 0)
+            continue;
+        offset = (offset + components[id].m_alignment - 1) / components[id].m_alignment * components[id].m_alignment;
+        archetype.m_offsets[id] = offset;
+        archetype.m_sizes[id] = components[id].m_size;
+        offset += archetype.m_capacity * components[id].m_size;
+    }
+    m_archetypes.push_back(std::move(archetype));
+    return static_cast<Uint32>(m_archetypes.size() - 1);
+}
+
+EcsEntity EcsWorld::createEntity(const ComponentMask p_mask)
+{
+    EcsEntity entity;
+    if (!m_freeIndices.empty())
+    {
+        entity.m_index = m_freeIndices.back();
+        m_freeIndices.pop_back();
+    }
+    else
+    {
+        entity.m_index = static_cast<Uint32>(m_records.size());
+        m_records.emplace_back();
+    }
+    Record& record = m_records[entity.m_index];
+    entity.m_generation = record.m_generation;
+    record.m_isAlive = true;
+    allocateRow(findArchetype(p_mask), entity);
+    ++m_entityCount;
+    ++m_structureVersion;
+    return entity;
+}
+
+void EcsWorld::allocateRow(const Uint32 p_archetype, const EcsEntity p_entity)
+{
+    Archetype& archetype = m_archetypes[p_archetype];
+    if (archetype.m_chunks.empty() || archetype.m_chunks.back()->m_count == archetype.m_capacity)
+    {
+        std::unique_ptr<Chunk> chunk(new Chunk);
+        chunk->m_data.reset(new Uint8[s_chunkSize]);
+        archetype.m_chunks.push_back(std::move(chunk));
+    }
+    Chunk& chunk = *archetype.m_chunks.back();
+    Record& record = m_records[p_entity.m_index];
+    record.m_archetype = p_archetype;
+    record.m_chunk = static_cast<Uint32>(archetype.m_chunks.size() - 1);
+    record.m_row = chunk.m_count++;
+    reinterpret_cast<EcsEntity*>(chunk.m_data.get())[record.m_row] = p_entity;
+    ++archetype.m_entityCount;
+}
+
+void EcsWorld::freeRow(const Record& p_record)
+{
+    Archetype& archetype = m_archetypes[p_record.m_archetype];
+    Chunk& lastChunk = *archetype.m_chunks.back();
+    const Uint32 lastRow = lastChunk.m_count - 1;
+    Chunk& chunk = *archetype.m_chunks[p_record.m_chunk];
+    if (&chunk != &lastChunk || p_record.m_row != lastRow)
+    {
+        EcsEntity* entities = reinterpret_cast<EcsEntity*>(chunk.m_data.get());
+        const EcsEntity movedEntity = reinterpret_cast<EcsEntity*>(lastChunk.m_data.get())[lastRow];
+        entities[p_record.m_row] = movedEntity;
+        for (int id = 0; id < s_maxComponents; ++id)
+        {
+            if ((archetype.m_mask & 1u << id) == 0)
+                continue;
+            const size_t size = archetype.m_sizes[id];
+            std::memcpy(chunk.m_data.get() + archetype.m_offsets[id] + p_record.m_row * size,
+                lastChunk.m_data.get() + archetype.m_offsets[id] + lastRow * size, size);
+        }
+        Record& movedRecord = m_records[movedEntity.m_index];
+        movedRecord.m_chunk = p_record.m_chunk;
+        movedRecord.m_row = p_record.m_row;
+    }
+    //the first chunk is kept for the next entities
+    if (--lastChunk.m_count == 0 && archetype.m_chunks.size() > 1)
+        archetype.m_chunks.pop_back();
+    --archetype.m_entityCount;
+}
+
+void EcsWorld::changeArchetype(const EcsEntity p_entity, const ComponentMask p_mask)
+{
+    const Uint32 archetypeIndex = findArchetype(p_mask);
+    const Record previousRecord = m_records[p_entity.m_index];
+    allocateRow(archetypeIndex, p_entity);
+
+    //the components both archetypes have are copied over
+    const Archetype& previousArchetype = m_archetypes[previousRecord.m_archetype];
+    const Archetype& archetype = m_archetypes[archetypeIndex];
+    const Record& record = m_records[p_entity.m_index];
+    const Uint8* previousData = previousArchetype.m_chunks[previousRecord.m_chunk]->m_data.get();
+    Uint8* data = archetype.m_chunks[record.m_chunk]->m_data.get();
+    for (int id = 0; id < s_maxComponents; ++id)
+    {
+        if ((previousArchetype.m_mask & archetype.m_mask & 1u << id) == 0)
+            continue;
+        const size_t size = archetype.m_sizes[id];
+        std::memcpy(data + archetype.m_offsets[id] + record.m_row * size,
+            previousData + previousArchetype.m_offsets[id] + previousRecord.m_row * size, size);
+    }
+    freeRow(previousRecord);
+    ++m_structureVersion;
+}
+
+void EcsWorld::addComponent(const EcsEntity p_entity, const int p_id, const void* p_component, const size_t p_size)
+{
+    if (!isAlive(p_entity))
+        return;
+    const ComponentMask mask = getMask(p_entity);
+    if ((mask & 1u << p_id) == 0)
+        changeArchetype(p_entity, mask | 1u << p_id);
+    std::memcpy(getComponent(p_entity, p_id), p_component, p_size);
+}
+
+void EcsWorld::removeComponent(const EcsEntity p_entity, const int p_id)
+{
+    const ComponentMask mask = getMask(p_entity);
+    //an entity keeps at least one component
+    if ((mask & 1u << p_id) != 0 && (mask & ~(1u << p_id)) != 0)
+        changeArchetype(p_entity, mask & ~(1u << p_id));
+}
+
+void EcsCommandBuffer::record(const EcsCommandType_e p_type, const EcsEntity p_entity, const int p_componentId,
+                              const void* p_component, const size_t p_size)
+{
+    const size_t offset = m_data.size();
+    if (p_size != 0)
+    {
+        m_data.resize(offset + p_size);
+        std::memcpy(m_data.data() + offset, p_component, p_size);
+    }
+    m_commands.push_back({p_type, p_entity, p_componentId, offset, p_size});
+}
+
+void EcsCommandBuffer::playback(EcsWorld& p_world)
+{
+    for (const Command& command : m_commands)
+    {
+        switch (command.m_type)
+        {
+        case ECS_COMMAND_ADD:
+            p_world.addComponent(command.m_entity, command.m_componentId, m_data.data() + command.m_offset,
+                command.m_size);
+            break;
+        case ECS_COMMAND_REMOVE:
+            p_world.removeComponent(command.m_entity, command.m_componentId);
+            break;
+        case ECS_COMMAND_DESTROY:
+            p_world.destroy(command.m_entity);
+            break;
+        default:
+            break;
+        }
+    }
+    clear();
+}
+
+void EcsCommandBuffer::clear()
+{
+    m_commands.clear();
+    m_data.clear();
+}
+
+void EcsScheduler::addSystem(const char* p_name, std::function<size_t(float)> p_system)
+{
+    m_systems.push_back(std::move(p_system));
+    SystemStats stats;
+    stats.m_name = p_name;
+    m_stats.push_back(stats);
+}
+
+void EcsScheduler::run(const float p_deltaTime)
+{
+    for (size_t i = 0; i < m_systems.size(); ++i)
+    {
+        const auto start = std::chrono::steady_clock::now();
+        const size_t entityCount = m_systems[i](p_deltaTime);
+        const double time = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        SystemStats& stats = m_stats[i];
+        stats.m_entityCount = entityCount;
+        stats.m_time = time;
+        stats.m_totalEntityCount += entityCount;
+        stats.m_totalTime += time;
+        ++stats.m_runCount;
+    }
+}
+
+void EcsScheduler::resetStats()
+{
+    for (SystemStats& stats : m_stats)
+    {
+        stats.m_totalEntityCount = 0;
+        stats.m_totalTime = 0.0;
+        stats.m_runCount = 0;
+    }
+}
@@ -0,0 +1,291 @@
+﻿#pragma once
+#include <SDL_stdinc.h>
+#include <cstring>
+#include <functional>
+#include <memory>
+#include <type_traits>
+#include <vector>
+
+//index in the world's records and the generation telling a reused index apart, no entity by default
+struct EcsEntity
+{
+    Uint32 m_index = ~0u;
+    Uint32 m_generation = 0;
+};
+
+typedef Uint32 ComponentMask;
+
+//Archetype storage: the entities with the same set of components share fixed size chunks where every
+//component has its own contiguous array. Queries go through the chunks of every archetype holding a set
+//of components. Components are plain data, they are copied with memcpy when an entity changes archetype.
+class EcsWorld
+{
+public:
+    static constexpr int s_maxComponents = 32;
+    static constexpr size_t s_chunkSize = 16 * 1024;
+
+    EcsWorld() = default;
+    EcsWorld(const EcsWorld&) = delete;
+    EcsWorld& operator=(const EcsWorld&) = delete;
+
+    //ids are given on first use and shared by every world
+    template <typename T>
+    static int getComponentId()
+    {
+        static_assert(std::is_trivially_copyable<T>::value, "components are copied with memcpy");
+        static const int id = registerComponent(sizeof(T), alignof(T));
+        return id;
+    }
+
+    template <typename... Ts>
+    static ComponentMask getMask()
+    {
+        static_assert(sizeof...(Ts) > 0, "an entity has at least one component");
+        ComponentMask mask = 0;
+        const int ids[] = {getComponentId<Ts>()...};
+        for (const int id : ids)
+            mask |= 1u << id;
+        return mask;
+    }
+
+    template <typename... Ts>
+    EcsEntity create(const Ts&... p_components)
+    {
+        const EcsEntity entity = createEntity(getMask<Ts...>());
+        const int ids[] = {getComponentId<Ts>()...};
+        const void* components[] = {&p_components...};
+        const size_t sizes[] = {sizeof(Ts)...};
+        for (size_t i = 0; i < sizeof...(Ts); ++i)
+            std::memcpy(getComponent(entity, ids[i]), components[i], sizes[i]);
+        return entity;
+    }
+
+    void destroy(EcsEntity p_entity);
+    bool isAlive(EcsEntity p_entity) const
+    {
+        return p_entity.m_index < m_records.size() && m_records[p_entity.m_index].m_isAlive &&
+            m_records[p_entity.m_index].m_generation == p_entity.m_generation;
+    }
+
+    ComponentMask getMask(const EcsEntity p_entity) const
+    {
+        return isAlive(p_entity) ? m_archetypes[m_records[p_entity.m_index].m_archetype].m_mask : 0;
+    }
+
+    template <typename T>
+    bool has(const EcsEntity p_entity) const { return (getMask(p_entity) & 1u << getComponentId<T>()) != 0; }
+
+    //nullptr when the entity doesn't have the component
+    template <typename T>
+    T* get(const EcsEntity p_entity)
+    {
+        return has<T>(p_entity) ? static_cast<T*>(getComponent(p_entity, getComponentId<T>())) : nullptr;
+    }
+
+    //the entity moves to the archetype with the added component
+    template <typename T>
+    void add(const EcsEntity p_entity, const T& p_component)
+    {
+        addComponent(p_entity, getComponentId<T>(), &p_component, sizeof(T));
+    }
+
+    template <typename T>
+    void remove(const EcsEntity p_entity) { removeComponent(p_entity, getComponentId<T>()); }
+
+    //p_function(size_t p_count, const EcsEntity* p_entities, Ts* p_components...) once per chunk
+    template <typename... Ts, typename F>
+    void forEachChunk(F&& p_function)
+    {
+        const ComponentMask mask = getMask<Ts...>();
+        for (Archetype& archetype : m_archetypes)
+        {
+            if ((archetype.m_mask & mask) != mask)
+                continue;
+            for (const std::unique_ptr<Chunk>& chunk : archetype.m_chunks)
+                if (chunk->m_count != 0)
+                    p_function(static_cast<size_t>(chunk->m_count),
+                        reinterpret_cast<const EcsEntity*>(chunk->m_data.get()),
+                        reinterpret_cast<Ts*>(chunk->m_data.get() + archetype.m_offsets[getComponentId<Ts>()])...);
+        }
+    }
+
+    template <typename... Ts, typename F>
+    void forEachChunk(F&& p_function) const
+    {
+        const_cast<EcsWorld*>(this)->forEachChunk<Ts...>(
+            [&p_function](const size_t p_count, const EcsEntity* p_entities, Ts*... p_components)
+            {
+                p_function(p_count, p_entities, static_cast<const Ts*>(p_components)...);
+            });
+    }
+
+    //p_function(Ts& p_components...) once per entity
+    template <typename... Ts, typename F>
+    void forEach(F&& p_function)
+    {
+        forEachChunk<Ts...>([&p_function](const size_t p_count, const EcsEntity*, Ts*... p_components)
+        {
+            for (size_t i = 0; i < p_count; ++i)
+                p_function(p_components[i]...);
+        });
+    }
+
+    template <typename... Ts, typename F>
+    void forEach(F&& p_function) const
+    {
+        forEachChunk<Ts...>([&p_function](const size_t p_count, const EcsEntity*, const Ts*... p_components)
+        {
+            for (size_t i = 0; i < p_count; ++i)
+                p_function(p_components[i]...);
+        });
+    }
+
+    template <typename... Ts>
+    size_t count() const
+    {
+        const ComponentMask mask = getMask<Ts...>();
+        size_t entityCount = 0;
+        for (const Archetype& archetype : m_archetypes)
+            if ((archetype.m_mask & mask) == mask)
+                entityCount += archetype.m_entityCount;
+        return entityCount;
+    }
+
+    //goes up whenever an entity is created, destroyed or changes archetype
+    Uint32 getStructureVersion() const { return m_structureVersion; }
+    size_t getEntityCount() const { return m_entityCount; }
+    size_t getArchetypeCount() const { return m_archetypes.size(); }
+    //chunk bytes, allocated or not used yet
+    size_t getChunkMemory() const;
+    void clear();
+private:
+    friend class EcsCommandBuffer;
+
+    struct Chunk
+    {
+        std::unique_ptr<Uint8[]> m_data;
+        Uint32 m_count = 0;
+    };
+
+    struct Archetype
+    {
+        ComponentMask m_mask = 0;
+        //entities per chunk
+        Uint32 m_capacity = 0;
+        //start of each component's array in a chunk, the entities' array is first
+        size_t m_offsets[s_maxComponents] = {};
+        size_t m_sizes[s_maxComponents] = {};
+        size_t m_entityCount = 0;
+        //only the last one may have room left
+        std::vector<std::unique_ptr<Chunk>> m_chunks;
+    };
+
+    struct Record
+    {
+        Uint32 m_generation = 0;
+        Uint32 m_archetype = 0;
+        Uint32 m_chunk = 0;
+        Uint32 m_row = 0;
+        bool m_isAlive = false;
+    };
+
+    static int registerComponent(size_t p_size, size_t p_alignment);
+
+    Uint32 findArchetype(ComponentMask p_mask);
+    EcsEntity createEntity(ComponentMask p_mask);
+    //puts the entity at the end of the archetype
+    void allocateRow(Uint32 p_archetype, EcsEntity p_entity);
+    //the archetype's last entity takes the freed row so the arrays stay packed
+    void freeRow(const Record& p_record);
+    void changeArchetype(EcsEntity p_entity, ComponentMask p_mask);
+    void addComponent(EcsEntity p_entity, int p_id, const void* p_component, size_t p_size);
+    void removeComponent(EcsEntity p_entity, int p_id);
+    void* getComponent(const EcsEntity p_entity, const int p_id)
+    {
+        const Record& record = m_records[p_entity.m_index];
+        const Archetype& archetype = m_archetypes[record.m_archetype];
+        return archetype.m_chunks[record.m_chunk]->m_data.get() + archetype.m_offsets[p_id] +
+            record.m_row * archetype.m_sizes[p_id];
+    }
+
+    std::vector<Archetype> m_archetypes;
+    std::vector<Record> m_records;
+    std::vector<Uint32> m_freeIndices;
+    Uint32 m_structureVersion = 0;
+    size_t m_entityCount = 0;
+};
+
+enum EcsCommandType_e
+{
+    ECS_COMMAND_ADD,
+    ECS_COMMAND_REMOVE,
+    ECS_COMMAND_DESTROY,
+    //LEAVE THIS AT THE END FOR AUTOMATIC INCREMENT
+    ECS_COMMAND_TYPES_NUMBER
+};
+
+//Structural changes recorded while the world may be iterated, played back in one pass at a sync point.
+//The components are copied in when recorded, the commands on an entity destroyed meanwhile are skipped.
+class EcsCommandBuffer
+{
+public:
+    template <typename T>
+    void add(const EcsEntity p_entity, const T& p_component)
+    {
+        record(ECS_COMMAND_ADD, p_entity, EcsWorld::getComponentId<T>(), &p_component, sizeof(T));
+    }
+
+    template <typename T>
+    void remove(const EcsEntity p_entity)
+    {
+        record(ECS_COMMAND_REMOVE, p_entity, EcsWorld::getComponentId<T>(), nullptr, 0);
+    }
+
+    void destroy(const EcsEntity p_entity) { record(ECS_COMMAND_DESTROY, p_entity, -1, nullptr, 0); }
+    //in recording order, the buffer is empty afterwards
+    void playback(EcsWorld& p_world);
+    bool isEmpty() const { return m_commands.empty(); }
+    size_t getCommandCount() const { return m_commands.size(); }
+    void clear();
+private:
+    struct Command
+    {
+        EcsCommandType_e m_type;
+        EcsEntity m_entity;
+        int m_componentId;
+        //of the component's bytes in m_data
+        size_t m_offset;
+        size_t m_size;
+    };
+
+    void record(EcsCommandType_e p_type, EcsEntity p_entity, int p_componentId, const void* p_component,
+                size_t p_size);
+
+    std::vector<Command> m_commands;
+    std::vector<Uint8> m_data;
+};
+
+struct SystemStats
+{
+    const char* m_name;
+    //the times are in milliseconds, the last run's then the sums since the last reset
+    size_t m_entityCount = 0;
+    double m_time = 0.0;
+    Uint64 m_totalEntityCount = 0;
+    double m_totalTime = 0.0;
+    Uint32 m_runCount = 0;
+};
+
+//Runs the systems of a tick in the order they were added and times each of them
+class EcsScheduler
+{
+public:
+    //p_system returns the number of entities it went through
+    void addSystem(const char* p_name, std::function<size_t(float)> p_system);
+    void run(float p_deltaTime);
+    const std::vector<SystemStats>& getStats() const { return m_stats; }
+    void resetStats();
+private:
+    std::vector<std::function<size_t(float)>> m_systems;
+    std::vector<SystemStats> m_stats;
+};
@@ -1,8 +1,32 @@
+#include <cstdlib>
+#include <iostream>
+#include <string>
 #include "SDLHandler.h"
 
 int main(int argc, char* argv[])
 {
     SDLHandler* handler = SDLHandler::getHandlerInstance();
+    //Engine2D --record <path> records the session for HeadlessBenchmark --replay
+    //Engine2D --net <local port> <peer address> <peer port> <player 0 or 1> plays with a second instance
+    //Engine2D --world <path> streams a world written by HeadlessBenchmark --streaming around the player
+    for (int i = 1; i < argc; ++i)
+    {
+        const std::string argument = argv[i];
+        if (argument == "--record" && i + 1 < argc)
+            handler->setRecordingPath(argv[++i]);
+        else if (argument == "--world" && i + 1 < argc)
+            handler->setWorldPath(argv[++i]);
+        else if (argument == "--net" && i + 4 < argc)
+        {
+            if (!handler->openNetworkSession(static_cast<Uint16>(std::atoi(argv[i + 1])), argv[i + 2],
+                static_cast<Uint16>(std::atoi(argv[i + 3])), std::atoi(argv[i + 4])))
+            {
+                std::cerr << "Couldn't open the network session" << std::endl;
+                return 1;
+            }
+            i += 4;
+        }
+    }
     if (!handler->initSDL())
         return 1;
     handler->loop();
@@ -1,5 +1,7 @@
 ﻿#include "Entity.h"
-#include <SDL_image.h>
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
 #include "EntityManager.h"
 
 
@@ -8,93 +10,246 @@ int g_scenePosX = HIERARCHY_WIDTH;
 int g_scenePosY = 0;
 int g_sceneWidth = SCENE_WIDTH;
 int g_sceneHeight = SCENE_HEIGHT;
+//a streamed world larger than the scene keeps its entities inside itself instead, 0 without one
+int g_worldWidth = 0;
+int g_worldHeight = 0;
 
 Entity::Entity(EntityManager* p_entityManager, const Uint16 p_id, SDL_Renderer* p_renderer, const char* p_path,
                const FRect& p_rect) : m_id(p_id), m_name("Entity " + to_string(m_id)), m_renderer(p_renderer),
-                                      m_rect(p_rect), m_entityManager(p_entityManager)
+                                      m_transform(&m_stagedTransform), m_entityManager(p_entityManager)
 {
+    m_stagedTransform = {toPhysicsRect(p_rect), 0.f};
     setTexture(p_path);
-    m_collider = new BoxCollider(this, m_rect);
+    m_collider = new OrientedBoxCollider(this, getEntityRect());
+    m_collider->setLayerAndMask(LAYER_STATIC, LAYER_ALL);
 }
 
 Entity::~Entity()
 {
-    SDL_DestroyTexture(m_texture);
-    m_texture = nullptr;
+    //the texture belongs to the entity manager, other entities may show it
     delete m_collider;
     m_collider = nullptr;
 }
 
-void Entity::setPosition(const float p_x, const float p_y)
+void Entity::setPosition(const float p_x, const float p_y) { setPhysicsPosition(p_x, p_y); }
+
+void Entity::setPhysicsPosition(const PhysicsScalar p_x, const PhysicsScalar p_y)
 {
-    m_rect.x = (p_x + m_rect.w) > g_sceneWidth ? (g_sceneWidth - m_rect.w) : p_x;
-    m_rect.y = (p_y + m_rect.h) > g_sceneHeight ? (g_sceneHeight - m_rect.h) : p_y;
+    const int boundsWidth = std::max(g_sceneWidth, g_worldWidth);
+    const int boundsHeight = std::max(g_sceneHeight, g_worldHeight);
+    Rect<PhysicsScalar>& rect = m_transform->m_rect;
+    rect.x = (p_x + rect.w) > boundsWidth ? (boundsWidth - rect.w) : p_x;
+    rect.y = (p_y + rect.h) > boundsHeight ? (boundsHeight - rect.h) : p_y;
     m_collider->updatePosition();
 }
 
 void Entity::setRotation(const float p_rotationAngle)
 {
-    m_rotationAngle = p_rotationAngle;
+    m_transform->m_rotation = p_rotationAngle;
     m_collider->setRotation(p_rotationAngle);
 }
 
 void Entity::setSize(const float p_w, const float p_h)
 {
     const FRect colliderRect = m_collider->getColliderRect();
-    m_collider->setDimensions(colliderRect.w - m_rect.w + p_w, colliderRect.h - m_rect.h + p_h);
-    m_rect.w = p_w;
-    m_rect.h = p_h;
+    Rect<PhysicsScalar>& rect = m_transform->m_rect;
+    m_collider->setDimensions(colliderRect.w - toFloat(rect.w) + p_w, colliderRect.h - toFloat(rect.h) + p_h);
+    rect.w = p_w;
+    rect.h = p_h;
+}
+
+void Entity::setCollider(Collider* p_collider)
+{
+    if (m_collider)
+    {
+        p_collider->setLayerAndMask(m_collider->getLayer(), m_collider->getMask());
+        p_collider->setKinematic(m_collider->isKinematic());
+        //a spawned entity's shape stays in its chunk
+        if (m_collider->isCollisionShapeBound())
+            p_collider->moveCollisionShapeTo(m_collider->getCollisionShape());
+    }
+    delete m_collider;
+    m_collider = p_collider;
 }
 
 bool Entity::operator==(const Entity& p_entity) const { return this->m_id == p_entity.m_id; }
 
 void Entity::setTexture(const char* p_path)
 {
-    const auto surface = IMG_Load(p_path);
-    m_texture = SDL_CreateTextureFromSurface(m_renderer, surface);
-}
-
-std::string Entity::prepareEntityInfos() const
-{
-    const SDL_Rect entityRect = convertFRect(getEntityRect());
-    const SDL_Rect colliderRect = convertFRect(getCollider()->getColliderRect());
-
-    //no need to recreate these variables at runtime but I don't see them as object's attribute
-    std::string entityInfosString = "Entity's name : " + m_name + "\n"
-        "Entity's ID : " + to_string(m_id) + "\n"
-        "Entity's X position : " + to_string(entityRect.x) + "\n"
-        "Entity's Y position : " + to_string(entityRect.y) + "\n"
-        "Entity's rotation : " + to_string(m_rotationAngle) + "\n"
-        "Entity's X size : " + to_string(entityRect.w) + "\n"
-        "Entity's Y size : " + to_string(entityRect.h) + "\n"
-        "Collider's X position : " + to_string(colliderRect.x) + "\n"
-        "Collider's Y position : " + to_string(colliderRect.y) + "\n"
-        "Collider's X size : " + to_string(colliderRect.w) + "\n"
-        "Collider's Y size : " + to_string(colliderRect.h) + "\n"
-        "Is kinematic : " + to_string(m_isKinematic) + "\n"
-        "Entity's texture : \n";
-    return entityInfosString;
-}
-void Entity::updateBeforeDelete() const
-{
-    const std::vector<Entity*> entities = m_entityManager->getEntities();
-    const std::vector<Entity*> staticEntities = m_entityManager->getStaticEntities();
-    std::vector<Entity*> remainingEntities = {};
-    std::vector<Entity*> remainingStaticEntities = {};
-    for (Entity* currEntity : entities)
-    {
-        if (currEntity == this)
-            continue;
-        remainingEntities.emplace_back(currEntity);
-    }
-    for (Entity* currStaticEntity : staticEntities)
-    {
-        if (currStaticEntity == this)
-            continue;
-        remainingStaticEntities.emplace_back(currStaticEntity);
-    }
-    m_entityManager->setEntities(std::move(remainingEntities));
-    m_entityManager->setStaticEntities(std::move(remainingStaticEntities));
+    //headless entity managers have no renderer
+    if (!m_renderer)
+        return;
+    m_texture = m_entityManager->loadTexture(p_path, m_textureId);
+    m_textureRect = {0.f, 0.f, 1.f, 1.f};
+}
+
+const PropertyTable& Entity::getPropertyTable() const
+{
+    static const EntityProperty properties[] = {
+        {
+            "Entity's name", PROPERTY_TEXT,
+            [](const Entity& p_entity, PropertyValue& p_value) { p_value.m_text = p_entity.m_name; },
+            [](Entity& p_entity, const PropertyValue& p_value) { p_entity.setName(p_value.m_text); }
+        },
+        {
+            "Entity's ID", PROPERTY_INTEGER,
+            [](const Entity& p_entity, PropertyValue& p_value) { p_value.m_integer = p_entity.m_id; }, nullptr
+        },
+        {
+            "Entity's X position", PROPERTY_FLOAT,
+            [](const Entity& p_entity, PropertyValue& p_value) { p_value.m_float = p_entity.getPosition().x; },
+            [](Entity& p_entity, const PropertyValue& p_value)
+            {
+                p_entity.setPosition(p_value.m_float, p_entity.getPosition().y);
+            }
+        },
+        {
+            "Entity's Y position", PROPERTY_FLOAT,
+            [](const Entity& p_entity, PropertyValue& p_value) { p_value.m_float = p_entity.getPosition().y; },
+            [](Entity& p_entity, const PropertyValue& p_value)
+            {
+                p_entity.setPosition(p_entity.getPosition().x, p_value.m_float);
+            }
+        },
+        {
+            "Entity's rotation", PROPERTY_FLOAT,
+            [](const Entity& p_entity, PropertyValue& p_value) { p_value.m_float = p_entity.getRotation(); },
+            [](Entity& p_entity, const PropertyValue& p_value) { p_entity.setRotation(p_value.m_float); }
+        },
+        {
+            "Entity's X size", PROPERTY_FLOAT,
+            [](const Entity& p_entity, PropertyValue& p_value) { p_value.m_float = p_entity.getSize().x; },
+            [](Entity& p_entity, const PropertyValue& p_value) { p_entity.setSize(p_value.m_float, p_entity.getSize().y); }
+        },
+        {
+            "Entity's Y size", PROPERTY_FLOAT,
+            [](const Entity& p_entity, PropertyValue& p_value) { p_value.m_float = p_entity.getSize().y; },
+            [](Entity& p_entity, const PropertyValue& p_value) { p_entity.setSize(p_entity.getSize().x, p_value.m_float); }
+        },
+        {
+            "Collider's X position", PROPERTY_FLOAT,
+            [](const Entity& p_entity, PropertyValue& p_value)
+            {
+                p_value.m_float = p_entity.m_collider->getColliderRect().x;
+            },
+            [](Entity& p_entity, const PropertyValue& p_value)
+            {
+                p_entity.m_collider->setPosition(p_value.m_float, p_entity.m_collider->getColliderRect().y);
+            }
+        },
+        {
+            "Collider's Y position", PROPERTY_FLOAT,
+            [](const Entity& p_entity, PropertyValue& p_value)
+            {
+                p_value.m_float = p_entity.m_collider->getColliderRect().y;
+            },
+            [](Entity& p_entity, const PropertyValue& p_value)
+            {
+                p_entity.m_collider->setPosition(p_entity.m_collider->getColliderRect().x, p_value.m_float);
+            }
+        },
+        {
+            "Collider's X size", PROPERTY_FLOAT,
+            [](const Entity& p_entity, PropertyValue& p_value)
+            {
+                p_value.m_float = p_entity.m_collider->getColliderRect().w;
+            },
+            [](Entity& p_entity, const PropertyValue& p_value)
+            {
+                p_entity.m_collider->setDimensions(p_value.m_float, p_entity.m_collider->getColliderRect().h);
+            }
+        },
+        {
+            "Collider's Y size", PROPERTY_FLOAT,
+            [](const Entity& p_entity, PropertyValue& p_value)
+            {
+                p_value.m_float = p_entity.m_collider->getColliderRect().h;
+            },
+            [](Entity& p_entity, const PropertyValue& p_value)
+            {
+                p_entity.m_collider->setDimensions(p_entity.m_collider->getColliderRect().w, p_value.m_float);
+            }
+        },
+        {
+            "Is kinematic", PROPERTY_BOOLEAN,
+            [](const Entity& p_entity, PropertyValue& p_value) { p_value.m_integer = p_entity.getIsKinematic(); },
+            [](Entity& p_entity, const PropertyValue& p_value) { p_entity.setKinematic(p_value.m_integer != 0); }
+        },
+        {
+            "Collision layer", PROPERTY_BITFIELD,
+            [](const Entity& p_entity, PropertyValue& p_value) { p_value.m_integer = p_entity.m_collider->getLayer(); },
+            [](Entity& p_entity, const PropertyValue& p_value)
+            {
+                p_entity.m_collider->setLayer(static_cast<Uint32>(p_value.m_integer));
+            }
+        },
+        {
+            "Collision mask", PROPERTY_BITFIELD,
+            [](const Entity& p_entity, PropertyValue& p_value) { p_value.m_integer = p_entity.m_collider->getMask(); },
+            [](Entity& p_entity, const PropertyValue& p_value)
+            {
+                p_entity.m_collider->setMask(static_cast<Uint32>(p_value.m_integer));
+            }
+        },
+        {
+            "Is trigger", PROPERTY_BOOLEAN,
+            [](const Entity& p_entity, PropertyValue& p_value) { p_value.m_integer = p_entity.m_collider->isTrigger(); },
+            [](Entity& p_entity, const PropertyValue& p_value) { p_entity.m_collider->setTrigger(p_value.m_integer != 0); }
+        },
+        {
+            //the path isn't kept, only a new one can be given
+            "Entity's texture", PROPERTY_TEXT,
+            [](const Entity&, PropertyValue& p_value) { p_value.m_text.clear(); },
+            [](Entity& p_entity, const PropertyValue& p_value) { p_entity.setTexture(p_value.m_text.c_str()); }
+        },
+        {
+            "Render layer", PROPERTY_INTEGER,
+            [](const Entity& p_entity, PropertyValue& p_value) { p_value.m_integer = p_entity.m_renderLayer; },
+            [](Entity& p_entity, const PropertyValue& p_value)
+            {
+                const Sint64 layer = std::min<Sint64>(std::max<Sint64>(p_value.m_integer, 0),
+                    RENDER_LAYERS_NUMBER - 1);
+                p_entity.setRenderLayer(static_cast<RenderLayer_e>(layer));
+            }
+        },
+        {
+            "Render depth", PROPERTY_INTEGER,
+            [](const Entity& p_entity, PropertyValue& p_value) { p_value.m_integer = p_entity.m_renderDepth; },
+            [](Entity& p_entity, const PropertyValue& p_value)
+            {
+                const Sint64 depth = std::min<Sint64>(std::max<Sint64>(p_value.m_integer, SDL_MIN_SINT16),
+                    SDL_MAX_SINT16);
+                p_entity.setRenderDepth(static_cast<Sint16>(depth));
+            }
+        }
+    };
+    static const PropertyTable table = {properties, SDL_arraysize(properties), nullptr};
+    return table;
+}
+void Entity::updateBeforeDelete() const { m_entityManager->removeEntity(this); }
+
+void Entity::bindComponents(EcsWorld& p_world)
+{
+    Transform* transform = p_world.get<Transform>(m_ecsEntity);
+    m_transform = transform ? transform : &m_stagedTransform;
+    m_collider->bindCollisionShape(p_world.get<CollisionShape>(m_ecsEntity));
+}
+
+void Entity::saveState(EntityState& p_state) const
+{
+    p_state.m_id = m_id;
+    p_state.m_rect = m_transform->m_rect;
+    p_state.m_rotation = m_transform->m_rotation;
+}
+
+void Entity::restoreState(const EntityState& p_state)
+{
+    const Rect<PhysicsScalar>& rect = m_transform->m_rect;
+    if (p_state.m_rect.w != rect.w || p_state.m_rect.h != rect.h)
+        setSize(toFloat(p_state.m_rect.w), toFloat(p_state.m_rect.h));
+    m_transform->m_rect = p_state.m_rect;
+    m_collider->updatePosition();
+    setRotation(p_state.m_rotation);
 }
 
 MoveableEntity::MoveableEntity(EntityManager* p_entityManager, const Uint16 p_id, SDL_Renderer* p_renderer,
@@ -107,16 +262,18 @@ MoveableEntity::MoveableEntity(EntityManager* p_entityManager, const Uint16 p_id
 MoveableEntity::MoveableEntity(EntityManager* p_entityManager, const Uint16 p_id, SDL_Renderer* p_renderer,
                                const char* p_path, const FRect& p_rect, const float p_mass,
                                const float p_viscosity) : Entity(p_entityManager, p_id, p_renderer, p_path, p_rect),
-                                                          m_initialPos({0, 0}), m_mass(p_mass),
-                                                          m_viscosity(p_viscosity)
+                                                          m_body(&m_stagedBody), m_initialPos({0, 0})
 {
+    m_stagedBody = {{0.f, 0.f}, 0.f, p_viscosity, true};
+    setMass(p_mass);
     m_name = "MoveableEntity " + to_string(m_id);
-    m_velocity = {0.f, 0.f};
-    m_initialPos.x = m_rect.x = p_rect.x;
-    m_initialPos.y = m_rect.y = p_rect.y;
+    m_renderLayer = RENDER_LAYER_ACTORS;
+    m_collider->setLayerAndMask(LAYER_CRATE, LAYER_ALL & ~LAYER_PICKUP);
+    m_initialPos.x = m_transform->m_rect.x = p_rect.x;
+    m_initialPos.y = m_transform->m_rect.y = p_rect.y;
 }
 
-MoveableEntity::~MoveableEntity() { Entity::~Entity(); }
+MoveableEntity::~MoveableEntity() = default;
 
 void MoveableEntity::setPosition(const float p_x, const float p_y)
 {
@@ -125,206 +282,189 @@ void MoveableEntity::setPosition(const float p_x, const float p_y)
     Entity::setPosition(p_x, p_y);
 }
 
-void MoveableEntity::setPositionKeepingInitialPos(const float p_x, const float p_y) { Entity::setPosition(p_x, p_y); }
+void MoveableEntity::setMass(const float p_mass)
+{
+    //a NaN typed in the inspector fails the comparison too
+    m_body->m_mass = p_mass > minMass ? PhysicsScalar(p_mass) : PhysicsScalar(minMass);
+}
 
-void MoveableEntity::move(const Axis_e p_axis, const float p_moveSpeed, const float p_deltaTime)
+void MoveableEntity::setPositionKeepingInitialPos(const PhysicsScalar p_x, const PhysicsScalar p_y)
 {
-    float deltaPos = p_deltaTime * p_moveSpeed;
-    const FRect colliderRect = m_collider->getColliderRect();
+    setPhysicsPosition(p_x, p_y);
+}
+
+void MoveableEntity::move(const Axis_e p_axis, const PhysicsScalar p_moveSpeed, const PhysicsScalar p_deltaTime)
+{
+    PhysicsScalar deltaPos = p_deltaTime * p_moveSpeed;
+    const Rect<PhysicsScalar> colliderRect = toPhysicsRect(m_collider->getColliderRect());
 
     if (p_axis == x)
     {
-        if (colliderRect.x + colliderRect.w > g_sceneWidth)
-            deltaPos = g_sceneWidth - colliderRect.w;
-        m_rect.x += deltaPos;
+        const int boundsWidth = std::max(g_sceneWidth, g_worldWidth);
+        if (colliderRect.x + colliderRect.w > boundsWidth)
+            deltaPos = boundsWidth - colliderRect.w;
+        m_transform->m_rect.x += deltaPos;
         return;
     }
-    if (colliderRect.y + colliderRect.h > g_sceneHeight)
-        deltaPos = g_sceneHeight - colliderRect.h;
-    m_rect.y += deltaPos;
+    const int boundsHeight = std::max(g_sceneHeight, g_worldHeight);
+    if (colliderRect.y + colliderRect.h > boundsHeight)
+        deltaPos = boundsHeight - colliderRect.h;
+    m_transform->m_rect.y += deltaPos;
 
     m_collider->updatePosition();
 }
 
-void MoveableEntity::move(const float p_deltaTime)
+void MoveableEntity::move(const PhysicsScalar p_deltaTime)
 {
-    move(x, m_velocity.x, p_deltaTime);
-    move(y, m_velocity.y, p_deltaTime);
+    move(x, m_body->m_velocity.x, p_deltaTime);
+    move(y, m_body->m_velocity.y, p_deltaTime);
 }
 
 void MoveableEntity::rotate(const float p_rotationSpeed, const float p_deltaTime)
 {
     const std::lock_guard<std::mutex> rotateGuard(this->m_entityMutex);
-    m_rotationAngle += p_rotationSpeed * p_deltaTime;
-    m_rotationAngle = fmod(m_rotationAngle, 360.f);
-    m_collider->setRotation(m_rotationAngle);
+    m_transform->m_rotation += p_rotationSpeed * p_deltaTime;
+    m_transform->m_rotation = fmod(m_transform->m_rotation, 360.f);
+    m_collider->setRotation(m_transform->m_rotation);
 }
 
-void MoveableEntity::applyForces(const float& p_deltaTime)
+void MoveableEntity::bindComponents(EcsWorld& p_world)
 {
-    if (m_isKinematic)
-        return;
-
-    Player* player = m_entityManager->getPlayer();
-    Collider* collider = this->getCollider();
-    const std::lock_guard<std::mutex> forceGuard(this->m_entityMutex);
-
-    player->setXCounterSpeed(0.f);
-    for (MoveableEntity* otherEntity : m_entityManager->getMoveableEntities())
-    {
-        if (otherEntity == this || otherEntity == player)
-            continue;
-
-        if (!collider->checkLeftCollisions(otherEntity, p_deltaTime) &&
-            !collider->checkRightCollisions(otherEntity, p_deltaTime) &&
-            !collider->checkUpperCollisions(otherEntity, p_deltaTime))
-            continue;
-
-        const float otherEntityMass = otherEntity->getMass();
-        Vec2<float> otherEntityVelocity = otherEntity->getVelocity();
-        Vec2<float> relativeVelocity = otherEntityVelocity - m_velocity;
-        if (std::abs(relativeVelocity.x) < 0.1f && std::abs(relativeVelocity.y) < 0.1f)
-            continue;
-
-        Vec2<float> impulse = (m_mass * relativeVelocity + otherEntityMass * otherEntityVelocity) /
-            (m_mass + otherEntityMass);
-        if (this == player)
-            player->setXCounterSpeed(impulse.x - 50.f);
-        else
-            applyForceTo(this, impulse);
-
-        applyForceTo(otherEntity, -1.f * impulse);
-        move(p_deltaTime);
-        otherEntity->move(p_deltaTime);
-        applyForceTo(otherEntity, -1.f * otherEntity->m_velocity * otherEntity->m_viscosity);
-    }
+    Entity::bindComponents(p_world);
+    RigidBody* body = p_world.get<RigidBody>(m_ecsEntity);
+    m_body = body ? body : &m_stagedBody;
 }
 
-void MoveableEntity::updateBeforeDelete() const
+void MoveableEntity::saveState(EntityState& p_state) const
 {
-    Entity::updateBeforeDelete();
-    const std::vector<MoveableEntity*> moveableEntities = m_entityManager->getMoveableEntities();
-    std::vector<MoveableEntity*> remainingMoveableEntities = {};
-    for (MoveableEntity* currMoveableEntity : moveableEntities)
-    {
-        if (currMoveableEntity == this)
-            continue;
-        remainingMoveableEntities.emplace_back(currMoveableEntity);
-    }
-    m_entityManager->setMoveableEntities(std::move(remainingMoveableEntities));
+    Entity::saveState(p_state);
+    p_state.m_velocity = m_body->m_velocity;
 }
-void MoveableEntity::applyForceTo(MoveableEntity* p_entity, const Vec2<float> p_velocity)
+
+void MoveableEntity::restoreState(const EntityState& p_state)
 {
-    p_entity->m_velocity.x += p_velocity.x;
-    p_entity->m_velocity.y += p_velocity.y;
+    Entity::restoreState(p_state);
+    m_body->m_velocity = p_state.m_velocity;
 }
 
 void MoveableEntity::resetEntity()
 {
     setPositionKeepingInitialPos(m_initialPos.x, m_initialPos.y);
     m_collider->updatePosition();
-    m_velocity = {0.f, 0.f};
+    m_body->m_velocity = {0.f, 0.f};
     setRotation(0.f);
 }
 
-void MoveableEntity::applyGravity(const float& p_deltaTime)
+const PropertyTable& MoveableEntity::getPropertyTable() const
 {
-    if (m_gravityReactive)
-    {
-        const float gravityDeltaVelocity = gravity * m_viscosity;
-        const auto entities = m_entityManager->getEntities();
-        const float gravityMovementThreshold = m_viscosity * gravity;
-        const auto player = m_entityManager->getPlayer();
-
-        //CHECK COLLISION WITH OTHER ENTITIES
-        for (const auto entity : entities)
+    static const EntityProperty properties[] = {
         {
-            if (entity == this)
-                continue;
-
-            const std::lock_guard<std::mutex> collisionMutex(this->m_entityMutex);
-
-            if (m_isKinematic || entity->getIsKinematic() || !m_collider->checkGroundCollision(entity, p_deltaTime))
-                continue;
-
-            if (this == player)
+            "Entity's X velocity", PROPERTY_FLOAT,
+            [](const Entity& p_entity, PropertyValue& p_value)
+            {
+                p_value.m_float = static_cast<const MoveableEntity&>(p_entity).getVelocity().x;
+            },
+            nullptr
+        },
+        {
+            "Entity's Y velocity", PROPERTY_FLOAT,
+            [](const Entity& p_entity, PropertyValue& p_value)
+            {
+                p_value.m_float = static_cast<const MoveableEntity&>(p_entity).getVelocity().y;
+            },
+            nullptr
+        },
+        {
+            "Entity's mass", PROPERTY_FLOAT,
+            [](const Entity& p_entity, PropertyValue& p_value)
             {
-                m_velocity.y = 0.f;
-                player->setOnGround(true);
-                return;
+                p_value.m_float = static_cast<const MoveableEntity&>(p_entity).getMass();
+            },
+            [](Entity& p_entity, const PropertyValue& p_value)
+            {
+                static_cast<MoveableEntity&>(p_entity).setMass(p_value.m_float);
             }
-
-            if (m_velocity.y > gravityMovementThreshold || m_velocity.y < -gravityMovementThreshold)
+        },
+        {
+            "Entity's viscosity", PROPERTY_FLOAT,
+            [](const Entity& p_entity, PropertyValue& p_value)
             {
-                if (typeid(*entity) == typeid(MoveableEntity))
-                    applyForceTo(reinterpret_cast<MoveableEntity*>(entity), {0.f, m_viscosity * m_mass});
-                m_velocity.y *= -m_viscosity;
+                p_value.m_float = static_cast<const MoveableEntity&>(p_entity).getViscosity();
+            },
+            [](Entity& p_entity, const PropertyValue& p_value)
+            {
+                static_cast<MoveableEntity&>(p_entity).setViscosity(p_value.m_float);
             }
-            else
+        },
+        {
+            "Gravity reactive", PROPERTY_BOOLEAN,
+            [](const Entity& p_entity, PropertyValue& p_value)
             {
-                m_velocity.y = 0.f;
-                return;
+                p_value.m_integer = static_cast<const MoveableEntity&>(p_entity).getGravityReactive();
+            },
+            [](Entity& p_entity, const PropertyValue& p_value)
+            {
+                static_cast<MoveableEntity&>(p_entity).setGravityReactive(p_value.m_integer != 0);
             }
         }
-        const std::lock_guard<std::mutex> collisionMutex(this->m_entityMutex);
-        if (this == player)
-            player->setOnGround(false);
-        m_velocity.y += gravityDeltaVelocity;
-        move(y, m_velocity.y, p_deltaTime);
-        m_collider->updatePosition();
-    }
+    };
+    static const PropertyTable table = {properties, SDL_arraysize(properties), &Entity::getPropertyTable()};
+    return table;
 }
 
-std::string MoveableEntity::prepareEntityInfos() const
+void Player::applyMovements(const float p_deltaTime)
 {
-    std::string moveableEntityInfosString = Entity::prepareEntityInfos() +
-        "Entity's velocity : x : " + to_string(m_velocity.x) + " y : " + to_string(m_velocity.y) + "\n"
-        "Entity's mass : " + to_string(m_mass) + " kg\n"
-        "Entity's viscosity : " + to_string(m_viscosity) + "\n"
-        "Gravity reactive : " + to_string(m_gravityReactive) + "\n"
-        "Is kinematic : " + to_string(m_isKinematic) + "\n";
-    return moveableEntityInfosString;
+    move(x, m_body->m_velocity.x - m_xCounterSpeed, p_deltaTime);
+    m_collider->updatePosition();
 }
 
-Player* Player::m_instance = nullptr;
-
-Player* Player::getPlayerInstance(EntityManager* p_entityManager, const Uint16 p_id,
-                                  SDL_Renderer* p_renderer, const char* p_path, const FRect& p_rect, const float p_mass,
-                                  const float p_viscosity)
+void Player::applyControls(const bool* p_controls)
 {
-    if (m_instance == nullptr)
-    {
-        m_instance = new Player(p_entityManager, p_id, p_renderer, p_path, p_rect, p_mass, p_viscosity);
-        return m_instance;
-    }
-
-    return m_instance;
+    if (p_controls[UP] && m_onGround)
+        m_body->m_velocity.y = -250.f;
+    if (p_controls[RIGHT])
+        m_body->m_velocity.x = 100.f;
+    if (p_controls[LEFT])
+        m_body->m_velocity.x = -100.f;
+    if ((p_controls[LEFT] ^ p_controls[RIGHT]) == false)
+        m_body->m_velocity.x = 0.f;
 }
 
-Player::~Player()
+const PropertyTable& Player::getPropertyTable() const
 {
-    MoveableEntity::~MoveableEntity();
-    m_entityManager->setPlayer(nullptr);
-    m_instance = nullptr;
-    Mix_FreeChunk(m_jumpSoundEffect);
+    static const EntityProperty properties[] = {
+        {
+            "On ground", PROPERTY_BOOLEAN,
+            [](const Entity& p_entity, PropertyValue& p_value)
+            {
+                p_value.m_integer = static_cast<const Player&>(p_entity).getOnGround();
+            },
+            nullptr
+        }
+    };
+    static const PropertyTable table = {properties, SDL_arraysize(properties), &MoveableEntity::getPropertyTable()};
+    return table;
 }
 
-void Player::applyMovements(const float p_deltaTime)
+void Player::resetEntity()
 {
-    move(x, m_velocity.x - m_xCounterSpeed, p_deltaTime);
-    m_collider->updatePosition();
+    MoveableEntity::resetEntity();
+    m_xCounterSpeed = 0;
 }
 
-std::string Player::prepareEntityInfos() const
+void Player::saveState(EntityState& p_state) const
 {
-    return MoveableEntity::prepareEntityInfos() +
-        "On ground : " + to_string(m_onGround) + '\n';
+    MoveableEntity::saveState(p_state);
+    p_state.m_xCounterSpeed = m_xCounterSpeed;
+    if (m_onGround)
+        p_state.m_flags |= STATE_ON_GROUND;
 }
 
-void Player::resetEntity()
+void Player::restoreState(const EntityState& p_state)
 {
-    MoveableEntity::resetEntity();
-    m_xCounterSpeed = 0;
+    MoveableEntity::restoreState(p_state);
+    m_xCounterSpeed = p_state.m_xCounterSpeed;
+    m_onGround = (p_state.m_flags & STATE_ON_GROUND) != 0;
 }
 
 Player::Player(EntityManager* p_entityManager, Uint16 p_id, SDL_Renderer* p_renderer,
@@ -332,62 +472,103 @@ Player::Player(EntityManager* p_entityManager, Uint16 p_id, SDL_Renderer* p_rend
     p_entityManager, p_id, p_renderer, p_path, p_rect, p_mass, p_viscosity), m_xCounterSpeed(0.f)
 {
     m_name = "Player";
-    m_jumpSoundEffect = Mix_LoadWAV("./sounds/jump.mp3");
-}
-
-Collectible::~Collectible()
-{
-    Entity::~Entity();
-    Mix_FreeChunk(m_coinSoundEffect);
+    m_renderLayer = RENDER_LAYER_PLAYERS;
+    m_collider->setLayerAndMask(LAYER_PLAYER, LAYER_ALL);
 }
 
-std::string Collectible::prepareEntityInfos() const
+const PropertyTable& Collectible::getPropertyTable() const
 {
-    const std::vector<Collectible*> collectibles = m_entityManager->getCollectibles();
-    unsigned short int count = 1;
-    for (const Collectible* collectible : collectibles)
-    {
-        if (collectible == this)
-            break;
-        count++;
-    }
-    std::string collectibleInfos = Entity::prepareEntityInfos() +
-        "Collectible N°" + to_string(count) + "/" + to_string(collectibles.size()) + "\n";
-    return collectibleInfos;
+    static const EntityProperty properties[] = {
+        {
+            "Collectible", PROPERTY_TEXT,
+            [](const Entity& p_entity, PropertyValue& p_value)
+            {
+                const std::vector<Collectible*>& collectibles =
+                    static_cast<const Collectible&>(p_entity).m_entityManager->getCollectibles();
+                const size_t index = std::find(collectibles.cbegin(), collectibles.cend(), &p_entity) -
+                    collectibles.cbegin();
+                char buffer[32];
+                std::snprintf(buffer, sizeof(buffer), "%u/%u", static_cast<unsigned int>(index + 1),
+                    static_cast<unsigned int>(collectibles.size()));
+                p_value.m_text = buffer;
+            },
+            nullptr
+        },
+        {
+            "Is collected", PROPERTY_BOOLEAN,
+            [](const Entity& p_entity, PropertyValue& p_value)
+            {
+                p_value.m_integer = static_cast<const Collectible&>(p_entity).m_isCollected;
+            },
+            nullptr
+        }
+    };
+    static const PropertyTable table = {properties, SDL_arraysize(properties), &Entity::getPropertyTable()};
+    return table;
 }
 
-void Collectible::detectCollected(const FRect& p_playerRect)
+void Collectible::collect()
 {
     if (m_isCollected)
         return;
-
-    m_isCollected = (m_rect.x + m_rect.w >= p_playerRect.x &&
-        m_rect.x <= p_playerRect.x + p_playerRect.w &&
-        m_rect.y + m_rect.h >= p_playerRect.y &&
-        m_rect.y <= p_playerRect.y + p_playerRect.h);
-    if (m_isCollected)
-    {
-        Mix_PlayChannel(2, m_coinSoundEffect, 0);
-        m_texture = SDL_CreateTexture(m_renderer, SDL_TEXTUREACCESS_STATIC, 0, 0, 0);
-    }
+    m_isCollected = true;
+    //nothing is drawn without a texture, the one shown comes back on reset, an animation's atlas with its frame
+    m_textureSave = m_texture;
+    m_texture = nullptr;
 }
 
 void Collectible::resetEntity()
 {
-    m_texture = m_textureSave;
+    if (m_isCollected)
+        m_texture = m_textureSave;
     m_isCollected = false;
 }
-void Collectible::updateBeforeDelete() const
+void Collectible::saveState(EntityState& p_state) const
 {
-    Entity::updateBeforeDelete();
+    Entity::saveState(p_state);
+    if (m_isCollected)
+        p_state.m_flags |= STATE_COLLECTED;
+}
 
-    const std::vector<Collectible*> collectibles = m_entityManager->getCollectibles();
-    std::vector<Collectible*> remainingCollectibles = {};
-    for (Collectible* currCollectible : collectibles)
+void Collectible::restoreState(const EntityState& p_state)
+{
+    Entity::restoreState(p_state);
+    m_isCollected = (p_state.m_flags & STATE_COLLECTED) != 0;
+    if (m_isCollected && m_texture)
     {
-        if (currCollectible == this)
-            continue;
-        remainingCollectibles.emplace_back(currCollectible);
+        m_textureSave = m_texture;
+        m_texture = nullptr;
     }
-    m_entityManager->setCollectibles(std::move(remainingCollectibles));
+    else if (!m_isCollected && !m_texture)
+        m_texture = m_textureSave;
+}
+
+TriggerZone::TriggerZone(EntityManager* p_entityManager, const Uint16 p_id, SDL_Renderer* p_renderer,
+                         const char* p_path, const FRect& p_rect, const TriggerAction_e p_action) : Entity(
+    p_entityManager, p_id, p_renderer, p_path, p_rect), m_action(p_action)
+{
+    m_name = (m_action == TRIGGER_FINISH ? "Finish flag " : "Kill zone ") + to_string(m_id);
+    setKinematic(true);
+    m_collider->setLayerAndMask(LAYER_TRIGGER, LAYER_PLAYER);
+    m_collider->setTrigger(true);
+}
+
+const PropertyTable& TriggerZone::getPropertyTable() const
+{
+    static const EntityProperty properties[] = {
+        {
+            "Trigger action", PROPERTY_INTEGER,
+            [](const Entity& p_entity, PropertyValue& p_value)
+            {
+                p_value.m_integer = static_cast<const TriggerZone&>(p_entity).m_action;
+            },
+            [](Entity& p_entity, const PropertyValue& p_value)
+            {
+                if (p_value.m_integer >= 0 && p_value.m_integer < TRIGGER_ACTIONS_NUMBER)
+                    static_cast<TriggerZone&>(p_entity).m_action = static_cast<TriggerAction_e>(p_value.m_integer);
+            }
+        }
+    };
+    static const PropertyTable table = {properties, SDL_arraysize(properties), &Entity::getPropertyTable()};
+    return table;
 }
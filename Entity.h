@@ -3,52 +3,128 @@
 #include <string>
 #include <chrono>
 #include <mutex>
-#include <SDL_mixer.h>
 
 #include "utils.h"
 #include "Collider.h"
+#include "Ecs.h"
+#include "EntityProperties.h"
+#include "Fixed.h"
+#include "WorldSnapshot.h"
 
 using std::to_string;
 class EntityManager;
 
+//Drawn from the first to the last, the sprites of a layer are grouped by texture then by depth
+enum RenderLayer_e
+{
+    RENDER_LAYER_BACKGROUND,
+    RENDER_LAYER_DECOR,
+    RENDER_LAYER_WORLD,
+    RENDER_LAYER_PICKUPS,
+    RENDER_LAYER_ACTORS,
+    RENDER_LAYER_PLAYERS,
+    RENDER_LAYER_FOREGROUND,
+
+    //LEAVE THIS AT THE END FOR AUTOMATIC INCREMENT
+    RENDER_LAYERS_NUMBER
+};
+
+//The hot physics state as components, the spawned entities write theirs in the world's chunks through the
+//pointers set by bindComponents, the other ones keep their own copies
+struct Transform
+{
+    Rect<PhysicsScalar> m_rect;
+    float m_rotation;
+};
+
+struct RigidBody
+{
+    Vec2<PhysicsScalar> m_velocity;
+    PhysicsScalar m_mass;
+    PhysicsScalar m_viscosity;
+    bool m_isGravityReactive;
+};
+
 class Entity
 {
 public:
     Entity(EntityManager* p_entityManager, Uint16 p_id, SDL_Renderer* p_renderer, const char* p_path,
            const FRect& p_rect);
     virtual ~Entity();
+    //the components would point at the copy's own
+    Entity(const Entity&) = delete;
+    Entity& operator=(const Entity&) = delete;
 
     virtual void setPosition(float p_x, float p_y);
-    Vec2<float> getPosition() const { return {m_rect.x, m_rect.y}; }
+    Vec2<float> getPosition() const { return {toFloat(m_transform->m_rect.x), toFloat(m_transform->m_rect.y)}; }
     void setRotation(float p_rotationAngle);
-    float getRotation() const { return m_rotationAngle; }
+    float getRotation() const { return m_transform->m_rotation; }
     void setSize(float p_w, float p_h);
-    Vec2<float> getSize() const { return {m_rect.w, m_rect.h}; }
-    FRect getEntityRect() const { return m_rect; }
+    Vec2<float> getSize() const { return {toFloat(m_transform->m_rect.w), toFloat(m_transform->m_rect.h)}; }
+    FRect getEntityRect() const { return toFRect(m_transform->m_rect); }
+    const Rect<PhysicsScalar>& getPhysicsRect() const { return m_transform->m_rect; }
     bool operator==(const Entity& p_entity) const;
     Collider* getCollider() const { return m_collider; }
+    void setCollider(Collider* p_collider);
     SDL_Texture* getTexture() const { return m_texture; }
-    inline void setTexture(const char* p_path);
+    //index of the texture in the entity manager's loaded textures, the same for every entity showing the image
+    Uint16 getTextureId() const { return m_textureId; }
+    virtual void setTexture(const char* p_path);
+    //the part of the texture shown in texture coordinates, all of it but for an animation's frame
+    const FRect& getTextureRect() const { return m_textureRect; }
+    //shows p_textureRect of an atlas of the entity manager, a negative width mirrors it
+    void setTextureFrame(SDL_Texture* p_atlas, const Uint16 p_atlasId, const FRect& p_textureRect)
+    {
+        m_texture = p_atlas;
+        m_textureId = p_atlasId;
+        m_textureRect = p_textureRect;
+    }
+    RenderLayer_e getRenderLayer() const { return m_renderLayer; }
+    void setRenderLayer(const RenderLayer_e p_renderLayer) { m_renderLayer = p_renderLayer; }
+    //the higher ones are drawn over the other sprites of the layer sharing their texture
+    Sint16 getRenderDepth() const { return m_renderDepth; }
+    void setRenderDepth(const Sint16 p_renderDepth) { m_renderDepth = p_renderDepth; }
     Uint16 getId() const { return m_id; }
-    virtual std::string prepareEntityInfos() const;
-    bool getIsKinematic() const { return m_isKinematic; }
-    void setKinematic(const bool p_kinematic) { m_isKinematic = p_kinematic; }
-    std::string getName() const { return m_name; }
+    //the properties the inspector shows and edits, one static table per type
+    virtual const PropertyTable& getPropertyTable() const;
+    //as named in the entity chooser
+    virtual const char* getTypeName() const { return "Entity"; }
+    bool getIsKinematic() const { return m_collider->isKinematic(); }
+    bool getIsTrigger() const { return m_collider->isTrigger(); }
+    void setKinematic(const bool p_kinematic) { m_collider->setKinematic(p_kinematic); }
+    const std::string& getName() const { return m_name; }
     void setName(const std::string& p_name) { m_name = p_name; }
+    //takes the entity out of the entity manager
     virtual void updateBeforeDelete() const;
+    EcsEntity getEcsEntity() const { return m_ecsEntity; }
+    void setEcsEntity(const EcsEntity p_ecsEntity) { m_ecsEntity = p_ecsEntity; }
+    const Transform& getTransform() const { return *m_transform; }
+    //Points the entity and its collider at their components in p_world, at their own copies when it has none.
+    //Called once spawned and whenever the world may have moved the chunks' rows
+    virtual void bindComponents(EcsWorld& p_world);
+    //what a WorldSnapshot keeps of the entity
+    virtual void saveState(EntityState& p_state) const;
+    virtual void restoreState(const EntityState& p_state);
 protected:
+    //kept inside the scene
+    void setPhysicsPosition(PhysicsScalar p_x, PhysicsScalar p_y);
+
     Uint16 m_id = 0;
     std::string m_name;
+    //its components say what the entity is, see the bundles in EntityManager.h
+    EcsEntity m_ecsEntity;
 
     SDL_Renderer* m_renderer = nullptr;
-    FRect m_rect;
+    Transform* m_transform;
+    Transform m_stagedTransform;
     SDL_Texture* m_texture = nullptr;
+    Uint16 m_textureId = 0;
+    FRect m_textureRect = {0.f, 0.f, 1.f, 1.f};
+    RenderLayer_e m_renderLayer = RENDER_LAYER_WORLD;
+    Sint16 m_renderDepth = 0;
     EntityManager* m_entityManager = nullptr;
 
-    float m_rotationAngle = 0.f;
-    Collider* m_collider;
-    bool m_isKinematic = false;
-    Vec2<float> m_velocity;
+    Collider* m_collider = nullptr;
 };
 
 class MoveableEntity : public Entity
@@ -60,59 +136,63 @@ public:
                    const FRect& p_rect, float p_mass, float p_viscosity);
     ~MoveableEntity() override;
     void setPosition(float p_x, float p_y) override;
-    void setVelocity(const Vec2<float> p_velocity) { m_velocity = p_velocity; }
-    void setPositionKeepingInitialPos(float p_x, float p_y);
-    void move(Axis_e p_axis, float p_moveSpeed, float p_deltaTime);
-    void move(float p_deltaTime);
+    void setVelocity(const Vec2<float> p_velocity) { m_body->m_velocity = toPhysicsVec2(p_velocity); }
+    void setPhysicsVelocity(const Vec2<PhysicsScalar> p_velocity) { m_body->m_velocity = p_velocity; }
+    void setPositionKeepingInitialPos(PhysicsScalar p_x, PhysicsScalar p_y);
+    void move(Axis_e p_axis, PhysicsScalar p_moveSpeed, PhysicsScalar p_deltaTime);
+    void move(PhysicsScalar p_deltaTime);
     void rotate(float p_rotationSpeed, float p_deltaTime);
-    void applyForces(const float& p_deltaTime);
-    void setMass(const float p_mass) { m_mass = p_mass; }
-    float getMass() const { return m_mass; }
-    void setGravityReactive(const bool p_gravityReactive) { m_gravityReactive = p_gravityReactive; }
-    bool getGravityReactive() const { return m_gravityReactive; }
-    Vec2<float> getVelocity() const { return m_velocity; }
+    void setMass(float p_mass);
+    float getMass() const { return toFloat(m_body->m_mass); }
+    void setGravityReactive(const bool p_gravityReactive) { m_body->m_isGravityReactive = p_gravityReactive; }
+    bool getGravityReactive() const { return m_body->m_isGravityReactive; }
+    Vec2<float> getVelocity() const { return toFloatVec2(m_body->m_velocity); }
+    const Vec2<PhysicsScalar>& getPhysicsVelocity() const { return m_body->m_velocity; }
+    const RigidBody& getRigidBody() const { return *m_body; }
+    RigidBody& getRigidBody() { return *m_body; }
     virtual void resetEntity();
-    void applyGravity(const float& p_deltaTime);
-    std::string prepareEntityInfos() const override;
-    void setViscosity(const float p_viscosity) { m_viscosity = p_viscosity; }
-    float getViscosity() const { return m_viscosity; }
+    const PropertyTable& getPropertyTable() const override;
+    const char* getTypeName() const override { return "Moveable entity"; }
+    void setViscosity(const float p_viscosity) { m_body->m_viscosity = p_viscosity; }
+    float getViscosity() const { return toFloat(m_body->m_viscosity); }
     std::mutex& getMutex() { return m_entityMutex; }
-    void updateBeforeDelete() const override;
-protected:
-    static void applyForceTo(MoveableEntity* p_entity, Vec2<float> p_velocity);
-    bool m_gravityReactive = true;
-    Vec2<float> m_initialPos;
+    void bindComponents(EcsWorld& p_world) override;
+    void saveState(EntityState& p_state) const override;
+    void restoreState(const EntityState& p_state) override;
     constexpr static float gravity = 9.81f;
-    float m_mass = 0.f;
-    float m_viscosity = 1.f;
+    //the pushes divide by the sum of two masses, a lighter one is raised to it
+    constexpr static float minMass = 0.01f;
+protected:
+    RigidBody* m_body;
+    RigidBody m_stagedBody;
+    Vec2<PhysicsScalar> m_initialPos;
     std::mutex m_entityMutex;
 };
 
+//The first player is the one the editor controls, the other ones are driven by a NetworkSession
 class Player : public MoveableEntity
 {
 public:
-    static Player* getPlayerInstance(EntityManager* p_entityManager, Uint16 p_id,
-                                     SDL_Renderer* p_renderer, const char* p_path, const FRect& p_rect, float p_mass,
-                                     float p_viscosity);
-    ~Player() override;
+    Player(EntityManager* p_entityManager, Uint16 p_id,
+           SDL_Renderer* p_renderer, const char* p_path, const FRect& p_rect, float p_mass,
+           float p_viscosity);
     void setOnGround(const bool p_onGround) { m_onGround = p_onGround; }
     bool getOnGround() const { return m_onGround; }
-    void setXVelocity(const float p_x) { m_velocity.x = p_x; }
-    void setYVelocity(const float p_y) { m_velocity.y = p_y; }
+    void setXVelocity(const float p_x) { m_body->m_velocity.x = p_x; }
+    void setYVelocity(const float p_y) { m_body->m_velocity.y = p_y; }
     void applyMovements(float p_deltaTime);
-    std::string prepareEntityInfos() const override;
-    void setXCounterSpeed(const float& p_counterSpeed) { m_xCounterSpeed = p_counterSpeed; }
+    //p_controls has CONTROLS_NUMBER values
+    void applyControls(const bool* p_controls);
+    const PropertyTable& getPropertyTable() const override;
+    const char* getTypeName() const override { return "Player"; }
+    void setXCounterSpeed(const PhysicsScalar p_counterSpeed) { m_xCounterSpeed = p_counterSpeed; }
+    PhysicsScalar getXCounterSpeed() const { return m_xCounterSpeed; }
     void resetEntity() override;
-    void playJumpSound() const { Mix_PlayChannel(2, m_jumpSoundEffect, 0); }
-private:
-    Player(EntityManager* p_entityManager, Uint16 p_id,
-           SDL_Renderer* p_renderer, const char* p_path, const FRect& p_rect, float p_mass,
-           float p_viscosity);
+    void saveState(EntityState& p_state) const override;
+    void restoreState(const EntityState& p_state) override;
 private:
-    static Player* m_instance;
     bool m_onGround = false;
-    float m_xCounterSpeed;
-    Mix_Chunk* m_jumpSoundEffect;
+    PhysicsScalar m_xCounterSpeed;
 };
 
 class Collectible : public Entity
@@ -122,18 +202,44 @@ public:
                 const FRect& p_rect) : Entity(p_entityManager, p_id, p_renderer, p_path, p_rect)
     {
         m_name = "Collectible " + to_string(m_id);
-        m_isKinematic = true;
+        setKinematic(true);
+        m_renderLayer = RENDER_LAYER_PICKUPS;
+        setCollider(new CircleCollider(this, getEntityRect()));
+        m_collider->setLayerAndMask(LAYER_PICKUP, LAYER_PLAYER);
+        m_collider->setTrigger(true);
         m_textureSave = m_texture;
-        m_coinSoundEffect = Mix_LoadWAV("./sounds/coin.mp3");
     }
-    ~Collectible() override;
-    std::string prepareEntityInfos() const override;
-    void detectCollected(const FRect& p_playerRect);
+    const PropertyTable& getPropertyTable() const override;
+    const char* getTypeName() const override { return "Collectible"; }
+    void collect();
     bool getIsCollected() const { return m_isCollected; }
     void resetEntity();
-    void updateBeforeDelete() const override;
+    void saveState(EntityState& p_state) const override;
+    void restoreState(const EntityState& p_state) override;
 private:
     bool m_isCollected = false;
     SDL_Texture* m_textureSave;
-    Mix_Chunk* m_coinSoundEffect;
+};
+
+enum TriggerAction_e
+{
+    TRIGGER_FINISH,
+    TRIGGER_KILL,
+
+    //LEAVE THIS AT THE END FOR AUTOMATIC INCREMENT
+    TRIGGER_ACTIONS_NUMBER
+};
+
+//Invisible to the physics, tells the Gameloop what to do when the player walks in
+class TriggerZone : public Entity
+{
+public:
+    TriggerZone(EntityManager* p_entityManager, Uint16 p_id, SDL_Renderer* p_renderer, const char* p_path,
+                const FRect& p_rect, TriggerAction_e p_action);
+    const PropertyTable& getPropertyTable() const override;
+    const char* getTypeName() const override { return m_action == TRIGGER_FINISH ? "Finish flag" : "Kill zone"; }
+    TriggerAction_e getAction() const { return m_action; }
+    void setAction(const TriggerAction_e p_action) { m_action = p_action; }
+private:
+    TriggerAction_e m_action;
 };
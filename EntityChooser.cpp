@@ -3,11 +3,9 @@
 #include <algorithm>
 #include <SDL_image.h>
 
-#include "Hierarchy.h"
-
 EntityChooser::EntityChooser(SDL_Renderer* p_renderer, EntityManager* p_entityManager) : m_renderer(p_renderer),
     m_entityManager(p_entityManager),
-    m_font(TTF_OpenFont(BASE_FONT, static_cast<int>(0.0167f * SCREEN_HEIGHT))), m_inspector(nullptr)
+    m_font(TTF_OpenFont(BASE_FONT, PANEL_FONT_SIZE)), m_inspector(nullptr)
 {
     m_rect = {HIERARCHY_WIDTH, SCENE_HEIGHT, SCENE_WIDTH, SCREEN_HEIGHT - SCENE_HEIGHT};
     SDL_Surface* surface = SDL_CreateRGBSurface(0, m_rect.w, m_rect.h, 32, 0, 0, 0, 0);
@@ -27,6 +25,9 @@ EntityChooser::EntityChooser(SDL_Renderer* p_renderer, EntityManager* p_entityMa
     addChoice(BASE_MOVEABLE_TEXTURE, "Moveable entity", spaceBetween);
     addChoice(BASE_COLLECTIBLE_TEXTURE, "Collectible", spaceBetween);
     addChoice(BASE_PLAYER_TEXTURE, "Player", spaceBetween);
+    addChoice(BASE_FINISH_FLAG_TEXTURE, "Finish flag", spaceBetween);
+    addChoice(BASE_KILL_ZONE_TEXTURE, "Kill zone", spaceBetween);
+    addChoice(BASE_TEXTURE, "Tilemap", spaceBetween);
 
     //AFTER ADDING CHOICES
     unsigned short int count = 0;
@@ -80,20 +81,7 @@ bool EntityChooser::detectChosenEntity(const int p_x, const int p_y) const
     {
         if (detectButtonClicked(p_x, p_y, choice.m_shownTextureRect) || detectButtonClicked(p_x, p_y, choice.m_nameRect))
         {
-            Entity* addedEntity = nullptr;
-            if (choice.m_name == "Entity")
-                addedEntity = m_entityManager->addEntity(BASE_TEXTURE, {SCENE_WIDTH / 2, SCENE_HEIGHT / 2, 50.f, 50.f});
-            else if (choice.m_name == "Moveable entity")
-                addedEntity = m_entityManager->addMoveableEntity(BASE_MOVEABLE_TEXTURE,
-                    {SCENE_WIDTH / 2, SCENE_HEIGHT / 2, 50.f, 50.f}, 10.f);
-            else if (choice.m_name == "Collectible")
-                addedEntity = m_entityManager->addCollectible(BASE_COLLECTIBLE_TEXTURE, {
-                    SCENE_WIDTH / 2, SCENE_HEIGHT / 2, 50.f, 50.f
-                });
-            else if (choice.m_name == "Player")
-                addedEntity = m_entityManager->addPlayer(BASE_PLAYER_TEXTURE,
-                    {SCENE_WIDTH / 2, SCENE_HEIGHT / 2, 30, 70}, 80);
-            m_hierarchy->updateHierarchy();
+            Entity* addedEntity = m_entityManager->addChosenEntity(choice.m_name);
             if (addedEntity)
                 m_inspector->selectEntity(addedEntity);
             return true;
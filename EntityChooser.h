@@ -5,7 +5,7 @@
 
 #include "Entity.h"
 #include "EntityManager.h"
-#include "Hierarchy.h"
+#include "Inspector.h"
 
 struct Choice
 {
@@ -24,7 +24,6 @@ public:
     void displayEntityChooser() const;
     void addChoice(const char* p_path, const std::string& p_entityName, unsigned short int p_spaceBetween);
     bool detectChosenEntity(int p_x, int p_y) const;
-    void setHierarchy(Hierarchy* p_hierarchy) { m_hierarchy = p_hierarchy; }
     void setInspector(Inspector* p_inspector) { m_inspector = p_inspector; }
 private:
     SDL_Renderer* m_renderer;
@@ -36,6 +35,5 @@ private:
     std::vector<Choice> m_choices;
     SDL_Color m_fontColor = {100, 100, 100, 255};
     SDL_Rect m_choiceRect;
-    Hierarchy* m_hierarchy;
     Inspector* m_inspector;
 };
@@ -1,19 +1,128 @@
 ﻿#include "EntityManager.h"
+#include <algorithm>
+#include <iostream>
+#ifndef ENGINE_HEADLESS
+#include <SDL_image.h>
+#endif
 
-#include "Inspector.h"
+#include "Narrowphase.h"
+#include "Profiler.h"
 
-EntityManager::~EntityManager() { deleteEntities(); }
+EntityManager::~EntityManager()
+{
+    deleteEntities();
+    for (const LoadedTexture& loadedTexture : m_loadedTextures)
+        SDL_DestroyTexture(loadedTexture.m_texture);
+}
 
 Entity* EntityManager::addEntity(const char* p_texturePath, const FRect& p_rect)
 {
     auto* entity = new Entity(this, m_nbEntities, m_renderer, p_texturePath, p_rect);
     ++m_nbEntities;
-    m_entities.push_back(entity);
-    m_staticEntities.push_back(entity);
+    spawnEntity(entity, [](EcsWorld& p_world, Entity* p_entity)
+    {
+        return p_world.create(StaticBody{p_entity}, p_entity->getTransform(),
+            p_entity->getCollider()->getCollisionShape());
+    });
 
     return entity;
 }
 
+SDL_Texture* EntityManager::loadTexture(const char* p_path, Uint16& p_textureId)
+{
+    //a scene has a handful of images, the coins and the crates share theirs
+    for (size_t i = 0; i < m_loadedTextures.size(); ++i)
+    {
+        if (m_loadedTextures[i].m_path == p_path)
+        {
+            p_textureId = static_cast<Uint16>(i);
+            return m_loadedTextures[i].m_texture;
+        }
+    }
+    SDL_Surface* surface = decodeImage(p_path);
+    SDL_Texture* texture = SDL_CreateTextureFromSurface(m_renderer, surface);
+    SDL_FreeSurface(surface);
+    p_textureId = static_cast<Uint16>(m_loadedTextures.size());
+    m_loadedTextures.push_back({p_path, texture});
+    return texture;
+}
+
+#ifdef ENGINE_HEADLESS
+SDL_Surface* EntityManager::decodeImage(const char*) { return nullptr; }
+#else
+SDL_Surface* EntityManager::decodeImage(const char* p_path)
+{
+    return IMG_Load(p_path);
+}
+#endif
+
+void EntityManager::addDecodedTexture(const std::string& p_path, SDL_Surface* p_surface)
+{
+    //an entity added meanwhile may have loaded it
+    const bool isLoaded = std::any_of(m_loadedTextures.cbegin(), m_loadedTextures.cend(),
+        [&p_path](const LoadedTexture& p_texture) { return p_texture.m_path == p_path; });
+    if (!isLoaded && m_renderer)
+        m_loadedTextures.push_back({p_path, SDL_CreateTextureFromSurface(m_renderer, p_surface)});
+    SDL_FreeSurface(p_surface);
+}
+
+Uint16 EntityManager::addTexture(const std::string& p_name, SDL_Texture* p_texture)
+{
+    m_loadedTextures.push_back({p_name, p_texture});
+    return static_cast<Uint16>(m_loadedTextures.size() - 1);
+}
+
+size_t EntityManager::updateAnimations(const float p_deltaTime)
+{
+    //outside of a play session the players stand still whatever they did last
+    const bool isInPlaySession = m_isInPlaySession;
+    m_world.forEach<PlayerControl, SpriteAnimation>(
+        [isInPlaySession](const PlayerControl& p_control, SpriteAnimation& p_animation)
+        {
+            const Player* player = p_control.m_player;
+            const Vec2<float> velocity = player->getVelocity();
+            Uint16 clip = CLIP_PLAYER_IDLE;
+            if (isInPlaySession && !player->getOnGround())
+                clip = CLIP_PLAYER_JUMP;
+            else if (isInPlaySession && velocity.x != 0.f)
+                clip = CLIP_PLAYER_RUN;
+            //a new clip starts from its first frame
+            if (clip != p_animation.m_clip)
+            {
+                p_animation.m_clip = clip;
+                p_animation.m_time = 0.f;
+                p_animation.m_frame = AnimationLibrary::s_noFrame;
+            }
+            const bool isMirrored = velocity.x != 0.f ? velocity.x < 0.f : p_animation.m_isMirrored;
+            if (isMirrored != p_animation.m_isMirrored)
+            {
+                p_animation.m_isMirrored = isMirrored;
+                p_animation.m_frame = AnimationLibrary::s_noFrame;
+            }
+        });
+    return m_animations.update(m_world, p_deltaTime);
+}
+
+void EntityManager::spawnEntity(Entity* p_entity, EcsEntity (*p_createBundle)(EcsWorld& p_world, Entity* p_entity))
+{
+    if (m_insertsInBulk)
+    {
+        m_bulkSpawns.push_back({ENTITY_COMMAND_SPAWN, p_entity, p_entity->getId(), p_createBundle});
+        return;
+    }
+    if (m_defersSpawns)
+    {
+        m_entityCommands.push_back({ENTITY_COMMAND_SPAWN, p_entity, p_entity->getId(), p_createBundle});
+        return;
+    }
+    //the fixed update may be running, the network players are added while playing
+    const std::lock_guard<std::mutex> tickGuard(m_tickMutex);
+    m_entities.push_back(p_entity);
+    p_entity->setEcsEntity(p_createBundle(m_world, p_entity));
+    refreshTypeLists();
+    pushEntityListEvent(ENTITY_ADDED, p_entity->getId());
+}
+
 void EntityManager::deleteEntityUpdate(const Entity* p_entity)
 {
     p_entity->updateBeforeDelete();
@@ -25,22 +134,27 @@ MoveableEntity* EntityManager::addMoveableEntity(const char* p_texturePath, cons
 {
     auto* entity = new MoveableEntity(this, m_nbEntities, m_renderer, p_texturePath, p_rect, p_mass);
     ++m_nbEntities;
-    m_entities.push_back(entity);
-    m_moveableEntities.push_back(entity);
+    spawnEntity(entity, [](EcsWorld& p_world, Entity* p_entity)
+    {
+        auto* moveableEntity = static_cast<MoveableEntity*>(p_entity);
+        return p_world.create(MoveableBody{moveableEntity}, moveableEntity->getTransform(),
+            moveableEntity->getCollider()->getCollisionShape(), moveableEntity->getRigidBody());
+    });
 
     return entity;
 }
 
 Player* EntityManager::addPlayer(const char* p_texturePath, const FRect& p_rect, const float p_mass)
 {
-    auto* entity = Player::getPlayerInstance(this, m_nbEntities, m_renderer, p_texturePath, p_rect,
-        p_mass, 0.3f);
-    if (m_player == entity)
-        return entity;
+    auto* entity = new Player(this, m_nbEntities, m_renderer, p_texturePath, p_rect, p_mass, 0.3f);
     ++m_nbEntities;
-    m_entities.push_back(entity);
-    m_moveableEntities.push_back(entity);
-    m_player = entity;
+    spawnEntity(entity, [](EcsWorld& p_world, Entity* p_entity)
+    {
+        auto* player = static_cast<Player*>(p_entity);
+        return p_world.create(MoveableBody{player}, PlayerControl{player},
+            SpriteAnimation{player, 0.f, CLIP_PLAYER_IDLE, AnimationLibrary::s_noFrame, false},
+            player->getTransform(), player->getCollider()->getCollisionShape(), player->getRigidBody());
+    });
     return entity;
 }
 
@@ -49,117 +163,862 @@ Collectible* EntityManager::addCollectible(const char* p_texturePath, const FRec
     auto* collectible = new Collectible(this, m_nbEntities, m_renderer, p_texturePath, p_rect);
     collectible->setKinematic(true);
     ++m_nbEntities;
-    m_entities.push_back(collectible);
-    m_collectibles.push_back(collectible);
+    spawnEntity(collectible, [](EcsWorld& p_world, Entity* p_entity)
+    {
+        return p_world.create(Pickup{static_cast<Collectible*>(p_entity)},
+            SpriteAnimation{p_entity, 0.f, CLIP_COIN_SPIN, AnimationLibrary::s_noFrame, false},
+            p_entity->getTransform(), p_entity->getCollider()->getCollisionShape());
+    });
     return collectible;
 }
 
+Entity* EntityManager::addSlope(const char* p_texturePath, const FRect& p_rect, const bool p_risingToTheRight)
+{
+    Entity* slope = addEntity(p_texturePath, p_rect);
+    slope->setCollider(ConvexPolygonCollider::createSlope(slope, p_rect, p_risingToTheRight));
+    slope->setName("Slope " + to_string(slope->getId()));
+    return slope;
+}
+
+TriggerZone* EntityManager::addTriggerZone(const char* p_texturePath, const FRect& p_rect,
+                                          const TriggerAction_e p_action)
+{
+    auto* triggerZone = new TriggerZone(this, m_nbEntities, m_renderer, p_texturePath, p_rect, p_action);
+    ++m_nbEntities;
+    spawnEntity(triggerZone, [](EcsWorld& p_world, Entity* p_entity)
+    {
+        return p_world.create(StaticBody{p_entity}, TriggerArea{static_cast<TriggerZone*>(p_entity)},
+            p_entity->getTransform(), p_entity->getCollider()->getCollisionShape());
+    });
+    return triggerZone;
+}
+
+Tilemap* EntityManager::addTilemap(const char* p_tilesetPath, const float p_x, const float p_y, const int p_columns,
+                                   const int p_rows, const int p_tileSize)
+{
+    auto* tilemap = new Tilemap(this, m_nbEntities, m_renderer, p_tilesetPath, p_x, p_y, p_columns, p_rows,
+        p_tileSize);
+    ++m_nbEntities;
+    spawnEntity(tilemap, [](EcsWorld& p_world, Entity* p_entity)
+    {
+        return p_world.create(TileLayer{static_cast<Tilemap*>(p_entity)}, p_entity->getTransform());
+    });
+    return tilemap;
+}
+
+void EntityManager::deleteEntity(const Entity* p_entity)
+{
+    if (m_inputRecorder)
+        m_inputRecorder->recordDeleteEntity(m_tick, p_entity->getId());
+    m_entityCommands.push_back({ENTITY_COMMAND_DESTROY, nullptr, p_entity->getId(), nullptr});
+}
+
+Entity* EntityManager::addChosenEntity(const std::string& p_choiceName)
+{
+    if (m_inputRecorder)
+        m_inputRecorder->recordAddEntity(m_tick, p_choiceName);
+    m_defersSpawns = true;
+    Entity* entity = nullptr;
+    if (p_choiceName == "Entity")
+        entity = addEntity(BASE_TEXTURE, {SCENE_WIDTH / 2, SCENE_HEIGHT / 2, 50.f, 50.f});
+    else if (p_choiceName == "Moveable entity")
+        entity = addMoveableEntity(BASE_MOVEABLE_TEXTURE, {SCENE_WIDTH / 2, SCENE_HEIGHT / 2, 50.f, 50.f}, 10.f);
+    else if (p_choiceName == "Collectible")
+        entity = addCollectible(BASE_COLLECTIBLE_TEXTURE, {SCENE_WIDTH / 2, SCENE_HEIGHT / 2, 50.f, 50.f});
+    else if (p_choiceName == "Player")
+        entity = addPlayer(BASE_PLAYER_TEXTURE, {SCENE_WIDTH / 2, SCENE_HEIGHT / 2, 30, 70}, 80);
+    else if (p_choiceName == "Finish flag")
+        entity = addTriggerZone(BASE_FINISH_FLAG_TEXTURE, {SCENE_WIDTH / 2, SCENE_HEIGHT / 2, 30, 40}, TRIGGER_FINISH);
+    else if (p_choiceName == "Kill zone")
+        entity = addTriggerZone(BASE_KILL_ZONE_TEXTURE, {SCENE_WIDTH / 2, SCENE_HEIGHT / 2, 100.f, 20.f}, TRIGGER_KILL);
+    else if (p_choiceName == "Tilemap")
+    {
+        //covers the scene, with a floor to start from
+        constexpr int tileSize = 16;
+        Tilemap* tilemap = addTilemap(BASE_TEXTURE, 0.f, 0.f, SCENE_WIDTH / tileSize, SCENE_HEIGHT / tileSize,
+            tileSize);
+        tilemap->fillTiles(0, tilemap->getRows() - 1, tilemap->getColumns(), 1, 1);
+        entity = tilemap;
+    }
+    m_defersSpawns = false;
+    return entity;
+}
+
+void EntityManager::applyCommands()
+{
+    if (!hasPendingCommands())
+        return;
+    const std::lock_guard<std::mutex> tickGuard(m_tickMutex);
+    bool hasRemovedColliders = false;
+    for (const EntityCommand& command : m_entityCommands)
+    {
+        if (command.m_type == ENTITY_COMMAND_SPAWN)
+        {
+            //an entity added right away in the meantime has a greater id
+            const auto position = std::upper_bound(m_entities.begin(), m_entities.end(), command.m_id,
+                [](const Uint16 p_id, const Entity* p_listedEntity) { return p_id < p_listedEntity->getId(); });
+            m_entities.insert(position, command.m_entity);
+            command.m_entity->setEcsEntity(command.m_createBundle(m_world, command.m_entity));
+            pushEntityListEvent(ENTITY_ADDED, command.m_id);
+        }
+        else if (const Entity* entity = getEntityById(command.m_id))
+        {
+            pushEntityListEvent(ENTITY_REMOVED, command.m_id);
+            deleteEntityUpdate(entity);
+            hasRemovedColliders = true;
+        }
+    }
+    m_entityCommands.clear();
+    m_componentCommands.playback(m_world);
+    //settled here so the fixed update and the render preparation only read the lists
+    refreshTypeLists();
+    for (Tilemap* tilemap : m_tilemaps)
+    {
+        if (!tilemap->hasDirtyChunks())
+            continue;
+        tilemap->rebuildDirtyChunks();
+        hasRemovedColliders = true;
+    }
+    if (refreshStaticGeometry())
+        hasRemovedColliders = true;
+    //the published broadphase still hands out the deleted entities' colliders, or the replaced bodies
+    if (hasRemovedColliders)
+        updateBroadphase(0.f);
+}
+
+void EntityManager::beginBulkInsert()
+{
+    m_insertsInBulk = true;
+    m_bulkInsertNextId = m_nbEntities;
+}
+
+void EntityManager::endBulkInsert()
+{
+    m_insertsInBulk = false;
+    m_nbEntities = m_bulkInsertNextId;
+    if (m_bulkSpawns.empty())
+        return;
+    const std::lock_guard<std::mutex> tickGuard(m_tickMutex);
+    auto isBefore = [](const EntityCommand& p_spawn, const EntityCommand& p_otherSpawn)
+    {
+        return p_spawn.m_id < p_otherSpawn.m_id;
+    };
+    std::sort(m_bulkSpawns.begin(), m_bulkSpawns.end(), isBefore);
+    const size_t listedEntities = m_entities.size();
+    for (const EntityCommand& spawn : m_bulkSpawns)
+    {
+        m_entities.push_back(spawn.m_entity);
+        spawn.m_entity->setEcsEntity(spawn.m_createBundle(m_world, spawn.m_entity));
+        pushEntityListEvent(ENTITY_ADDED, spawn.m_id);
+    }
+    m_bulkSpawns.clear();
+    //the spawned ids fall between the listed ones, both halves are already in id order
+    std::inplace_merge(m_entities.begin(), m_entities.begin() + static_cast<std::ptrdiff_t>(listedEntities),
+        m_entities.end(), [](const Entity* p_entity, const Entity* p_otherEntity)
+        {
+            return p_entity->getId() < p_otherEntity->getId();
+        });
+    refreshTypeLists();
+}
+
+void EntityManager::removeEntities(std::vector<Uint16>& p_ids)
+{
+    if (p_ids.empty())
+        return;
+    std::sort(p_ids.begin(), p_ids.end());
+    const std::lock_guard<std::mutex> tickGuard(m_tickMutex);
+    size_t keptEntities = 0;
+    std::vector<const Entity*> removedEntities;
+    removedEntities.reserve(p_ids.size());
+    for (Entity* entity : m_entities)
+    {
+        if (!std::binary_search(p_ids.begin(), p_ids.end(), entity->getId()))
+        {
+            m_entities[keptEntities++] = entity;
+            continue;
+        }
+        pushEntityListEvent(ENTITY_REMOVED, entity->getId());
+        removedEntities.push_back(entity);
+    }
+    m_entities.resize(keptEntities);
+    //already out of the list, removeEntity only has their components left to destroy
+    for (const Entity* entity : removedEntities)
+        deleteEntityUpdate(entity);
+    refreshTypeLists();
+    //the published broadphase still hands out their colliders
+    updateBroadphase(0.f);
+}
+
+void EntityManager::applyEntityEdit(Entity* p_entity, const std::string& p_infoName, const std::string& p_value)
+{
+    if (m_inputRecorder)
+        m_inputRecorder->recordEdit(m_tick, p_entity->getId(), p_infoName, p_value);
+    const EntityProperty* property = EntityProperties::find(p_entity->getPropertyTable(), p_infoName);
+    if (!property || property->isReadOnly())
+        return;
+    PropertyValue value;
+    if (!EntityProperties::parse(property->m_type, p_value, value))
+    {
+        std::cerr << "User didn't enter a valid value for " << property->m_name << std::endl;
+        return;
+    }
+    property->m_set(*p_entity, value);
+    m_isStaticGeometryDirty = true;
+    if (p_infoName == "Entity's name")
+        pushEntityListEvent(ENTITY_RENAMED, p_entity->getId());
+}
+
+void EntityManager::handleTriggerEvent(const TriggerEvent& p_event, bool& p_playerOnFinish)
+{
+    if (p_event.m_type == TRIGGER_STAY)
+        return;
+    Player* player = getPlayerById(p_event.m_otherId);
+    if (!player)
+        return;
+    Entity* trigger = getEntityById(p_event.m_triggerId);
+    if (!trigger)
+        return;
+
+    if (m_world.has<Pickup>(trigger->getEcsEntity()))
+    {
+        if (p_event.m_type == TRIGGER_ENTER)
+            static_cast<Collectible*>(trigger)->collect();
+    }
+    else if (m_world.has<TriggerArea>(trigger->getEcsEntity()))
+    {
+        switch (static_cast<TriggerZone*>(trigger)->getAction())
+        {
+        case TRIGGER_FINISH:
+            p_playerOnFinish = p_event.m_type == TRIGGER_ENTER;
+            break;
+        case TRIGGER_KILL:
+            if (p_event.m_type == TRIGGER_ENTER)
+                player->resetEntity();
+            break;
+        default:
+            break;
+        }
+    }
+}
+
+Uint64 EntityManager::computeStateHash() const
+{
+    Uint64 hash = 14695981039346656037ull;
+    auto hashBytes = [&hash](const void* p_data, const size_t p_size)
+    {
+        const auto* bytes = static_cast<const Uint8*>(p_data);
+        for (size_t i = 0; i < p_size; ++i)
+        {
+            hash ^= bytes[i];
+            hash *= 1099511628211ull;
+        }
+    };
+    //in the world's order, the same for the simulations that spawned and deleted the same entities
+    m_world.forEachChunk<Transform>([&hashBytes](const size_t p_count, const EcsEntity*, const Transform* p_transforms)
+    {
+        for (size_t i = 0; i < p_count; ++i)
+        {
+            hashBytes(&p_transforms[i].m_rect, sizeof(p_transforms[i].m_rect));
+            hashBytes(&p_transforms[i].m_rotation, sizeof(p_transforms[i].m_rotation));
+        }
+    });
+    m_world.forEachChunk<RigidBody>([&hashBytes](const size_t p_count, const EcsEntity*, const RigidBody* p_bodies)
+    {
+        for (size_t i = 0; i < p_count; ++i)
+            hashBytes(&p_bodies[i].m_velocity, sizeof(p_bodies[i].m_velocity));
+    });
+    for (const Collectible* collectible : getCollectibles())
+    {
+        const bool isCollected = collectible->getIsCollected();
+        hashBytes(&isCollected, sizeof(isCollected));
+    }
+    return hash;
+}
+
+Entity* EntityManager::getEntityById(const Uint16 p_id) const
+{
+    const auto entity = std::lower_bound(m_entities.cbegin(), m_entities.cend(), p_id,
+        [](const Entity* p_entity, const Uint16 p_entityId) { return p_entity->getId() < p_entityId; });
+    return entity != m_entities.cend() && (*entity)->getId() == p_id ? *entity : nullptr;
+}
+
+Player* EntityManager::getPlayerById(const Uint16 p_id) const
+{
+    for (Player* player : getPlayers())
+        if (player->getId() == p_id)
+            return player;
+    return nullptr;
+}
+
+bool EntityManager::hasTriggerZone(const TriggerAction_e p_action) const
+{
+    bool hasTriggerZone = false;
+    m_world.forEachChunk<TriggerArea>([&hasTriggerZone, p_action](const size_t p_count, const EcsEntity*,
+                                                                  const TriggerArea* p_triggerAreas)
+    {
+        for (size_t i = 0; i < p_count && !hasTriggerZone; ++i)
+            hasTriggerZone = p_triggerAreas[i].m_triggerZone->getAction() == p_action;
+    });
+    return hasTriggerZone;
+}
+
 void EntityManager::resetEntities() const
 {
-    for (const auto entity : m_moveableEntities)
+    for (const auto entity : getMoveableEntities())
         entity->resetEntity();
 
-    for (const auto collectible : m_collectibles)
+    for (const auto collectible : getCollectibles())
         collectible->resetEntity();
 }
 
 void EntityManager::deleteEntities()
 {
+    const std::lock_guard<std::mutex> tickGuard(m_tickMutex);
     for (const Entity* entity : m_entities)
     {
         delete entity;
         entity = nullptr;
     }
     m_entities.clear();
+    //the entities spawned by the commands were never in the lists
+    for (const EntityCommand& command : m_entityCommands)
+        delete command.m_entity;
+    m_entityCommands.clear();
+    m_componentCommands.clear();
+    m_world.clear();
+    m_staticGeometry.clear();
+    refreshTypeLists();
+    pushEntityListEvent(ENTITY_LIST_CLEARED, 0);
+}
+void EntityManager::rebuildBroadphase()
+{
+    const std::lock_guard<std::mutex> tickGuard(m_tickMutex);
+    updateBroadphase(0.f);
+}
+
+void EntityManager::updateBroadphase(const float& p_deltaTime)
+{
+    const int backBroadphase = 1 - m_publishedBroadphase;
+    std::unique_lock<std::shared_timed_mutex> lock(m_broadphaseMutexes[backBroadphase]);
+    Broadphase& broadphase = m_broadphases[backBroadphase];
+    broadphase.clear();
+    //the entities added right away, without a sync point, are merged here
+    refreshStaticGeometry();
+    for (const BodyChunk& bodyChunk : m_bodyChunks)
+    {
+        for (size_t row = 0; row < bodyChunk.m_count; ++row)
+        {
+            //fattened by the next move so the ground and side checks still find their candidates
+            const FRect& aabb = bodyChunk.m_shapes[row].m_aabb;
+            const Vec2<float> velocity = toFloatVec2(bodyChunk.m_bodies[row].m_velocity);
+            const float xMargin = std::abs(velocity.x) * p_deltaTime + 2.f * g_epsilonValue;
+            const float yMargin = std::abs(velocity.y) * p_deltaTime + 2.f * g_epsilonValue;
+            broadphase.addProxy(bodyChunk.m_shapes[row].m_collider, {
+                aabb.x - xMargin, aabb.y - yMargin, aabb.w + 2.f * xMargin, aabb.h + 2.f * yMargin
+            }, true);
+        }
+    }
+    m_world.forEachChunk<StaticBody, CollisionShape>([&broadphase](const size_t p_count, const EcsEntity*,
+                                                                   StaticBody*, CollisionShape* p_shapes)
+    {
+        //a merged entity is only there for the queries, its group's bodies collide in its place
+        for (size_t i = 0; i < p_count; ++i)
+            broadphase.addProxy(p_shapes[i].m_collider, p_shapes[i].m_aabb, false, nullptr,
+                p_shapes[i].m_isMerged ? PROXY_QUERIED : PROXY_ALL_USES);
+    });
+    for (Entity* body : m_staticGeometry.getBodies())
+        broadphase.addProxy(body->getCollider(), body->getCollider()->getAABB(), false, nullptr, PROXY_COLLIDES);
+    m_world.forEachChunk<Pickup, CollisionShape>([&broadphase](const size_t p_count, const EcsEntity*, Pickup*,
+                                                               CollisionShape* p_shapes)
+    {
+        for (size_t i = 0; i < p_count; ++i)
+            broadphase.addProxy(p_shapes[i].m_collider, p_shapes[i].m_aabb, false);
+    });
+    //the queries report the tilemap rather than one of its bodies
+    for (Tilemap* tilemap : getTilemaps())
+        for (Entity* body : tilemap->getBodies())
+            broadphase.addProxy(body->getCollider(), body->getCollider()->getAABB(), false, tilemap);
+    broadphase.build();
+    m_pairTestCount = broadphase.getPairTestCount();
+    m_publishedBroadphase = backBroadphase;
+}
+
+int EntityManager::queryPoint(const Vec2<float>& p_point, const Uint32 p_mask, QueryHit* p_hits,
+                              const int p_maxHits) const
+{
+    const int published = m_publishedBroadphase;
+    std::shared_lock<std::shared_timed_mutex> lock(m_broadphaseMutexes[published]);
+    return m_broadphases[published].queryPoint(p_point, p_mask, p_hits, p_maxHits);
+}
+
+int EntityManager::queryAABB(const FRect& p_rect, const Uint32 p_mask, QueryHit* p_hits, const int p_maxHits) const
+{
+    const int published = m_publishedBroadphase;
+    std::shared_lock<std::shared_timed_mutex> lock(m_broadphaseMutexes[published]);
+    return m_broadphases[published].queryAABB(p_rect, p_mask, p_hits, p_maxHits);
+}
+
+bool EntityManager::raycast(const Vec2<float>& p_start, const Vec2<float>& p_end, const Uint32 p_mask,
+                            RaycastHit& p_hit, const Collider* p_ignored) const
+{
+    const int published = m_publishedBroadphase;
+    std::shared_lock<std::shared_timed_mutex> lock(m_broadphaseMutexes[published]);
+    return m_broadphases[published].raycast(p_start, p_end, p_mask, p_hit, p_ignored);
+}
+
+bool EntityManager::sweepBox(const FRect& p_box, const Vec2<float>& p_move, const Uint32 p_mask, RaycastHit& p_hit,
+                             const Collider* p_ignored) const
+{
+    const int published = m_publishedBroadphase;
+    std::shared_lock<std::shared_timed_mutex> lock(m_broadphaseMutexes[published]);
+    return m_broadphases[published].sweepBox(p_box, p_move, p_mask, p_hit, p_ignored);
+}
+
+void EntityManager::stepPhysics(const float& p_deltaTime)
+{
+    PROFILE_SCOPE("FixedTick");
+    const std::lock_guard<std::mutex> tickGuard(m_tickMutex);
+    m_scheduler.run(p_deltaTime);
+    ++m_tick;
+    if (m_snapshotRing)
+    {
+        PROFILE_SCOPE("Snapshot");
+        m_snapshotRing->push(*this);
+    }
+}
+
+void EntityManager::addSystems()
+{
+    m_scheduler.addSystem("Broadphase", [this](const float p_deltaTime)
+    {
+        PROFILE_SCOPE("Broadphase");
+        updateBroadphase(p_deltaTime);
+        return m_moveableEntities.size() + m_staticEntities.size() + m_collectibles.size();
+    });
+    m_scheduler.addSystem("ForcesAndGravity", [this](const float p_deltaTime)
+    {
+        PROFILE_SCOPE("ForcesAndGravity");
+        applyForcesAndGravity(p_deltaTime);
+        return m_moveableEntities.size();
+    });
+    m_scheduler.addSystem("SolveInsiders", [this](const float p_deltaTime)
+    {
+        PROFILE_SCOPE("SolveInsiders");
+        solveInsidersEntities(p_deltaTime);
+        return m_moveableEntities.size();
+    });
+    m_scheduler.addSystem("Triggers", [this](float)
+    {
+        PROFILE_SCOPE("Triggers");
+        updateTriggers(m_tick);
+        return m_world.count<Pickup>() + m_world.count<TriggerArea>();
+    });
+}
+
+void EntityManager::applyForcesAndGravity(const float& p_deltaTime)
+{
+    const PhysicsScalar deltaTime = p_deltaTime;
+    auto applyForceAndGravitySubset = [this, deltaTime](const size_t p_start, const size_t p_end)
+    {
+        if (p_start == p_end)
+            return;
+        //a batch may start in the middle of a chunk and go on in the next ones
+        auto bodyChunk = std::upper_bound(m_bodyChunks.cbegin(), m_bodyChunks.cend(), p_start,
+            [](const size_t p_index, const BodyChunk& p_bodyChunk) { return p_index < p_bodyChunk.m_first; }) - 1;
+        for (size_t i = p_start; i < p_end; ++i)
+        {
+            while (i == bodyChunk->m_first + bodyChunk->m_count)
+                ++bodyChunk;
+            applyForces(*bodyChunk, i - bodyChunk->m_first, deltaTime);
+            applyGravity(*bodyChunk, i - bodyChunk->m_first, deltaTime);
+        }
+    };
+    //fixed point runs stay on this thread, in the world's order, so the entities push each other the same way
+    //every run
+    if (g_deterministicPhysics || !m_jobSystem)
+    {
+        applyForceAndGravitySubset(0, m_bodyCount);
+        return;
+    }
+    //small batches so the idle workers have something to steal when the crowded areas take longer
+    constexpr size_t batchSize = 64;
+    m_jobSystem->parallelFor("ForcesAndGravityBatch", m_bodyCount, batchSize, applyForceAndGravitySubset);
+}
+
+static void applyForceTo(RigidBody& p_body, const Vec2<PhysicsScalar> p_velocity)
+{
+    p_body.m_velocity.x += p_velocity.x;
+    p_body.m_velocity.y += p_velocity.y;
+}
+
+//a worker pushing the other entity holds both, the lower id first: the one handling the same pair from the other
+//side takes them in the same order and can't wait on it
+static void lockPair(MoveableEntity* p_entity, MoveableEntity* p_otherEntity, std::unique_lock<std::mutex>& p_lock,
+                     std::unique_lock<std::mutex>& p_otherLock)
+{
+    if (p_otherEntity->getId() < p_entity->getId())
+        p_otherLock = std::unique_lock<std::mutex>(p_otherEntity->getMutex());
+    p_lock = std::unique_lock<std::mutex>(p_entity->getMutex());
+    if (!p_otherLock.owns_lock())
+        p_otherLock = std::unique_lock<std::mutex>(p_otherEntity->getMutex());
+}
+
+void EntityManager::applyForces(const BodyChunk& p_bodyChunk, const size_t p_row,
+                                const PhysicsScalar p_deltaTime) const
+{
+    PROFILE_SCOPE("Forces");
+    const CollisionShape& shape = p_bodyChunk.m_shapes[p_row];
+    if (shape.m_isKinematic)
+        return;
+
+    //nothing pushes a player, it slows down by a counter speed from what it walks into this tick
+    Player* player = p_bodyChunk.m_controls ? p_bodyChunk.m_controls[p_row].m_player : nullptr;
+    MoveableEntity* entity = p_bodyChunk.m_owners[p_row].m_entity;
+    RigidBody& body = p_bodyChunk.m_bodies[p_row];
+    const Collider* collider = shape.m_collider;
+
+    if (player)
+    {
+        const std::lock_guard<std::mutex> forceGuard(entity->getMutex());
+        player->setXCounterSpeed(0.f);
+    }
+    for (const BroadphaseProxy* candidate : getCollisionCandidates(collider))
+    {
+        if (!candidate->m_isDynamic || candidate->m_isTrigger)
+            continue;
+        const Collider& otherCollider = *candidate->m_collider;
+        auto* otherEntity = static_cast<MoveableEntity*>(otherCollider.getParent());
+        if (otherEntity == entity || m_world.has<PlayerControl>(otherEntity->getEcsEntity()))
+            continue;
+
+        //both bodies change and both entities move
+        std::unique_lock<std::mutex> forceLock;
+        std::unique_lock<std::mutex> otherForceLock;
+        lockPair(entity, otherEntity, forceLock, otherForceLock);
+        if (!collider->checkLeftCollisions(otherCollider, body.m_velocity.x * p_deltaTime) &&
+            !collider->checkRightCollisions(otherCollider, body.m_velocity.x * p_deltaTime) &&
+            !collider->checkUpperCollisions(otherCollider, body.m_velocity.y * p_deltaTime))
+            continue;
+
+        RigidBody& otherBody = otherEntity->getRigidBody();
+        const Vec2<PhysicsScalar> relativeVelocity = otherBody.m_velocity - body.m_velocity;
+        if (scalarAbs(relativeVelocity.x) < 0.1f && scalarAbs(relativeVelocity.y) < 0.1f)
+            continue;
+
+        //mass ratios first, mass times velocity overflows 16.16 fixed points
+        const PhysicsScalar totalMass = body.m_mass + otherBody.m_mass;
+        //setMass keeps them positive, the division stays safe whatever else wrote the bodies
+        if (totalMass <= PhysicsScalar(0))
+            continue;
+        const Vec2<PhysicsScalar> impulse = (body.m_mass / totalMass) * relativeVelocity +
+            (otherBody.m_mass / totalMass) * otherBody.m_velocity;
+        if (player)
+            player->setXCounterSpeed(impulse.x - 50.f);
+        else
+            applyForceTo(body, impulse);
+
+        applyForceTo(otherBody, -1.f * impulse);
+        entity->move(p_deltaTime);
+        otherEntity->move(p_deltaTime);
+        applyForceTo(otherBody, -1.f * otherBody.m_velocity * otherBody.m_viscosity);
+    }
+}
+
+void EntityManager::applyGravity(const BodyChunk& p_bodyChunk, const size_t p_row,
+                                 const PhysicsScalar p_deltaTime) const
+{
+    PROFILE_SCOPE("Gravity");
+    RigidBody& body = p_bodyChunk.m_bodies[p_row];
+    if (!body.m_isGravityReactive)
+        return;
+
+    const PhysicsScalar gravityDeltaVelocity = PhysicsScalar(MoveableEntity::gravity) * body.m_viscosity;
+    const PhysicsScalar gravityMovementThreshold = body.m_viscosity * PhysicsScalar(MoveableEntity::gravity);
+    const CollisionShape& shape = p_bodyChunk.m_shapes[p_row];
+    Player* player = p_bodyChunk.m_controls ? p_bodyChunk.m_controls[p_row].m_player : nullptr;
+    MoveableEntity* entity = p_bodyChunk.m_owners[p_row].m_entity;
+    Collider* collider = shape.m_collider;
+
+    //CHECK COLLISION WITH OTHER ENTITIES
+    for (const BroadphaseProxy* candidate : getCollisionCandidates(collider))
+    {
+        if (candidate->m_isTrigger)
+            continue;
+        const Collider& otherCollider = *candidate->m_collider;
+        Entity* otherEntity = otherCollider.getParent();
+        if (otherEntity == entity)
+            continue;
+
+        //a crate landed on is pushed down, it's locked along
+        std::unique_lock<std::mutex> collisionLock;
+        std::unique_lock<std::mutex> otherCollisionLock;
+        if (candidate->m_isDynamic)
+            lockPair(entity, static_cast<MoveableEntity*>(otherEntity), collisionLock, otherCollisionLock);
+        else
+            collisionLock = std::unique_lock<std::mutex>(entity->getMutex());
+
+        if (shape.m_isKinematic || otherCollider.isKinematic() ||
+            !collider->checkGroundCollision(otherCollider, body.m_velocity.y * p_deltaTime))
+            continue;
+
+        if (player)
+        {
+            body.m_velocity.y = 0.f;
+            player->setOnGround(true);
+            return;
+        }
+
+        if (body.m_velocity.y > gravityMovementThreshold || body.m_velocity.y < -gravityMovementThreshold)
+        {
+            //crates only, players aren't pushed
+            if (candidate->m_isDynamic && !m_world.has<PlayerControl>(otherEntity->getEcsEntity()))
+                applyForceTo(static_cast<MoveableEntity*>(otherEntity)->getRigidBody(),
+                    {0.f, body.m_viscosity * body.m_mass});
+            body.m_velocity.y *= -body.m_viscosity;
+        }
+        else
+        {
+            body.m_velocity.y = 0.f;
+            return;
+        }
+    }
+    const std::lock_guard<std::mutex> collisionMutex(entity->getMutex());
+    if (player)
+        player->setOnGround(false);
+    body.m_velocity.y += gravityDeltaVelocity;
+    entity->move(y, body.m_velocity.y, p_deltaTime);
+    collider->updatePosition();
+}
+
+void EntityManager::refreshTypeLists()
+{
+    m_staticEntities.clear();
     m_moveableEntities.clear();
-    m_player = nullptr;
     m_collectibles.clear();
+    m_players.clear();
+    m_tilemaps.clear();
+    m_world.forEach<StaticBody>([this](const StaticBody& p_body) { m_staticEntities.push_back(p_body.m_entity); });
+    m_world.forEach<MoveableBody>([this](const MoveableBody& p_body) { m_moveableEntities.push_back(p_body.m_entity); });
+    m_world.forEach<Pickup>([this](const Pickup& p_pickup) { m_collectibles.push_back(p_pickup.m_collectible); });
+    m_world.forEach<PlayerControl>([this](const PlayerControl& p_control) { m_players.push_back(p_control.m_player); });
+    m_world.forEach<TileLayer>([this](const TileLayer& p_layer) { m_tilemaps.push_back(p_layer.m_tilemap); });
+
+    //the archetypes and the deletions mix the entities up, the lists are in creation order
+    const auto byId = [](const Entity* p_first, const Entity* p_second) { return p_first->getId() < p_second->getId(); };
+    std::sort(m_staticEntities.begin(), m_staticEntities.end(), byId);
+    std::sort(m_moveableEntities.begin(), m_moveableEntities.end(), byId);
+    std::sort(m_collectibles.begin(), m_collectibles.end(), byId);
+    std::sort(m_players.begin(), m_players.end(), byId);
+    std::sort(m_tilemaps.begin(), m_tilemaps.end(), byId);
+
+    //the rows destroyed or moved to another archetype were filled by other entities
+    for (Entity* entity : m_entities)
+        entity->bindComponents(m_world);
+    m_bodyChunks.clear();
+    m_bodyCount = 0;
+    m_world.forEachChunk<MoveableBody, Transform, RigidBody, CollisionShape>([this](const size_t p_count,
+        const EcsEntity* p_entities, const MoveableBody* p_owners, Transform* p_transforms, RigidBody* p_bodies,
+        CollisionShape* p_shapes)
+    {
+        //the chunk's first entity is on its first row, so are its components
+        m_bodyChunks.push_back({m_bodyCount, p_count, p_owners, p_transforms, p_bodies, p_shapes,
+            m_world.get<PlayerControl>(p_entities[0])});
+        m_bodyCount += p_count;
+    });
+}
+
+bool EntityManager::hasDirtyTilemaps() const
+{
+    const std::vector<Tilemap*>& tilemaps = getTilemaps();
+    return std::any_of(tilemaps.cbegin(), tilemaps.cend(), [](const Tilemap* p_tilemap)
+    {
+        return p_tilemap->hasDirtyChunks();
+    });
+}
+
+bool EntityManager::refreshStaticGeometry()
+{
+    const std::vector<Entity*>& staticEntities = getStaticEntities();
+    if (m_staticGeometryVersion == m_world.getStructureVersion() && !m_isStaticGeometryDirty)
+        return false;
+    m_staticGeometryVersion = m_world.getStructureVersion();
+    m_isStaticGeometryDirty = false;
+    PROFILE_SCOPE("MergeStaticGeometry");
+    const bool hasChangedBodies = m_staticGeometry.update(this, staticEntities);
+    //the broadphase reads the static shapes from the chunks
+    for (size_t i = 0; i < staticEntities.size(); ++i)
+        staticEntities[i]->getCollider()->getCollisionShape().m_isMerged = m_staticGeometry.isMerged(i);
+    return hasChangedBodies;
 }
+
+void EntityManager::removeEntity(const Entity* p_entity)
+{
+    const auto entity = std::lower_bound(m_entities.begin(), m_entities.end(), p_entity->getId(),
+        [](const Entity* p_listedEntity, const Uint16 p_id) { return p_listedEntity->getId() < p_id; });
+    if (entity != m_entities.end() && *entity == p_entity)
+        m_entities.erase(entity);
+    m_world.destroy(p_entity->getEcsEntity());
+}
+
+void EntityManager::beginPlaySession()
+{
+    if (m_isInPlaySession)
+        return;
+    m_isInPlaySession = true;
+    WorldSnapshot::capture(*this, m_editSnapshot);
+    if (m_snapshotRing)
+        m_snapshotRing->clear();
+}
+
+void EntityManager::endPlaySession()
+{
+    if (!m_isInPlaySession)
+        return;
+    m_isInPlaySession = false;
+    if (!WorldSnapshot::apply(*this, m_editSnapshot, false))
+        resetEntities();
+    //the static entities edited while playing are back where they were
+    m_isStaticGeometryDirty = true;
+    clearTriggers();
+    if (m_snapshotRing)
+        m_snapshotRing->clear();
+}
+
+bool EntityManager::restoreTick(const Uint32 p_tick)
+{
+    const Uint32 tick = m_tick;
+    if (!m_snapshotRing || !m_snapshotRing->restore(*this, p_tick))
+        return false;
+    m_isStaticGeometryDirty = true;
+    if (m_inputRecorder)
+        m_inputRecorder->recordRestore(tick, p_tick);
+    return true;
+}
+
 void EntityManager::solveInsidersEntities(const float& p_deltaTime) const
 {
-    for (MoveableEntity* moveableEntity : m_moveableEntities)
+    const PhysicsScalar deltaTime = p_deltaTime;
+    for (const BodyChunk& bodyChunk : m_bodyChunks)
+        for (size_t row = 0; row < bodyChunk.m_count; ++row)
+            solveInsiders(bodyChunk, row, deltaTime);
+}
+
+void EntityManager::solveInsiders(const BodyChunk& p_bodyChunk, const size_t p_row,
+                                  const PhysicsScalar p_deltaTime) const
+{
+    const CollisionShape& shape = p_bodyChunk.m_shapes[p_row];
+    if (shape.m_isKinematic)
+        return;
+
+    MoveableEntity* moveableEntity = p_bodyChunk.m_owners[p_row].m_entity;
+    RigidBody& body = p_bodyChunk.m_bodies[p_row];
+    Collider* moveableEntityCollider = shape.m_collider;
+    const Rect<PhysicsScalar>& moveableEntityRect = p_bodyChunk.m_transforms[p_row].m_rect;
+    const Vec2<PhysicsScalar> moveableEntityPosition = {moveableEntityRect.x, moveableEntityRect.y};
+    std::mutex& moveableEntityMutex = moveableEntity->getMutex();
+
+    for (const BroadphaseProxy* candidate : getCollisionCandidates(moveableEntityCollider))
     {
-        if (moveableEntity->getIsKinematic())
+        if (candidate->m_isTrigger)
+            continue;
+        const Collider* entityCollider = candidate->m_collider;
+        const Entity* entity = entityCollider->getParent();
+        if (moveableEntity == entity || m_world.has<PlayerControl>(entity->getEcsEntity()) ||
+            entityCollider->isKinematic())
             continue;
 
-        Collider* moveableEntityCollider = moveableEntity->getCollider();
-        const FRect& moveableEntityColliderRect = moveableEntityCollider->getColliderRect();
-        const Vec2<float> moveableEntityPosition = moveableEntity->getPosition();
-        std::mutex& moveableEntityMutex = moveableEntity->getMutex();
+        std::lock_guard<std::mutex> insidersLock(moveableEntityMutex);
 
-        for (const Entity* entity : m_entities)
+        //rotated boxes, circles and polygons are pushed out along the contact normal instead of the world axes
+        if (!moveableEntityCollider->isAxisAlignedBox() || !entityCollider->isAxisAlignedBox())
         {
-            if (moveableEntity == entity || entity == m_player || entity->getIsKinematic())
+            ContactManifold manifold;
+            if (!Narrowphase::collide(*moveableEntityCollider, *entityCollider, manifold))
                 continue;
+            const Vec2<float> currentPosition = moveableEntity->getPosition();
+            const Vec2<float> pushOut = manifold.m_normal * (manifold.m_depth + g_epsilonValue);
+            moveableEntity->setPositionKeepingInitialPos(currentPosition.x - pushOut.x,
+                currentPosition.y - pushOut.y);
+            const Vec2<float> velocity = toFloatVec2(body.m_velocity);
+            const float normalVelocity = velocity.x * manifold.m_normal.x + velocity.y * manifold.m_normal.y;
+            if (normalVelocity > 0.f)
+                body.m_velocity = toPhysicsVec2(velocity - manifold.m_normal * (normalVelocity *
+                    (1.f + toFloat(body.m_viscosity))));
+            moveableEntityCollider->updatePosition();
+            continue;
+        }
 
-            Collider* entityCollider = entity->getCollider();
-            const FRect& entityColliderRect = entityCollider->getColliderRect();
-
-            std::lock_guard<std::mutex> insidersLock(moveableEntityMutex);
-
-            const float yOverlap = std::min(entityColliderRect.y + entityColliderRect.h - moveableEntityColliderRect.y,
-                moveableEntityColliderRect.y + moveableEntityColliderRect.h - entityColliderRect.y);
+        //the AABB solve runs on the physics scalar, the pushes above stay in float like the narrowphase
+        const Rect<PhysicsScalar> moveableEntityColliderRect =
+            toPhysicsRect(moveableEntityCollider->getColliderRect());
+        const Rect<PhysicsScalar> entityColliderRect = toPhysicsRect(entityCollider->getColliderRect());
+        const PhysicsScalar yOverlap = std::min(
+            entityColliderRect.y + entityColliderRect.h - moveableEntityColliderRect.y,
+            moveableEntityColliderRect.y + moveableEntityColliderRect.h - entityColliderRect.y);
 
-            const float xOverlap = std::min(entityColliderRect.x + entityColliderRect.w - moveableEntityColliderRect.x,
-                moveableEntityColliderRect.x + moveableEntityColliderRect.w - entityColliderRect.x);
+        const PhysicsScalar xOverlap = std::min(
+            entityColliderRect.x + entityColliderRect.w - moveableEntityColliderRect.x,
+            moveableEntityColliderRect.x + moveableEntityColliderRect.w - entityColliderRect.x);
 
-            if (xOverlap - g_epsilonValue <= 0 || yOverlap - g_epsilonValue <= 0)
-                continue;
+        if (xOverlap - g_physicsEpsilon <= 0 || yOverlap - g_physicsEpsilon <= 0)
+            continue;
 
-            const Vec2<float> moveableEntityVelocity = moveableEntity->getVelocity();
+        const Vec2<PhysicsScalar> moveableEntityVelocity = body.m_velocity;
+        const PhysicsScalar viscosity = body.m_viscosity;
+        const PhysicsScalar nextXMove = moveableEntityVelocity.x * p_deltaTime;
+        const PhysicsScalar nextYMove = moveableEntityVelocity.y * p_deltaTime;
 
-            if (std::abs(xOverlap) < std::abs(yOverlap))
+        if (scalarAbs(xOverlap) < scalarAbs(yOverlap))
+        {
+            // Horizontal collision
+            if (moveableEntityVelocity.x < -g_physicsEpsilon &&
+                xOverlap > -g_physicsEpsilon &&
+                moveableEntityCollider->checkLeftCollisions(*entityCollider, nextXMove))
             {
-                // Horizontal collision
-                if (moveableEntityVelocity.x < -g_epsilonValue &&
-                    xOverlap > -g_epsilonValue &&
-                    moveableEntityCollider->checkLeftCollisions(entity, p_deltaTime))
-                {
-                    moveableEntity->setPositionKeepingInitialPos(
-                        entityColliderRect.x + entityColliderRect.w + g_epsilonValue,
-                        moveableEntityPosition.y);
-                    moveableEntity->setVelocity({
-                        -moveableEntityVelocity.x * moveableEntity->getViscosity(),
-                        -moveableEntityVelocity.y * moveableEntity->getViscosity()
-                    });
-                }
-                else if (moveableEntityVelocity.x > g_epsilonValue &&
-                    xOverlap > -g_epsilonValue &&
-                    moveableEntityCollider->checkRightCollisions(entity, p_deltaTime))
-                {
-                    moveableEntity->setPositionKeepingInitialPos(
-                        entityColliderRect.x - moveableEntityColliderRect.w - g_epsilonValue,
-                        moveableEntityPosition.y);
-                    moveableEntity->setVelocity({
-                        -moveableEntityVelocity.x * moveableEntity->getViscosity(),
-                        -moveableEntityVelocity.y * moveableEntity->getViscosity()
-                    });
-                }
+                moveableEntity->setPositionKeepingInitialPos(
+                    entityColliderRect.x + entityColliderRect.w + g_physicsEpsilon,
+                    moveableEntityPosition.y);
+                body.m_velocity = {
+                    -moveableEntityVelocity.x * viscosity,
+                    -moveableEntityVelocity.y * viscosity
+                };
             }
-            else
+            else if (moveableEntityVelocity.x > g_physicsEpsilon &&
+                xOverlap > -g_physicsEpsilon &&
+                moveableEntityCollider->checkRightCollisions(*entityCollider, nextXMove))
             {
-                // Vertical collision
-                if (moveableEntityVelocity.y < -g_epsilonValue &&
-                    yOverlap > -g_epsilonValue &&
-                    moveableEntityCollider->checkUpperCollisions(entity, p_deltaTime))
-                {
-                    moveableEntity->setPositionKeepingInitialPos(moveableEntityPosition.x,
-                        entityColliderRect.y + entityColliderRect.h + g_epsilonValue);
-                    moveableEntity->setVelocity({
-                        moveableEntityVelocity.x * moveableEntity->getViscosity(),
-                        -moveableEntityVelocity.y * moveableEntity->getViscosity()
-                    });
-                }
-                else if (moveableEntityVelocity.y > g_epsilonValue &&
-                    yOverlap > -g_epsilonValue &&
-                    moveableEntityCollider->checkGroundCollision(entity, p_deltaTime))
-                {
-                    moveableEntity->setPositionKeepingInitialPos(moveableEntityPosition.x,
-                        entityColliderRect.y - moveableEntityColliderRect.h - g_epsilonValue);
-                    //Already handled in gravity, should maybe change that
-                }
+                moveableEntity->setPositionKeepingInitialPos(
+                    entityColliderRect.x - moveableEntityColliderRect.w - g_physicsEpsilon,
+                    moveableEntityPosition.y);
+                body.m_velocity = {
+                    -moveableEntityVelocity.x * viscosity,
+                    -moveableEntityVelocity.y * viscosity
+                };
+            }
+        }
+        else
+        {
+            // Vertical collision
+            if (moveableEntityVelocity.y < -g_physicsEpsilon &&
+                yOverlap > -g_physicsEpsilon &&
+                moveableEntityCollider->checkUpperCollisions(*entityCollider, nextYMove))
+            {
+                moveableEntity->setPositionKeepingInitialPos(moveableEntityPosition.x,
+                    entityColliderRect.y + entityColliderRect.h + g_physicsEpsilon);
+                body.m_velocity = {
+                    moveableEntityVelocity.x * viscosity,
+                    -moveableEntityVelocity.y * viscosity
+                };
+            }
+            else if (moveableEntityVelocity.y > g_physicsEpsilon &&
+                yOverlap > -g_physicsEpsilon &&
+                moveableEntityCollider->checkGroundCollision(*entityCollider, nextYMove))
+            {
+                moveableEntity->setPositionKeepingInitialPos(moveableEntityPosition.x,
+                    entityColliderRect.y - moveableEntityColliderRect.h - g_physicsEpsilon);
+                //Already handled in gravity, should maybe change that
             }
-            moveableEntityCollider->updatePosition();
         }
+        moveableEntityCollider->updatePosition();
     }
 }
@@ -1,44 +1,336 @@
 ﻿#pragma once
-#include <SDL_mixer.h>
+#include <algorithm>
+#include <atomic>
+#include <mutex>
+#include <shared_mutex>
+#include <string>
 #include <vector>
+#include "Animation.h"
+#include "Broadphase.h"
+#include "Ecs.h"
 #include "Entity.h"
+#include "InputRecording.h"
+#include "JobSystem.h"
+#include "StaticGeometry.h"
+#include "Tilemap.h"
+#include "TriggerSystem.h"
+#include "WorldSnapshot.h"
+
+enum EntityListEventType_e
+{
+    ENTITY_ADDED,
+    ENTITY_REMOVED,
+    ENTITY_RENAMED,
+    ENTITY_LIST_CLEARED
+};
+
+struct EntityListEvent
+{
+    EntityListEventType_e m_type;
+    //the entity is already deleted when its ENTITY_REMOVED is read
+    Uint16 m_id;
+};
+
+enum EntityCommandType_e
+{
+    ENTITY_COMMAND_SPAWN,
+    ENTITY_COMMAND_DESTROY,
+    //LEAVE THIS AT THE END FOR AUTOMATIC INCREMENT
+    ENTITY_COMMAND_TYPES_NUMBER
+};
+
+//One image loaded for the renderer, shared by the entities showing it
+struct LoadedTexture
+{
+    std::string m_path;
+    //nullptr when the image couldn't be loaded
+    SDL_Texture* m_texture;
+};
+
+struct EntityCommand
+{
+    EntityCommandType_e m_type;
+    //built when the command is recorded, it joins the lists when applied
+    Entity* m_entity;
+    //the destroyed entity is looked up by id, it may have been deleted since
+    Uint16 m_id;
+    //gives the spawned entity its components
+    EcsEntity (*m_createBundle)(EcsWorld& p_world, Entity* p_entity);
+};
+
+//The entity classes as component bundles:
+//Entity: StaticBody, MoveableEntity: MoveableBody, Player: MoveableBody, PlayerControl and SpriteAnimation,
+//Collectible: Pickup and SpriteAnimation, TriggerZone: StaticBody and TriggerArea, Tilemap: TileLayer.
+//The physics reads the Transform they all have, the CollisionShape of all but the tilemaps and the moveable
+//entities' RigidBody, the components below only lead back to the entities
+struct StaticBody
+{
+    Entity* m_entity;
+};
+
+struct MoveableBody
+{
+    MoveableEntity* m_entity;
+};
+
+struct PlayerControl
+{
+    Player* m_player;
+};
+
+struct Pickup
+{
+    Collectible* m_collectible;
+};
+
+struct TriggerArea
+{
+    TriggerZone* m_triggerZone;
+};
+
+//the tilemap's chunk bodies are static, the tilemap itself never collides
+struct TileLayer
+{
+    Tilemap* m_tilemap;
+};
 
 class EntityManager
 {
 public:
     explicit EntityManager(SDL_Renderer* p_renderer) : m_renderer(p_renderer), m_nbEntities(0), m_entities(0),
-                                                       m_moveableEntities(0), m_player(nullptr)
+                                                       m_moveableEntities(0), m_publishedBroadphase(0)
     {
+        addSystems();
+        m_animations.addDefaultClips(*this, m_renderer);
     }
 
     ~EntityManager();
     Entity* addEntity(const char* p_texturePath, const FRect& p_rect);
     std::vector<Entity*>& getEntities() { return m_entities; }
-    std::vector<MoveableEntity*>& getMoveableEntities() { return m_moveableEntities; }
-    std::vector<Entity*>& getStaticEntities() { return m_staticEntities; }
-    Player* getPlayer() const { return m_player; }
-    std::vector<Collectible*>& getCollectibles() { return m_collectibles; }
-    void setEntities(const std::vector<Entity*>&& p_entities) { m_entities = p_entities; }
-    void setMoveableEntities(const std::vector<MoveableEntity*>&& p_moveableEntities)
-    {
-        m_moveableEntities = p_moveableEntities;
-    }
-    void setPlayer(Player* p_player) { m_player = p_player; }
-    void setCollectibles(const std::vector<Collectible*>&& p_collectibles) { m_collectibles = p_collectibles; }
-    void setStaticEntities(const std::vector<Entity*>&& p_staticEntities) { m_staticEntities = p_staticEntities; }
+    const std::vector<Entity*>& getEntities() const { return m_entities; }
+    //the lists below are the world's queries in id order, gathered again at the sync points which change the
+    //entities so the fixed update and the render preparation only read them
+    const std::vector<MoveableEntity*>& getMoveableEntities() const { return m_moveableEntities; }
+    const std::vector<Entity*>& getStaticEntities() const { return m_staticEntities; }
+    //the editor's player, nullptr when the scene has none
+    Player* getPlayer() const { return getPlayers().empty() ? nullptr : m_players.front(); }
+    const std::vector<Player*>& getPlayers() const { return m_players; }
+    Player* getPlayerById(Uint16 p_id) const;
+    const std::vector<Collectible*>& getCollectibles() const { return m_collectibles; }
+    const std::vector<Tilemap*>& getTilemaps() const { return m_tilemaps; }
+    //the touching static boxes merged into bodies, as of the last sync point or broadphase update
+    const StaticGeometry& getStaticGeometry() const { return m_staticGeometry; }
+    EcsWorld& getWorld() { return m_world; }
+    const EcsWorld& getWorld() const { return m_world; }
+    //the fixed update's systems, gameplay systems are added after the physics ones
+    EcsScheduler& getScheduler() { return m_scheduler; }
+    const EcsScheduler& getScheduler() const { return m_scheduler; }
+    //called by Entity::updateBeforeDelete
+    void removeEntity(const Entity* p_entity);
     static void deleteEntityUpdate(const Entity* p_entity);
+    //Editor operations, they go through here so a recording can replay them.
+    //The spawns and deletions are recorded, the entity is only added or deleted by applyCommands
+    void deleteEntity(const Entity* p_entity);
+    Entity* addChosenEntity(const std::string& p_choiceName);
+    //the entity must already be in the world, applied with the spawns and deletions
+    template <typename T>
+    void addComponent(const Entity* p_entity, const T& p_component)
+    {
+        m_componentCommands.add(p_entity->getEcsEntity(), p_component);
+    }
+    template <typename T>
+    void removeComponent(const Entity* p_entity) { m_componentCommands.remove<T>(p_entity->getEcsEntity()); }
+    //The sync point: waits for the running tick and applies the recorded structural changes in one pass,
+    //the edited tilemap chunks and the static geometry are rebuilt there too.
+    //Called by the thread that records them and reads the entity list, never during a tick
+    void applyCommands();
+    bool hasPendingCommands() const
+    {
+        return !m_entityCommands.empty() || !m_componentCommands.isEmpty() || hasDirtyTilemaps() ||
+            m_isStaticGeometryDirty;
+    }
+    //Whole cells of a streamed world, called between two ticks like applyCommands.
+    //The add functions called in between give the ids set by setNextEntityId, their entities join the lists
+    //in one merge by id at endBulkInsert
+    void beginBulkInsert();
+    void setNextEntityId(const Uint16 p_id) { m_nbEntities = p_id; }
+    void endBulkInsert();
+    //deleted in one pass over the list, the ids that aren't in it are skipped
+    void removeEntities(std::vector<Uint16>& p_ids);
+    //the entities added afterwards get ids from p_count on, a streamed world keeps the ones below for its file
+    void reserveEntityIds(const Uint16 p_count) { m_nbEntities = std::max(m_nbEntities, p_count); }
+    //p_infoName is the name of one of the entity's properties, p_value is parsed by its type
+    void applyEntityEdit(Entity* p_entity, const std::string& p_infoName, const std::string& p_value);
     MoveableEntity* addMoveableEntity(const char* p_texturePath, const FRect& p_rect, float p_mass);
     Player* addPlayer(const char* p_texturePath, const FRect& p_rect, float p_mass);
     Collectible* addCollectible(const char* p_texturePath, const FRect& p_rect);
+    Entity* addSlope(const char* p_texturePath, const FRect& p_rect, bool p_risingToTheRight);
+    TriggerZone* addTriggerZone(const char* p_texturePath, const FRect& p_rect, TriggerAction_e p_action);
+    //empty, its chunks are built once tiles are set and rebuildDirtyChunks or applyCommands is called
+    Tilemap* addTilemap(const char* p_tilesetPath, float p_x, float p_y, int p_columns, int p_rows, int p_tileSize);
+    //Loaded once per path, the textures stay until the entity manager is deleted so a render list
+    //prepared before an edit never shows a destroyed one. p_textureId is set to its index in getLoadedTextures()
+    SDL_Texture* loadTexture(const char* p_path, Uint16& p_textureId);
+    //the image file read into a surface, on any thread. nullptr when it couldn't be read, always without
+    //SDL_image in the headless build (ENGINE_HEADLESS), nothing is drawn there
+    static SDL_Surface* decodeImage(const char* p_path);
+    //loadTexture from an image decoded beforehand, the surface is freed
+    void addDecodedTexture(const std::string& p_path, SDL_Surface* p_surface);
+    //the entities show no texture without one
+    bool hasRenderer() const { return m_renderer != nullptr; }
+    const std::vector<LoadedTexture>& getLoadedTextures() const { return m_loadedTextures; }
+    //a texture built at run time, an atlas, kept and destroyed like the loaded ones. Returns its id
+    Uint16 addTexture(const std::string& p_name, SDL_Texture* p_texture);
+    //the clips shared by every entity playing them, the default ones first
+    const AnimationLibrary& getAnimations() const { return m_animations; }
+    //The players' clips follow what they do, then every animation moves on by p_deltaTime and its entity shows
+    //the frame it is on. Called by the thread drawing while no render list is prepared, returns the number
+    //of animations
+    size_t updateAnimations(float p_deltaTime);
+    //the entities are in creation order, so in id order
+    Entity* getEntityById(Uint16 p_id) const;
+    bool hasTriggerZone(TriggerAction_e p_action) const;
     void resetEntities() const;
     void deleteEntities();
     void solveInsidersEntities(const float& p_deltaTime) const;
+    //one fixed update: broadphase, forces and gravity on the worker threads, insiders and triggers
+    void stepPhysics(const float& p_deltaTime);
+    //number of fixed updates run so far
+    Uint32 getTick() const { return m_tick; }
+    void setTick(const Uint32 p_tick) { m_tick = p_tick; }
+    //play keeps the edited scene in a snapshot, stop puts it back
+    void beginPlaySession();
+    void endPlaySession();
+    bool getIsInPlaySession() const { return m_isInPlaySession; }
+    //goes back (or forward) to a tick kept in the snapshot ring, recorded like the editor operations
+    bool restoreTick(Uint32 p_tick);
+    //when set, every fixed update pushes its state to it
+    SnapshotRing* getSnapshotRing() const { return m_snapshotRing; }
+    void setSnapshotRing(SnapshotRing* p_snapshotRing) { m_snapshotRing = p_snapshotRing; }
+    //collectibles and trigger zones reacting to the player, called with the drained trigger events
+    void handleTriggerEvent(const TriggerEvent& p_event, bool& p_playerOnFinish);
+    //FNV-1a of every entity's id, rect, velocity and state, equal hashes mean identical simulations
+    Uint64 computeStateHash() const;
+    //the hierarchy follows the entity list through these events instead of reading it again after every edit
+    void setRecordsEntityListEvents(const bool p_recordsEntityListEvents)
+    {
+        m_recordsEntityListEvents = p_recordsEntityListEvents;
+    }
+    void drainEntityListEvents(std::vector<EntityListEvent>& p_events)
+    {
+        p_events.clear();
+        m_entityListEvents.swap(p_events);
+    }
+    InputRecorder* getInputRecorder() const { return m_inputRecorder; }
+    void setInputRecorder(InputRecorder* p_inputRecorder) { m_inputRecorder = p_inputRecorder; }
+    //the forces and gravity are applied on its workers, without one the fixed update runs on its own thread
+    JobSystem* getJobSystem() const { return m_jobSystem; }
+    void setJobSystem(JobSystem* p_jobSystem) { m_jobSystem = p_jobSystem; }
+    void updateBroadphase(const float& p_deltaTime);
+    //updateBroadphase outside the fixed update, once it is done with the entities
+    void rebuildBroadphase();
+    //only called from the fixed update, between two updateBroadphase
+    CandidateRange getCollisionCandidates(const Collider* p_collider) const
+    {
+        return getBroadphase().getCandidates(p_collider->getProxyId());
+    }
+    const Broadphase& getBroadphase() const { return m_broadphases[m_publishedBroadphase]; }
+    //pair tests of the last built broadphase, readable from any thread
+    size_t getPairTestCount() const { return m_pairTestCount; }
+    void updateTriggers(const Uint32 p_tick) { m_triggerSystem.update(getBroadphase(), p_tick); }
+
+    //Spatial queries on the last published broadphase, safe to call from any thread.
+    //They see the shapes as they were at the start of the last fixed update.
+    int queryPoint(const Vec2<float>& p_point, Uint32 p_mask, QueryHit* p_hits, int p_maxHits) const;
+    int queryAABB(const FRect& p_rect, Uint32 p_mask, QueryHit* p_hits, int p_maxHits) const;
+    bool raycast(const Vec2<float>& p_start, const Vec2<float>& p_end, Uint32 p_mask, RaycastHit& p_hit,
+                 const Collider* p_ignored = nullptr) const;
+    bool sweepBox(const FRect& p_box, const Vec2<float>& p_move, Uint32 p_mask, RaycastHit& p_hit,
+                  const Collider* p_ignored = nullptr) const;
+    void drainTriggerEvents(std::vector<TriggerEvent>& p_events) { m_triggerSystem.drainEvents(p_events); }
+    void clearTriggers() { m_triggerSystem.clear(); }
+    const std::vector<Uint32>& getTriggerOverlaps() const { return m_triggerSystem.getOverlaps(); }
+    void setTriggerOverlaps(const Uint32* p_overlaps, const size_t p_count)
+    {
+        m_triggerSystem.setOverlaps(p_overlaps, p_count);
+    }
 private:
+    void addSystems();
+    //into the lists right away, or recorded while an editor operation runs
+    void spawnEntity(Entity* p_entity, EcsEntity (*p_createBundle)(EcsWorld& p_world, Entity* p_entity));
+    //the components of the moveable entities in one of the world's chunks
+    struct BodyChunk
+    {
+        //the index of its first body over every chunk
+        size_t m_first;
+        size_t m_count;
+        const MoveableBody* m_owners;
+        Transform* m_transforms;
+        RigidBody* m_bodies;
+        CollisionShape* m_shapes;
+        //nullptr in the crates' chunks
+        const PlayerControl* m_controls;
+    };
+
+    //on the worker threads, on this one with the fixed point physics
+    void applyForcesAndGravity(const float& p_deltaTime);
+    void applyForces(const BodyChunk& p_bodyChunk, size_t p_row, PhysicsScalar p_deltaTime) const;
+    void applyGravity(const BodyChunk& p_bodyChunk, size_t p_row, PhysicsScalar p_deltaTime) const;
+    void solveInsiders(const BodyChunk& p_bodyChunk, size_t p_row, PhysicsScalar p_deltaTime) const;
+    //the world moves rows around when its structure changes, the entities are bound to their components again.
+    //With m_tickMutex held
+    void refreshTypeLists();
+    bool hasDirtyTilemaps() const;
+    //merges again the groups of the static entities added, removed or edited since, returns whether the bodies
+    //changed
+    bool refreshStaticGeometry();
+    void pushEntityListEvent(const EntityListEventType_e p_type, const Uint16 p_id)
+    {
+        if (m_recordsEntityListEvents)
+            m_entityListEvents.push_back({p_type, p_id});
+    }
+
     SDL_Renderer* m_renderer;
     Uint16 m_nbEntities;
     std::vector<Entity*> m_entities;
+    std::vector<LoadedTexture> m_loadedTextures;
+    AnimationLibrary m_animations;
+    EcsWorld m_world;
+    EcsScheduler m_scheduler;
     std::vector<Entity*> m_staticEntities;
     std::vector<MoveableEntity*> m_moveableEntities;
     std::vector<Collectible*> m_collectibles;
-    Player* m_player;
+    std::vector<Player*> m_players;
+    std::vector<Tilemap*> m_tilemaps;
+    //in the world's order, the bodies aren't sorted by id
+    std::vector<BodyChunk> m_bodyChunks;
+    size_t m_bodyCount = 0;
+    StaticGeometry m_staticGeometry;
+    Uint32 m_staticGeometryVersion = ~0u;
+    //an edit may have moved a static entity, the structure version doesn't tell
+    std::atomic<bool> m_isStaticGeometryDirty{false};
+    //one is built while the queries read the other one
+    Broadphase m_broadphases[2];
+    mutable std::shared_timed_mutex m_broadphaseMutexes[2];
+    std::atomic<int> m_publishedBroadphase;
+    std::atomic<size_t> m_pairTestCount{0};
+    TriggerSystem m_triggerSystem;
+
+    JobSystem* m_jobSystem = nullptr;
+    std::atomic<Uint32> m_tick{0};
+    InputRecorder* m_inputRecorder = nullptr;
+    SnapshotRing* m_snapshotRing = nullptr;
+    std::vector<Uint8> m_editSnapshot;
+    bool m_isInPlaySession = false;
+    bool m_recordsEntityListEvents = false;
+    bool m_defersSpawns = false;
+    std::vector<EntityCommand> m_entityCommands;
+    bool m_insertsInBulk = false;
+    //the id the add functions were at when the bulk insert began
+    Uint16 m_bulkInsertNextId = 0;
+    std::vector<EntityCommand> m_bulkSpawns;
+    EcsCommandBuffer m_componentCommands;
+    //held by every tick, applyCommands takes it between two ticks
+    std::mutex m_tickMutex;
+    std::vector<EntityListEvent> m_entityListEvents;
 };
@@ -0,0 +1,86 @@
+﻿#include "EntityProperties.h"
+#include <cstdio>
+#include <cstring>
+
+void EntityProperties::collect(const PropertyTable& p_table, std::vector<const EntityProperty*>& p_properties)
+{
+    if (p_table.m_base)
+        collect(*p_table.m_base, p_properties);
+    for (size_t i = 0; i < p_table.m_count; ++i)
+        p_properties.push_back(&p_table.m_properties[i]);
+}
+
+const EntityProperty* EntityProperties::find(const PropertyTable& p_table, const std::string& p_name)
+{
+    for (const PropertyTable* table = &p_table; table; table = table->m_base)
+        for (size_t i = 0; i < table->m_count; ++i)
+            if (p_name == table->m_properties[i].m_name)
+                return &table->m_properties[i];
+    return nullptr;
+}
+
+bool EntityProperties::equals(const PropertyType_e p_type, const PropertyValue& p_first, const PropertyValue& p_second)
+{
+    switch (p_type)
+    {
+    case PROPERTY_TEXT:
+        return p_first.m_text == p_second.m_text;
+    case PROPERTY_FLOAT:
+        return p_first.m_float == p_second.m_float;
+    default:
+        return p_first.m_integer == p_second.m_integer;
+    }
+}
+
+void EntityProperties::format(const PropertyType_e p_type, const PropertyValue& p_value, std::string& p_text)
+{
+    char buffer[32];
+    switch (p_type)
+    {
+    case PROPERTY_TEXT:
+        p_text += p_value.m_text;
+        return;
+    case PROPERTY_FLOAT:
+        std::snprintf(buffer, sizeof(buffer), "%g", p_value.m_float);
+        break;
+    case PROPERTY_BOOLEAN:
+        std::strcpy(buffer, p_value.m_integer ? "true" : "false");
+        break;
+    case PROPERTY_BITFIELD:
+        std::snprintf(buffer, sizeof(buffer), "0x%llX", static_cast<unsigned long long>(p_value.m_integer));
+        break;
+    default:
+        std::snprintf(buffer, sizeof(buffer), "%lld", static_cast<long long>(p_value.m_integer));
+        break;
+    }
+    p_text += buffer;
+}
+
+bool EntityProperties::parse(const PropertyType_e p_type, const std::string& p_text, PropertyValue& p_value)
+{
+    try
+    {
+        switch (p_type)
+        {
+        case PROPERTY_TEXT:
+            p_value.m_text = p_text;
+            return true;
+        case PROPERTY_FLOAT:
+            p_value.m_float = std::stof(p_text);
+            return true;
+        case PROPERTY_BOOLEAN:
+            if (p_text != "true" && p_text != "1" && p_text != "false" && p_text != "0")
+                return false;
+            p_value.m_integer = p_text == "true" || p_text == "1";
+            return true;
+        case PROPERTY_BITFIELD:
+            //decimal or 0x prefixed
+            p_value.m_integer = static_cast<Uint32>(std::stoul(p_text, nullptr, 0));
+            return true;
+        default:
+            p_value.m_integer = std::stoll(p_text);
+            return true;
+        }
+    }
+    catch (...) { return false; }
+}
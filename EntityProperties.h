@@ -0,0 +1,61 @@
+﻿#pragma once
+#include <SDL_stdinc.h>
+#include <string>
+#include <vector>
+
+class Entity;
+
+enum PropertyType_e
+{
+    PROPERTY_TEXT,
+    PROPERTY_FLOAT,
+    PROPERTY_INTEGER,
+    PROPERTY_BOOLEAN,
+    //shown and read as hexadecimal, decimal is read too
+    PROPERTY_BITFIELD,
+
+    //LEAVE THIS AT THE END FOR AUTOMATIC INCREMENT
+    PROPERTY_TYPES_NUMBER
+};
+
+//Only the member of the property's type is used
+struct PropertyValue
+{
+    float m_float = 0.f;
+    //integers, booleans and bitfields
+    Sint64 m_integer = 0;
+    std::string m_text;
+};
+
+struct EntityProperty
+{
+    //shown by the inspector, also names the edits in the input recordings
+    const char* m_name;
+    PropertyType_e m_type;
+    void (*m_get)(const Entity& p_entity, PropertyValue& p_value);
+    //nullptr for the read only properties
+    void (*m_set)(Entity& p_entity, const PropertyValue& p_value);
+
+    bool isReadOnly() const { return m_set == nullptr; }
+};
+
+//The properties an entity type adds to the ones of the type it derives from
+struct PropertyTable
+{
+    const EntityProperty* m_properties;
+    size_t m_count;
+    const PropertyTable* m_base;
+};
+
+class EntityProperties
+{
+public:
+    //the base type's properties first
+    static void collect(const PropertyTable& p_table, std::vector<const EntityProperty*>& p_properties);
+    static const EntityProperty* find(const PropertyTable& p_table, const std::string& p_name);
+    static bool equals(PropertyType_e p_type, const PropertyValue& p_first, const PropertyValue& p_second);
+    //appends the value to p_text
+    static void format(PropertyType_e p_type, const PropertyValue& p_value, std::string& p_text);
+    //false when p_text isn't a value of p_type
+    static bool parse(PropertyType_e p_type, const std::string& p_text, PropertyValue& p_value);
+};
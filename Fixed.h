@@ -0,0 +1,113 @@
+﻿#pragma once
+#include <SDL_stdinc.h>
+#include "utils.h"
+
+//16.16 fixed point, every operation gives the same bits whatever the compiler or the CPU
+class Fixed
+{
+public:
+    constexpr Fixed() : m_raw(0)
+    {
+    }
+    //implicit so the physics code reads the same with floats and fixed points
+    constexpr Fixed(const int p_value) : m_raw(p_value * s_one)
+    {
+    }
+    constexpr Fixed(const float p_value) : Fixed(static_cast<double>(p_value))
+    {
+    }
+    //the scaling is exact in double, only the rounding to the nearest raw value happens
+    constexpr Fixed(const double p_value) : m_raw(toRaw(p_value * s_one + (p_value < 0 ? -0.5 : 0.5)))
+    {
+    }
+
+    static constexpr Fixed fromRaw(const Sint32 p_raw)
+    {
+        Fixed fixed;
+        fixed.m_raw = p_raw;
+        return fixed;
+    }
+    constexpr Sint32 getRaw() const { return m_raw; }
+    constexpr float toFloat() const { return static_cast<float>(m_raw) / s_one; }
+
+    friend constexpr Fixed operator+(const Fixed p_first, const Fixed p_second)
+    {
+        return fromRaw(p_first.m_raw + p_second.m_raw);
+    }
+    friend constexpr Fixed operator-(const Fixed p_first, const Fixed p_second)
+    {
+        return fromRaw(p_first.m_raw - p_second.m_raw);
+    }
+    friend constexpr Fixed operator*(const Fixed p_first, const Fixed p_second)
+    {
+        return fromRaw(static_cast<Sint32>(static_cast<Sint64>(p_first.m_raw) * p_second.m_raw / s_one));
+    }
+    friend constexpr Fixed operator/(const Fixed p_first, const Fixed p_second)
+    {
+        return fromRaw(static_cast<Sint32>(static_cast<Sint64>(p_first.m_raw) * s_one / p_second.m_raw));
+    }
+    constexpr Fixed operator-() const { return fromRaw(-m_raw); }
+    Fixed& operator+=(const Fixed p_other) { return *this = *this + p_other; }
+    Fixed& operator-=(const Fixed p_other) { return *this = *this - p_other; }
+    Fixed& operator*=(const Fixed p_other) { return *this = *this * p_other; }
+    Fixed& operator/=(const Fixed p_other) { return *this = *this / p_other; }
+
+    friend constexpr bool operator==(const Fixed p_first, const Fixed p_second) { return p_first.m_raw == p_second.m_raw; }
+    friend constexpr bool operator!=(const Fixed p_first, const Fixed p_second) { return p_first.m_raw != p_second.m_raw; }
+    friend constexpr bool operator<(const Fixed p_first, const Fixed p_second) { return p_first.m_raw < p_second.m_raw; }
+    friend constexpr bool operator<=(const Fixed p_first, const Fixed p_second) { return p_first.m_raw <= p_second.m_raw; }
+    friend constexpr bool operator>(const Fixed p_first, const Fixed p_second) { return p_first.m_raw > p_second.m_raw; }
+    friend constexpr bool operator>=(const Fixed p_first, const Fixed p_second) { return p_first.m_raw >= p_second.m_raw; }
+private:
+    //past the range the conversion is undefined, the value sticks to the nearest bound and a NaN gives 0
+    static constexpr Sint32 toRaw(const double p_scaled)
+    {
+        return p_scaled >= 2147483647.0 ? SDL_MAX_SINT32 : p_scaled <= -2147483648.0 ? SDL_MIN_SINT32 :
+            p_scaled == p_scaled ? static_cast<Sint32>(p_scaled) : 0;
+    }
+
+    static constexpr Sint32 s_one = 1 << 16;
+    Sint32 m_raw;
+};
+
+#pragma region physics scalar policy
+//Define ENGINE_FIXED_POINT_PHYSICS to run the physics in fixed point: replays and checksums then match
+//between thread counts and compilers, at the cost of precision and some speed.
+#ifdef ENGINE_FIXED_POINT_PHYSICS
+using PhysicsScalar = Fixed;
+//the worker threads push each other's entities, in an order that changes from one run to the next
+constexpr bool g_deterministicPhysics = true;
+#else
+using PhysicsScalar = float;
+constexpr bool g_deterministicPhysics = false;
+#endif
+
+constexpr PhysicsScalar g_physicsEpsilon = PhysicsScalar(g_epsilonValue);
+
+inline float toFloat(const float p_value) { return p_value; }
+inline float toFloat(const Fixed p_value) { return p_value.toFloat(); }
+inline float scalarAbs(const float p_value) { return p_value < 0.f ? -p_value : p_value; }
+inline Fixed scalarAbs(const Fixed p_value) { return p_value < Fixed() ? -p_value : p_value; }
+
+template <typename T>
+FRect toFRect(const Rect<T>& p_rect)
+{
+    return {toFloat(p_rect.x), toFloat(p_rect.y), toFloat(p_rect.w), toFloat(p_rect.h)};
+}
+
+inline Rect<PhysicsScalar> toPhysicsRect(const FRect& p_rect)
+{
+    return {PhysicsScalar(p_rect.x), PhysicsScalar(p_rect.y), PhysicsScalar(p_rect.w), PhysicsScalar(p_rect.h)};
+}
+
+template <typename T>
+Vec2<float> toFloatVec2(const Vec2<T>& p_vec)
+{
+    return {toFloat(p_vec.x), toFloat(p_vec.y)};
+}
+
+inline Vec2<PhysicsScalar> toPhysicsVec2(const Vec2<float>& p_vec)
+{
+    return {PhysicsScalar(p_vec.x), PhysicsScalar(p_vec.y)};
+}
+#pragma endregion
@@ -1,16 +1,30 @@
 ﻿#include "Gameloop.h"
 
 #include <algorithm>
+#include <cmath>
 
 #include "EntityManager.h"
 #include "InputManager.h"
+#include "SceneGenerator.h"
 
 //to handle fullscreen when playing
 extern int g_scenePosX;
 extern int g_scenePo;
 extern int g_sceneWidth;
 extern int g_sceneHeight;
+extern int g_worldWidth;
+extern int g_worldHeight;
 
+//in ParticleEffect_e's order
+static const ParticleEmitterDefinition s_particleEffects[PARTICLE_EFFECTS_NUMBER] = {
+    //small coins thrown up
+    {BASE_COLLECTIBLE_TEXTURE, 24, 60.f, 180.f, -150.f, -30.f, 0.3f, 0.7f, 400.f, 6.f, {255, 255, 255, 255},
+        {255, 230, 150, 255}},
+    //dust from the feet, to both sides
+    {nullptr, 16, 20.f, 70.f, -180.f, 0.f, 0.2f, 0.45f, 60.f, 3.f, {200, 190, 170, 200}, {150, 140, 120, 200}},
+    //confetti all around the player
+    {nullptr, 600, 100.f, 400.f, -180.f, 180.f, 1.f, 2.5f, 250.f, 4.f, {255, 80, 80, 255}, {80, 160, 255, 255}}
+};
 
 Gameloop::Gameloop(InputManager* p_inputManager, SDL_Renderer* p_renderer, SDL_Rect& p_sceneRect) : Gameloop(
     p_inputManager, p_renderer, p_sceneRect, nullptr)
@@ -24,22 +38,37 @@ Gameloop::Gameloop(InputManager* p_inputManager, SDL_Renderer* p_renderer, SDL_R
                                                 m_fixedUpdateTime(FIXED_UPDATE_TIME),
                                                 m_playingGame(false),
                                                 m_playingSDL(true),
-                                                m_inputManager(p_inputManager)
+                                                m_inputManager(p_inputManager),
+                                                m_snapshotRing(SNAPSHOT_RING_CAPACITY)
 {
     m_entityManager = new EntityManager(m_renderer);
+    m_entityManager->setSnapshotRing(&m_snapshotRing);
+    m_entityManager->setJobSystem(&m_jobSystem);
     m_fixedUpdateThread = std::thread([this]() { fixedUpdate(); });
 
     chargeMyLevel();
     m_winSoundEffect = Mix_LoadWAV("./sounds/victory.mp3");
-    m_threads.reserve(m_processor_count - 1);
+    m_jumpSoundEffect = Mix_LoadWAV("./sounds/jump.mp3");
+    m_coinSoundEffect = Mix_LoadWAV("./sounds/coin.mp3");
+    for (const ParticleEmitterDefinition& definition : s_particleEffects)
+    {
+        Uint16 textureId;
+        SDL_Texture* texture = definition.m_texturePath ? m_entityManager->loadTexture(definition.m_texturePath,
+            textureId) : nullptr;
+        m_particleSystem.addEmitter(definition, texture);
+    }
 }
 
 Gameloop::~Gameloop()
 {
     m_playingSDL = m_playingGame = false;
     m_fixedUpdateThread.join();
+    waitForRenderPreparation();
+    m_worldStreamer.close();
     delete m_entityManager;
     Mix_FreeChunk(m_winSoundEffect);
+    Mix_FreeChunk(m_jumpSoundEffect);
+    Mix_FreeChunk(m_coinSoundEffect);
 }
 
 void Gameloop::updateDeltaTime()
@@ -51,15 +80,73 @@ void Gameloop::updateDeltaTime()
 
 void Gameloop::update()
 {
+    updateStreamedWorld();
+    //the editor's spawns and deletions and the streamed cells, between two ticks of the fixed update thread
+    const bool hasStreamedCells = m_worldStreamer.hasPendingChanges();
+    if (m_entityManager->hasPendingCommands() || hasStreamedCells)
+    {
+        //the prepared lists still show the deleted entities and the replaced chunk textures, they are built again
+        waitForRenderPreparation();
+        m_entityManager->applyCommands();
+        if (hasStreamedCells)
+            m_worldStreamer.integrate();
+        for (RenderList& renderList : m_renderLists)
+            renderList.invalidate();
+    }
+    //frozen while paused, the win's burst still plays out once stopped
+    if (m_playingGame || !m_entityManager->getIsInPlaySession())
+        m_particleSystem.update(m_deltaTime, &m_jobSystem);
     if (!m_playingGame)
         return;
-    const auto player = m_entityManager->getPlayer();
-    player->applyMovements(m_deltaTime);
-    const auto collectibles = m_entityManager->getCollectibles();
-    for (auto* collectible : collectibles) { collectible->detectCollected(player->getCollider()->getColliderRect()); }
+    //a network session handles the triggers in its ticks, they may be run again
+    if (!m_networkSession)
+        handleTriggerEvents();
+    playGameplayEffects();
     checkCollectibles();
 }
 
+void Gameloop::playGameplayEffects()
+{
+    //a player leaving the ground on its way up has jumped
+    const std::vector<Player*>& players = m_entityManager->getPlayers();
+    m_playersOnGround.resize(players.size(), true);
+    for (size_t i = 0; i < players.size(); ++i)
+    {
+        const bool isOnGround = players[i]->getOnGround();
+        if (m_playersOnGround[i] && !isOnGround && players[i]->getVelocity().y < 0.f)
+        {
+            const FRect rect = players[i]->getEntityRect();
+            m_particleSystem.emit(PARTICLE_JUMP_DUST, {rect.x + rect.w / 2.f, rect.y + rect.h});
+            Mix_PlayChannel(2, m_jumpSoundEffect, 0);
+        }
+        m_playersOnGround[i] = isOnGround;
+    }
+
+    //the triggers may have been handled by the network session, the collectibles' states tell either way.
+    //A list that changed (a streamed cell, a stop) is only taken as it is
+    const std::vector<Collectible*>& collectibles = m_entityManager->getCollectibles();
+    const bool isSameList = m_collectedStates.size() == collectibles.size();
+    m_collectedStates.resize(collectibles.size());
+    for (size_t i = 0; i < collectibles.size(); ++i)
+    {
+        const bool isCollected = collectibles[i]->getIsCollected();
+        if (isSameList && isCollected && !m_collectedStates[i])
+        {
+            const FRect rect = collectibles[i]->getEntityRect();
+            m_particleSystem.emit(PARTICLE_COIN_PICKUP, {rect.x + rect.w / 2.f, rect.y + rect.h / 2.f});
+            Mix_PlayChannel(2, m_coinSoundEffect, 0);
+        }
+        m_collectedStates[i] = isCollected;
+    }
+}
+
+void Gameloop::handleTriggerEvents()
+{
+    m_entityManager->drainTriggerEvents(m_triggerEvents);
+    for (const TriggerEvent& event : m_triggerEvents)
+        m_entityManager->handleTriggerEvent(event, m_playerOnFinish);
+}
+
 void Gameloop::fixedUpdate()
 {
     while (m_playingSDL)
@@ -67,73 +154,138 @@ void Gameloop::fixedUpdate()
         if (!m_playingGame)
             continue;
         auto startTime = std::chrono::steady_clock::now();
-        auto moveableEntities = m_entityManager->getMoveableEntities();
-
-        //Optimisation on multiple threads to waste less time
-        const float fixedUpdateTime = m_fixedUpdateTime.count() / 1000.f;
-        const size_t max = std::min(moveableEntities.size(), m_processor_count - 1);
-        auto applyForceAndGravitySubset = [&moveableEntities, &fixedUpdateTime](const int p_start, const int p_end)
-        {
-            for (int i = p_start; i < p_end; ++i)
-            {
-                moveableEntities[i]->applyForces(fixedUpdateTime);
-                moveableEntities[i]->applyGravity(fixedUpdateTime);
-            }
-        };
-
-        const size_t entitiesPerThread = moveableEntities.size() / max;
-        for (size_t i = 0; i < max; ++i)
-        {
-            m_threads.emplace_back(applyForceAndGravitySubset, i * entitiesPerThread, (i + 1) * entitiesPerThread);
-        }
-        for (auto& thread : m_threads)
-            thread.join();
-        m_threads.clear();
-        m_entityManager->solveInsidersEntities(fixedUpdateTime);
+        fixedTick(m_fixedUpdateTime.count() / 1000.f);
         auto endTime = std::chrono::steady_clock::now();
         auto sleepTime = endTime - startTime;
+        m_lastTickTime = std::chrono::duration<float, std::milli>(sleepTime).count();
+        if (sleepTime > m_fixedUpdateTime)
+            ++m_tickOverruns;
         if (sleepTime > std::chrono::steady_clock::duration::zero())
             std::this_thread::sleep_until(startTime + m_fixedUpdateTime);
     }
 }
 
-SDL_Rect Gameloop::convertEntityRectToScene(const FRect& p_rect) const
+void Gameloop::fixedTick(const float& p_deltaTime)
 {
-    const SDL_Rect rect = {
-        static_cast<int>(p_rect.x) + m_sceneRect.x,
-        static_cast<int>(p_rect.y),
-        static_cast<int>(p_rect.w),
-        static_cast<int>(p_rect.h)
-    };
+    if (m_networkSession)
+    {
+        m_networkSession->advance(*m_entityManager, p_deltaTime, m_playerOnFinish);
+        return;
+    }
+    //the same steps as a replayed tick, the players move by the fixed step rather than the frame's
+    for (Player* player : m_entityManager->getPlayers())
+        player->applyMovements(p_deltaTime);
+    m_entityManager->stepPhysics(p_deltaTime);
+}
+
+void Gameloop::setNetworkSession(NetworkSession* p_networkSession)
+{
+    m_networkSession = p_networkSession;
+    if (!m_networkSession)
+        return;
+    //both peers need the same entities, the cells are loaded whenever their reads end
+    m_worldStreamer.close();
+    g_worldWidth = g_worldHeight = 0;
+    //both instances build the same level, the peer's player comes right after the editor's
+    SceneGenerator::addNetworkPlayers(*m_entityManager);
+    //the fixed update thread applies the forces alone, in the same order on both instances
+    m_entityManager->setJobSystem(nullptr);
+}
+
+SDL_FRect Gameloop::convertEntityRectToScene(const FRect& p_rect) const
+{
+    const SDL_FRect rect = {p_rect.x + static_cast<float>(m_sceneRect.x), p_rect.y, p_rect.w, p_rect.h};
     return rect;
 }
 
-void Gameloop::draw() const
+void Gameloop::draw()
 {
+    const SDL_FRect sceneRect = {
+        static_cast<float>(m_sceneRect.x), static_cast<float>(m_sceneRect.y), static_cast<float>(m_sceneRect.w),
+        static_cast<float>(m_sceneRect.h)
+    };
+    const float offsetX = static_cast<float>(m_sceneRect.x) - m_cameraX;
+    //last frame's list is submitted while the workers prepare this frame's, the entities are shown a frame late
+    waitForRenderPreparation();
+    //no list reads the entities' frames meanwhile, they are frozen while paused like the particles
+    const bool isAnimating = m_playingGame || !m_entityManager->getIsInPlaySession();
+    m_entityManager->updateAnimations(isAnimating ? m_deltaTime : 0.f);
+    RenderList& submittedList = m_renderLists[m_preparedRenderList];
+    const std::vector<Entity*>& entities = m_entityManager->getEntities();
+    const std::vector<Tilemap*>& tilemaps = m_entityManager->getTilemaps();
+    if (!submittedList.isValidFor(offsetX, sceneRect))
+        submittedList.build(entities, tilemaps, offsetX, sceneRect, &m_jobSystem);
+    m_preparedRenderList = 1 - m_preparedRenderList;
+    m_renderPreparation = m_renderLists[m_preparedRenderList].schedule(entities, tilemaps, offsetX, sceneRect,
+        m_jobSystem);
+
     SDL_RenderClear(m_renderer);
     SDL_RenderCopy(m_renderer, m_background, nullptr, &m_sceneRect);
-    const std::vector<Entity*> entities = m_entityManager->getEntities();
-    for (const auto entity : entities)
-    {
-        const FRect entityRect = entity->getEntityRect();
-        const SDL_Rect convertedRect = convertEntityRectToScene(entityRect);
-        SDL_RenderCopy(m_renderer, entity->getTexture(), nullptr, &convertedRect);
-    }
+    submittedList.submit(m_renderer);
+    m_particleSystem.prepare(offsetX, &m_jobSystem);
+    m_particleSystem.submit(m_renderer, m_sceneRect);
+    m_renderStats = submittedList.getStats();
+    //the background and the particles
+    m_renderStats.m_drawCalls += 1 + m_particleSystem.getStats().m_drawCalls;
+}
+
+void Gameloop::waitForRenderPreparation()
+{
+    if (!m_renderPreparation.m_job)
+        return;
+    m_jobSystem.wait(m_renderPreparation);
+    m_renderPreparation = JobHandle();
+}
+
+bool Gameloop::openStreamedWorld(const char* p_path)
+{
+    if (m_playingGame || m_networkSession)
+        return false;
+    //the workers read the entity list the world replaces
+    waitForRenderPreparation();
+    m_worldStreamer.setLoadRadius(STREAMING_LOAD_RADIUS);
+    if (!m_worldStreamer.open(p_path, *m_entityManager, &m_jobSystem))
+        return false;
+    g_worldWidth = static_cast<int>(std::ceil(m_worldStreamer.getWorldWidth()));
+    g_worldHeight = static_cast<int>(std::ceil(m_worldStreamer.getWorldHeight()));
+    for (RenderList& renderList : m_renderLists)
+        renderList.invalidate();
+    return true;
+}
+
+void Gameloop::updateStreamedWorld()
+{
+    const Player* player = m_entityManager->getPlayer();
+    if (!m_worldStreamer.getIsOpen() || !player)
+        return;
+    const FRect playerRect = player->getEntityRect();
+    const Vec2<float> focus = {playerRect.x + playerRect.w / 2.f, playerRect.y + playerRect.h / 2.f};
+    m_worldStreamer.update(focus);
+    const float maxCameraX = std::max(m_worldStreamer.getWorldWidth() - static_cast<float>(m_sceneRect.w), 0.f);
+    m_cameraX = std::min(std::max(focus.x - static_cast<float>(m_sceneRect.w) / 2.f, 0.f), maxCameraX);
 }
 
 void Gameloop::playGame()
 {
+    recordGameState(RECORDED_PLAY);
+    const bool isNewSession = !m_entityManager->getIsInPlaySession();
+    m_entityManager->beginPlaySession();
+    if (m_networkSession && isNewSession)
+        m_networkSession->start(*m_entityManager);
     m_playingGame = true;
 
     m_sceneRect.x = g_scenePosX = 0;
     m_sceneRect.w = g_sceneWidth = SCREEN_WIDTH;
     m_sceneRect.h = g_sceneHeight = SCREEN_HEIGHT;
-    m_inputManager->setPlayerInstance(m_entityManager->getPlayer());
+    const std::vector<Player*>& players = m_entityManager->getPlayers();
+    const size_t localPlayer = m_networkSession ? static_cast<size_t>(m_networkSession->getLocalPlayer()) : 0;
+    m_inputManager->setPlayerInstance(localPlayer < players.size() ? players[localPlayer] : nullptr);
     m_gameStateButtons->updateButtonsRect();
 }
 
 void Gameloop::pauseGame()
 {
+    recordGameState(RECORDED_PAUSE);
     m_playingGame = false;
     m_sceneRect.x = g_scenePosX = HIERARCHY_WIDTH;
     m_sceneRect.w = g_sceneWidth = SCENE_WIDTH;
@@ -143,25 +295,53 @@ void Gameloop::pauseGame()
 
 void Gameloop::stopGame()
 {
+    recordGameState(RECORDED_STOP);
     m_playingGame = false;
     m_sceneRect.x = g_scenePosX = HIERARCHY_WIDTH;
     m_sceneRect.w = g_sceneWidth = SCENE_WIDTH;
     m_sceneRect.h = g_sceneHeight = SCENE_HEIGHT;
     m_gameStateButtons->updateButtonsRect();
-    m_entityManager->resetEntities();
+    m_entityManager->endPlaySession();
+    m_playerOnFinish = false;
+}
+
+void Gameloop::scrubTicks(const int p_ticks)
+{
+    //the peer keeps going, the network session owns the ring
+    if (m_playingGame || m_networkSession || !m_entityManager->getIsInPlaySession() || m_snapshotRing.isEmpty())
+        return;
+    const long long tick = static_cast<long long>(m_entityManager->getTick()) + p_ticks;
+    const long long oldestTick = m_snapshotRing.getOldestTick();
+    const long long newestTick = m_snapshotRing.getNewestTick();
+    m_entityManager->restoreTick(static_cast<Uint32>(std::min(std::max(tick, oldestTick), newestTick)));
+}
+
+void Gameloop::recordGameState(const RecordedEventType_e p_type) const
+{
+    if (InputRecorder* inputRecorder = m_entityManager->getInputRecorder())
+        inputRecorder->recordGameState(m_entityManager->getTick(), p_type);
 }
 
 Entity* Gameloop::getEntityFromPos(int p_x, const int p_y) const
 {
-    p_x -= (SCREEN_WIDTH - SCENE_WIDTH) / 2;
-    const auto entities = m_entityManager->getEntities();
-    for (Entity* entity : entities)
+    p_x -= g_scenePosX - static_cast<int>(m_cameraX);
+    //while editing nothing rebuilds the broadphase, the entities may have been moved by the inspector
+    if (!m_playingGame)
+        m_entityManager->rebuildBroadphase();
+    QueryHit hits[16];
+    const int hitNumber = m_entityManager->queryPoint({static_cast<float>(p_x), static_cast<float>(p_y)},
+        LAYER_ALL, hits, 16);
+    //the last created entity is drawn on top of the others
+    Entity* pickedEntity = nullptr;
+    Uint16 pickedId = 0;
+    for (int i = 0; i < hitNumber; ++i)
     {
-        const auto entityRect = entity->getEntityRect();
-        if (detectButtonClicked(p_x, p_y, convertFRect(entityRect)))
-            return entity;
+        if (pickedEntity != nullptr && hits[i].m_entityId < pickedId)
+            continue;
+        pickedEntity = hits[i].m_entity;
+        pickedId = hits[i].m_entityId;
     }
-    return nullptr;
+    return pickedEntity;
 }
 
 void Gameloop::checkCollectibles()
@@ -170,6 +350,14 @@ void Gameloop::checkCollectibles()
     if (!std::all_of(collectibles.cbegin(), collectibles.cend(),
         [](const Collectible* p_collectible) { return p_collectible->getIsCollected(); }))
         return;
+    //with a finish flag in the level, the player also has to reach it
+    if (!m_playerOnFinish && m_entityManager->hasTriggerZone(TRIGGER_FINISH))
+        return;
+    if (const Player* player = m_entityManager->getPlayer())
+    {
+        const FRect rect = player->getEntityRect();
+        m_particleSystem.emit(PARTICLE_WIN, {rect.x + rect.w / 2.f, rect.y + rect.h / 2.f});
+    }
     stopGame();
     //WIN
     Mix_PlayChannel(2, m_winSoundEffect, 0);
@@ -178,29 +366,5 @@ void Gameloop::checkCollectibles()
 
 void Gameloop::chargeMyLevel() const
 {
-    m_entityManager->addPlayer(BASE_PLAYER_TEXTURE, {50, 30, 20, 40}, 80);
-    m_entityManager->addEntity(BASE_TEXTURE, {10, 75, 100, 10});
-    m_entityManager->addEntity(BASE_TEXTURE, {10, 150, 100, 10});
-    m_entityManager->addCollectible(BASE_COLLECTIBLE_TEXTURE, {50, 130, 20, 20});
-
-    m_entityManager->addEntity(BASE_TEXTURE, {10, 225, 100, 10});
-    m_entityManager->addCollectible(BASE_COLLECTIBLE_TEXTURE, {50, 205, 20, 20});
-    m_entityManager->addEntity(BASE_TEXTURE, {10, 300, 100, 10});
-    m_entityManager->addCollectible(BASE_COLLECTIBLE_TEXTURE, {50, 280, 20, 20});
-    m_entityManager->addEntity(BASE_TEXTURE, {150, 0, 20, 300});
-    m_entityManager->addEntity(BASE_TEXTURE, {30, 400, 200, 20});
-    m_entityManager->addEntity(BASE_TEXTURE, {300, 400, 200, 20});
-    m_entityManager->addEntity(BASE_TEXTURE, {350, 380, 25, 20});
-    m_entityManager->addMoveableEntity(BASE_MOVEABLE_TEXTURE, {360, 365, 75, 15}, 10);
-    m_entityManager->addEntity(BASE_TEXTURE, {400, 380, 25, 20});
-    m_entityManager->addCollectible(BASE_COLLECTIBLE_TEXTURE, {380, 380, 20, 20});
-
-    m_entityManager->addEntity(BASE_TEXTURE, {550, 325, 100, 10});
-    m_entityManager->addCollectible(BASE_COLLECTIBLE_TEXTURE, {590, 305, 20, 20});
-    m_entityManager->addEntity(BASE_TEXTURE, {500, 250, 100, 10});
-    m_entityManager->addCollectible(BASE_COLLECTIBLE_TEXTURE, {540, 230, 20, 20});
-    m_entityManager->addEntity(BASE_TEXTURE, {400, 150, 100, 10});
-    m_entityManager->addCollectible(BASE_COLLECTIBLE_TEXTURE, {440, 130, 20, 20});
-    m_entityManager->addEntity(BASE_TEXTURE, {450, 75, 100, 10});
-    m_entityManager->addCollectible(BASE_COLLECTIBLE_TEXTURE, {490, 55, 20, 20});
+    SceneGenerator::generateDefaultLevel(*m_entityManager);
 }
@@ -2,10 +2,19 @@
 
 #include "utils.h"
 #include <SDL.h>
+#include <atomic>
 #include <chrono>
 #include <SDL_mixer.h>
 #include <thread>
 #include <vector>
+#include "InputRecording.h"
+#include "JobSystem.h"
+#include "NetworkSession.h"
+#include "ParticleSystem.h"
+#include "RenderList.h"
+#include "TriggerSystem.h"
+#include "WorldSnapshot.h"
+#include "WorldStreaming.h"
 
 class InputManager;
 class EntityManager;
@@ -14,6 +23,17 @@ class MoveableEntity;
 class Player;
 class GameStateButtons;
 
+//the gameloop's particle emitters, added in this order
+enum ParticleEffect_e
+{
+    PARTICLE_COIN_PICKUP,
+    PARTICLE_JUMP_DUST,
+    PARTICLE_WIN,
+
+    //LEAVE THIS AT THE END FOR AUTOMATIC INCREMENT
+    PARTICLE_EFFECTS_NUMBER
+};
+
 class Gameloop
 {
 public:
@@ -23,16 +43,32 @@ public:
     void updateDeltaTime();
     void update();
     void fixedUpdate();
-    SDL_Rect convertEntityRectToScene(const FRect& p_rect) const;
-    void draw() const;
+    //one physics step, run by fixedUpdate
+    void fixedTick(const float& p_deltaTime);
+    SDL_FRect convertEntityRectToScene(const FRect& p_rect) const;
+    void draw();
     void playGame();
     void pauseGame();
     void stopGame();
+    //while paused, moves through the last ticks kept in the snapshot ring
+    void scrubTicks(int p_ticks);
     bool& getPlayingGame() { return m_playingGame; }
     Entity* getEntityFromPos(int p_x, int p_y) const;
     EntityManager* getEntityManager() const { return m_entityManager; }
+    void handleTriggerEvents();
     void checkCollectibles();
     void setCheckStateButtons(GameStateButtons* p_gameStateButtons) { m_gameStateButtons = p_gameStateButtons; }
+    const RenderStats& getRenderStats() const { return m_renderStats; }
+    const ParticleStats& getParticleStats() const { return m_particleSystem.getStats(); }
+    //in milliseconds, written by the fixed update thread
+    float getLastTickTime() const { return m_lastTickTime; }
+    Uint32 getTickOverruns() const { return m_tickOverruns; }
+    //the fixed update goes through p_networkSession, a second player is added when the level has only one
+    void setNetworkSession(NetworkSession* p_networkSession);
+    const NetworkSession* getNetworkSession() const { return m_networkSession; }
+    //replaces the level with a world file streamed around the player, refused while playing or in a network session
+    bool openStreamedWorld(const char* p_path);
+    const WorldStreamer& getWorldStreamer() const { return m_worldStreamer; }
 private:
     SDL_Renderer* m_renderer;
     SDL_Texture* m_background;
@@ -50,8 +86,35 @@ private:
     GameStateButtons* m_gameStateButtons;
 
     Mix_Chunk* m_winSoundEffect = nullptr;
+    Mix_Chunk* m_jumpSoundEffect = nullptr;
+    Mix_Chunk* m_coinSoundEffect = nullptr;
+    std::vector<TriggerEvent> m_triggerEvents;
+    bool m_playerOnFinish = false;
+    RenderStats m_renderStats;
+    SnapshotRing m_snapshotRing;
+    //the fixed update's physics jobs and the render lists' preparation
+    JobSystem m_jobSystem;
+    //one is submitted while the other is prepared for the next frame
+    RenderList m_renderLists[2];
+    int m_preparedRenderList = 0;
+    JobHandle m_renderPreparation;
+    NetworkSession* m_networkSession = nullptr;
+    std::atomic<float> m_lastTickTime{0.f};
+    //ticks that took longer than m_fixedUpdateTime
+    std::atomic<Uint32> m_tickOverruns{0};
+    WorldStreamer m_worldStreamer;
+    //left edge of the view in a streamed world wider than the scene
+    float m_cameraX = 0.f;
+    ParticleSystem m_particleSystem;
+    //as of the last frame, a change emits particles and plays a sound
+    std::vector<bool> m_playersOnGround;
+    std::vector<bool> m_collectedStates;
     void chargeMyLevel() const;
-
-    const unsigned int m_processor_count = std::thread::hardware_concurrency();
-    std::vector<std::thread> m_threads;
+    //the workers read the entity list until it returns
+    void waitForRenderPreparation();
+    //the cells around the player, and the view following it
+    void updateStreamedWorld();
+    void recordGameState(RecordedEventType_e p_type) const;
+    //the jumps and the pickups since the last frame, kept out of the ticks a network session may run again
+    void playGameplayEffects();
 };
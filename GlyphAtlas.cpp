@@ -0,0 +1,180 @@
+﻿#include "GlyphAtlas.h"
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+
+GlyphAtlas::GlyphAtlas(SDL_Renderer* p_renderer, TTF_Font* p_font) : m_renderer(p_renderer), m_texture(nullptr),
+                                                                      m_width(256), m_height(0), m_lineHeight(0)
+{
+    build(p_font);
+}
+
+GlyphAtlas::GlyphAtlas(SDL_Renderer* p_renderer, const char* p_fontPath, const int p_fontSize) :
+    m_renderer(p_renderer), m_texture(nullptr), m_width(256), m_height(0), m_lineHeight(0)
+{
+    TTF_Font* font = TTF_OpenFont(p_fontPath, p_fontSize);
+    if (!font)
+    {
+        std::cerr << "Couldn't open the font of the glyph atlas" << std::endl;
+        return;
+    }
+    build(font);
+    TTF_CloseFont(font);
+}
+
+GlyphAtlas::~GlyphAtlas() { SDL_DestroyTexture(m_texture); }
+
+void GlyphAtlas::build(TTF_Font* p_font)
+{
+    m_lineHeight = TTF_FontHeight(p_font);
+    SDL_Surface* glyphSurfaces[s_glyphsNumber];
+    SDL_Rect glyphRects[s_glyphsNumber];
+
+    //simple row packing, the glyphs of one font have about the same height
+    int x = 0;
+    int y = 0;
+    int rowHeight = 0;
+    for (int i = 0; i < s_glyphsNumber; ++i)
+    {
+        const Uint16 character = static_cast<Uint16>(s_firstGlyph + i);
+        glyphSurfaces[i] = TTF_RenderGlyph_Blended(p_font, character, {255, 255, 255, 255});
+        int advance = 0;
+        TTF_GlyphMetrics(p_font, character, nullptr, nullptr, nullptr, nullptr, &advance);
+        const int w = glyphSurfaces[i] ? glyphSurfaces[i]->w : 0;
+        const int h = glyphSurfaces[i] ? glyphSurfaces[i]->h : 0;
+        if (x + w > m_width)
+        {
+            x = 0;
+            y += rowHeight + 1;
+            rowHeight = 0;
+        }
+        rowHeight = std::max(rowHeight, h);
+        glyphRects[i] = {x, y, w, h};
+        m_glyphs[i].m_width = static_cast<float>(w);
+        m_glyphs[i].m_height = static_cast<float>(h);
+        m_glyphs[i].m_advance = static_cast<float>(advance);
+        x += w + 1;
+    }
+    m_height = y + rowHeight + 1;
+
+    SDL_Surface* atlasSurface = SDL_CreateRGBSurfaceWithFormat(0, m_width, m_height, 32, SDL_PIXELFORMAT_RGBA32);
+    SDL_FillRect(atlasSurface, nullptr, SDL_MapRGBA(atlasSurface->format, 255, 255, 255, 0));
+    for (int i = 0; i < s_glyphsNumber; ++i)
+    {
+        if (!glyphSurfaces[i])
+            continue;
+        //copy the alpha as is instead of blending it over the empty atlas
+        SDL_SetSurfaceBlendMode(glyphSurfaces[i], SDL_BLENDMODE_NONE);
+        SDL_BlitSurface(glyphSurfaces[i], nullptr, atlasSurface, &glyphRects[i]);
+        SDL_FreeSurface(glyphSurfaces[i]);
+        m_glyphs[i].m_uv = {
+            static_cast<float>(glyphRects[i].x) / static_cast<float>(m_width),
+            static_cast<float>(glyphRects[i].y) / static_cast<float>(m_height),
+            static_cast<float>(glyphRects[i].w) / static_cast<float>(m_width),
+            static_cast<float>(glyphRects[i].h) / static_cast<float>(m_height)
+        };
+    }
+    m_texture = SDL_CreateTextureFromSurface(m_renderer, atlasSurface);
+    if (!m_texture)
+        std::cerr << "Couldn't create glyph atlas texture" << std::endl;
+    SDL_SetTextureBlendMode(m_texture, SDL_BLENDMODE_BLEND);
+    SDL_FreeSurface(atlasSurface);
+
+    m_vertices.reserve(256 * 4);
+    m_indices.reserve(256 * 6);
+}
+
+float GlyphAtlas::addText(const char* p_text, const float p_x, const float p_y, const SDL_Color p_color)
+{
+    return addGlyphs(p_text, p_text + std::strlen(p_text), p_x, p_y, p_color);
+}
+
+int GlyphAtlas::addWrappedText(const char* p_text, const float p_x, float p_y, const float p_maxWidth,
+                               const SDL_Color p_color)
+{
+    int lineCount = 0;
+    do
+    {
+        const char* lineEnd = findLineEnd(p_text, p_maxWidth);
+        addGlyphs(p_text, lineEnd, p_x, p_y, p_color);
+        p_y += static_cast<float>(m_lineHeight);
+        ++lineCount;
+        p_text = *lineEnd == ' ' ? lineEnd + 1 : lineEnd;
+    }
+    while (*p_text != '\0');
+    return lineCount;
+}
+
+float GlyphAtlas::addGlyphs(const char* p_begin, const char* p_end, float p_x, const float p_y,
+                            const SDL_Color p_color)
+{
+    for (const char* character = p_begin; character != p_end; ++character)
+    {
+        const Glyph& glyph = getGlyph(*character);
+        if (glyph.m_width > 0.f)
+        {
+            const int first = static_cast<int>(m_vertices.size());
+            const SDL_FRect& uv = glyph.m_uv;
+            m_vertices.push_back({{p_x, p_y}, p_color, {uv.x, uv.y}});
+            m_vertices.push_back({{p_x + glyph.m_width, p_y}, p_color, {uv.x + uv.w, uv.y}});
+            m_vertices.push_back({{p_x + glyph.m_width, p_y + glyph.m_height}, p_color, {uv.x + uv.w, uv.y + uv.h}});
+            m_vertices.push_back({{p_x, p_y + glyph.m_height}, p_color, {uv.x, uv.y + uv.h}});
+            const int quadIndices[] = {first, first + 1, first + 2, first, first + 2, first + 3};
+            m_indices.insert(m_indices.end(), quadIndices, quadIndices + 6);
+        }
+        p_x += glyph.m_advance;
+    }
+    return p_x;
+}
+
+void GlyphAtlas::flush()
+{
+    if (m_indices.empty())
+        return;
+    SDL_RenderGeometry(m_renderer, m_texture, m_vertices.data(), static_cast<int>(m_vertices.size()),
+        m_indices.data(), static_cast<int>(m_indices.size()));
+    m_vertices.clear();
+    m_indices.clear();
+}
+
+float GlyphAtlas::measureText(const char* p_text) const
+{
+    float width = 0.f;
+    for (const char* character = p_text; *character != '\0'; ++character)
+        width += getGlyph(*character).m_advance;
+    return width;
+}
+
+int GlyphAtlas::countWrappedLines(const char* p_text, const float p_maxWidth) const
+{
+    int lineCount = 0;
+    do
+    {
+        const char* lineEnd = findLineEnd(p_text, p_maxWidth);
+        ++lineCount;
+        p_text = *lineEnd == ' ' ? lineEnd + 1 : lineEnd;
+    }
+    while (*p_text != '\0');
+    return lineCount;
+}
+
+const char* GlyphAtlas::findLineEnd(const char* p_text, const float p_maxWidth) const
+{
+    float width = 0.f;
+    const char* lastSpace = nullptr;
+    for (const char* character = p_text; *character != '\0'; ++character)
+    {
+        width += getGlyph(*character).m_advance;
+        if (width <= p_maxWidth)
+        {
+            if (*character == ' ')
+                lastSpace = character;
+            continue;
+        }
+        //a word longer than the line is cut where it overflows, at least one glyph per line
+        if (lastSpace)
+            return lastSpace;
+        return character == p_text ? character + 1 : character;
+    }
+    return p_text + std::strlen(p_text);
+}
@@ -0,0 +1,60 @@
+﻿#pragma once
+#include <SDL_render.h>
+#include <SDL_ttf.h>
+#include <vector>
+
+//All the printable ASCII glyphs of a font rasterised once in a single texture, one atlas per font size.
+//Text is queued as textured quads and drawn with one SDL_RenderGeometry call per flush.
+class GlyphAtlas
+{
+public:
+    GlyphAtlas(SDL_Renderer* p_renderer, TTF_Font* p_font);
+    //the font is only open while the glyphs are rasterised
+    GlyphAtlas(SDL_Renderer* p_renderer, const char* p_fontPath, int p_fontSize);
+    ~GlyphAtlas();
+    GlyphAtlas(const GlyphAtlas&) = delete;
+    GlyphAtlas& operator=(const GlyphAtlas&) = delete;
+
+    //returns the x position after the last glyph
+    float addText(const char* p_text, float p_x, float p_y, SDL_Color p_color);
+    //breaks the lines at the last space that fits in p_maxWidth, returns the number of lines
+    int addWrappedText(const char* p_text, float p_x, float p_y, float p_maxWidth, SDL_Color p_color);
+    void flush();
+    float measureText(const char* p_text) const;
+    int countWrappedLines(const char* p_text, float p_maxWidth) const;
+    int getLineHeight() const { return m_lineHeight; }
+    //bytes of the atlas texture, 4 per pixel
+    size_t getTextureMemory() const { return static_cast<size_t>(m_width) * m_height * 4; }
+private:
+    static constexpr char s_firstGlyph = ' ';
+    static constexpr char s_lastGlyph = '~';
+    static constexpr int s_glyphsNumber = s_lastGlyph - s_firstGlyph + 1;
+
+    struct Glyph
+    {
+        SDL_FRect m_uv;
+        float m_width;
+        float m_height;
+        float m_advance;
+    };
+
+    void build(TTF_Font* p_font);
+    const Glyph& getGlyph(const char p_character) const
+    {
+        //anything outside of the atlas is drawn as a space
+        return m_glyphs[p_character >= s_firstGlyph && p_character <= s_lastGlyph ? p_character - s_firstGlyph : 0];
+    }
+    float addGlyphs(const char* p_begin, const char* p_end, float p_x, float p_y, SDL_Color p_color);
+    //end of the line starting at p_text, the following one starts after the space it was broken at
+    const char* findLineEnd(const char* p_text, float p_maxWidth) const;
+
+    SDL_Renderer* m_renderer;
+    SDL_Texture* m_texture;
+    int m_width;
+    int m_height;
+    int m_lineHeight;
+    Glyph m_glyphs[s_glyphsNumber] = {};
+
+    std::vector<SDL_Vertex> m_vertices;
+    std::vector<int> m_indices;
+};
@@ -0,0 +1,715 @@
+﻿//Headless physics benchmark: no window, no renderer, no audio device.
+//Usage: HeadlessBenchmark [ticks] [seed] [threads, 0 for every core]
+//Built with ENGINE_FIXED_POINT_PHYSICS (HeadlessBenchmarkFixed) the checksums match between thread counts.
+//       HeadlessBenchmark --replay <recording> [hash file to write] [--compare <hash file>]
+//       HeadlessBenchmark --loopback [ticks] [ticks each peer runs in turn], two network sessions over 127.0.0.1
+//       HeadlessBenchmark --scaling [ticks], the large and crowded scenes from 1 thread to every core
+//       HeadlessBenchmark --streaming [ticks] [world file to write], a wide scene written in cells then crossed
+//       HeadlessBenchmark --particles [particles] [frames], kept alive and drawn by SDL's software renderer
+//       HeadlessBenchmark --animations [coins] [frames], spinning coins with atlases baked by the software renderer
+//       HeadlessBenchmark --jobs [rounds], the job system's dependencies and full pool, exits with 1 on a failure
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <memory>
+#include <new>
+#include <random>
+#include <thread>
+#include <vector>
+#include "EntityManager.h"
+#include "InputRecording.h"
+#include "NetworkSession.h"
+#include "ParticleSystem.h"
+#include "SceneGenerator.h"
+#include "WorldSnapshot.h"
+#include "WorldStreaming.h"
+
+extern int g_sceneWidth;
+extern int g_sceneHeight;
+
+static std::atomic<size_t> g_allocationCount{0};
+static std::atomic<size_t> g_allocatedBytes{0};
+
+void* operator new(const size_t p_size)
+{
+    ++g_allocationCount;
+    g_allocatedBytes += p_size;
+    if (void* memory = std::malloc(p_size != 0 ? p_size : 1))
+        return memory;
+    throw std::bad_alloc();
+}
+
+void operator delete(void* p_memory) noexcept { std::free(p_memory); }
+void operator delete(void* p_memory, size_t) noexcept { std::free(p_memory); }
+
+struct BenchmarkResult
+{
+    double m_meanTickTime;
+    double m_medianTickTime;
+    double m_worstTickTime;
+    double m_pairTestsPerTick;
+    double m_allocationsPerTick;
+    double m_bytesPerTick;
+    //every tick's state hash folded together
+    Uint64 m_checksum;
+    double m_snapshotPushTime;
+    double m_snapshotRestoreTime;
+    double m_snapshotBytes;
+    double m_stolenJobsPerTick;
+    //the measured ticks only
+    std::vector<SystemStats> m_systemStats;
+};
+
+static double elapsedNanoseconds(const std::chrono::steady_clock::time_point p_start)
+{
+    return static_cast<double>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now() - p_start).count());
+}
+
+//without a job system the ticks run on the calling thread alone
+static BenchmarkResult runScene(const SceneDescription& p_description, const int p_ticks, JobSystem* p_jobSystem)
+{
+    g_sceneWidth = static_cast<int>(p_description.m_width);
+    g_sceneHeight = static_cast<int>(p_description.m_height);
+    EntityManager entityManager(nullptr);
+    entityManager.setJobSystem(p_jobSystem);
+    SceneGenerator::generate(entityManager, p_description);
+
+    const float deltaTime = FIXED_UPDATE_TIME / 1000.f;
+    std::vector<TriggerEvent> triggerEvents;
+    //lets the crates settle and the vectors reach their final capacity
+    for (int i = 0; i < 60; ++i)
+    {
+        entityManager.stepPhysics(deltaTime);
+        entityManager.drainTriggerEvents(triggerEvents);
+    }
+    entityManager.getScheduler().resetStats();
+    if (p_jobSystem)
+        p_jobSystem->resetStats();
+
+    std::vector<double> tickTimes(p_ticks);
+    size_t pairTests = 0;
+    Uint64 checksum = 0;
+    const size_t allocationsBefore = g_allocationCount;
+    const size_t bytesBefore = g_allocatedBytes;
+    for (int i = 0; i < p_ticks; ++i)
+    {
+        const auto start = std::chrono::steady_clock::now();
+        entityManager.stepPhysics(deltaTime);
+        tickTimes[i] = elapsedNanoseconds(start);
+        pairTests += entityManager.getPairTestCount();
+        checksum = (checksum ^ entityManager.computeStateHash()) * 1099511628211ull;
+        //the main thread would read them every frame
+        entityManager.drainTriggerEvents(triggerEvents);
+    }
+    const size_t allocations = g_allocationCount - allocationsBefore;
+    const size_t bytes = g_allocatedBytes - bytesBefore;
+    std::vector<SystemStats> systemStats = entityManager.getScheduler().getStats();
+    const Uint64 stolenJobs = p_jobSystem ? p_jobSystem->getStolenJobCount() : 0;
+
+    //snapshot of every tick, then a rollback to the middle of the ring
+    constexpr int snapshotTicks = 64;
+    SnapshotRing snapshotRing(snapshotTicks);
+    double pushTime = 0.0;
+    for (int i = 0; i < snapshotTicks; ++i)
+    {
+        entityManager.stepPhysics(deltaTime);
+        entityManager.drainTriggerEvents(triggerEvents);
+        const auto start = std::chrono::steady_clock::now();
+        snapshotRing.push(entityManager);
+        pushTime += elapsedNanoseconds(start);
+    }
+    const auto restoreStart = std::chrono::steady_clock::now();
+    snapshotRing.restore(entityManager, snapshotRing.getNewestTick() - snapshotTicks / 2);
+    const double restoreTime = elapsedNanoseconds(restoreStart);
+
+    BenchmarkResult result;
+    result.m_meanTickTime = 0.0;
+    for (const double tickTime : tickTimes)
+        result.m_meanTickTime += tickTime;
+    result.m_meanTickTime /= p_ticks;
+    std::sort(tickTimes.begin(), tickTimes.end());
+    result.m_medianTickTime = tickTimes[p_ticks / 2];
+    result.m_worstTickTime = tickTimes.back();
+    result.m_pairTestsPerTick = static_cast<double>(pairTests) / p_ticks;
+    result.m_allocationsPerTick = static_cast<double>(allocations) / p_ticks;
+    result.m_bytesPerTick = static_cast<double>(bytes) / p_ticks;
+    result.m_checksum = checksum;
+    result.m_snapshotPushTime = pushTime / snapshotTicks;
+    result.m_snapshotRestoreTime = restoreTime;
+    result.m_snapshotBytes = static_cast<double>(snapshotRing.getEncodedSize()) / snapshotTicks;
+    result.m_stolenJobsPerTick = static_cast<double>(stolenJobs) / p_ticks;
+    result.m_systemStats.swap(systemStats);
+    return result;
+}
+
+//the hash file is one hash per line, in the order the ticks ran
+static bool writeHashes(const char* p_path, const std::vector<Uint64>& p_tickHashes)
+{
+    std::ofstream file(p_path);
+    for (const Uint64 hash : p_tickHashes)
+        file << hash << '\n';
+    return static_cast<bool>(file);
+}
+
+static bool readHashes(const char* p_path, std::vector<Uint64>& p_tickHashes)
+{
+    std::ifstream file(p_path);
+    if (!file)
+        return false;
+    Uint64 hash;
+    while (file >> hash)
+        p_tickHashes.push_back(hash);
+    return true;
+}
+
+static int replay(const int argc, char* argv[])
+{
+    if (argc < 3)
+    {
+        std::printf("Usage: HeadlessBenchmark --replay <recording> [hash file to write] [--compare <hash file>]\n");
+        return 1;
+    }
+    InputReplayer replayer;
+    if (!replayer.load(argv[2]))
+    {
+        std::printf("Couldn't load the recording %s\n", argv[2]);
+        return 1;
+    }
+    const char* outputPath = nullptr;
+    const char* comparePath = nullptr;
+    for (int i = 3; i < argc; ++i)
+    {
+        if (std::strcmp(argv[i], "--compare") == 0 && i + 1 < argc)
+            comparePath = argv[++i];
+        else
+            outputPath = argv[i];
+    }
+
+    //the editor window, the recorded session starts from the default level
+    g_sceneWidth = 900;
+    g_sceneHeight = 576;
+    EntityManager entityManager(nullptr);
+    SceneGenerator::generateDefaultLevel(entityManager);
+    std::vector<Uint64> tickHashes;
+    replayer.run(entityManager, tickHashes);
+    std::printf("%zu events replayed over %zu ticks, final hash %016llx\n", replayer.getEvents().size(),
+        tickHashes.size(), tickHashes.empty() ? 0ull : static_cast<unsigned long long>(tickHashes.back()));
+
+    if (outputPath && !writeHashes(outputPath, tickHashes))
+    {
+        std::printf("Couldn't write the hashes to %s\n", outputPath);
+        return 1;
+    }
+    if (!comparePath)
+        return 0;
+    std::vector<Uint64> referenceHashes;
+    if (!readHashes(comparePath, referenceHashes))
+    {
+        std::printf("Couldn't read the hashes from %s\n", comparePath);
+        return 1;
+    }
+    const size_t count = std::min(tickHashes.size(), referenceHashes.size());
+    for (size_t tick = 0; tick < count; ++tick)
+    {
+        if (tickHashes[tick] != referenceHashes[tick])
+        {
+            std::printf("Diverged at tick %zu\n", tick);
+            return 2;
+        }
+    }
+    if (tickHashes.size() != referenceHashes.size())
+    {
+        std::printf("Diverged at tick %zu, one run is longer\n", count);
+        return 2;
+    }
+    std::printf("Identical over %zu ticks\n", count);
+    return 0;
+}
+
+//new random controls every 25 ticks, the same for the peers and the reference run
+static void getScriptedControls(const int p_player, const Uint32 p_tick, bool* p_controls)
+{
+    std::mt19937 generator(static_cast<Uint32>(p_player) * 7919u + p_tick / 25);
+    const Uint32 random = generator();
+    for (int i = 0; i < CONTROLS_NUMBER; ++i)
+        p_controls[i] = false;
+    p_controls[RIGHT] = (random & 1) != 0;
+    p_controls[LEFT] = (random & 6) == 6;
+    p_controls[UP] = (random & 8) != 0;
+}
+
+struct LoopbackPeer
+{
+    EntityManager m_entityManager{nullptr};
+    SnapshotRing m_snapshotRing{SNAPSHOT_RING_CAPACITY};
+    NetworkSession m_networkSession;
+    std::vector<Uint64> m_tickHashes;
+    bool m_playerOnFinish = false;
+};
+
+static int loopback(const int argc, char* argv[])
+{
+    const Uint32 ticks = argc > 2 ? static_cast<Uint32>(std::max(std::atoi(argv[2]), 1)) : 1000;
+    //how late each peer gets the other's controls, the predictions are wrong more often the later they are
+    const int turnTicks = argc > 3 ? std::min(std::max(std::atoi(argv[3]), 1), NETWORK_MAX_PREDICTION - 1) : 4;
+    const float deltaTime = FIXED_UPDATE_TIME / 1000.f;
+    g_sceneWidth = 900;
+    g_sceneHeight = 576;
+
+    LoopbackPeer peers[NETWORK_PLAYER_COUNT];
+    for (int i = 0; i < NETWORK_PLAYER_COUNT; ++i)
+    {
+        LoopbackPeer& peer = peers[i];
+        SceneGenerator::generateDefaultLevel(peer.m_entityManager);
+        SceneGenerator::addNetworkPlayers(peer.m_entityManager);
+        peer.m_entityManager.setSnapshotRing(&peer.m_snapshotRing);
+        if (!peer.m_networkSession.open(static_cast<Uint16>(47001 + i), "127.0.0.1", static_cast<Uint16>(47002 - i),
+            i))
+        {
+            std::printf("Couldn't open the UDP port %d\n", 47001 + i);
+            return 1;
+        }
+        peer.m_networkSession.setTickHashes(&peer.m_tickHashes);
+        peer.m_entityManager.beginPlaySession();
+        peer.m_networkSession.start(peer.m_entityManager);
+    }
+
+    //the peers take turns instead of running on two threads, the runs are the same every time.
+    //The first turn is half as long so each peer gets ahead of the other in turn
+    bool controls[CONTROLS_NUMBER];
+    int turnLength = std::max(turnTicks / 2, 1);
+    while (peers[0].m_networkSession.getTick() < ticks || peers[1].m_networkSession.getTick() < ticks)
+    {
+        for (int i = 0; i < NETWORK_PLAYER_COUNT; ++i)
+        {
+            LoopbackPeer& peer = peers[i];
+            for (int turnTick = 0; turnTick < turnLength && peer.m_networkSession.getTick() < ticks; ++turnTick)
+            {
+                getScriptedControls(i, peer.m_networkSession.getTick(), controls);
+                peer.m_networkSession.setLocalControls(controls);
+                peer.m_networkSession.advance(peer.m_entityManager, deltaTime, peer.m_playerOnFinish);
+            }
+            turnLength = turnTicks;
+        }
+    }
+    for (LoopbackPeer& peer : peers)
+        peer.m_networkSession.synchronize(peer.m_entityManager, deltaTime, peer.m_playerOnFinish);
+
+    //the same ticks with every control known in advance
+    EntityManager reference(nullptr);
+    SceneGenerator::generateDefaultLevel(reference);
+    SceneGenerator::addNetworkPlayers(reference);
+    std::vector<TriggerEvent> triggerEvents;
+    std::vector<Uint64> referenceHashes;
+    bool playerOnFinish = false;
+    for (Uint32 tick = 0; tick < ticks; ++tick)
+    {
+        const std::vector<Player*>& players = reference.getPlayers();
+        for (int i = 0; i < NETWORK_PLAYER_COUNT; ++i)
+        {
+            getScriptedControls(i, tick, controls);
+            players[i]->applyControls(controls);
+        }
+        for (Player* player : players)
+            player->applyMovements(deltaTime);
+        reference.stepPhysics(deltaTime);
+        reference.drainTriggerEvents(triggerEvents);
+        for (const TriggerEvent& triggerEvent : triggerEvents)
+            reference.handleTriggerEvent(triggerEvent, playerOnFinish);
+        referenceHashes.push_back(reference.computeStateHash());
+    }
+
+    std::printf("%u ticks over 127.0.0.1, the peers run %d ticks in turn, %s physics\n", ticks, turnTicks,
+        g_deterministicPhysics ? "16.16 fixed point" : "float");
+    std::printf("%-6s %10s %12s %10s %14s %14s %8s %14s %10s\n", "peer", "rollbacks", "resim ticks", "deepest",
+        "ms per rollback", "worst ms", "stalls", "packets in/out", "diverged");
+    int result = 0;
+    for (int i = 0; i < NETWORK_PLAYER_COUNT; ++i)
+    {
+        const LoopbackPeer& peer = peers[i];
+        const NetworkStats stats = peer.m_networkSession.getStats();
+        Uint32 divergedTick = ticks;
+        for (Uint32 tick = 0; tick < ticks && divergedTick == ticks; ++tick)
+            if (tick >= peer.m_tickHashes.size() || peer.m_tickHashes[tick] != referenceHashes[tick])
+                divergedTick = tick;
+        if (divergedTick != ticks || peer.m_networkSession.getConfirmedTicks() < ticks)
+            result = 2;
+        char packets[32];
+        std::snprintf(packets, sizeof(packets), "%u/%u", stats.m_packetsReceived, stats.m_packetsSent);
+        char diverged[16];
+        std::snprintf(diverged, sizeof(diverged), divergedTick == ticks ? "no" : "tick %u", divergedTick);
+        std::printf("%-6d %10u %12u %10u %14.3f %14.3f %8u %14s %10s\n", i, stats.m_rollbacks,
+            stats.m_resimulatedTicks, stats.m_deepestRollback,
+            stats.m_rollbacks != 0 ? stats.m_rollbackTime / static_cast<float>(stats.m_rollbacks) : 0.f,
+            stats.m_worstRollbackTime, stats.m_stalls, packets, diverged);
+    }
+    return result;
+}
+
+static std::vector<SceneDescription> getScenes(const Uint32 p_seed)
+{
+    return {
+        {"small", 20, 50, 20, p_seed, 900.f, 576.f, true, 0},
+        {"medium", 100, 500, 100, p_seed, 1800.f, 1152.f, true, 0},
+        {"large", 400, 3000, 400, p_seed, 3600.f, 2304.f, true, 0},
+        {"crowded", 10, 2000, 0, p_seed, 900.f, 576.f, false, 0},
+        //the large scene's platforms merged into the chunks of a tilemap
+        {"tiled", 400, 3000, 400, p_seed, 3600.f, 2304.f, true, 16},
+    };
+}
+
+//the large and crowded scenes from 1 thread to one per core, the calling thread counts as one
+static int scaling(const int argc, char* argv[])
+{
+    const int ticks = argc > 2 ? std::max(std::atoi(argv[2]), 1) : 300;
+    const unsigned int maxThreads = std::max(std::thread::hardware_concurrency(), 1u);
+    const std::vector<SceneDescription> scenes = getScenes(42);
+    std::printf("%d ticks, seed 42, %s physics, up to %u threads\n", ticks,
+        g_deterministicPhysics ? "16.16 fixed point" : "float", maxThreads);
+    std::printf("%-8s %8s %12s %10s %12s %14s\n", "scene", "threads", "mean ns", "speedup", "efficiency",
+        "stolen/tick");
+    for (const SceneDescription& scene : scenes)
+    {
+        if (std::strcmp(scene.m_name, "large") != 0 && std::strcmp(scene.m_name, "crowded") != 0)
+            continue;
+        double singleThreadTime = 0.0;
+        for (unsigned int threads = 1; threads <= maxThreads; ++threads)
+        {
+            std::unique_ptr<JobSystem> jobSystem(threads > 1 ? new JobSystem(threads - 1) : nullptr);
+            const BenchmarkResult result = runScene(scene, ticks, jobSystem.get());
+            if (threads == 1)
+                singleThreadTime = result.m_meanTickTime;
+            const double speedup = singleThreadTime / result.m_meanTickTime;
+            std::printf("%-8s %8u %12.0f %10.2f %11.0f%% %14.1f\n", scene.m_name, threads, result.m_meanTickTime,
+                speedup, 100.0 * speedup / threads, result.m_stolenJobsPerTick);
+        }
+    }
+    return 0;
+}
+
+//the focus crosses the world once over the ticks, the cells are loaded while the ticks run without waiting
+static int streaming(const int argc, char* argv[])
+{
+    const int ticks = argc > 2 ? std::max(std::atoi(argv[2]), 1) : 2000;
+    const char* worldPath = argc > 3 ? argv[3] : "streamed.world";
+    const SceneDescription description = {"streamed", 2000, 3000, 1500, 42, 18000.f, 1152.f, true, 0};
+    constexpr float cellSize = 512.f;
+    g_sceneWidth = static_cast<int>(description.m_width);
+    g_sceneHeight = static_cast<int>(description.m_height);
+    const float deltaTime = FIXED_UPDATE_TIME / 1000.f;
+    std::vector<TriggerEvent> triggerEvents;
+
+    double wholeWorldTime = 0.0;
+    size_t worldEntities = 0;
+    {
+        EntityManager entityManager(nullptr);
+        SceneGenerator::generate(entityManager, description);
+        worldEntities = entityManager.getEntities().size();
+        if (!WorldStreamer::writeWorld(worldPath, entityManager, cellSize))
+        {
+            std::printf("Couldn't write the world %s\n", worldPath);
+            return 1;
+        }
+        for (int i = 0; i < ticks; ++i)
+        {
+            const auto start = std::chrono::steady_clock::now();
+            entityManager.stepPhysics(deltaTime);
+            wholeWorldTime += elapsedNanoseconds(start);
+            entityManager.drainTriggerEvents(triggerEvents);
+        }
+    }
+
+    JobSystem jobSystem;
+    EntityManager entityManager(nullptr);
+    //closed before the entity manager and the job system go
+    WorldStreamer worldStreamer;
+    worldStreamer.setLoadRadius(STREAMING_LOAD_RADIUS);
+    if (!worldStreamer.open(worldPath, entityManager, &jobSystem))
+    {
+        std::printf("Couldn't open the world %s\n", worldPath);
+        return 1;
+    }
+    double streamedTime = 0.0;
+    double worstFrameTime = 0.0;
+    size_t peakEntities = 0;
+    for (int i = 0; i < ticks; ++i)
+    {
+        const Vec2<float> focus = {description.m_width * static_cast<float>(i) / ticks, description.m_height / 2.f};
+        const auto start = std::chrono::steady_clock::now();
+        worldStreamer.update(focus);
+        if (worldStreamer.hasPendingChanges())
+            worldStreamer.integrate();
+        entityManager.stepPhysics(deltaTime);
+        const double frameTime = elapsedNanoseconds(start);
+        streamedTime += frameTime;
+        worstFrameTime = std::max(worstFrameTime, frameTime);
+        peakEntities = std::max(peakEntities, entityManager.getEntities().size());
+        entityManager.drainTriggerEvents(triggerEvents);
+    }
+
+    const StreamingStats& stats = worldStreamer.getStats();
+    std::printf("%d ticks, %.0fx%.0f world of %zu entities in cells of %.0f px, written to %s\n", ticks,
+        description.m_width, description.m_height, worldEntities, cellSize, worldPath);
+    std::printf("resident cells %u  peak entities %zu  loaded %u  evicted %u  still loading %u\n",
+        stats.m_residentCells, peakEntities, stats.m_loadedCells, stats.m_evictedCells, stats.m_pendingCells);
+    std::printf("load latency mean %.2f ms  worst %.2f ms  hitches %u  worst integration %.2f ms\n",
+        stats.m_meanLoadLatency, stats.m_worstLoadLatency, stats.m_hitches, stats.m_worstIntegrationTime);
+    std::printf("mean tick %.0f ns streamed (worst %.0f ns), %.0f ns with the whole world\n", streamedTime / ticks,
+        worstFrameTime, wholeWorldTime / ticks);
+    return 0;
+}
+
+//the particles that die are emitted again at once, the frame is the update, the quads and the draw into a surface
+static int particles(const int argc, char* argv[])
+{
+    const size_t count = argc > 2 ? static_cast<size_t>(std::max(std::atoi(argv[2]), 1))
+        : static_cast<size_t>(PARTICLE_BUDGET);
+    const int frames = argc > 3 ? std::max(std::atoi(argv[3]), 1) : 600;
+    constexpr float deltaTime = 1.f / 60.f;
+    JobSystem jobSystem;
+    ParticleSystem particleSystem(count);
+    const ParticleEmitterDefinition definition = {
+        nullptr, 0, 20.f, 200.f, -180.f, 180.f, 1.f, 3.f, 100.f, 2.f, {255, 200, 80, 255}, {255, 80, 40, 255}
+    };
+    //untextured like the game's dust and confetti, both go into one draw call
+    const int emitters[] = {
+        particleSystem.addEmitter(definition, nullptr), particleSystem.addEmitter(definition, nullptr)
+    };
+    //without a video device, the software renderer draws into a plain surface
+    SDL_Surface* surface = SDL_CreateRGBSurfaceWithFormat(0, SCREEN_WIDTH, SCREEN_HEIGHT, 32,
+        SDL_PIXELFORMAT_ARGB8888);
+    SDL_Renderer* renderer = surface ? SDL_CreateSoftwareRenderer(surface) : nullptr;
+    const SDL_Rect screenRect = {0, 0, SCREEN_WIDTH, SCREEN_HEIGHT};
+    std::mt19937 random(42);
+    std::uniform_real_distribution<float> xs(0.f, static_cast<float>(SCREEN_WIDTH));
+    std::uniform_real_distribution<float> ys(0.f, static_cast<float>(SCREEN_HEIGHT));
+
+    double updateTime = 0.0;
+    double prepareTime = 0.0;
+    double submitTime = 0.0;
+    double worstFrameTime = 0.0;
+    for (int frame = 0; frame < frames; ++frame)
+    {
+        for (int burst = 0; particleSystem.getStats().m_liveParticles < count; ++burst)
+        {
+            const size_t missing = count - particleSystem.getStats().m_liveParticles;
+            particleSystem.emit(emitters[burst % 2], {xs(random), ys(random)}, std::min<size_t>(missing, 256));
+        }
+        const auto start = std::chrono::steady_clock::now();
+        particleSystem.update(deltaTime, &jobSystem);
+        const double updated = elapsedNanoseconds(start);
+        particleSystem.prepare(0.f, &jobSystem);
+        const double prepared = elapsedNanoseconds(start);
+        if (renderer)
+        {
+            SDL_RenderClear(renderer);
+            particleSystem.submit(renderer, screenRect);
+        }
+        const double frameTime = elapsedNanoseconds(start);
+        updateTime += updated;
+        prepareTime += prepared - updated;
+        submitTime += frameTime - prepared;
+        worstFrameTime = std::max(worstFrameTime, frameTime);
+    }
+    if (renderer)
+        SDL_DestroyRenderer(renderer);
+    SDL_FreeSurface(surface);
+
+    const double meanFrameTime = (updateTime + prepareTime + submitTime) / frames / 1e6;
+    std::printf("%zu particles over %d frames, %u workers\n", count, frames, jobSystem.getWorkerCount());
+    std::printf("update %.3f ms  quads %.3f ms  draw %.3f ms in %u calls%s\n", updateTime / frames / 1e6,
+        prepareTime / frames / 1e6, submitTime / frames / 1e6, particleSystem.getStats().m_drawCalls,
+        renderer ? "" : " (no software renderer)");
+    //without the draw the frame says nothing about the target
+    if (!renderer)
+        std::printf("mean frame %.2f ms  worst %.2f ms without the draw, 60 FPS not measured\n", meanFrameTime,
+            worstFrameTime / 1e6);
+    else
+        std::printf("mean frame %.2f ms  worst %.2f ms, %s 60 FPS\n", meanFrameTime, worstFrameTime / 1e6,
+            meanFrameTime <= 1000.0 / 60.0 ? "holds" : "misses");
+    return 0;
+}
+
+//the frame is the one pass over the coins' animations, the atlases need the images in the working directory
+static int animations(const int argc, char* argv[])
+{
+    const int coins = argc > 2 ? std::max(std::atoi(argv[2]), 1) : 5000;
+    const int frames = argc > 3 ? std::max(std::atoi(argv[3]), 1) : 600;
+    constexpr float deltaTime = 1.f / 60.f;
+    SDL_Surface* surface = SDL_CreateRGBSurfaceWithFormat(0, SCREEN_WIDTH, SCREEN_HEIGHT, 32,
+        SDL_PIXELFORMAT_ARGB8888);
+    SDL_Renderer* renderer = surface ? SDL_CreateSoftwareRenderer(surface) : nullptr;
+    double passTime = 0.0;
+    double worstPassTime = 0.0;
+    bool hasAtlas = false;
+    {
+        EntityManager entityManager(renderer);
+        const int columns = std::max(SCREEN_WIDTH / 16, 1);
+        for (int i = 0; i < coins; ++i)
+        {
+            entityManager.addCollectible(BASE_COLLECTIBLE_TEXTURE, {
+                static_cast<float>(i % columns * 16), static_cast<float>(i / columns % 60 * 16), 16.f, 16.f
+            });
+        }
+        hasAtlas = entityManager.getAnimations().getClip(CLIP_COIN_SPIN).m_atlas != nullptr;
+        for (int frame = 0; frame < frames; ++frame)
+        {
+            const auto start = std::chrono::steady_clock::now();
+            entityManager.updateAnimations(deltaTime);
+            const double frameTime = elapsedNanoseconds(start);
+            passTime += frameTime;
+            worstPassTime = std::max(worstPassTime, frameTime);
+        }
+    }
+    if (renderer)
+        SDL_DestroyRenderer(renderer);
+    SDL_FreeSurface(surface);
+
+    std::printf("%d coins over %d frames\n", coins, frames);
+    std::printf("animation pass %.3f ms  worst %.3f ms%s\n", passTime / frames / 1e6, worstPassTime / 1e6,
+        hasAtlas ? "" : " (no atlas, the frames are only picked)");
+    return 0;
+}
+
+struct JobCheck
+{
+    std::atomic<int> m_dependencyDone{0};
+    std::atomic<int> m_continuationsRun{0};
+    std::atomic<int> m_orderErrors{0};
+    std::atomic<Uint64> m_sums[3];
+};
+
+//a fan-in past the continuations one job holds, then parallelFors with more batches than there are job slots
+//from this thread and two others at once
+static int jobs(const int argc, char* argv[])
+{
+    const int rounds = argc > 2 ? std::max(std::atoi(argv[2]), 1) : 100;
+    constexpr int continuationCount = 3 * Job::s_maxContinuations;
+    constexpr size_t count = 3 * JobSystem::s_poolSize;
+    constexpr Uint64 expectedSum = static_cast<Uint64>(count) * (count - 1) / 2;
+    JobSystem jobSystem;
+    int failures = 0;
+    const auto start = std::chrono::steady_clock::now();
+    for (int round = 0; round < rounds; ++round)
+    {
+        JobCheck check;
+        JobCheck* checkPointer = &check;
+        Job* dependency = jobSystem.createJob("Dependency", [checkPointer]
+        {
+            std::this_thread::yield();
+            checkPointer->m_dependencyDone.store(1, std::memory_order_release);
+        });
+        Job* continuations = jobSystem.createJob("Continuations", [] {});
+        const JobHandle continuationsHandle = JobSystem::getHandle(continuations);
+        for (int i = 0; i < continuationCount; ++i)
+        {
+            Job* continuation = jobSystem.createJob("Continuation", [checkPointer]
+            {
+                if (checkPointer->m_dependencyDone.load(std::memory_order_acquire) == 0)
+                    ++checkPointer->m_orderErrors;
+                ++checkPointer->m_continuationsRun;
+            }, continuations);
+            jobSystem.addDependency(continuation, dependency);
+            jobSystem.run(continuation);
+        }
+        jobSystem.run(continuations);
+        jobSystem.run(dependency);
+        jobSystem.wait(continuationsHandle);
+
+        for (std::atomic<Uint64>& sum : check.m_sums)
+            sum.store(0, std::memory_order_relaxed);
+        auto sumRange = [&jobSystem, checkPointer](const int p_sum)
+        {
+            jobSystem.parallelFor("SumBatch", count, 1, [checkPointer, p_sum](const size_t p_start, const size_t p_end)
+            {
+                for (size_t i = p_start; i < p_end; ++i)
+                    checkPointer->m_sums[p_sum].fetch_add(i, std::memory_order_relaxed);
+            });
+        };
+        std::thread first(sumRange, 1);
+        std::thread second(sumRange, 2);
+        sumRange(0);
+        first.join();
+        second.join();
+
+        bool hasFailed = check.m_orderErrors != 0 || check.m_continuationsRun != continuationCount;
+        for (const std::atomic<Uint64>& sum : check.m_sums)
+            hasFailed |= sum.load() != expectedSum;
+        if (hasFailed)
+        {
+            std::printf("round %d: %d/%d continuations, %d before their dependency, sums %llu %llu %llu of %llu\n",
+                round, check.m_continuationsRun.load(), continuationCount, check.m_orderErrors.load(),
+                static_cast<unsigned long long>(check.m_sums[0].load()),
+                static_cast<unsigned long long>(check.m_sums[1].load()),
+                static_cast<unsigned long long>(check.m_sums[2].load()), static_cast<unsigned long long>(expectedSum));
+            ++failures;
+        }
+    }
+    std::printf("%d rounds on %u workers, %d failed, %.3f ms each\n", rounds, jobSystem.getWorkerCount(), failures,
+        elapsedNanoseconds(start) / rounds / 1e6);
+    return failures == 0 ? 0 : 1;
+}
+
+int main(int argc, char* argv[])
+{
+    if (argc > 1 && std::strcmp(argv[1], "--replay") == 0)
+        return replay(argc, argv);
+    if (argc > 1 && std::strcmp(argv[1], "--loopback") == 0)
+        return loopback(argc, argv);
+    if (argc > 1 && std::strcmp(argv[1], "--scaling") == 0)
+        return scaling(argc, argv);
+    if (argc > 1 && std::strcmp(argv[1], "--streaming") == 0)
+        return streaming(argc, argv);
+    if (argc > 1 && std::strcmp(argv[1], "--particles") == 0)
+        return particles(argc, argv);
+    if (argc > 1 && std::strcmp(argv[1], "--animations") == 0)
+        return animations(argc, argv);
+    if (argc > 1 && std::strcmp(argv[1], "--jobs") == 0)
+        return jobs(argc, argv);
+
+    const int ticks = argc > 1 ? std::max(std::atoi(argv[1]), 1) : 1000;
+    const Uint32 seed = argc > 2 ? static_cast<Uint32>(std::strtoul(argv[2], nullptr, 10)) : 42;
+    const unsigned int threads = argc > 3 ? static_cast<unsigned int>(std::atoi(argv[3])) : 0;
+
+    const std::vector<SceneDescription> scenes = getScenes(seed);
+    //1 thread runs everything on this one, 0 gives one thread per core
+    std::unique_ptr<JobSystem> jobSystem(threads != 1 ? new JobSystem(threads != 0 ? threads - 1 : 0) : nullptr);
+
+    std::printf("%d ticks, seed %u, %s physics\n", ticks, seed, g_deterministicPhysics ? "16.16 fixed point" : "float");
+    std::printf("%-8s %8s %12s %12s %12s %12s %10s %12s %18s %10s %10s %10s\n", "scene", "entities", "mean ns",
+        "median ns", "worst ns", "pair tests", "allocs", "bytes", "checksum", "push ns", "restore ns", "snap bytes");
+    std::vector<BenchmarkResult> results;
+    for (const SceneDescription& scene : scenes)
+    {
+        results.push_back(runScene(scene, ticks, jobSystem.get()));
+        const BenchmarkResult& result = results.back();
+        //the ground and the platforms or the tilemap holding them
+        const int staticEntities = scene.m_tileSize > 0 ? 1 : 1 + scene.m_platforms;
+        const int entities = staticEntities + scene.m_crates + scene.m_coins + (scene.m_addPlayer ? 1 : 0);
+        std::printf("%-8s %8d %12.0f %12.0f %12.0f %12.1f %10.2f %12.1f %18llx %10.0f %10.0f %10.0f\n",
+            scene.m_name, entities, result.m_meanTickTime, result.m_medianTickTime, result.m_worstTickTime,
+            result.m_pairTestsPerTick, result.m_allocationsPerTick, result.m_bytesPerTick,
+            static_cast<unsigned long long>(result.m_checksum), result.m_snapshotPushTime,
+            result.m_snapshotRestoreTime, result.m_snapshotBytes);
+    }
+
+    std::printf("\n%-8s %-18s %14s %12s %16s\n", "scene", "system", "entities/tick", "mean us", "M entities/s");
+    for (size_t i = 0; i < results.size(); ++i)
+    {
+        for (const SystemStats& stats : results[i].m_systemStats)
+        {
+            const double runCount = std::max<double>(stats.m_runCount, 1.0);
+            const double throughput = stats.m_totalTime > 0.0 ?
+                static_cast<double>(stats.m_totalEntityCount) / stats.m_totalTime / 1000.0 : 0.0;
+            std::printf("%-8s %-18s %14.0f %12.2f %16.2f\n", scenes[i].m_name, stats.m_name,
+                static_cast<double>(stats.m_totalEntityCount) / runCount, stats.m_totalTime * 1000.0 / runCount,
+                throughput);
+        }
+    }
+    return 0;
+}
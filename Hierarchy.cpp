@@ -1,10 +1,22 @@
 ﻿#include "Hierarchy.h"
 
+#include <algorithm>
+#include <cctype>
+
 #include "SDLHandler.h"
 
-Hierarchy::Hierarchy(SDL_Renderer* p_renderer, TTF_Font* p_font,
-                     EntityManager* p_entityManager) : m_renderer(p_renderer),
-                                                       m_font(p_font), m_entityManager(p_entityManager)
+static bool containsIgnoringCase(const std::string& p_text, const std::string& p_lowercasePart)
+{
+    return std::search(p_text.cbegin(), p_text.cend(), p_lowercasePart.cbegin(), p_lowercasePart.cend(),
+        [](const char p_textCharacter, const char p_partCharacter)
+        {
+            return std::tolower(static_cast<unsigned char>(p_textCharacter)) == p_partCharacter;
+        }) != p_text.cend();
+}
+
+Hierarchy::Hierarchy(SDL_Renderer* p_renderer, TTF_Font* p_font, GlyphAtlas* p_glyphAtlas,
+                     EntityManager* p_entityManager) : m_renderer(p_renderer), m_glyphAtlas(p_glyphAtlas),
+                                                       m_entityManager(p_entityManager), m_inspector(nullptr)
 {
     m_rect = {0, 0, HIERARCHY_WIDTH, HIERARCHY_HEIGHT};
     SDL_Surface* surface = SDL_CreateRGBSurface(0, m_rect.w, m_rect.h, 32, 0, 0, 0, 0);
@@ -12,64 +24,170 @@ Hierarchy::Hierarchy(SDL_Renderer* p_renderer, TTF_Font* p_font,
     SDL_FillRect(surface, &temp, SDL_MapRGBA(surface->format, 0, 0, 255, 255));
     m_texture = SDL_CreateTextureFromSurface(m_renderer, surface);
 
-    SDL_Surface* titleSurface = TTF_RenderText_Solid(m_font, "Hierarchy", m_fontColor);
+    SDL_Surface* titleSurface = TTF_RenderText_Solid(p_font, "Hierarchy", m_fontColor);
     m_titleTexture = SDL_CreateTextureFromSurface(m_renderer, titleSurface);
     m_titleRect = {
         m_rect.x + HIERARCHY_WIDTH / 2 - titleSurface->w / 2, m_rect.y, titleSurface->w, titleSurface->h
     };
 
-    m_infosPos = {HIERARCHY_WIDTH / 50, m_titleRect.y + m_titleRect.h};
+    m_rowHeight = m_glyphAtlas->getLineHeight();
+    const int margin = HIERARCHY_WIDTH / 50;
+    m_filterRect = {margin, m_titleRect.y + m_titleRect.h, HIERARCHY_WIDTH - 2 * margin, m_rowHeight};
+    m_rowsRect = {
+        margin, m_filterRect.y + m_filterRect.h + margin, HIERARCHY_WIDTH - 2 * margin,
+        HIERARCHY_HEIGHT - (m_filterRect.y + m_filterRect.h + margin)
+    };
 
     SDL_FreeSurface(surface);
     SDL_FreeSurface(titleSurface);
-    updateHierarchy();
+    m_entityManager->setRecordsEntityListEvents(true);
+    rebuildRows();
 }
 
-Hierarchy::~Hierarchy() { SDL_DestroyTexture(m_texture); }
+Hierarchy::~Hierarchy()
+{
+    m_entityManager->setRecordsEntityListEvents(false);
+    SDL_DestroyTexture(m_texture);
+}
 
 void Hierarchy::updateHierarchy()
 {
-    for (const EntityInfo& entityInfo : m_entityInfos)
-        SDL_DestroyTexture(entityInfo.m_textTexture);
-    m_entityInfos.clear();
-
-    const std::vector<Entity*> entities = m_entityManager->getEntities();
-    unsigned short int count = 0;
-    TTF_SetFontSize(m_font, static_cast<int>(0.0167f * SCREEN_HEIGHT));
-    for (const Entity* entity : entities)
+    m_entityManager->drainEntityListEvents(m_events);
+    for (const EntityListEvent& event : m_events)
     {
-        SDL_Surface* currEntityInfoSurface = TTF_RenderText_Solid_Wrapped(m_font, entity->getName().c_str(), m_fontColor,
-            HIERARCHY_WIDTH);
-        SDL_Rect currEntityRect = {
-            m_infosPos.x, m_infosPos.y + count * currEntityInfoSurface->h, currEntityInfoSurface->w,
-            currEntityInfoSurface->h
-        };
-        m_entityInfos.emplace_back(SDL_CreateTextureFromSurface(m_renderer, currEntityInfoSurface), currEntityRect,
-            entity);
-        SDL_FreeSurface(currEntityInfoSurface);
-        ++count;
+        switch (event.m_type)
+        {
+        case ENTITY_ADDED:
+        case ENTITY_RENAMED:
+            {
+                //an entity added then deleted before this update is already gone
+                Entity* entity = m_entityManager->getEntityById(event.m_id);
+                const auto row = findRow(event.m_id);
+                const bool isListed = row != m_rows.end() && row->m_id == event.m_id;
+                const bool isShown = entity && matchesFilter(entity);
+                if (isShown && !isListed)
+                    m_rows.insert(row, {event.m_id, entity});
+                else if (!isShown && isListed)
+                    m_rows.erase(row);
+                break;
+            }
+        case ENTITY_REMOVED:
+            {
+                const auto row = findRow(event.m_id);
+                if (row != m_rows.end() && row->m_id == event.m_id)
+                    m_rows.erase(row);
+                break;
+            }
+        case ENTITY_LIST_CLEARED:
+            m_rows.clear();
+            break;
+        }
     }
-    TTF_SetFontSize(m_font, static_cast<int>(0.0278f * SCREEN_HEIGHT));
+    clampScroll();
 }
 
-void Hierarchy::displayHierarchy() const
+void Hierarchy::displayHierarchy()
 {
+    updateHierarchy();
     SDL_RenderCopy(m_renderer, m_texture, nullptr, &m_rect);
     SDL_RenderCopy(m_renderer, m_titleTexture, nullptr, &m_titleRect);
-    for (const EntityInfo& entityInfo : m_entityInfos)
+
+    SDL_SetRenderDrawColor(m_renderer, m_fontColor.r, m_fontColor.g, m_fontColor.b, m_fontColor.a);
+    SDL_RenderDrawRect(m_renderer, &m_filterRect);
+    if (m_filter.empty())
+        m_glyphAtlas->addText("Filter by name or type", static_cast<float>(m_filterRect.x + 2),
+            static_cast<float>(m_filterRect.y), m_filterHintColor);
+    else
+        m_glyphAtlas->addText(m_filter.c_str(), static_cast<float>(m_filterRect.x + 2),
+            static_cast<float>(m_filterRect.y), m_fontColor);
+    SDL_RenderSetClipRect(m_renderer, &m_filterRect);
+    m_glyphAtlas->flush();
+
+    //long names are cut at the panel's edge
+    const size_t lastVisibleRow = std::min(m_rows.size(), m_firstVisibleRow + getVisibleRowsNumber());
+    float y = static_cast<float>(m_rowsRect.y);
+    for (size_t i = m_firstVisibleRow; i < lastVisibleRow; ++i, y += static_cast<float>(m_rowHeight))
+        m_glyphAtlas->addText(m_rows[i].m_entityPtr->getName().c_str(), static_cast<float>(m_rowsRect.x), y,
+            m_fontColor);
+    SDL_RenderSetClipRect(m_renderer, &m_rowsRect);
+    m_glyphAtlas->flush();
+    SDL_RenderSetClipRect(m_renderer, nullptr);
+
+    if (m_rows.size() > static_cast<size_t>(getVisibleRowsNumber()))
     {
-        const SDL_Rect& currRect = entityInfo.m_textRect;
-        SDL_RenderCopy(m_renderer, entityInfo.m_textTexture, nullptr, &currRect);
+        //the scrollbar's thumb, as tall as the visible part of the list
+        const int thumbHeight = std::max(m_rowHeight / 2,
+            static_cast<int>(static_cast<Uint64>(m_rowsRect.h) * getVisibleRowsNumber() / m_rows.size()));
+        const int thumbY = m_rowsRect.y + static_cast<int>(static_cast<Uint64>(m_rowsRect.h - thumbHeight) *
+            m_firstVisibleRow / (m_rows.size() - getVisibleRowsNumber()));
+        const SDL_Rect thumbRect = {m_rect.x + m_rect.w - m_rowsRect.x, thumbY, m_rowsRect.x, thumbHeight};
+        SDL_RenderFillRect(m_renderer, &thumbRect);
     }
 }
-bool Hierarchy::detectClickedName(const int p_x, const int p_y) const
+
+bool Hierarchy::detectClickedName(const int p_x, const int p_y)
 {
-    for (const EntityInfo& entityInfo : m_entityInfos)
+    if (detectButtonClicked(p_x, p_y, m_filterRect))
     {
-        if (!detectButtonClicked(p_x, p_y, entityInfo.m_textRect))
-            continue;
-        m_inspector->selectEntity(const_cast<Entity*>(entityInfo.m_entityPtr));
+        setFilter(Inspector::readTextInput({p_x, p_y + m_filterRect.h, m_filterRect.w, m_filterRect.h}));
         return true;
     }
-    return false;
+    if (!detectButtonClicked(p_x, p_y, m_rowsRect))
+        return false;
+    //a deleted entity must not be selected
+    updateHierarchy();
+    const size_t row = m_firstVisibleRow + static_cast<size_t>((p_y - m_rowsRect.y) / m_rowHeight);
+    if (row >= m_rows.size())
+        return false;
+    m_inspector->selectEntity(m_rows[row].m_entityPtr);
+    return true;
+}
+
+void Hierarchy::scroll(const int p_rows)
+{
+    if (p_rows < 0)
+        m_firstVisibleRow -= std::min(m_firstVisibleRow, static_cast<size_t>(-p_rows));
+    else
+        m_firstVisibleRow += static_cast<size_t>(p_rows);
+    clampScroll();
+}
+
+void Hierarchy::setFilter(const std::string& p_filter)
+{
+    m_filter.resize(p_filter.size());
+    std::transform(p_filter.cbegin(), p_filter.cend(), m_filter.begin(),
+        [](const char p_character) { return static_cast<char>(std::tolower(static_cast<unsigned char>(p_character))); });
+    m_firstVisibleRow = 0;
+    rebuildRows();
+}
+
+void Hierarchy::rebuildRows()
+{
+    //the queued events are already part of the entity list
+    m_entityManager->drainEntityListEvents(m_events);
+    m_rows.clear();
+    for (Entity* entity : m_entityManager->getEntities())
+        if (matchesFilter(entity))
+            m_rows.push_back({entity->getId(), entity});
+    clampScroll();
+}
+
+bool Hierarchy::matchesFilter(const Entity* p_entity) const
+{
+    return m_filter.empty() || containsIgnoringCase(p_entity->getName(), m_filter) ||
+        containsIgnoringCase(p_entity->getTypeName(), m_filter);
+}
+
+std::vector<Hierarchy::Row>::iterator Hierarchy::findRow(const Uint16 p_id)
+{
+    return std::lower_bound(m_rows.begin(), m_rows.end(), p_id,
+        [](const Row& p_row, const Uint16 p_rowId) { return p_row.m_id < p_rowId; });
+}
+
+void Hierarchy::clampScroll()
+{
+    const size_t visibleRowsNumber = static_cast<size_t>(getVisibleRowsNumber());
+    m_firstVisibleRow = m_rows.size() > visibleRowsNumber
+                            ? std::min(m_firstVisibleRow, m_rows.size() - visibleRowsNumber)
+                            : 0;
 }
@@ -3,43 +3,62 @@
 #include <SDL_ttf.h>
 
 #include "EntityManager.h"
+#include "GlyphAtlas.h"
 #include "Inspector.h"
 
 
+//Only the rows inside the panel are drawn. The filtered rows are kept in creation order and follow the
+//entity manager's add, remove and rename events, so an edit costs a binary search instead of a rebuild.
 class Hierarchy
 {
 public:
-    Hierarchy(SDL_Renderer* p_renderer, TTF_Font* p_font, EntityManager* p_entityManager);
+    //p_font only draws the title, the names are drawn from p_glyphAtlas
+    Hierarchy(SDL_Renderer* p_renderer, TTF_Font* p_font, GlyphAtlas* p_glyphAtlas, EntityManager* p_entityManager);
     ~Hierarchy();
+    //applies the events queued since the last call, done before displaying or clicking
     void updateHierarchy();
-    void displayHierarchy() const;
+    void displayHierarchy();
     void setInspector(Inspector* p_inspector) { m_inspector = p_inspector; }
-    bool detectClickedName(int p_x, int p_y) const;
+    //a click on the filter box asks for a new filter
+    bool detectClickedName(int p_x, int p_y);
+    //positive p_rows go down the list
+    void scroll(int p_rows);
+    //keeps the entities whose name or type contains p_filter, ignoring the case. Empty shows them all
+    void setFilter(const std::string& p_filter);
 private:
-    struct EntityInfo
+    struct Row
     {
-        EntityInfo(SDL_Texture* p_textTexture, SDL_Rect p_textRect,
-                   const Entity* p_entityPtr) : m_textTexture(p_textTexture), m_textRect(p_textRect),
-                                                m_entityPtr(p_entityPtr)
-        {
-        }
-        SDL_Texture* m_textTexture;
-        SDL_Rect m_textRect;
-        const Entity* m_entityPtr;
+        //the entity may already be deleted when its ENTITY_REMOVED event is applied
+        Uint16 m_id;
+        Entity* m_entityPtr;
     };
 
+    void rebuildRows();
+    bool matchesFilter(const Entity* p_entity) const;
+    //first row whose id isn't below p_id
+    std::vector<Row>::iterator findRow(Uint16 p_id);
+    int getVisibleRowsNumber() const { return m_rowsRect.h / m_rowHeight; }
+    void clampScroll();
+
     SDL_Renderer* m_renderer;
-    TTF_Font* m_font;
+    GlyphAtlas* m_glyphAtlas;
     SDL_Color m_fontColor = {200, 200, 200, 255};
+    SDL_Color m_filterHintColor = {120, 120, 160, 255};
     SDL_Texture* m_texture;
     SDL_Rect m_rect;
 
     SDL_Texture* m_titleTexture;
     SDL_Rect m_titleRect;
 
-    Vec2<int> m_infosPos;
+    SDL_Rect m_filterRect;
+    SDL_Rect m_rowsRect;
+    int m_rowHeight;
 
     EntityManager* m_entityManager;
-    std::vector<EntityInfo> m_entityInfos;
+    std::vector<Row> m_rows;
+    std::vector<EntityListEvent> m_events;
+    size_t m_firstVisibleRow = 0;
+    //lowercase
+    std::string m_filter;
     Inspector* m_inspector;
 };
@@ -1,6 +1,11 @@
 ﻿#include "InputManager.h"
 #include "Gameloop.h"
+#include "Hierarchy.h"
 #include "Inspector.h"
+#include "NetworkSession.h"
+#include "PerformanceOverlay.h"
+#include "Profiler.h"
+#include <iostream>
 
 extern int g_scenePosX;
 extern int g_scenePosY;
@@ -43,6 +48,22 @@ void InputManager::checkInput()
             case SDLK_KP_BACKSPACE:
                 m_controls[DELETE] = true;
                 break;
+            case SDLK_PAGEUP:
+                m_gameloop->scrubTicks(-1);
+                break;
+            case SDLK_PAGEDOWN:
+                m_gameloop->scrubTicks(1);
+                break;
+            case SDLK_F2:
+                if (m_performanceOverlay)
+                    m_performanceOverlay->toggle();
+                break;
+#ifdef ENGINE_PROFILING
+            case SDLK_F3:
+                if (!Profiler::dumpChromeTrace(BASE_PROFILE_TRACE_PATH))
+                    std::cerr << "Couldn't write the profile trace" << std::endl;
+                break;
+#endif
             default:
                 break;
             }
@@ -78,6 +99,11 @@ void InputManager::checkInput()
                 break;
             break;
 
+        case SDL_MOUSEWHEEL:
+            if (!m_gameloop->getPlayingGame() && m_event.wheel.mouseX < g_scenePosX)
+                m_hierarchy->scroll(-m_event.wheel.y * 3);
+            break;
+
         case SDL_MOUSEBUTTONDOWN:
             if (m_event.button.button == SDL_BUTTON_LEFT)
             {
@@ -115,30 +141,26 @@ void InputManager::checkInput()
 
 void InputManager::sendControls()
 {
+    if (InputRecorder* inputRecorder = m_entityManager->getInputRecorder())
+        inputRecorder->recordControls(m_entityManager->getTick(), m_controls);
+
     if (!m_gameloop->getPlayingGame() && m_controls[DELETE])
     {
         const Entity* toDeleteEntity = m_inspector->getSelectedEntity();
         if (toDeleteEntity == nullptr)
             return;
         m_inspector->setEntityPtr(nullptr);
-        m_entityManager->deleteEntityUpdate(toDeleteEntity);
-        m_hierarchy->updateHierarchy();
+        m_entityManager->deleteEntity(toDeleteEntity);
         m_controls[DELETE] = false;
     }
 
+    if (m_networkSession)
+    {
+        m_networkSession->setLocalControls(m_controls);
+        return;
+    }
     if (!m_player)
         return;
 
-    if (m_controls[UP])
-        if (m_player->getOnGround())
-        {
-            m_player->playJumpSound();
-            m_player->setYVelocity(-250.f);
-        }
-    if (m_controls[RIGHT])
-        m_player->setXVelocity(100.f);
-    if (m_controls[LEFT])
-        m_player->setXVelocity(-100.f);
-    if ((m_controls[LEFT] ^ m_controls[RIGHT]) == false)
-        m_player->setXVelocity(0.f);
+    m_player->applyControls(m_controls);
 }
@@ -4,7 +4,10 @@
 #include "SDLHandler.h"
 
 class Gameloop;
+class Hierarchy;
 class Inspector;
+class NetworkSession;
+class PerformanceOverlay;
 
 class InputManager
 {
@@ -17,11 +20,17 @@ public:
     void checkInput();
     void sendControls();
     void setPlayerInstance(Player* p_player) { m_player = p_player; }
+    //the controls are then sent to the session, its ticks apply them
+    void setNetworkSession(NetworkSession* p_networkSession) { m_networkSession = p_networkSession; }
     void setGameloopObject(Gameloop* p_gameloop) { m_gameloop = p_gameloop; }
     void setGameStateButtonsObject(GameStateButtons* p_gameStateButtons) { m_gameStateButtons = p_gameStateButtons; }
     void setEntityChooser(EntityChooser* p_entityChooser) { m_entityChooser = p_entityChooser; }
     void setHierarchy(Hierarchy* p_hierarchy) { m_hierarchy = p_hierarchy; }
     void setEntityManager(EntityManager* p_entityManager) { m_entityManager = p_entityManager; }
+    void setPerformanceOverlay(PerformanceOverlay* p_performanceOverlay)
+    {
+        m_performanceOverlay = p_performanceOverlay;
+    }
 private:
     SDL_Event m_event = {0};
     bool* m_isPlaying;
@@ -33,4 +42,6 @@ private:
     GameStateButtons* m_gameStateButtons;
     EntityChooser* m_entityChooser;
     EntityManager* m_entityManager;
+    PerformanceOverlay* m_performanceOverlay = nullptr;
+    NetworkSession* m_networkSession = nullptr;
 };
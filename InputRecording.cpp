@@ -0,0 +1,298 @@
+﻿#include "InputRecording.h"
+#include <fstream>
+#include <iterator>
+#include "EntityManager.h"
+
+//file layout: magic, version, then per event a varint tick delta, the type and its payload
+static const char s_recordingMagic[4] = {'E', '2', 'D', 'R'};
+static constexpr Uint8 s_recordingVersion = 1;
+
+Uint8 InputRecorder::packControls(const bool* p_controls)
+{
+    Uint8 packedControls = 0;
+    for (int i = 0; i < CONTROLS_NUMBER; ++i)
+        if (p_controls[i])
+            packedControls |= static_cast<Uint8>(1 << i);
+    return packedControls;
+}
+
+void InputRecorder::unpackControls(const Uint8 p_packedControls, bool* p_controls)
+{
+    for (int i = 0; i < CONTROLS_NUMBER; ++i)
+        p_controls[i] = (p_packedControls >> i & 1) != 0;
+}
+
+void InputRecorder::start()
+{
+    m_buffer.assign(s_recordingMagic, s_recordingMagic + sizeof(s_recordingMagic));
+    m_buffer.push_back(s_recordingVersion);
+    m_lastControls = 0;
+    m_lastTick = 0;
+    m_isRecording = true;
+}
+
+bool InputRecorder::stop(const char* p_path, const Uint32 p_tick)
+{
+    if (!m_isRecording)
+        return false;
+    writeHeader(p_tick, RECORDED_END);
+    m_isRecording = false;
+    std::ofstream file(p_path, std::ios::binary);
+    file.write(reinterpret_cast<const char*>(m_buffer.data()), static_cast<std::streamsize>(m_buffer.size()));
+    m_buffer.clear();
+    return static_cast<bool>(file);
+}
+
+void InputRecorder::recordControls(const Uint32 p_tick, const bool* p_controls)
+{
+    const Uint8 packedControls = packControls(p_controls);
+    if (!m_isRecording || packedControls == m_lastControls)
+        return;
+    writeHeader(p_tick, RECORDED_CONTROLS);
+    m_buffer.push_back(packedControls);
+    m_lastControls = packedControls;
+}
+
+void InputRecorder::recordGameState(const Uint32 p_tick, const RecordedEventType_e p_type)
+{
+    if (m_isRecording)
+        writeHeader(p_tick, p_type);
+}
+
+void InputRecorder::recordEdit(const Uint32 p_tick, const Uint16 p_entityId, const std::string& p_infoName,
+                               const std::string& p_value)
+{
+    if (!m_isRecording)
+        return;
+    writeHeader(p_tick, RECORDED_EDIT);
+    writeVarint(p_entityId);
+    writeString(p_infoName);
+    writeString(p_value);
+}
+
+void InputRecorder::recordAddEntity(const Uint32 p_tick, const std::string& p_choiceName)
+{
+    if (!m_isRecording)
+        return;
+    writeHeader(p_tick, RECORDED_ADD_ENTITY);
+    writeString(p_choiceName);
+}
+
+void InputRecorder::recordDeleteEntity(const Uint32 p_tick, const Uint16 p_entityId)
+{
+    if (!m_isRecording)
+        return;
+    writeHeader(p_tick, RECORDED_DELETE_ENTITY);
+    writeVarint(p_entityId);
+}
+
+void InputRecorder::recordRestore(const Uint32 p_tick, const Uint32 p_restoredTick)
+{
+    if (!m_isRecording)
+        return;
+    writeHeader(p_tick, RECORDED_RESTORE);
+    writeVarint(p_restoredTick);
+    m_lastTick = p_restoredTick;
+}
+
+void InputRecorder::writeHeader(const Uint32 p_tick, const RecordedEventType_e p_type)
+{
+    //ticks only go forward outside of the restores, the delta is usually a single byte
+    writeVarint(p_tick - m_lastTick);
+    m_lastTick = p_tick;
+    m_buffer.push_back(p_type);
+}
+
+void InputRecorder::writeVarint(Uint32 p_value)
+{
+    while (p_value >= 0x80)
+    {
+        m_buffer.push_back(static_cast<Uint8>(p_value | 0x80));
+        p_value >>= 7;
+    }
+    m_buffer.push_back(static_cast<Uint8>(p_value));
+}
+
+void InputRecorder::writeString(const std::string& p_string)
+{
+    writeVarint(static_cast<Uint32>(p_string.size()));
+    m_buffer.insert(m_buffer.end(), p_string.begin(), p_string.end());
+}
+
+//reads from a byte range, any read past the end makes the whole load fail
+class RecordingReader
+{
+public:
+    RecordingReader(const std::vector<Uint8>& p_bytes, const size_t p_position) : m_bytes(p_bytes),
+        m_position(p_position)
+    {
+    }
+
+    bool isAtEnd() const { return m_position >= m_bytes.size(); }
+    bool getIsValid() const { return m_isValid; }
+
+    Uint8 readByte()
+    {
+        if (isAtEnd())
+        {
+            m_isValid = false;
+            return 0;
+        }
+        return m_bytes[m_position++];
+    }
+
+    Uint32 readVarint()
+    {
+        Uint32 value = 0;
+        for (int shift = 0; shift < 35 && m_isValid; shift += 7)
+        {
+            const Uint8 byte = readByte();
+            value |= static_cast<Uint32>(byte & 0x7F) << shift;
+            if ((byte & 0x80) == 0)
+                return value;
+        }
+        m_isValid = false;
+        return 0;
+    }
+
+    std::string readString()
+    {
+        const Uint32 size = readVarint();
+        if (!m_isValid || size > m_bytes.size() - m_position)
+        {
+            m_isValid = false;
+            return std::string();
+        }
+        std::string string(m_bytes.begin() + static_cast<std::ptrdiff_t>(m_position),
+            m_bytes.begin() + static_cast<std::ptrdiff_t>(m_position + size));
+        m_position += size;
+        return string;
+    }
+private:
+    const std::vector<Uint8>& m_bytes;
+    size_t m_position;
+    bool m_isValid = true;
+};
+
+bool InputReplayer::load(const char* p_path)
+{
+    m_events.clear();
+    std::ifstream file(p_path, std::ios::binary);
+    const std::vector<Uint8> bytes((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    if (bytes.size() < sizeof(s_recordingMagic) + 1 ||
+        !std::equal(s_recordingMagic, s_recordingMagic + sizeof(s_recordingMagic), bytes.begin()) ||
+        bytes[sizeof(s_recordingMagic)] != s_recordingVersion)
+        return false;
+
+    RecordingReader reader(bytes, sizeof(s_recordingMagic) + 1);
+    Uint32 tick = 0;
+    while (!reader.isAtEnd() && reader.getIsValid())
+    {
+        RecordedEvent event;
+        tick += reader.readVarint();
+        event.m_tick = tick;
+        const Uint8 type = reader.readByte();
+        if (type >= RECORDED_EVENT_TYPES_NUMBER)
+            return false;
+        event.m_type = static_cast<RecordedEventType_e>(type);
+        switch (event.m_type)
+        {
+        case RECORDED_CONTROLS:
+            event.m_controls = reader.readByte();
+            break;
+        case RECORDED_EDIT:
+            event.m_entityId = static_cast<Uint16>(reader.readVarint());
+            event.m_name = reader.readString();
+            event.m_value = reader.readString();
+            break;
+        case RECORDED_ADD_ENTITY:
+            event.m_name = reader.readString();
+            break;
+        case RECORDED_DELETE_ENTITY:
+            event.m_entityId = static_cast<Uint16>(reader.readVarint());
+            break;
+        case RECORDED_RESTORE:
+            event.m_restoredTick = reader.readVarint();
+            tick = event.m_restoredTick;
+            break;
+        default:
+            break;
+        }
+        m_events.push_back(event);
+    }
+    return reader.getIsValid() && !m_events.empty() && m_events.back().m_type == RECORDED_END;
+}
+
+void InputReplayer::run(EntityManager& p_entityManager, std::vector<Uint64>& p_tickHashes) const
+{
+    const float deltaTime = FIXED_UPDATE_TIME / 1000.f;
+    bool controls[CONTROLS_NUMBER] = {false};
+    bool isPlaying = false;
+    bool playerOnFinish = false;
+    std::vector<TriggerEvent> triggerEvents;
+    //the same ring as the editor's, the restores find the same snapshots
+    SnapshotRing snapshotRing(SNAPSHOT_RING_CAPACITY);
+    SnapshotRing* previousSnapshotRing = p_entityManager.getSnapshotRing();
+    p_entityManager.setSnapshotRing(&snapshotRing);
+
+    size_t eventIndex = 0;
+    while (eventIndex < m_events.size())
+    {
+        //every event recorded before this tick ran, in the order they were recorded
+        for (; eventIndex < m_events.size() && m_events[eventIndex].m_tick <= p_entityManager.getTick(); ++eventIndex)
+        {
+            const RecordedEvent& event = m_events[eventIndex];
+            switch (event.m_type)
+            {
+            case RECORDED_CONTROLS:
+                InputRecorder::unpackControls(event.m_controls, controls);
+                break;
+            case RECORDED_PLAY:
+                isPlaying = true;
+                p_entityManager.beginPlaySession();
+                break;
+            case RECORDED_PAUSE:
+                isPlaying = false;
+                break;
+            case RECORDED_STOP:
+                isPlaying = false;
+                playerOnFinish = false;
+                p_entityManager.endPlaySession();
+                break;
+            case RECORDED_EDIT:
+                if (Entity* entity = p_entityManager.getEntityById(event.m_entityId))
+                    p_entityManager.applyEntityEdit(entity, event.m_name, event.m_value);
+                break;
+            case RECORDED_ADD_ENTITY:
+                p_entityManager.addChosenEntity(event.m_name);
+                break;
+            case RECORDED_DELETE_ENTITY:
+                if (const Entity* entity = p_entityManager.getEntityById(event.m_entityId))
+                    p_entityManager.deleteEntity(entity);
+                break;
+            case RECORDED_RESTORE:
+                p_entityManager.restoreTick(event.m_restoredTick);
+                break;
+            default:
+                break;
+            }
+            //the editor applies them every frame, before the next event could edit what was added
+            p_entityManager.applyCommands();
+        }
+        //ticks only advance while playing, an event left over here means the session ended
+        if (eventIndex == m_events.size() || !isPlaying)
+            break;
+
+        //moved once per tick, as in the live game
+        if (Player* player = p_entityManager.getPlayer())
+            player->applyControls(controls);
+        for (Player* player : p_entityManager.getPlayers())
+            player->applyMovements(deltaTime);
+        p_entityManager.stepPhysics(deltaTime);
+        p_entityManager.drainTriggerEvents(triggerEvents);
+        for (const TriggerEvent& triggerEvent : triggerEvents)
+            p_entityManager.handleTriggerEvent(triggerEvent, playerOnFinish);
+        p_tickHashes.push_back(p_entityManager.computeStateHash());
+    }
+    p_entityManager.setSnapshotRing(previousSnapshotRing);
+}
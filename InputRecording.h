@@ -0,0 +1,79 @@
+﻿#pragma once
+#include <SDL_stdinc.h>
+#include <string>
+#include <vector>
+
+class EntityManager;
+
+enum RecordedEventType_e : Uint8
+{
+    RECORDED_CONTROLS,
+    RECORDED_PLAY,
+    RECORDED_PAUSE,
+    RECORDED_STOP,
+    RECORDED_EDIT,
+    RECORDED_ADD_ENTITY,
+    RECORDED_DELETE_ENTITY,
+    RECORDED_END,
+    RECORDED_RESTORE,
+
+    //LEAVE THIS AT THE END FOR AUTOMATIC INCREMENT
+    RECORDED_EVENT_TYPES_NUMBER
+};
+
+//Everything that changes the simulation, indexed by the fixed tick it happens before
+struct RecordedEvent
+{
+    Uint32 m_tick = 0;
+    RecordedEventType_e m_type = RECORDED_END;
+    //one bit per Controls value
+    Uint8 m_controls = 0;
+    Uint16 m_entityId = 0;
+    //edited info name or chosen entity name
+    std::string m_name;
+    std::string m_value;
+    //tick a RECORDED_RESTORE went back to, the following ticks count from it
+    Uint32 m_restoredTick = 0;
+};
+
+//Keeps the session in memory and writes it once, when the recording stops
+class InputRecorder
+{
+public:
+    static Uint8 packControls(const bool* p_controls);
+    static void unpackControls(Uint8 p_packedControls, bool* p_controls);
+
+    void start();
+    //p_tick is the last tick of the session
+    bool stop(const char* p_path, Uint32 p_tick);
+    bool getIsRecording() const { return m_isRecording; }
+
+    //only written when they differ from the last recorded controls
+    void recordControls(Uint32 p_tick, const bool* p_controls);
+    void recordGameState(Uint32 p_tick, RecordedEventType_e p_type);
+    void recordEdit(Uint32 p_tick, Uint16 p_entityId, const std::string& p_infoName, const std::string& p_value);
+    void recordAddEntity(Uint32 p_tick, const std::string& p_choiceName);
+    void recordDeleteEntity(Uint32 p_tick, Uint16 p_entityId);
+    void recordRestore(Uint32 p_tick, Uint32 p_restoredTick);
+private:
+    void writeHeader(Uint32 p_tick, RecordedEventType_e p_type);
+    void writeVarint(Uint32 p_value);
+    void writeString(const std::string& p_string);
+
+    bool m_isRecording = false;
+    Uint8 m_lastControls = 0;
+    Uint32 m_lastTick = 0;
+    std::vector<Uint8> m_buffer;
+};
+
+//Plays a recording back on a headless entity manager, one fixed tick at a time
+class InputReplayer
+{
+public:
+    bool load(const char* p_path);
+    const std::vector<RecordedEvent>& getEvents() const { return m_events; }
+    //runs the whole session, p_tickHashes gets the state hash after every tick, in the order they ran
+    void run(EntityManager& p_entityManager, std::vector<Uint64>& p_tickHashes) const;
+private:
+    std::vector<RecordedEvent> m_events;
+};
@@ -5,39 +5,48 @@
 #include <string>
 #include <vector>
 
+#include "EntityProperties.h"
 #include "GameStateButtons.h"
+#include "GlyphAtlas.h"
 
-class Hierarchy;
+class EntityManager;
 
 class Entity;
 
 class Inspector
 {
 public:
-    Inspector(SDL_Renderer* p_renderer, TTF_Font* p_font);
+    //p_font only draws the title, the infos are drawn from p_glyphAtlas
+    Inspector(SDL_Renderer* p_renderer, TTF_Font* p_font, GlyphAtlas* p_glyphAtlas);
     void displayInspector();
     bool selectEntity(Entity* p_entity);
-    void displayEntityInfos(const std::string& p_string, int p_entityId);
 
     void modifyInfoValue(int p_x, int p_y);
     void assignModifiedValue(const std::string& p_infoName, const std::string& p_value);
+    //blocks on a popup at p_rect until enter is pressed, escape gives an empty string
+    static std::string readTextInput(const SDL_Rect& p_rect);
     void setCurrentText(const std::string& p_text) { m_currentText = p_text; }
     const Entity* getSelectedEntity() const { return m_entityPtr; }
-    void setEntityPtr(Entity* p_entityPtr) { m_lastEntityPtr = m_entityPtr = p_entityPtr; }
-    void setHierarchy(Hierarchy* p_hierarchy) { m_hierarchy = p_hierarchy; }
+    void setEntityPtr(Entity* p_entityPtr) { m_entityPtr = p_entityPtr; }
+    void setEntityManager(EntityManager* p_entityManager) { m_entityManager = p_entityManager; }
 private:
     struct EntityInfo
     {
-        EntityInfo(SDL_Texture* p_textTexture, SDL_Rect p_textRect,
-                   std::string p_infoName) : m_textTexture(p_textTexture), m_textRect(p_textRect),
-                                             m_infoName(std::move(p_infoName))
-        {
-        }
-        SDL_Texture* m_textTexture;
+        const EntityProperty* m_property;
+        PropertyValue m_value;
+        //the property's name and value
+        std::string m_text;
         SDL_Rect m_textRect;
-        std::string m_infoName;
     };
 
+    //one info per property of p_table, kept while the selected entities share it
+    void bindProperties(const PropertyTable& p_table);
+    //reads every value and formats the changed ones again, returns true if one changed
+    bool refreshEntityInfos();
+    void formatEntityInfo(EntityInfo& p_entityInfo) const;
+    void layoutEntityInfos();
+    void displayEntityInfos() const;
+
     SDL_Renderer* m_renderer;
     SDL_Rect m_rect;
 
@@ -45,7 +54,7 @@ private:
     SDL_Texture* m_titleTexture;
     SDL_Rect m_titleRect;
 
-    TTF_Font* m_font;
+    GlyphAtlas* m_glyphAtlas;
     SDL_Color m_fontColor = {200, 200, 200, 255};
     SDL_Rect m_selectionRect;
     SDL_Texture* m_selectionTexture;
@@ -54,7 +63,8 @@ private:
     std::string m_currentText;
 
     std::vector<EntityInfo> m_entityInfos;
-    Entity* m_lastEntityPtr = nullptr;
-    bool m_entityChanged = true;
-    Hierarchy* m_hierarchy;
+    const PropertyTable* m_boundTable = nullptr;
+    std::vector<const EntityProperty*> m_properties;
+    PropertyValue m_currentValue;
+    EntityManager* m_entityManager = nullptr;
 };
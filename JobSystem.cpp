@@ -0,0 +1,297 @@
+﻿#include "JobSystem.h"
+#include <algorithm>
+
+#include "Profiler.h"
+
+//the worker running on this thread, -1 on the others
+static thread_local const JobSystem* s_workerJobSystem = nullptr;
+static thread_local int s_workerIndex = -1;
+
+bool JobDeque::push(Job* p_job)
+{
+    const Sint64 bottom = m_bottom.load(std::memory_order_relaxed);
+    const Sint64 top = m_top.load(std::memory_order_acquire);
+    if (bottom - top >= s_capacity)
+        return false;
+    m_jobs[bottom & (s_capacity - 1)].store(p_job, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    m_bottom.store(bottom + 1, std::memory_order_relaxed);
+    return true;
+}
+
+Job* JobDeque::pop()
+{
+    const Sint64 bottom = m_bottom.load(std::memory_order_relaxed) - 1;
+    m_bottom.store(bottom, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    Sint64 top = m_top.load(std::memory_order_relaxed);
+    if (top > bottom)
+    {
+        m_bottom.store(bottom + 1, std::memory_order_relaxed);
+        return nullptr;
+    }
+    Job* job = m_jobs[bottom & (s_capacity - 1)].load(std::memory_order_relaxed);
+    if (top == bottom)
+    {
+        //the last job, a thief may be taking it at the same time
+        if (!m_top.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+            job = nullptr;
+        m_bottom.store(bottom + 1, std::memory_order_relaxed);
+    }
+    return job;
+}
+
+Job* JobDeque::steal()
+{
+    Sint64 top = m_top.load(std::memory_order_acquire);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    const Sint64 bottom = m_bottom.load(std::memory_order_acquire);
+    if (top >= bottom)
+        return nullptr;
+    Job* job = m_jobs[top & (s_capacity - 1)].load(std::memory_order_relaxed);
+    if (!m_top.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+        return nullptr;
+    return job;
+}
+
+JobSystem::JobSystem(unsigned int p_workerCount) : m_jobs(new Job[s_poolSize])
+{
+    if (p_workerCount == 0)
+        p_workerCount = std::max(std::thread::hardware_concurrency(), 2u) - 1;
+    for (Uint32 i = 0; i < s_poolSize; ++i)
+    {
+        m_jobs[i].m_unfinishedJobs.store(0, std::memory_order_relaxed);
+        m_jobs[i].m_generation.store(0, std::memory_order_relaxed);
+    }
+    m_sharedJobs.reserve(s_poolSize);
+    for (unsigned int i = 0; i < p_workerCount; ++i)
+        m_workers.emplace_back(new Worker);
+    //started once every deque exists, they steal from each other right away
+    for (unsigned int i = 0; i < p_workerCount; ++i)
+        m_workers[i]->m_thread = std::thread([this, i] { workerLoop(static_cast<int>(i)); });
+}
+
+JobSystem::~JobSystem()
+{
+    {
+        std::lock_guard<std::mutex> sleepGuard(m_sleepMutex);
+        m_isStopping = true;
+    }
+    m_wakeCondition.notify_all();
+    for (const std::unique_ptr<Worker>& worker : m_workers)
+        worker->m_thread.join();
+}
+
+void JobSystem::addDependency(Job* p_job, Job* p_dependency)
+{
+    if (p_dependency->m_continuationCount == Job::s_maxContinuations)
+    {
+        //queued by the dependency in place of its last continuation, it then queues that one and p_job
+        Job* relay = createJob("Continuations", [] {});
+        //every slot is taken, the jobs finishing meanwhile free some. A worker helps with them, another thread
+        //leaves them to the workers so it doesn't take someone else's work
+        const int workerIndex = s_workerJobSystem == this ? s_workerIndex : -1;
+        while (!relay)
+        {
+            Job* job = workerIndex >= 0 ? findJob(workerIndex) : nullptr;
+            if (job)
+                execute(job);
+            else
+                std::this_thread::yield();
+            relay = createJob("Continuations", [] {});
+        }
+        Job*& lastContinuation = p_dependency->m_continuations[Job::s_maxContinuations - 1];
+        relay->m_continuations[relay->m_continuationCount++] = lastContinuation;
+        lastContinuation = relay;
+        p_dependency = relay;
+    }
+    p_job->m_remainingDependencies.fetch_add(1, std::memory_order_relaxed);
+    p_dependency->m_continuations[p_dependency->m_continuationCount++] = p_job;
+}
+
+void JobSystem::run(Job* p_job)
+{
+    if (p_job->m_remainingDependencies.fetch_sub(1, std::memory_order_acq_rel) == 1)
+        push(p_job);
+}
+
+void JobSystem::wait(const JobHandle& p_handle)
+{
+    const int workerIndex = s_workerJobSystem == this ? s_workerIndex : -1;
+    while (!isFinished(p_handle))
+    {
+        //the fixed update waits in its physics tick, it mustn't take the main thread's render list meanwhile
+        if (Job* job = workerIndex >= 0 ? findJob(workerIndex) : findSharedDescendant(p_handle.m_job))
+            execute(job);
+        else
+            std::this_thread::yield();
+    }
+}
+
+Job* JobSystem::allocateJob(const char* p_name, Job* p_parent)
+{
+    //the slots still queued or running are skipped, their count only drops to 0 once finish is done with them
+    for (Uint32 attempt = 0; attempt < s_poolSize; ++attempt)
+    {
+        Job* job = &m_jobs[m_nextJob.fetch_add(1, std::memory_order_relaxed) & (s_poolSize - 1)];
+        int unfinishedJobs = 0;
+        if (!job->m_unfinishedJobs.compare_exchange_strong(unfinishedJobs, 1, std::memory_order_acquire,
+            std::memory_order_relaxed))
+            continue;
+        job->m_name = p_name;
+        job->m_parent = p_parent;
+        job->m_remainingDependencies.store(1, std::memory_order_relaxed);
+        job->m_continuationCount = 0;
+        //after the count, a handle seeing the new generation knows the previous job has finished
+        job->m_generation.fetch_add(1, std::memory_order_release);
+        if (p_parent)
+            p_parent->m_unfinishedJobs.fetch_add(1, std::memory_order_relaxed);
+        return job;
+    }
+    return nullptr;
+}
+
+void JobSystem::push(Job* p_job)
+{
+    if (s_workerJobSystem == this)
+    {
+        if (!m_workers[s_workerIndex]->m_deque.push(p_job))
+        {
+            execute(p_job);
+            return;
+        }
+    }
+    else
+    {
+        std::lock_guard<std::mutex> sharedJobsGuard(m_sharedJobsMutex);
+        m_sharedJobs.push_back(p_job);
+        m_sharedJobCount.fetch_add(1, std::memory_order_release);
+    }
+    wakeWorkers();
+}
+
+Job* JobSystem::findJob(const int p_workerIndex)
+{
+    if (p_workerIndex >= 0)
+        if (Job* job = m_workers[p_workerIndex]->m_deque.pop())
+            return job;
+    if (m_sharedJobCount.load(std::memory_order_acquire) > 0)
+    {
+        std::lock_guard<std::mutex> sharedJobsGuard(m_sharedJobsMutex);
+        if (!m_sharedJobs.empty())
+        {
+            Job* job = m_sharedJobs.back();
+            m_sharedJobs.pop_back();
+            m_sharedJobCount.fetch_sub(1, std::memory_order_relaxed);
+            return job;
+        }
+    }
+    //starts after the calling worker so the thieves don't all go for the first one
+    const size_t workerCount = m_workers.size();
+    const size_t firstVictim = p_workerIndex >= 0 ? static_cast<size_t>(p_workerIndex) + 1 : 0;
+    for (size_t i = 0; i < workerCount; ++i)
+    {
+        const size_t victim = (firstVictim + i) % workerCount;
+        if (static_cast<int>(victim) == p_workerIndex)
+            continue;
+        if (Job* job = m_workers[victim]->m_deque.steal())
+        {
+            m_stolenJobCount.fetch_add(1, std::memory_order_relaxed);
+            return job;
+        }
+    }
+    return nullptr;
+}
+
+Job* JobSystem::findSharedDescendant(const Job* p_ancestor)
+{
+    if (m_sharedJobCount.load(std::memory_order_acquire) == 0)
+        return nullptr;
+    std::lock_guard<std::mutex> sharedJobsGuard(m_sharedJobsMutex);
+    //a queued job's parents haven't finished, their slots are still theirs
+    for (size_t i = m_sharedJobs.size(); i-- > 0;)
+    {
+        for (const Job* ancestor = m_sharedJobs[i]; ancestor; ancestor = ancestor->m_parent)
+        {
+            if (ancestor != p_ancestor)
+                continue;
+            Job* job = m_sharedJobs[i];
+            m_sharedJobs.erase(m_sharedJobs.begin() + static_cast<std::ptrdiff_t>(i));
+            m_sharedJobCount.fetch_sub(1, std::memory_order_relaxed);
+            return job;
+        }
+    }
+    return nullptr;
+}
+
+void JobSystem::execute(Job* p_job)
+{
+    {
+#ifdef ENGINE_PROFILING
+        ProfileScope profileScope(p_job->m_name);
+#endif
+        p_job->m_function(p_job->m_data);
+    }
+    m_executedJobCount.fetch_add(1, std::memory_order_relaxed);
+    finish(p_job);
+}
+
+void JobSystem::finish(Job* p_job)
+{
+    //read before the count goes down, any thread may take its slot right after
+    const int continuationCount = p_job->m_continuationCount;
+    Job* continuations[Job::s_maxContinuations];
+    std::copy(p_job->m_continuations, p_job->m_continuations + continuationCount, continuations);
+    Job* parent = p_job->m_parent;
+    if (p_job->m_unfinishedJobs.fetch_sub(1, std::memory_order_acq_rel) != 1)
+        return;
+    for (int i = 0; i < continuationCount; ++i)
+        run(continuations[i]);
+    if (parent)
+        finish(parent);
+}
+
+void JobSystem::workerLoop(const int p_workerIndex)
+{
+    s_workerJobSystem = this;
+    s_workerIndex = p_workerIndex;
+    while (!m_isStopping.load(std::memory_order_acquire))
+    {
+        const Uint32 wakeEpoch = m_wakeEpoch.load(std::memory_order_acquire);
+        if (Job* job = findJob(p_workerIndex))
+        {
+            execute(job);
+            continue;
+        }
+        //a short spin first, the jobs of a tick come in quick bursts
+        bool hasFoundJob = false;
+        for (int spin = 0; spin < 64 && !hasFoundJob; ++spin)
+        {
+            std::this_thread::yield();
+            if (Job* job = findJob(p_workerIndex))
+            {
+                execute(job);
+                hasFoundJob = true;
+            }
+        }
+        if (hasFoundJob)
+            continue;
+        std::unique_lock<std::mutex> sleepLock(m_sleepMutex);
+        m_sleepingWorkers.fetch_add(1, std::memory_order_seq_cst);
+        m_wakeCondition.wait(sleepLock, [this, wakeEpoch]
+        {
+            return m_isStopping.load(std::memory_order_relaxed) ||
+                m_wakeEpoch.load(std::memory_order_seq_cst) != wakeEpoch;
+        });
+        m_sleepingWorkers.fetch_sub(1, std::memory_order_relaxed);
+    }
+}
+
+void JobSystem::wakeWorkers()
+{
+    m_wakeEpoch.fetch_add(1, std::memory_order_seq_cst);
+    if (m_sleepingWorkers.load(std::memory_order_seq_cst) == 0)
+        return;
+    std::lock_guard<std::mutex> sleepGuard(m_sleepMutex);
+    m_wakeCondition.notify_all();
+}
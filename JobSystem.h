@@ -0,0 +1,184 @@
+﻿#pragma once
+#include <SDL_stdinc.h>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+//Filled by JobSystem::createJob, a slot is only taken again once its job and the job's children have finished
+struct Job
+{
+    static constexpr int s_maxContinuations = 8;
+    static constexpr size_t s_dataSize = 64;
+
+    void (*m_function)(void* p_data);
+    //profiling zone of the job, a string literal
+    const char* m_name;
+    Job* m_parent;
+    //the job itself and its children that haven't finished
+    std::atomic<int> m_unfinishedJobs;
+    //the dependencies left before it is queued, plus one until run is called
+    std::atomic<int> m_remainingDependencies;
+    //the jobs waiting for this one, set before it runs
+    int m_continuationCount;
+    Job* m_continuations[s_maxContinuations];
+    //goes up every time the slot is taken, so a JobHandle can tell its job from the ones after it
+    std::atomic<Uint32> m_generation;
+    alignas(std::max_align_t) unsigned char m_data[s_dataSize];
+};
+
+//A job along with the generation of its slot, the one thing to keep once the job has been run: the slot may
+//hold another job by the time it's waited on, which means the job has finished
+struct JobHandle
+{
+    Job* m_job = nullptr;
+    Uint32 m_generation = 0;
+};
+
+//Chase-Lev deque: its worker pushes and pops at the bottom, the other workers steal from the top
+class JobDeque
+{
+public:
+    static constexpr Sint64 s_capacity = 4096;
+
+    //false when full, the job is then run right away
+    bool push(Job* p_job);
+    Job* pop();
+    Job* steal();
+private:
+    //apart so the thieves and the owner don't share a cache line
+    std::atomic<Sint64> m_top{0};
+    Uint8 m_topPadding[64 - sizeof(std::atomic<Sint64>)];
+    std::atomic<Sint64> m_bottom{0};
+    Uint8 m_bottomPadding[64 - sizeof(std::atomic<Sint64>)];
+    std::atomic<Job*> m_jobs[s_capacity] = {};
+};
+
+//Worker threads running jobs from their own deque and stealing from the others' when it is empty.
+//Threads that aren't workers queue their jobs in a shared list, while they wait they run the ones they wait for.
+class JobSystem
+{
+public:
+    static constexpr Uint32 s_poolSize = 4096;
+
+    //0 gives one worker per core but the calling thread's
+    explicit JobSystem(unsigned int p_workerCount = 0);
+    ~JobSystem();
+    JobSystem(const JobSystem&) = delete;
+    JobSystem& operator=(const JobSystem&) = delete;
+
+    //p_function() may run on any thread, p_parent waits for the job to finish as well.
+    //nullptr when every slot holds a job that hasn't finished, the caller then runs p_function() itself
+    template <typename F>
+    Job* createJob(const char* p_name, const F& p_function, Job* p_parent = nullptr)
+    {
+        static_assert(sizeof(F) <= Job::s_dataSize, "the job's captures don't fit in its data");
+        static_assert(alignof(F) <= alignof(std::max_align_t), "the job's captures are over aligned");
+        static_assert(std::is_trivially_destructible<F>::value, "the job's captures are never destroyed");
+        Job* job = allocateJob(p_name, p_parent);
+        if (!job)
+            return nullptr;
+        new(job->m_data) F(p_function);
+        job->m_function = [](void* p_data) { (*static_cast<F*>(p_data))(); };
+        return job;
+    }
+
+    //p_job is queued once p_dependency has finished, neither of them has been run yet.
+    //Past s_maxContinuations the dependency queues an empty job which queues the ones that didn't fit,
+    //when no slot is free for it the call waits until one is
+    void addDependency(Job* p_job, Job* p_dependency);
+    //made before run is called, the job can't have finished yet
+    static JobHandle getHandle(Job* p_job)
+    {
+        return {p_job, p_job->m_generation.load(std::memory_order_relaxed)};
+    }
+    //p_handle's job and its children have finished, its slot may already hold another job
+    static bool isFinished(const JobHandle& p_handle)
+    {
+        return p_handle.m_job->m_generation.load(std::memory_order_acquire) != p_handle.m_generation ||
+            p_handle.m_job->m_unfinishedJobs.load(std::memory_order_acquire) == 0;
+    }
+    //queues the job, or leaves it to its last dependency
+    void run(Job* p_job);
+    //runs the queued jobs until p_handle's job and its children have finished, a thread that isn't a worker only
+    //takes that job and its descendants from the shared list so it doesn't run another thread's work meanwhile
+    void wait(const JobHandle& p_handle);
+    //p_function(size_t p_start, size_t p_end) over [0, p_count) in batches, the calling thread takes some too
+    template <typename F>
+    void parallelFor(const char* p_name, const size_t p_count, const size_t p_batchSize, const F& p_function)
+    {
+        if (p_count == 0)
+            return;
+        const size_t batchSize = p_batchSize != 0 ? p_batchSize : 1;
+        Job* root = createJob(p_name, [] {});
+        if (!root)
+        {
+            p_function(static_cast<size_t>(0), p_count);
+            return;
+        }
+        const JobHandle rootHandle = getHandle(root);
+        for (size_t start = 0; start < p_count; start += batchSize)
+        {
+            const size_t end = start + batchSize < p_count ? start + batchSize : p_count;
+            const F* function = &p_function;
+            //the batches past the free slots are run here
+            if (Job* job = createJob(p_name, [function, start, end] { (*function)(start, end); }, root))
+                run(job);
+            else
+                p_function(start, end);
+        }
+        run(root);
+        wait(rootHandle);
+    }
+
+    unsigned int getWorkerCount() const { return static_cast<unsigned int>(m_workers.size()); }
+    //since the creation or the last reset, every thread's jobs together
+    Uint64 getExecutedJobCount() const { return m_executedJobCount.load(std::memory_order_relaxed); }
+    Uint64 getStolenJobCount() const { return m_stolenJobCount.load(std::memory_order_relaxed); }
+    void resetStats()
+    {
+        m_executedJobCount.store(0, std::memory_order_relaxed);
+        m_stolenJobCount.store(0, std::memory_order_relaxed);
+    }
+private:
+    struct Worker
+    {
+        JobDeque m_deque;
+        std::thread m_thread;
+    };
+
+    //nullptr when no slot is free
+    Job* allocateJob(const char* p_name, Job* p_parent);
+    void push(Job* p_job);
+    //from the calling worker's deque, the shared list, then the other workers
+    Job* findJob(int p_workerIndex);
+    //the latest job of the shared list that is p_ancestor or one of its descendants
+    Job* findSharedDescendant(const Job* p_ancestor);
+    void execute(Job* p_job);
+    void finish(Job* p_job);
+    void workerLoop(int p_workerIndex);
+    void wakeWorkers();
+
+    std::unique_ptr<Job[]> m_jobs;
+    std::atomic<Uint32> m_nextJob{0};
+    std::vector<std::unique_ptr<Worker>> m_workers;
+
+    std::mutex m_sharedJobsMutex;
+    std::vector<Job*> m_sharedJobs;
+    std::atomic<int> m_sharedJobCount{0};
+
+    //bumped by every push, a worker only sleeps if it hasn't changed since it last looked for jobs
+    std::atomic<Uint32> m_wakeEpoch{0};
+    std::atomic<int> m_sleepingWorkers{0};
+    std::mutex m_sleepMutex;
+    std::condition_variable m_wakeCondition;
+    std::atomic<bool> m_isStopping{false};
+
+    std::atomic<Uint64> m_executedJobCount{0};
+    std::atomic<Uint64> m_stolenJobCount{0};
+};
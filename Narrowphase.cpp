@@ -0,0 +1,240 @@
+﻿#include "Narrowphase.h"
+#include <cfloat>
+#include <cmath>
+
+//boxes and polygons seen the same way by the polygon tests, built on the stack
+struct PolygonView
+{
+    Vec2<float> m_vertices[g_maxPolygonVertices];
+    Vec2<float> m_normals[g_maxPolygonVertices];
+    int m_count = 0;
+};
+
+static void buildPolygonView(const Collider& p_collider, const Vec2<float>& p_offset, PolygonView& p_view)
+{
+    if (p_collider.getShape() == CONVEX_POLYGON)
+    {
+        const auto& polygon = static_cast<const ConvexPolygonCollider&>(p_collider);
+        p_view.m_count = polygon.getVertexCount();
+        for (int i = 0; i < p_view.m_count; ++i)
+        {
+            p_view.m_vertices[i] = polygon.getWorldVertices()[i] + p_offset;
+            p_view.m_normals[i] = polygon.getWorldNormals()[i];
+        }
+        return;
+    }
+
+    const Vec2<float> center = p_collider.getCenter() + p_offset;
+    const Vec2<float> halfSize = p_collider.getHalfSize();
+    const Vec2<float> xAxis = {p_collider.getCos(), p_collider.getSin()};
+    const Vec2<float> yAxis = {-p_collider.getSin(), p_collider.getCos()};
+    p_view.m_count = 4;
+    p_view.m_vertices[0] = center - xAxis * halfSize.x - yAxis * halfSize.y;
+    p_view.m_vertices[1] = center + xAxis * halfSize.x - yAxis * halfSize.y;
+    p_view.m_vertices[2] = center + xAxis * halfSize.x + yAxis * halfSize.y;
+    p_view.m_vertices[3] = center - xAxis * halfSize.x + yAxis * halfSize.y;
+    p_view.m_normals[0] = -1.f * yAxis;
+    p_view.m_normals[1] = xAxis;
+    p_view.m_normals[2] = yAxis;
+    p_view.m_normals[3] = -1.f * xAxis;
+}
+
+//greatest separation of p_other along p_reference's normals, positive means a separating axis exists
+static float findMaxSeparation(const PolygonView& p_reference, const PolygonView& p_other, int& p_edge,
+                               int& p_deepestVertex)
+{
+    float maxSeparation = -FLT_MAX;
+    for (int i = 0; i < p_reference.m_count; ++i)
+    {
+        float minSeparation = FLT_MAX;
+        int deepestVertex = 0;
+        for (int j = 0; j < p_other.m_count; ++j)
+        {
+            const float separation = dot(p_reference.m_normals[i], p_other.m_vertices[j] - p_reference.m_vertices[i]);
+            if (separation < minSeparation)
+            {
+                minSeparation = separation;
+                deepestVertex = j;
+            }
+        }
+        if (minSeparation > maxSeparation)
+        {
+            maxSeparation = minSeparation;
+            p_edge = i;
+            p_deepestVertex = deepestVertex;
+            if (maxSeparation > 0.f)
+                return maxSeparation;
+        }
+    }
+    return maxSeparation;
+}
+
+const Narrowphase::CollideFunction Narrowphase::s_collideTable[COLLIDER_SHAPES_NUMBER][COLLIDER_SHAPES_NUMBER] = {
+    //ORIENTED_BOX
+    {&Narrowphase::boxBox, &Narrowphase::polygonCircle, &Narrowphase::polygonPolygon},
+    //CIRCLE
+    {
+        &Narrowphase::swapped<&Narrowphase::polygonCircle>, &Narrowphase::circleCircle,
+        &Narrowphase::swapped<&Narrowphase::polygonCircle>
+    },
+    //CONVEX_POLYGON
+    {&Narrowphase::polygonPolygon, &Narrowphase::polygonCircle, &Narrowphase::polygonPolygon},
+};
+
+template <Narrowphase::CollideFunction t_function>
+bool Narrowphase::swapped(const Collider& p_first, const Collider& p_second, ContactManifold& p_manifold,
+                          const Vec2<float>& p_offset)
+{
+    //moving the second collider backward is the same as moving the first one forward
+    if (!t_function(p_second, p_first, p_manifold, -1.f * p_offset))
+        return false;
+    p_manifold.m_normal = -1.f * p_manifold.m_normal;
+    for (int i = 0; i < p_manifold.m_pointCount; ++i)
+        p_manifold.m_points[i] = p_manifold.m_points[i] + p_offset;
+    return true;
+}
+
+bool Narrowphase::boxBox(const Collider& p_first, const Collider& p_second, ContactManifold& p_manifold,
+                         const Vec2<float>& p_offset)
+{
+    const Vec2<float> axes[4] = {
+        {p_first.getCos(), p_first.getSin()}, {-p_first.getSin(), p_first.getCos()},
+        {p_second.getCos(), p_second.getSin()}, {-p_second.getSin(), p_second.getCos()}
+    };
+    const Vec2<float> halfSize = p_first.getHalfSize();
+    const Vec2<float> otherHalfSize = p_second.getHalfSize();
+    const Vec2<float> delta = p_second.getCenter() - (p_first.getCenter() + p_offset);
+
+    float minOverlap = FLT_MAX;
+    for (const Vec2<float>& axis : axes)
+    {
+        const float radius = halfSize.x * std::abs(dot(axes[0], axis)) + halfSize.y * std::abs(dot(axes[1], axis));
+        const float otherRadius = otherHalfSize.x * std::abs(dot(axes[2], axis)) +
+            otherHalfSize.y * std::abs(dot(axes[3], axis));
+        const float distance = dot(delta, axis);
+        const float overlap = radius + otherRadius - std::abs(distance);
+        if (overlap <= 0.f)
+            return false;
+        if (overlap < minOverlap)
+        {
+            minOverlap = overlap;
+            p_manifold.m_normal = distance < 0.f ? -1.f * axis : axis;
+        }
+    }
+    p_manifold.m_depth = minOverlap;
+
+    //deepest corner of the second box
+    const Vec2<float> secondCenter = p_second.getCenter();
+    const float xSign = dot(axes[2], p_manifold.m_normal) > 0.f ? -1.f : 1.f;
+    const float ySign = dot(axes[3], p_manifold.m_normal) > 0.f ? -1.f : 1.f;
+    p_manifold.m_points[0] = secondCenter + axes[2] * (xSign * otherHalfSize.x) + axes[3] * (ySign * otherHalfSize.y);
+    p_manifold.m_pointCount = 1;
+    return true;
+}
+
+bool Narrowphase::circleCircle(const Collider& p_first, const Collider& p_second, ContactManifold& p_manifold,
+                               const Vec2<float>& p_offset)
+{
+    const float radius = static_cast<const CircleCollider&>(p_first).getRadius();
+    const float otherRadius = static_cast<const CircleCollider&>(p_second).getRadius();
+    const Vec2<float> center = p_first.getCenter() + p_offset;
+    const Vec2<float> delta = p_second.getCenter() - center;
+    const float squaredDistance = dot(delta, delta);
+    const float radiusSum = radius + otherRadius;
+    if (squaredDistance >= radiusSum * radiusSum)
+        return false;
+
+    const float distance = std::sqrt(squaredDistance);
+    p_manifold.m_normal = distance > 0.f ? delta / distance : Vec2<float>{0.f, 1.f};
+    p_manifold.m_depth = radiusSum - distance;
+    p_manifold.m_points[0] = center + p_manifold.m_normal * radius;
+    p_manifold.m_pointCount = 1;
+    return true;
+}
+
+bool Narrowphase::polygonCircle(const Collider& p_first, const Collider& p_second, ContactManifold& p_manifold,
+                                const Vec2<float>& p_offset)
+{
+    PolygonView polygon;
+    buildPolygonView(p_first, p_offset, polygon);
+    const Vec2<float> center = p_second.getCenter();
+    const float radius = static_cast<const CircleCollider&>(p_second).getRadius();
+
+    float maxSeparation = -FLT_MAX;
+    int edge = 0;
+    for (int i = 0; i < polygon.m_count; ++i)
+    {
+        const float separation = dot(polygon.m_normals[i], center - polygon.m_vertices[i]);
+        if (separation > radius)
+            return false;
+        if (separation > maxSeparation)
+        {
+            maxSeparation = separation;
+            edge = i;
+        }
+    }
+
+    //center inside the polygon
+    if (maxSeparation < 0.f)
+    {
+        p_manifold.m_normal = polygon.m_normals[edge];
+        p_manifold.m_depth = radius - maxSeparation;
+        p_manifold.m_points[0] = center - p_manifold.m_normal * radius;
+        p_manifold.m_pointCount = 1;
+        return true;
+    }
+
+    const Vec2<float>& edgeStart = polygon.m_vertices[edge];
+    const Vec2<float> edgeVector = polygon.m_vertices[(edge + 1) % polygon.m_count] - edgeStart;
+    const float edgeSquaredLength = dot(edgeVector, edgeVector);
+    float t = edgeSquaredLength > 0.f ? dot(center - edgeStart, edgeVector) / edgeSquaredLength : 0.f;
+    t = t < 0.f ? 0.f : (t > 1.f ? 1.f : t);
+    const Vec2<float> closestPoint = edgeStart + edgeVector * t;
+    const Vec2<float> delta = center - closestPoint;
+    const float squaredDistance = dot(delta, delta);
+    if (squaredDistance > radius * radius)
+        return false;
+
+    const float distance = std::sqrt(squaredDistance);
+    p_manifold.m_normal = distance > 0.f ? delta / distance : polygon.m_normals[edge];
+    p_manifold.m_depth = radius - distance;
+    p_manifold.m_points[0] = closestPoint;
+    p_manifold.m_pointCount = 1;
+    return true;
+}
+
+bool Narrowphase::polygonPolygon(const Collider& p_first, const Collider& p_second, ContactManifold& p_manifold,
+                                 const Vec2<float>& p_offset)
+{
+    PolygonView first;
+    PolygonView second;
+    buildPolygonView(p_first, p_offset, first);
+    buildPolygonView(p_second, {0.f, 0.f}, second);
+
+    int firstEdge = 0;
+    int secondDeepestVertex = 0;
+    const float firstSeparation = findMaxSeparation(first, second, firstEdge, secondDeepestVertex);
+    if (firstSeparation > 0.f)
+        return false;
+    int secondEdge = 0;
+    int firstDeepestVertex = 0;
+    const float secondSeparation = findMaxSeparation(second, first, secondEdge, firstDeepestVertex);
+    if (secondSeparation > 0.f)
+        return false;
+
+    //the axis of least penetration gives the normal, the deepest vertex of the other polygon the contact
+    if (firstSeparation >= secondSeparation)
+    {
+        p_manifold.m_normal = first.m_normals[firstEdge];
+        p_manifold.m_depth = -firstSeparation;
+        p_manifold.m_points[0] = second.m_vertices[secondDeepestVertex];
+    }
+    else
+    {
+        p_manifold.m_normal = -1.f * second.m_normals[secondEdge];
+        p_manifold.m_depth = -secondSeparation;
+        p_manifold.m_points[0] = first.m_vertices[firstDeepestVertex];
+    }
+    p_manifold.m_pointCount = 1;
+    return true;
+}
@@ -0,0 +1,33 @@
+﻿#pragma once
+#include "Collider.h"
+
+class Narrowphase
+{
+public:
+    //p_offset moves the first collider before testing (used to check the next move)
+    static bool collide(const Collider& p_first, const Collider& p_second, ContactManifold& p_manifold,
+                        const Vec2<float>& p_offset = {0.f, 0.f});
+private:
+    typedef bool (*CollideFunction)(const Collider&, const Collider&, ContactManifold&, const Vec2<float>&);
+    static const CollideFunction s_collideTable[COLLIDER_SHAPES_NUMBER][COLLIDER_SHAPES_NUMBER];
+
+    static bool boxBox(const Collider& p_first, const Collider& p_second, ContactManifold& p_manifold,
+                       const Vec2<float>& p_offset);
+    static bool circleCircle(const Collider& p_first, const Collider& p_second, ContactManifold& p_manifold,
+                             const Vec2<float>& p_offset);
+    //the first collider is a box or a polygon
+    static bool polygonCircle(const Collider& p_first, const Collider& p_second, ContactManifold& p_manifold,
+                              const Vec2<float>& p_offset);
+    //both colliders are boxes or polygons
+    static bool polygonPolygon(const Collider& p_first, const Collider& p_second, ContactManifold& p_manifold,
+                               const Vec2<float>& p_offset);
+    template <CollideFunction t_function>
+    static bool swapped(const Collider& p_first, const Collider& p_second, ContactManifold& p_manifold,
+                        const Vec2<float>& p_offset);
+};
+
+inline bool Narrowphase::collide(const Collider& p_first, const Collider& p_second, ContactManifold& p_manifold,
+                                 const Vec2<float>& p_offset)
+{
+    return s_collideTable[p_first.getShape()][p_second.getShape()](p_first, p_second, p_manifold, p_offset);
+}
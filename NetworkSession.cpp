@@ -0,0 +1,302 @@
+﻿#include "NetworkSession.h"
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <iostream>
+#include "EntityManager.h"
+#include "InputRecording.h"
+#include "Profiler.h"
+
+#ifdef _WIN32
+#define NOMINMAX
+#include <winsock2.h>
+#include <ws2tcpip.h>
+using NativeSocket = SOCKET;
+using SocketLength = int;
+static void closeNativeSocket(const NativeSocket p_socket) { closesocket(p_socket); }
+#else
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+using NativeSocket = int;
+using SocketLength = socklen_t;
+static void closeNativeSocket(const NativeSocket p_socket) { ::close(p_socket); }
+#endif
+
+//packet layout: magic, first tick, ticks of the peer's controls received, count, then one byte of controls per tick
+static const char s_packetMagic[4] = {'E', '2', 'D', 'N'};
+static constexpr size_t s_packetHeaderSize = sizeof(s_packetMagic) + 2 * sizeof(Uint32) + 1;
+
+static void writeWord(std::vector<Uint8>& p_bytes, const Uint32 p_word)
+{
+    for (int i = 0; i < 4; ++i)
+        p_bytes.push_back(static_cast<Uint8>(p_word >> 8 * i));
+}
+
+static Uint32 readWord(const Uint8* p_bytes)
+{
+    return static_cast<Uint32>(p_bytes[0]) | static_cast<Uint32>(p_bytes[1]) << 8 |
+        static_cast<Uint32>(p_bytes[2]) << 16 | static_cast<Uint32>(p_bytes[3]) << 24;
+}
+
+bool NetworkSession::open(const Uint16 p_localPort, const char* p_peerAddress, const Uint16 p_peerPort,
+                          const int p_localPlayer)
+{
+    close();
+    if (p_localPlayer < 0 || p_localPlayer >= NETWORK_PLAYER_COUNT)
+        return false;
+#ifdef _WIN32
+    WSADATA wsaData;
+    if (WSAStartup(MAKEWORD(2, 2), &wsaData) != 0)
+        return false;
+#endif
+    auto fail = [](const NativeSocket p_socket, const bool p_isSocketOpen)
+    {
+        if (p_isSocketOpen)
+            closeNativeSocket(p_socket);
+#ifdef _WIN32
+        WSACleanup();
+#endif
+        return false;
+    };
+
+    in_addr peerAddress;
+    if (inet_pton(AF_INET, p_peerAddress, &peerAddress) != 1)
+        return fail(NativeSocket(), false);
+    const NativeSocket nativeSocket = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+#ifdef _WIN32
+    if (nativeSocket == INVALID_SOCKET)
+        return fail(nativeSocket, false);
+#else
+    if (nativeSocket < 0)
+        return fail(nativeSocket, false);
+#endif
+
+    sockaddr_in localAddress = {};
+    localAddress.sin_family = AF_INET;
+    localAddress.sin_addr.s_addr = htonl(INADDR_ANY);
+    localAddress.sin_port = htons(p_localPort);
+    if (bind(nativeSocket, reinterpret_cast<const sockaddr*>(&localAddress), sizeof(localAddress)) != 0)
+        return fail(nativeSocket, true);
+    //the fixed update reads what has arrived and moves on
+#ifdef _WIN32
+    u_long nonBlocking = 1;
+    if (ioctlsocket(nativeSocket, FIONBIO, &nonBlocking) != 0)
+        return fail(nativeSocket, true);
+#else
+    if (fcntl(nativeSocket, F_SETFL, fcntl(nativeSocket, F_GETFL, 0) | O_NONBLOCK) != 0)
+        return fail(nativeSocket, true);
+#endif
+
+    m_socket = static_cast<std::uintptr_t>(nativeSocket);
+    m_peerAddress = peerAddress.s_addr;
+    m_peerPort = htons(p_peerPort);
+    m_localPlayer = p_localPlayer;
+    m_isOpen = true;
+    return true;
+}
+
+void NetworkSession::close()
+{
+    if (!m_isOpen)
+        return;
+    closeNativeSocket(static_cast<NativeSocket>(m_socket));
+#ifdef _WIN32
+    WSACleanup();
+#endif
+    m_isOpen = false;
+}
+
+void NetworkSession::setLocalControls(const bool* p_controls)
+{
+    m_localControls = InputRecorder::packControls(p_controls);
+}
+
+void NetworkSession::start(EntityManager& p_entityManager)
+{
+    m_startTick = p_entityManager.getTick();
+    m_tick = 0;
+    m_remoteTickCount = 0;
+    m_peerAcknowledgedTicks = 0;
+    std::memset(m_history, 0, sizeof(m_history));
+    {
+        const std::lock_guard<std::mutex> statsLock(m_statsMutex);
+        m_stats = NetworkStats();
+    }
+    //the first tick can be rolled back too
+    if (SnapshotRing* snapshotRing = p_entityManager.getSnapshotRing())
+        snapshotRing->push(p_entityManager);
+}
+
+bool NetworkSession::advance(EntityManager& p_entityManager, const float p_deltaTime, bool& p_playerOnFinish)
+{
+    synchronize(p_entityManager, p_deltaTime, p_playerOnFinish);
+    if (m_tick >= m_remoteTickCount + NETWORK_MAX_PREDICTION)
+    {
+        send();
+        const std::lock_guard<std::mutex> statsLock(m_statsMutex);
+        ++m_stats.m_stalls;
+        return false;
+    }
+
+    TickControls& tickControls = getTickControls(m_tick);
+    tickControls.m_controls[m_localPlayer] = m_localControls;
+    if (m_tick >= m_remoteTickCount)
+        tickControls.m_controls[1 - m_localPlayer] = predictRemoteControls();
+    simulateTick(p_entityManager, m_tick, p_deltaTime, p_playerOnFinish);
+    ++m_tick;
+    send();
+    const std::lock_guard<std::mutex> statsLock(m_statsMutex);
+    ++m_stats.m_ticks;
+    return true;
+}
+
+void NetworkSession::synchronize(EntityManager& p_entityManager, const float p_deltaTime, bool& p_playerOnFinish)
+{
+    const Uint32 rollbackTick = receive();
+    if (rollbackTick >= m_tick)
+        return;
+
+    PROFILE_SCOPE("Rollback");
+    const auto startTime = std::chrono::steady_clock::now();
+    SnapshotRing* snapshotRing = p_entityManager.getSnapshotRing();
+    if (!snapshotRing || !snapshotRing->restore(p_entityManager, m_startTick + rollbackTick))
+    {
+        std::cerr << "Tick " << rollbackTick << " isn't in the snapshot ring anymore, the peers have diverged" <<
+            std::endl;
+        return;
+    }
+    for (Uint32 tick = rollbackTick; tick < m_tick; ++tick)
+    {
+        if (tick >= m_remoteTickCount)
+            getTickControls(tick).m_controls[1 - m_localPlayer] = predictRemoteControls();
+        simulateTick(p_entityManager, tick, p_deltaTime, p_playerOnFinish);
+    }
+    const float rollbackTime = std::chrono::duration<float, std::milli>(
+        std::chrono::steady_clock::now() - startTime).count();
+
+    const std::lock_guard<std::mutex> statsLock(m_statsMutex);
+    ++m_stats.m_rollbacks;
+    m_stats.m_resimulatedTicks += m_tick - rollbackTick;
+    m_stats.m_deepestRollback = std::max(m_stats.m_deepestRollback, m_tick - rollbackTick);
+    m_stats.m_rollbackTime += rollbackTime;
+    m_stats.m_worstRollbackTime = std::max(m_stats.m_worstRollbackTime, rollbackTime);
+}
+
+NetworkStats NetworkSession::getStats() const
+{
+    const std::lock_guard<std::mutex> statsLock(m_statsMutex);
+    return m_stats;
+}
+
+Uint8 NetworkSession::predictRemoteControls()
+{
+    return m_remoteTickCount > 0 ? getTickControls(m_remoteTickCount - 1).m_controls[1 - m_localPlayer] : 0;
+}
+
+void NetworkSession::simulateTick(EntityManager& p_entityManager, const Uint32 p_tick, const float p_deltaTime,
+                                  bool& p_playerOnFinish)
+{
+    //the same steps as a replayed tick, with the players in creation order
+    const TickControls& tickControls = getTickControls(p_tick);
+    const std::vector<Player*>& players = p_entityManager.getPlayers();
+    bool controls[CONTROLS_NUMBER];
+    for (size_t i = 0; i < players.size() && i < NETWORK_PLAYER_COUNT; ++i)
+    {
+        InputRecorder::unpackControls(tickControls.m_controls[i], controls);
+        players[i]->applyControls(controls);
+    }
+    for (Player* player : players)
+        player->applyMovements(p_deltaTime);
+    p_entityManager.stepPhysics(p_deltaTime);
+    p_entityManager.drainTriggerEvents(m_triggerEvents);
+    for (const TriggerEvent& triggerEvent : m_triggerEvents)
+        p_entityManager.handleTriggerEvent(triggerEvent, p_playerOnFinish);
+
+    if (!m_tickHashes)
+        return;
+    if (m_tickHashes->size() <= p_tick)
+        m_tickHashes->resize(p_tick + 1);
+    (*m_tickHashes)[p_tick] = p_entityManager.computeStateHash();
+}
+
+void NetworkSession::send()
+{
+    if (!m_isOpen)
+        return;
+    //everything the peer hasn't acknowledged, a lost packet is covered by the next one
+    const Uint32 firstTick = std::min(m_peerAcknowledgedTicks, m_tick);
+    const Uint32 count = std::min<Uint32>(m_tick - firstTick, 255);
+    m_packet.assign(s_packetMagic, s_packetMagic + sizeof(s_packetMagic));
+    writeWord(m_packet, firstTick);
+    writeWord(m_packet, m_remoteTickCount);
+    m_packet.push_back(static_cast<Uint8>(count));
+    for (Uint32 tick = firstTick; tick < firstTick + count; ++tick)
+        m_packet.push_back(getTickControls(tick).m_controls[m_localPlayer]);
+
+    sockaddr_in peerAddress = {};
+    peerAddress.sin_family = AF_INET;
+    peerAddress.sin_addr.s_addr = m_peerAddress;
+    peerAddress.sin_port = m_peerPort;
+    if (sendto(static_cast<NativeSocket>(m_socket), reinterpret_cast<const char*>(m_packet.data()),
+        static_cast<int>(m_packet.size()), 0, reinterpret_cast<const sockaddr*>(&peerAddress),
+        sizeof(peerAddress)) < 0)
+        return;
+    const std::lock_guard<std::mutex> statsLock(m_statsMutex);
+    ++m_stats.m_packetsSent;
+}
+
+Uint32 NetworkSession::receive()
+{
+    Uint32 rollbackTick = m_tick;
+    if (!m_isOpen)
+        return rollbackTick;
+    const int remotePlayer = 1 - m_localPlayer;
+    Uint32 packetsReceived = 0;
+    Uint8 packet[s_packetHeaderSize + 255];
+    for (;;)
+    {
+        sockaddr_in senderAddress = {};
+        SocketLength senderAddressLength = sizeof(senderAddress);
+        const int size = static_cast<int>(recvfrom(static_cast<NativeSocket>(m_socket),
+            reinterpret_cast<char*>(packet), sizeof(packet), 0, reinterpret_cast<sockaddr*>(&senderAddress),
+            &senderAddressLength));
+        //nothing left to read
+        if (size <= 0)
+            break;
+        if (senderAddress.sin_addr.s_addr != m_peerAddress || senderAddress.sin_port != m_peerPort ||
+            static_cast<size_t>(size) < s_packetHeaderSize ||
+            std::memcmp(packet, s_packetMagic, sizeof(s_packetMagic)) != 0)
+            continue;
+        const Uint32 firstTick = readWord(packet + sizeof(s_packetMagic));
+        const Uint32 acknowledgedTicks = readWord(packet + sizeof(s_packetMagic) + sizeof(Uint32));
+        const Uint32 count = packet[s_packetHeaderSize - 1];
+        if (static_cast<size_t>(size) < s_packetHeaderSize + count)
+            continue;
+        ++packetsReceived;
+        m_peerAcknowledgedTicks = std::max(m_peerAcknowledgedTicks, std::min(acknowledgedTicks, m_tick));
+
+        //the packets overlap, one starting after the controls we have waits for the one filling the gap
+        if (firstTick > m_remoteTickCount)
+            continue;
+        //the peer waits for us before going further than that
+        const Uint32 lastTick = std::min(firstTick + count, m_tick + NETWORK_MAX_PREDICTION + 1);
+        for (Uint32 tick = m_remoteTickCount; tick < lastTick; ++tick)
+        {
+            const Uint8 controls = packet[s_packetHeaderSize + tick - firstTick];
+            Uint8& tickControls = getTickControls(tick).m_controls[remotePlayer];
+            if (tick < m_tick && tickControls != controls)
+                rollbackTick = std::min(rollbackTick, tick);
+            tickControls = controls;
+            m_remoteTickCount = tick + 1;
+        }
+    }
+    if (packetsReceived != 0)
+    {
+        const std::lock_guard<std::mutex> statsLock(m_statsMutex);
+        m_stats.m_packetsReceived += packetsReceived;
+    }
+    return rollbackTick;
+}
@@ -0,0 +1,98 @@
+﻿#pragma once
+#include <SDL_stdinc.h>
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+#include "TriggerSystem.h"
+#include "utils.h"
+
+class EntityManager;
+
+struct NetworkStats
+{
+    //ticks run once, the resimulated ones are counted apart
+    Uint32 m_ticks = 0;
+    //fixed updates skipped waiting for the peer
+    Uint32 m_stalls = 0;
+    Uint32 m_rollbacks = 0;
+    Uint32 m_resimulatedTicks = 0;
+    Uint32 m_deepestRollback = 0;
+    //in milliseconds, restores and resimulations together
+    float m_rollbackTime = 0.f;
+    float m_worstRollbackTime = 0.f;
+    Uint32 m_packetsSent = 0;
+    Uint32 m_packetsReceived = 0;
+};
+
+//Two players over UDP. Every tick the local controls are sent with the ones the peer hasn't acknowledged yet,
+//the peer's controls are guessed from its last known ones until they arrive. A wrong guess restores the tick
+//from the entity manager's snapshot ring and runs the following ones again.
+class NetworkSession
+{
+public:
+    NetworkSession() = default;
+    ~NetworkSession() { close(); }
+    NetworkSession(const NetworkSession&) = delete;
+    NetworkSession& operator=(const NetworkSession&) = delete;
+
+    //p_peerAddress is an IPv4 address, p_localPlayer the index of the player this instance controls
+    bool open(Uint16 p_localPort, const char* p_peerAddress, Uint16 p_peerPort, int p_localPlayer);
+    void close();
+    bool getIsOpen() const { return m_isOpen; }
+    int getLocalPlayer() const { return m_localPlayer; }
+    //read by the next tick, called by the main thread
+    void setLocalControls(const bool* p_controls);
+
+    //at play, the entity manager's snapshot ring has just been cleared
+    void start(EntityManager& p_entityManager);
+    //reads the peer's controls and rolls back if one was guessed wrong, then runs one tick.
+    //Returns false when the peer is NETWORK_MAX_PREDICTION ticks behind, nothing ran
+    bool advance(EntityManager& p_entityManager, float p_deltaTime, bool& p_playerOnFinish);
+    //the reading and rolling back part of advance
+    void synchronize(EntityManager& p_entityManager, float p_deltaTime, bool& p_playerOnFinish);
+    //ticks run since start
+    Uint32 getTick() const { return m_tick; }
+    //ticks whose peer controls are known
+    Uint32 getConfirmedTicks() const { return m_remoteTickCount; }
+    NetworkStats getStats() const;
+    //when set, gets the state hash after every tick, a resimulated tick overwrites its hash
+    void setTickHashes(std::vector<Uint64>* p_tickHashes) { m_tickHashes = p_tickHashes; }
+private:
+    //controls of both players, kept for the ticks that may still be resimulated or resent
+    static constexpr Uint32 s_historySize = 128;
+
+    struct TickControls
+    {
+        Uint8 m_controls[NETWORK_PLAYER_COUNT];
+    };
+
+    TickControls& getTickControls(const Uint32 p_tick) { return m_history[p_tick % s_historySize]; }
+    //the peer's last known controls, or none before the first ones arrive
+    Uint8 predictRemoteControls();
+    void simulateTick(EntityManager& p_entityManager, Uint32 p_tick, float p_deltaTime, bool& p_playerOnFinish);
+    void send();
+    //gives the first tick whose guess was wrong, m_tick if none
+    Uint32 receive();
+
+    bool m_isOpen = false;
+    std::uintptr_t m_socket = 0;
+    Uint32 m_peerAddress = 0;
+    Uint16 m_peerPort = 0;
+    int m_localPlayer = 0;
+    std::atomic<Uint8> m_localControls{0};
+
+    Uint32 m_startTick = 0;
+    Uint32 m_tick = 0;
+    Uint32 m_remoteTickCount = 0;
+    //the peer has our controls up to this tick
+    Uint32 m_peerAcknowledgedTicks = 0;
+    TickControls m_history[s_historySize] = {};
+    std::vector<Uint8> m_packet;
+    std::vector<TriggerEvent> m_triggerEvents;
+    std::vector<Uint64>* m_tickHashes = nullptr;
+
+    NetworkStats m_stats;
+    //the stats are read by the performance overlay
+    mutable std::mutex m_statsMutex;
+};
@@ -0,0 +1,252 @@
+﻿#include "ParticleSystem.h"
+#include <algorithm>
+#include <cmath>
+#include "JobSystem.h"
+#include "Profiler.h"
+
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#include <xmmintrin.h>
+#define PARTICLES_USE_SSE
+#endif
+
+ParticleSystem::ParticleSystem(const size_t p_budget) : m_budget(p_budget), m_random(std::random_device()())
+{
+}
+
+int ParticleSystem::addEmitter(const ParticleEmitterDefinition& p_definition, SDL_Texture* p_texture)
+{
+    Emitter emitter;
+    emitter.m_definition = p_definition;
+    emitter.m_count = 0;
+    emitter.m_firstQuad = 0;
+    const auto batch = std::find_if(m_batches.cbegin(), m_batches.cend(),
+        [p_texture](const Batch& p_batch) { return p_batch.m_texture == p_texture; });
+    emitter.m_batch = static_cast<size_t>(batch - m_batches.cbegin());
+    if (batch == m_batches.cend())
+        m_batches.push_back({p_texture, 0, {}});
+    m_emitters.push_back(std::move(emitter));
+    return static_cast<int>(m_emitters.size()) - 1;
+}
+
+size_t ParticleSystem::emit(const int p_emitter, const Vec2<float>& p_position, const size_t p_count)
+{
+    Emitter& emitter = m_emitters[p_emitter];
+    const ParticleEmitterDefinition& definition = emitter.m_definition;
+    const size_t wanted = p_count != 0 ? p_count : definition.m_burstCount;
+    const size_t count = std::min(wanted, m_budget - m_liveParticles);
+    m_stats.m_droppedParticles += static_cast<Uint32>(wanted - count);
+    if (count == 0)
+        return 0;
+    const size_t first = emitter.m_count;
+    emitter.m_count += count;
+    m_liveParticles += count;
+    m_stats.m_liveParticles = static_cast<Uint32>(m_liveParticles);
+    if (emitter.m_positionsX.size() < emitter.m_count)
+    {
+        emitter.m_positionsX.resize(emitter.m_count);
+        emitter.m_positionsY.resize(emitter.m_count);
+        emitter.m_velocitiesX.resize(emitter.m_count);
+        emitter.m_velocitiesY.resize(emitter.m_count);
+        emitter.m_lifetimes.resize(emitter.m_count);
+        emitter.m_inverseLifetimes.resize(emitter.m_count);
+        emitter.m_colors.resize(emitter.m_count);
+    }
+
+    std::uniform_real_distribution<float> speeds(definition.m_minSpeed, definition.m_maxSpeed);
+    std::uniform_real_distribution<float> angles(definition.m_minAngle * g_pi / 180.f,
+        definition.m_maxAngle * g_pi / 180.f);
+    std::uniform_real_distribution<float> lifetimes(definition.m_minLifetime, definition.m_maxLifetime);
+    std::uniform_real_distribution<float> shades(0.f, 1.f);
+    const SDL_Color& firstColor = definition.m_firstColor;
+    const SDL_Color& secondColor = definition.m_secondColor;
+    for (size_t i = first; i < emitter.m_count; ++i)
+    {
+        const float speed = speeds(m_random);
+        const float angle = angles(m_random);
+        const float lifetime = std::max(lifetimes(m_random), 0.001f);
+        const float shade = shades(m_random);
+        emitter.m_positionsX[i] = p_position.x;
+        emitter.m_positionsY[i] = p_position.y;
+        emitter.m_velocitiesX[i] = speed * std::cos(angle);
+        emitter.m_velocitiesY[i] = speed * std::sin(angle);
+        emitter.m_lifetimes[i] = lifetime;
+        emitter.m_inverseLifetimes[i] = 1.f / lifetime;
+        emitter.m_colors[i] = {
+            static_cast<Uint8>(firstColor.r + (secondColor.r - firstColor.r) * shade),
+            static_cast<Uint8>(firstColor.g + (secondColor.g - firstColor.g) * shade),
+            static_cast<Uint8>(firstColor.b + (secondColor.b - firstColor.b) * shade),
+            static_cast<Uint8>(firstColor.a + (secondColor.a - firstColor.a) * shade)
+        };
+    }
+    return count;
+}
+
+void ParticleSystem::update(const float p_deltaTime, JobSystem* p_jobSystem)
+{
+    PROFILE_SCOPE("UpdateParticles");
+    m_liveParticles = 0;
+    for (Emitter& emitter : m_emitters)
+    {
+        Emitter* updatedEmitter = &emitter;
+        auto integrateBatch = [updatedEmitter, p_deltaTime](const size_t p_start, const size_t p_end)
+        {
+            integrate(*updatedEmitter, p_start, p_end, p_deltaTime);
+        };
+        //a burst or two aren't worth waking the workers
+        if (p_jobSystem && emitter.m_count > s_batchSize)
+            p_jobSystem->parallelFor("IntegrateParticles", emitter.m_count, s_batchSize, integrateBatch);
+        else
+            integrateBatch(0, emitter.m_count);
+        removeDeadParticles(emitter);
+        m_liveParticles += emitter.m_count;
+    }
+    m_stats.m_liveParticles = static_cast<Uint32>(m_liveParticles);
+}
+
+void ParticleSystem::prepare(const float p_offsetX, JobSystem* p_jobSystem)
+{
+    PROFILE_SCOPE("PrepareParticles");
+    //the emitters' quads follow each other in their batch, the buffers are sized before any is written
+    for (Batch& batch : m_batches)
+        batch.m_quadCount = 0;
+    for (Emitter& emitter : m_emitters)
+    {
+        Batch& batch = m_batches[emitter.m_batch];
+        emitter.m_firstQuad = batch.m_quadCount;
+        batch.m_quadCount += emitter.m_count;
+    }
+    size_t largestBatch = 0;
+    for (Batch& batch : m_batches)
+    {
+        if (batch.m_vertices.size() < 4 * batch.m_quadCount)
+            batch.m_vertices.resize(4 * batch.m_quadCount);
+        largestBatch = std::max(largestBatch, batch.m_quadCount);
+    }
+    for (const Emitter& emitter : m_emitters)
+    {
+        const Emitter* preparedEmitter = &emitter;
+        SDL_Vertex* vertices = m_batches[emitter.m_batch].m_vertices.data() + 4 * emitter.m_firstQuad;
+        auto prepareBatch = [preparedEmitter, vertices, p_offsetX](const size_t p_start, const size_t p_end)
+        {
+            prepareQuads(*preparedEmitter, vertices, p_start, p_end, p_offsetX);
+        };
+        if (p_jobSystem && emitter.m_count > s_batchSize)
+            p_jobSystem->parallelFor("PrepareParticles", emitter.m_count, s_batchSize, prepareBatch);
+        else
+            prepareBatch(0, emitter.m_count);
+    }
+    for (size_t quad = m_indices.size() / 6; quad < largestBatch; ++quad)
+    {
+        const int first = static_cast<int>(4 * quad);
+        const int quadIndices[] = {first, first + 1, first + 2, first, first + 2, first + 3};
+        m_indices.insert(m_indices.end(), quadIndices, quadIndices + 6);
+    }
+}
+
+void ParticleSystem::submit(SDL_Renderer* p_renderer, const SDL_Rect& p_sceneRect)
+{
+    PROFILE_SCOPE("SubmitParticles");
+    m_stats.m_drawCalls = 0;
+    if (m_liveParticles == 0)
+        return;
+    SDL_Rect previousClipRect;
+    SDL_RenderGetClipRect(p_renderer, &previousClipRect);
+    const bool wasClipping = SDL_RenderIsClipEnabled(p_renderer) == SDL_TRUE;
+    SDL_BlendMode previousBlendMode;
+    SDL_GetRenderDrawBlendMode(p_renderer, &previousBlendMode);
+    SDL_RenderSetClipRect(p_renderer, &p_sceneRect);
+    //the untextured particles are blended with the draw blend mode
+    SDL_SetRenderDrawBlendMode(p_renderer, SDL_BLENDMODE_BLEND);
+    for (const Batch& batch : m_batches)
+    {
+        if (batch.m_quadCount == 0)
+            continue;
+        const int quadCount = static_cast<int>(batch.m_quadCount);
+        SDL_RenderGeometry(p_renderer, batch.m_texture, batch.m_vertices.data(), 4 * quadCount, m_indices.data(),
+            6 * quadCount);
+        ++m_stats.m_drawCalls;
+    }
+    SDL_SetRenderDrawBlendMode(p_renderer, previousBlendMode);
+    SDL_RenderSetClipRect(p_renderer, wasClipping ? &previousClipRect : nullptr);
+}
+
+void ParticleSystem::clear()
+{
+    for (Emitter& emitter : m_emitters)
+        emitter.m_count = 0;
+    m_liveParticles = 0;
+    m_stats.m_liveParticles = 0;
+}
+
+void ParticleSystem::integrate(Emitter& p_emitter, const size_t p_start, const size_t p_end,
+                               const float p_deltaTime)
+{
+    float* positionsX = p_emitter.m_positionsX.data();
+    float* positionsY = p_emitter.m_positionsY.data();
+    const float* velocitiesX = p_emitter.m_velocitiesX.data();
+    float* velocitiesY = p_emitter.m_velocitiesY.data();
+    float* lifetimes = p_emitter.m_lifetimes.data();
+    const float gravityStep = p_emitter.m_definition.m_gravity * p_deltaTime;
+    size_t i = p_start;
+#ifdef PARTICLES_USE_SSE
+    const __m128 deltaTime = _mm_set1_ps(p_deltaTime);
+    const __m128 gravity = _mm_set1_ps(gravityStep);
+    for (; i + 4 <= p_end; i += 4)
+    {
+        const __m128 velocityY = _mm_add_ps(_mm_loadu_ps(velocitiesY + i), gravity);
+        _mm_storeu_ps(velocitiesY + i, velocityY);
+        _mm_storeu_ps(positionsX + i,
+            _mm_add_ps(_mm_loadu_ps(positionsX + i), _mm_mul_ps(_mm_loadu_ps(velocitiesX + i), deltaTime)));
+        _mm_storeu_ps(positionsY + i, _mm_add_ps(_mm_loadu_ps(positionsY + i), _mm_mul_ps(velocityY, deltaTime)));
+        _mm_storeu_ps(lifetimes + i, _mm_sub_ps(_mm_loadu_ps(lifetimes + i), deltaTime));
+    }
+#endif
+    //what is left of the batch, or all of it without SSE
+    for (; i < p_end; ++i)
+    {
+        velocitiesY[i] += gravityStep;
+        positionsX[i] += velocitiesX[i] * p_deltaTime;
+        positionsY[i] += velocitiesY[i] * p_deltaTime;
+        lifetimes[i] -= p_deltaTime;
+    }
+}
+
+void ParticleSystem::prepareQuads(const Emitter& p_emitter, SDL_Vertex* p_vertices, const size_t p_start,
+                                  const size_t p_end, const float p_offsetX)
+{
+    const float halfSize = p_emitter.m_definition.m_size / 2.f;
+    for (size_t i = p_start; i < p_end; ++i)
+    {
+        const float x = p_emitter.m_positionsX[i] + p_offsetX;
+        const float y = p_emitter.m_positionsY[i];
+        SDL_Color color = p_emitter.m_colors[i];
+        const float lifeLeft = std::min(std::max(p_emitter.m_lifetimes[i] * p_emitter.m_inverseLifetimes[i], 0.f), 1.f);
+        color.a = static_cast<Uint8>(static_cast<float>(color.a) * lifeLeft);
+        SDL_Vertex* corners = &p_vertices[4 * i];
+        corners[0] = {{x - halfSize, y - halfSize}, color, {0.f, 0.f}};
+        corners[1] = {{x + halfSize, y - halfSize}, color, {1.f, 0.f}};
+        corners[2] = {{x + halfSize, y + halfSize}, color, {1.f, 1.f}};
+        corners[3] = {{x - halfSize, y + halfSize}, color, {0.f, 1.f}};
+    }
+}
+
+void ParticleSystem::removeDeadParticles(Emitter& p_emitter)
+{
+    size_t i = 0;
+    while (i < p_emitter.m_count)
+    {
+        if (p_emitter.m_lifetimes[i] > 0.f)
+        {
+            ++i;
+            continue;
+        }
+        const size_t last = --p_emitter.m_count;
+        p_emitter.m_positionsX[i] = p_emitter.m_positionsX[last];
+        p_emitter.m_positionsY[i] = p_emitter.m_positionsY[last];
+        p_emitter.m_velocitiesX[i] = p_emitter.m_velocitiesX[last];
+        p_emitter.m_velocitiesY[i] = p_emitter.m_velocitiesY[last];
+        p_emitter.m_lifetimes[i] = p_emitter.m_lifetimes[last];
+        p_emitter.m_inverseLifetimes[i] = p_emitter.m_inverseLifetimes[last];
+        p_emitter.m_colors[i] = p_emitter.m_colors[last];
+    }
+}
@@ -0,0 +1,110 @@
+﻿#pragma once
+#include <SDL_render.h>
+#include <random>
+#include <vector>
+#include "utils.h"
+
+class JobSystem;
+
+//How the particles of an emitter move and look, every particle gets values picked between the min and the max
+struct ParticleEmitterDefinition
+{
+    //nullptr draws plain squares of the particles' colours
+    const char* m_texturePath;
+    //emitted by a burst
+    Uint16 m_burstCount;
+    //in pixels per second
+    float m_minSpeed;
+    float m_maxSpeed;
+    //in degrees, clockwise from the right like the sprites' rotation, -90 is up
+    float m_minAngle;
+    float m_maxAngle;
+    //in seconds
+    float m_minLifetime;
+    float m_maxLifetime;
+    //in pixels per second squared, down
+    float m_gravity;
+    //side of the square, in pixels
+    float m_size;
+    //a particle's colour is picked between both, it fades out over its lifetime
+    SDL_Color m_firstColor;
+    SDL_Color m_secondColor;
+};
+
+struct ParticleStats
+{
+    Uint32 m_liveParticles = 0;
+    //cut by the budget since the creation
+    Uint32 m_droppedParticles = 0;
+    Uint32 m_drawCalls = 0;
+};
+
+//Particles kept per emitter in arrays of their fields, moved four at a time with SSE on the job system's workers
+//and drawn with one SDL_RenderGeometry call per texture. The live particles of every emitter together never go
+//over the budget, the buffers stop allocating once it has been reached
+class ParticleSystem
+{
+public:
+    explicit ParticleSystem(size_t p_budget = PARTICLE_BUDGET);
+    //the emitters are drawn in the order they are added, one sharing an earlier one's texture along with it.
+    //Returns the emitter's index
+    int addEmitter(const ParticleEmitterDefinition& p_definition, SDL_Texture* p_texture);
+    //p_count 0 emits the definition's burst, returns how many the budget let through
+    size_t emit(int p_emitter, const Vec2<float>& p_position, size_t p_count = 0);
+    //moves and ages the particles, the ones at the end of their lifetime are removed.
+    //Without a job system it runs on the calling thread
+    void update(float p_deltaTime, JobSystem* p_jobSystem);
+    //the quads of the live particles, moved by p_offsetX onto the screen
+    void prepare(float p_offsetX, JobSystem* p_jobSystem);
+    //clipped to p_sceneRect
+    void submit(SDL_Renderer* p_renderer, const SDL_Rect& p_sceneRect);
+    void clear();
+    size_t getBudget() const { return m_budget; }
+    const ParticleStats& getStats() const { return m_stats; }
+private:
+    //one array per field, a particle is the same index in every one of them
+    struct Emitter
+    {
+        ParticleEmitterDefinition m_definition;
+        size_t m_count;
+        std::vector<float> m_positionsX;
+        std::vector<float> m_positionsY;
+        std::vector<float> m_velocitiesX;
+        std::vector<float> m_velocitiesY;
+        //left to live, in seconds
+        std::vector<float> m_lifetimes;
+        std::vector<float> m_inverseLifetimes;
+        std::vector<SDL_Color> m_colors;
+        //in m_batches
+        size_t m_batch;
+        //where its quads start in its batch's, this frame
+        size_t m_firstQuad;
+    };
+
+    //the quads of the emitters drawing the same texture
+    struct Batch
+    {
+        SDL_Texture* m_texture;
+        size_t m_quadCount;
+        std::vector<SDL_Vertex> m_vertices;
+    };
+
+    //particles per job
+    static constexpr size_t s_batchSize = 4096;
+
+    static void integrate(Emitter& p_emitter, size_t p_start, size_t p_end, float p_deltaTime);
+    static void prepareQuads(const Emitter& p_emitter, SDL_Vertex* p_vertices, size_t p_start, size_t p_end,
+                             float p_offsetX);
+    //the dead particles are replaced by the last live ones
+    static void removeDeadParticles(Emitter& p_emitter);
+
+    std::vector<Emitter> m_emitters;
+    //in the order of their first emitter
+    std::vector<Batch> m_batches;
+    size_t m_budget;
+    size_t m_liveParticles = 0;
+    //the same two triangles for every quad, as many as the largest batch has
+    std::vector<int> m_indices;
+    std::mt19937 m_random;
+    ParticleStats m_stats;
+};
@@ -0,0 +1,147 @@
+﻿#include "PerformanceOverlay.h"
+#include <algorithm>
+#include <cstdio>
+#include "EntityManager.h"
+#include "Gameloop.h"
+
+extern int g_scenePosX;
+extern int g_scenePosY;
+
+PerformanceOverlay::PerformanceOverlay(SDL_Renderer* p_renderer, TTF_Font* p_font, const Gameloop* p_gameloop,
+                                       EntityManager* p_entityManager) : m_renderer(p_renderer),
+                                                                         m_glyphAtlas(p_renderer, p_font),
+                                                                         m_gameloop(p_gameloop),
+                                                                         m_entityManager(p_entityManager),
+                                                                         m_lastFrameCounter(
+                                                                             SDL_GetPerformanceCounter()),
+                                                                         m_rect({0, 0, 260, 0})
+{
+}
+
+void PerformanceOverlay::recordFrame()
+{
+    const Uint64 counter = SDL_GetPerformanceCounter();
+    m_frameTimes[m_frameIndex] = static_cast<float>(counter - m_lastFrameCounter) * 1000.f / static_cast<float>(
+        SDL_GetPerformanceFrequency());
+    m_frameIndex = (m_frameIndex + 1) % s_frameHistorySize;
+    m_lastFrameCounter = counter;
+}
+
+void PerformanceOverlay::addLine(const char* p_text)
+{
+    m_glyphAtlas.addText(p_text, static_cast<float>(m_rect.x + 5), m_lineY, m_fontColor);
+    m_lineY += static_cast<float>(m_glyphAtlas.getLineHeight());
+}
+
+size_t PerformanceOverlay::computeTextureMemory()
+{
+    //the entity manager loads every image once, the entities share the textures
+    size_t bytes = m_glyphAtlas.getTextureMemory();
+    for (const LoadedTexture& loadedTexture : m_entityManager->getLoadedTextures())
+    {
+        int w = 0;
+        int h = 0;
+        if (loadedTexture.m_texture &&
+            SDL_QueryTexture(loadedTexture.m_texture, nullptr, nullptr, &w, &h) == 0)
+            bytes += static_cast<size_t>(w) * h * 4;
+    }
+    return bytes;
+}
+
+void PerformanceOverlay::displayOverlay()
+{
+    if (!m_isVisible)
+        return;
+
+    float averageFrameTime = 0.f;
+    float worstFrameTime = 0.f;
+    for (const float frameTime : m_frameTimes)
+    {
+        averageFrameTime += frameTime;
+        worstFrameTime = std::max(worstFrameTime, frameTime);
+    }
+    averageFrameTime /= static_cast<float>(s_frameHistorySize);
+
+    size_t awakeEntities = 0;
+    for (const MoveableEntity* moveableEntity : m_entityManager->getMoveableEntities())
+    {
+        const Vec2<float> velocity = moveableEntity->getVelocity();
+        if (!moveableEntity->getIsKinematic() && (velocity.x != 0.f || velocity.y != 0.f))
+            ++awakeEntities;
+    }
+    const RenderStats& renderStats = m_gameloop->getRenderStats();
+    const NetworkSession* networkSession = m_gameloop->getNetworkSession();
+    const WorldStreamer& worldStreamer = m_gameloop->getWorldStreamer();
+
+    const int lineHeight = m_glyphAtlas.getLineHeight();
+    const float graphHeight = 33.f * s_graphScale;
+    m_rect.x = g_scenePosX;
+    m_rect.y = g_scenePosY;
+    const int lineCount = 8 + (networkSession ? 1 : 0) + (worldStreamer.getIsOpen() ? 1 : 0);
+    m_rect.h = lineCount * lineHeight + static_cast<int>(graphHeight) + 10;
+    SDL_BlendMode blendMode;
+    SDL_GetRenderDrawBlendMode(m_renderer, &blendMode);
+    SDL_Color drawColor;
+    SDL_GetRenderDrawColor(m_renderer, &drawColor.r, &drawColor.g, &drawColor.b, &drawColor.a);
+    SDL_SetRenderDrawBlendMode(m_renderer, SDL_BLENDMODE_BLEND);
+    SDL_SetRenderDrawColor(m_renderer, 0, 0, 0, 180);
+    SDL_RenderFillRect(m_renderer, &m_rect);
+
+    char line[96];
+    m_lineY = static_cast<float>(m_rect.y + 2);
+    const float fps = averageFrameTime > 0.f ? 1000.f / averageFrameTime : 0.f;
+    snprintf(line, sizeof(line), "FPS %.0f  frame %.2f ms (worst %.2f)", fps, averageFrameTime, worstFrameTime);
+    addLine(line);
+    snprintf(line, sizeof(line), "Fixed tick %.2f ms  overruns %u", m_gameloop->getLastTickTime(),
+        m_gameloop->getTickOverruns());
+    addLine(line);
+    snprintf(line, sizeof(line), "Entities %u  awake %u  culled %u",
+        static_cast<unsigned>(m_entityManager->getEntities().size()), static_cast<unsigned>(awakeEntities),
+        renderStats.m_culledEntities);
+    addLine(line);
+    snprintf(line, sizeof(line), "Draw calls %u  texture switches %u  sprites %u", renderStats.m_drawCalls,
+        renderStats.m_textureSwitches, renderStats.m_sprites);
+    addLine(line);
+    snprintf(line, sizeof(line), "Texture memory %.1f KB", static_cast<float>(computeTextureMemory()) / 1024.f);
+    addLine(line);
+    snprintf(line, sizeof(line), "Pair tests per tick %u", static_cast<unsigned>(m_entityManager->getPairTestCount()));
+    addLine(line);
+    const ParticleStats& particleStats = m_gameloop->getParticleStats();
+    snprintf(line, sizeof(line), "Particles %u / %u  dropped %u", particleStats.m_liveParticles,
+        static_cast<unsigned>(PARTICLE_BUDGET), particleStats.m_droppedParticles);
+    addLine(line);
+    if (networkSession)
+    {
+        const NetworkStats stats = networkSession->getStats();
+        snprintf(line, sizeof(line), "Rollbacks %u  resim %.1f ms  stalls %u", stats.m_rollbacks,
+            stats.m_rollbackTime, stats.m_stalls);
+        addLine(line);
+    }
+    if (worldStreamer.getIsOpen())
+    {
+        const StreamingStats& stats = worldStreamer.getStats();
+        snprintf(line, sizeof(line), "Cells %u  loading %u  latency %.1f ms (worst %.1f)  hitches %u",
+            stats.m_residentCells, stats.m_pendingCells, stats.m_meanLoadLatency, stats.m_worstLoadLatency,
+            stats.m_hitches);
+        addLine(line);
+    }
+    m_glyphAtlas.flush();
+
+    //oldest frame on the left, the line at the top of the graph is 33 ms (30 FPS)
+    const float graphBottom = m_lineY + graphHeight + 4.f;
+    const float graphStep = static_cast<float>(m_rect.w - 10) / static_cast<float>(s_frameHistorySize - 1);
+    for (int i = 0; i < s_frameHistorySize; ++i)
+    {
+        const float frameTime = std::min(m_frameTimes[(m_frameIndex + i) % s_frameHistorySize], 33.f);
+        m_graphPoints[i] = {
+            static_cast<float>(m_rect.x + 5) + graphStep * static_cast<float>(i), graphBottom - frameTime * s_graphScale
+        };
+    }
+    SDL_SetRenderDrawColor(m_renderer, 90, 90, 90, 255);
+    SDL_RenderDrawLineF(m_renderer, static_cast<float>(m_rect.x + 5), graphBottom - graphHeight,
+        static_cast<float>(m_rect.x + m_rect.w - 5), graphBottom - graphHeight);
+    SDL_SetRenderDrawColor(m_renderer, 0, 220, 0, 255);
+    SDL_RenderDrawLinesF(m_renderer, m_graphPoints, s_frameHistorySize);
+    SDL_SetRenderDrawColor(m_renderer, drawColor.r, drawColor.g, drawColor.b, drawColor.a);
+    SDL_SetRenderDrawBlendMode(m_renderer, blendMode);
+}
@@ -0,0 +1,43 @@
+﻿#pragma once
+#include <SDL_render.h>
+#include <SDL_ttf.h>
+#include <vector>
+#include "GlyphAtlas.h"
+
+class Gameloop;
+class EntityManager;
+
+//Frame and tick timings drawn over the top left corner of the scene, toggled with F2
+class PerformanceOverlay
+{
+public:
+    PerformanceOverlay(SDL_Renderer* p_renderer, TTF_Font* p_font, const Gameloop* p_gameloop,
+                       EntityManager* p_entityManager);
+    void toggle() { m_isVisible = !m_isVisible; }
+    bool getIsVisible() const { return m_isVisible; }
+    //called once per frame, even when hidden, so the graph is ready when shown
+    void recordFrame();
+    void displayOverlay();
+private:
+    static constexpr int s_frameHistorySize = 120;
+    //graph height in pixels for 33 ms
+    static constexpr float s_graphScale = 2.f;
+
+    void addLine(const char* p_text);
+    size_t computeTextureMemory();
+
+    SDL_Renderer* m_renderer;
+    GlyphAtlas m_glyphAtlas;
+    const Gameloop* m_gameloop;
+    EntityManager* m_entityManager;
+    SDL_Color m_fontColor = {200, 200, 200, 255};
+    bool m_isVisible = false;
+
+    Uint64 m_lastFrameCounter;
+    float m_frameTimes[s_frameHistorySize] = {0.f};
+    int m_frameIndex = 0;
+    SDL_FPoint m_graphPoints[s_frameHistorySize];
+
+    SDL_Rect m_rect;
+    float m_lineY = 0.f;
+};
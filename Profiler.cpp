@@ -0,0 +1,81 @@
+﻿#include "Profiler.h"
+
+#ifdef ENGINE_PROFILING
+
+#include <algorithm>
+#include <fstream>
+
+const Sint64 Profiler::s_origin = now();
+std::mutex Profiler::s_buffersMutex;
+std::vector<ProfileBuffer*> Profiler::s_buffers;
+std::vector<ProfileBuffer*> Profiler::s_freeBuffers;
+
+//gives the buffer back when its thread ends, the next thread started takes it
+struct ProfileBufferHandle
+{
+    ProfileBufferHandle() : m_buffer(Profiler::acquireBuffer())
+    {
+    }
+
+    ~ProfileBufferHandle() { Profiler::releaseBuffer(m_buffer); }
+    ProfileBuffer* m_buffer;
+};
+
+ProfileBuffer& Profiler::getThreadBuffer()
+{
+    static thread_local ProfileBufferHandle handle;
+    return *handle.m_buffer;
+}
+
+ProfileBuffer* Profiler::acquireBuffer()
+{
+    std::lock_guard<std::mutex> lock(s_buffersMutex);
+    if (!s_freeBuffers.empty())
+    {
+        ProfileBuffer* buffer = s_freeBuffers.back();
+        s_freeBuffers.pop_back();
+        return buffer;
+    }
+    //buffers are never deleted, the dump may still read them
+    s_buffers.push_back(new ProfileBuffer(static_cast<Uint32>(s_buffers.size())));
+    return s_buffers.back();
+}
+
+void Profiler::releaseBuffer(ProfileBuffer* p_buffer)
+{
+    std::lock_guard<std::mutex> lock(s_buffersMutex);
+    s_freeBuffers.push_back(p_buffer);
+}
+
+bool Profiler::dumpChromeTrace(const char* p_path)
+{
+    std::ofstream file(p_path);
+    if (!file)
+        return false;
+
+    std::lock_guard<std::mutex> lock(s_buffersMutex);
+    file << "{\"traceEvents\":[";
+    bool isFirst = true;
+    for (const ProfileBuffer* buffer : s_buffers)
+    {
+        //the owner keeps writing, the oldest slots are left out so they cannot be overwritten while read
+        const Uint32 writeCount = buffer->getWriteCount();
+        const Uint32 margin = ProfileBuffer::s_capacity / 8;
+        const Uint32 readCount = std::min(writeCount, ProfileBuffer::s_capacity - margin);
+        for (Uint32 i = writeCount - readCount; i != writeCount; ++i)
+        {
+            const ProfileEvent& event = buffer->getEvent(i);
+            if (!isFirst)
+                file << ",";
+            isFirst = false;
+            file << "\n{\"name\":\"" << event.m_name << "\",\"ph\":\"X\",\"pid\":0,\"tid\":" << buffer->
+                getThreadId() << ",\"ts\":" << static_cast<double>(event.m_start - s_origin) / 1000.0 << ",\"dur\":" <<
+                static_cast<double>(event.m_end - event.m_start) / 1000.0 << ",\"args\":{\"depth\":" << event.m_depth <<
+                "}}";
+        }
+    }
+    file << "\n],\"displayTimeUnit\":\"ms\"}\n";
+    return static_cast<bool>(file);
+}
+
+#endif
@@ -0,0 +1,106 @@
+﻿#pragma once
+
+//Scoped timing zones, only compiled with ENGINE_PROFILING (Profiling configuration).
+//PROFILE_SCOPE("Name") times the rest of the enclosing block, p_name must be a string literal.
+#ifdef ENGINE_PROFILING
+
+#include <SDL_stdinc.h>
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <vector>
+
+struct ProfileEvent
+{
+    const char* m_name;
+    Sint64 m_start;
+    Sint64 m_end;
+    Uint16 m_depth;
+};
+
+//Written by a single thread, read by the dump
+class ProfileBuffer
+{
+public:
+    static constexpr Uint32 s_capacity = 1 << 14;
+
+    explicit ProfileBuffer(const Uint32 p_threadId) : m_threadId(p_threadId), m_writeCount(0), m_depth(0)
+    {
+        m_events.resize(s_capacity);
+    }
+
+    void push(const char* p_name, const Sint64 p_start, const Sint64 p_end)
+    {
+        const Uint32 index = m_writeCount.load(std::memory_order_relaxed);
+        m_events[index & (s_capacity - 1)] = {p_name, p_start, p_end, m_depth};
+        m_writeCount.store(index + 1, std::memory_order_release);
+    }
+
+    Uint32 getThreadId() const { return m_threadId; }
+    Uint32 getWriteCount() const { return m_writeCount.load(std::memory_order_acquire); }
+    const ProfileEvent& getEvent(const Uint32 p_index) const { return m_events[p_index & (s_capacity - 1)]; }
+    Uint16& getDepth() { return m_depth; }
+private:
+    Uint32 m_threadId;
+    std::vector<ProfileEvent> m_events;
+    std::atomic<Uint32> m_writeCount;
+    Uint16 m_depth;
+};
+
+class Profiler
+{
+public:
+    static Sint64 now()
+    {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
+    //buffer of the calling thread, taken from the pool the first time
+    static ProfileBuffer& getThreadBuffer();
+    //writes every buffered zone as Chrome trace_event JSON (chrome://tracing, Perfetto)
+    static bool dumpChromeTrace(const char* p_path);
+private:
+    friend struct ProfileBufferHandle;
+    static ProfileBuffer* acquireBuffer();
+    static void releaseBuffer(ProfileBuffer* p_buffer);
+
+    //trace timestamps start at the launch of the program
+    static const Sint64 s_origin;
+    static std::mutex s_buffersMutex;
+    static std::vector<ProfileBuffer*> s_buffers;
+    static std::vector<ProfileBuffer*> s_freeBuffers;
+};
+
+class ProfileScope
+{
+public:
+    explicit ProfileScope(const char* p_name) : m_name(p_name), m_buffer(Profiler::getThreadBuffer()),
+                                                m_start(Profiler::now())
+    {
+        ++m_buffer.getDepth();
+    }
+
+    ~ProfileScope()
+    {
+        --m_buffer.getDepth();
+        m_buffer.push(m_name, m_start, Profiler::now());
+    }
+
+    ProfileScope(const ProfileScope&) = delete;
+    ProfileScope& operator=(const ProfileScope&) = delete;
+private:
+    const char* m_name;
+    ProfileBuffer& m_buffer;
+    Sint64 m_start;
+};
+
+#define PROFILE_CONCAT_IMPL(p_first, p_second) p_first##p_second
+#define PROFILE_CONCAT(p_first, p_second) PROFILE_CONCAT_IMPL(p_first, p_second)
+#define PROFILE_SCOPE(p_name) ProfileScope PROFILE_CONCAT(profileScope, __LINE__)(p_name)
+
+#else
+
+#define PROFILE_SCOPE(p_name)
+
+#endif
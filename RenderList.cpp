@@ -0,0 +1,244 @@
+﻿#include "RenderList.h"
+#include <algorithm>
+#include <cmath>
+
+#include "Entity.h"
+#include "JobSystem.h"
+#include "Profiler.h"
+#include "Tilemap.h"
+
+void RenderList::build(const std::vector<Entity*>& p_entities, const std::vector<Tilemap*>& p_tilemaps,
+                       const float p_offsetX, const SDL_FRect& p_sceneRect, JobSystem* p_jobSystem)
+{
+    if (p_jobSystem)
+    {
+        const JobHandle completion = schedule(p_entities, p_tilemaps, p_offsetX, p_sceneRect, *p_jobSystem);
+        if (completion.m_job)
+            p_jobSystem->wait(completion);
+        return;
+    }
+    PROFILE_SCOPE("BuildRenderList");
+    reset(p_entities, p_tilemaps, p_offsetX, p_sceneRect);
+    prepareSprites(p_entities, 0, p_entities.size());
+    prepareChunks(p_tilemaps, p_entities.size());
+    sortSprites();
+    gatherBatches();
+}
+
+JobHandle RenderList::schedule(const std::vector<Entity*>& p_entities, const std::vector<Tilemap*>& p_tilemaps,
+                          const float p_offsetX, const SDL_FRect& p_sceneRect, JobSystem& p_jobSystem)
+{
+    reset(p_entities, p_tilemaps, p_offsetX, p_sceneRect);
+    //the preparation's jobs are its children, the sort waits for all of them
+    Job* preparation = p_jobSystem.createJob("PrepareRenderList", [] {});
+    Job* completion = preparation ? p_jobSystem.createJob("FinishRenderList", [this]
+    {
+        sortSprites();
+        gatherBatches();
+    }) : nullptr;
+    if (!completion)
+    {
+        if (preparation)
+            p_jobSystem.run(preparation);
+        build(p_entities, p_tilemaps, p_offsetX, p_sceneRect, nullptr);
+        return JobHandle();
+    }
+    p_jobSystem.addDependency(completion, preparation);
+    const JobHandle completionHandle = JobSystem::getHandle(completion);
+    p_jobSystem.run(completion);
+
+    //every sprite has its own slot, the batches write next to each other without sharing anything
+    constexpr size_t batchSize = 256;
+    const std::vector<Entity*>* entities = &p_entities;
+    for (size_t start = 0; start < p_entities.size(); start += batchSize)
+    {
+        const size_t end = std::min(start + batchSize, p_entities.size());
+        if (Job* job = p_jobSystem.createJob("PrepareSprites", [this, entities, start, end]
+        {
+            prepareSprites(*entities, start, end);
+        }, preparation))
+            p_jobSystem.run(job);
+        else
+            prepareSprites(p_entities, start, end);
+    }
+    //a few chunks for a whole level, one job next to the entities' batches
+    const std::vector<Tilemap*>* tilemaps = &p_tilemaps;
+    const size_t firstChunkSprite = p_entities.size();
+    if (Job* job = p_jobSystem.createJob("PrepareChunks", [this, tilemaps, firstChunkSprite]
+    {
+        prepareChunks(*tilemaps, firstChunkSprite);
+    }, preparation))
+        p_jobSystem.run(job);
+    else
+        prepareChunks(p_tilemaps, firstChunkSprite);
+    p_jobSystem.run(preparation);
+    return completionHandle;
+}
+
+void RenderList::submit(SDL_Renderer* p_renderer) const
+{
+    PROFILE_SCOPE("SubmitRenderList");
+    for (const Batch& batch : m_batches)
+        SDL_RenderGeometry(p_renderer, batch.m_texture, &m_vertices[batch.m_firstVertex], 4 * batch.m_quadCount,
+            m_indices.data(), 6 * batch.m_quadCount);
+}
+
+void RenderList::reset(const std::vector<Entity*>& p_entities, const std::vector<Tilemap*>& p_tilemaps,
+                       const float p_offsetX, const SDL_FRect& p_sceneRect)
+{
+    m_offsetX = p_offsetX;
+    m_sceneRect = p_sceneRect;
+    m_isValid = false;
+    size_t chunkCount = 0;
+    for (const Tilemap* tilemap : p_tilemaps)
+        chunkCount += tilemap->getChunkCount();
+    m_sprites.resize(p_entities.size() + chunkCount);
+}
+
+void RenderList::prepareSprites(const std::vector<Entity*>& p_entities, const size_t p_start, const size_t p_end)
+{
+    for (size_t i = p_start; i < p_end; ++i)
+        prepareSprite(*p_entities[i], m_offsetX, m_sceneRect, m_sprites[i]);
+}
+
+void RenderList::prepareChunks(const std::vector<Tilemap*>& p_tilemaps, size_t p_firstSprite)
+{
+    for (const Tilemap* tilemap : p_tilemaps)
+    {
+        const Uint64 sortKey = makeSortKey(*tilemap);
+        for (size_t chunk = 0; chunk < tilemap->getChunkCount(); ++chunk)
+        {
+            const FRect chunkRect = tilemap->getChunkRect(chunk);
+            prepareQuad({chunkRect.x + m_offsetX, chunkRect.y, chunkRect.w, chunkRect.h}, 0.f,
+                tilemap->getChunkTexture(chunk), {0.f, 0.f, 1.f, 1.f}, sortKey, m_sceneRect,
+                m_sprites[p_firstSprite++]);
+        }
+    }
+}
+
+Uint64 RenderList::makeSortKey(const Entity& p_entity)
+{
+    //the depth is offset so the negative ones sort first
+    return static_cast<Uint64>(p_entity.getRenderLayer()) << 32 | static_cast<Uint64>(p_entity.getTextureId()) << 16 |
+        static_cast<Uint16>(p_entity.getRenderDepth() + 32768);
+}
+
+void RenderList::prepareSprite(const Entity& p_entity, const float p_offsetX, const SDL_FRect& p_sceneRect,
+                               Sprite& p_sprite)
+{
+    const FRect entityRect = p_entity.getEntityRect();
+    prepareQuad({entityRect.x + p_offsetX, entityRect.y, entityRect.w, entityRect.h}, p_entity.getRotation(),
+        p_entity.getTexture(), p_entity.getTextureRect(), makeSortKey(p_entity), p_sceneRect, p_sprite);
+}
+
+void RenderList::prepareQuad(const SDL_FRect& p_rect, const float p_rotation, SDL_Texture* p_texture,
+                             const FRect& p_textureRect, const Uint64 p_sortKey, const SDL_FRect& p_sceneRect,
+                             Sprite& p_sprite)
+{
+    //a rotated sprite stays inside the circle around its rect
+    SDL_FRect cullingRect = p_rect;
+    if (p_rotation != 0.f)
+    {
+        const float halfDiagonal = std::sqrt(p_rect.w * p_rect.w + p_rect.h * p_rect.h) / 2.f;
+        cullingRect = {
+            p_rect.x + p_rect.w / 2.f - halfDiagonal, p_rect.y + p_rect.h / 2.f - halfDiagonal, 2.f * halfDiagonal,
+            2.f * halfDiagonal
+        };
+    }
+    p_sprite.m_isCulled = !SDL_HasIntersectionF(&cullingRect, &p_sceneRect);
+    p_sprite.m_texture = p_sprite.m_isCulled ? nullptr : p_texture;
+    if (!p_sprite.m_texture)
+        return;
+    p_sprite.m_sortKey = p_sortKey;
+
+    //clockwise around the center, in degrees like SDL_RenderCopyEx
+    const float angle = p_rotation * g_pi / 180.f;
+    const float cosine = std::cos(angle);
+    const float sine = std::sin(angle);
+    const float centerX = p_rect.x + p_rect.w / 2.f;
+    const float centerY = p_rect.y + p_rect.h / 2.f;
+    const float halfWidth = p_rect.w / 2.f;
+    const float halfHeight = p_rect.h / 2.f;
+    const float cornerX[4] = {-halfWidth, halfWidth, halfWidth, -halfWidth};
+    const float cornerY[4] = {-halfHeight, -halfHeight, halfHeight, halfHeight};
+    const float left = p_textureRect.x;
+    const float right = p_textureRect.x + p_textureRect.w;
+    const float top = p_textureRect.y;
+    const float bottom = p_textureRect.y + p_textureRect.h;
+    const float textureX[4] = {left, right, right, left};
+    const float textureY[4] = {top, top, bottom, bottom};
+    for (int i = 0; i < 4; ++i)
+    {
+        p_sprite.m_corners[i] = {
+            {centerX + cornerX[i] * cosine - cornerY[i] * sine, centerY + cornerX[i] * sine + cornerY[i] * cosine},
+            {255, 255, 255, 255}, {textureX[i], textureY[i]}
+        };
+    }
+}
+
+void RenderList::sortSprites()
+{
+    PROFILE_SCOPE("SortRenderList");
+    m_drawOrder.clear();
+    for (size_t i = 0; i < m_sprites.size(); ++i)
+        if (m_sprites[i].m_texture)
+            m_drawOrder.push_back(static_cast<Uint32>(i));
+    if (m_drawOrder.size() < 2)
+        return;
+
+    Uint32 counts[s_sortKeyBytes][256] = {};
+    for (const Uint32 index : m_drawOrder)
+        for (int byte = 0; byte < s_sortKeyBytes; ++byte)
+            ++counts[byte][m_sprites[index].m_sortKey >> 8 * byte & 0xFF];
+    m_sortBuffer.resize(m_drawOrder.size());
+    for (int byte = 0; byte < s_sortKeyBytes; ++byte)
+    {
+        //every key has the same byte, the pass wouldn't move anything
+        Uint32* byteCounts = counts[byte];
+        if (byteCounts[m_sprites[m_drawOrder.front()].m_sortKey >> 8 * byte & 0xFF] == m_drawOrder.size())
+            continue;
+        Uint32 offset = 0;
+        for (int digit = 0; digit < 256; ++digit)
+        {
+            const Uint32 count = byteCounts[digit];
+            byteCounts[digit] = offset;
+            offset += count;
+        }
+        for (const Uint32 index : m_drawOrder)
+            m_sortBuffer[byteCounts[m_sprites[index].m_sortKey >> 8 * byte & 0xFF]++] = index;
+        m_drawOrder.swap(m_sortBuffer);
+    }
+}
+
+void RenderList::gatherBatches()
+{
+    m_vertices.clear();
+    m_batches.clear();
+    m_stats = RenderStats();
+    for (const Sprite& sprite : m_sprites)
+        if (sprite.m_isCulled)
+            ++m_stats.m_culledEntities;
+    int largestBatch = 0;
+    for (const Uint32 index : m_drawOrder)
+    {
+        const Sprite& sprite = m_sprites[index];
+        if (m_batches.empty() || m_batches.back().m_texture != sprite.m_texture)
+        {
+            if (!m_batches.empty())
+                ++m_stats.m_textureSwitches;
+            m_batches.push_back({sprite.m_texture, static_cast<int>(m_vertices.size()), 0});
+        }
+        m_vertices.insert(m_vertices.end(), sprite.m_corners, sprite.m_corners + 4);
+        largestBatch = std::max(largestBatch, ++m_batches.back().m_quadCount);
+        ++m_stats.m_sprites;
+    }
+    m_stats.m_drawCalls = static_cast<Uint32>(m_batches.size());
+
+    for (int quad = static_cast<int>(m_indices.size()) / 6; quad < largestBatch; ++quad)
+    {
+        const int first = 4 * quad;
+        const int quadIndices[] = {first, first + 1, first + 2, first, first + 2, first + 3};
+        m_indices.insert(m_indices.end(), quadIndices, quadIndices + 6);
+    }
+    m_isValid = true;
+}
@@ -0,0 +1,95 @@
+﻿#pragma once
+#include <SDL_render.h>
+#include <vector>
+#include "utils.h"
+
+class Entity;
+struct JobHandle;
+class JobSystem;
+class Tilemap;
+
+struct RenderStats
+{
+    Uint32 m_drawCalls = 0;
+    //between two consecutive sprites, every one of them cuts a batch
+    Uint32 m_textureSwitches = 0;
+    Uint32 m_culledEntities = 0;
+    Uint32 m_sprites = 0;
+};
+
+//The sprites of a frame as textured quads, sorted by render layer, texture then depth so the sprites of a
+//texture follow each other and are drawn in one call. Sprites with the same key keep the entity list's order.
+//Built from the entity list on the job system's workers, the renderer's thread only submits it.
+class RenderList
+{
+public:
+    //p_offsetX moves the entities into the scene on screen, the ones outside of p_sceneRect are culled.
+    //The tilemaps add one sprite per chunk. Without a job system it is built on the calling thread
+    void build(const std::vector<Entity*>& p_entities, const std::vector<Tilemap*>& p_tilemaps, float p_offsetX,
+               const SDL_FRect& p_sceneRect, JobSystem* p_jobSystem);
+    //Same as build without waiting: the sprites are prepared by one job each batch, the sort and the batches
+    //follow once they are all done. Returns the last job, the lists must be left as they are until it finishes.
+    //No job when the job system had no free slot left, the list is then already built
+    JobHandle schedule(const std::vector<Entity*>& p_entities, const std::vector<Tilemap*>& p_tilemaps, float p_offsetX,
+                  const SDL_FRect& p_sceneRect, JobSystem& p_jobSystem);
+    void submit(SDL_Renderer* p_renderer) const;
+    //the entities were deleted or the scene moved since, the sprites or positions may be wrong
+    void invalidate() { m_isValid = false; }
+    bool isValidFor(const float p_offsetX, const SDL_FRect& p_sceneRect) const
+    {
+        return m_isValid && m_offsetX == p_offsetX && m_sceneRect.x == p_sceneRect.x &&
+            m_sceneRect.y == p_sceneRect.y && m_sceneRect.w == p_sceneRect.w && m_sceneRect.h == p_sceneRect.h;
+    }
+    const RenderStats& getStats() const { return m_stats; }
+private:
+    struct Sprite
+    {
+        //nullptr when culled or without a texture
+        SDL_Texture* m_texture;
+        bool m_isCulled;
+        //layer, texture id and depth from the most significant bits
+        Uint64 m_sortKey;
+        SDL_Vertex m_corners[4];
+    };
+
+    struct Batch
+    {
+        SDL_Texture* m_texture;
+        int m_firstVertex;
+        int m_quadCount;
+    };
+
+    //bytes of the sort keys, the depth and the texture id take two each
+    static constexpr int s_sortKeyBytes = 5;
+
+    //sprites for the entities then the chunks, the list is invalid until gatherBatches
+    void reset(const std::vector<Entity*>& p_entities, const std::vector<Tilemap*>& p_tilemaps, float p_offsetX,
+               const SDL_FRect& p_sceneRect);
+    void prepareSprites(const std::vector<Entity*>& p_entities, size_t p_start, size_t p_end);
+    //their sprites follow the entities' from p_firstSprite
+    void prepareChunks(const std::vector<Tilemap*>& p_tilemaps, size_t p_firstSprite);
+    static Uint64 makeSortKey(const Entity& p_entity);
+    static void prepareSprite(const Entity& p_entity, float p_offsetX, const SDL_FRect& p_sceneRect,
+                              Sprite& p_sprite);
+    //p_rect is on screen, p_rotation in degrees, p_textureRect is the part of the texture shown
+    static void prepareQuad(const SDL_FRect& p_rect, float p_rotation, SDL_Texture* p_texture,
+                            const FRect& p_textureRect, Uint64 p_sortKey, const SDL_FRect& p_sceneRect,
+                            Sprite& p_sprite);
+    //radix sort of the visible sprites' indices into m_drawOrder, one stable pass per byte of the keys
+    void sortSprites();
+    //the visible sprites' corners in draw order, cut into batches where the texture changes, the list is then valid
+    void gatherBatches();
+
+    std::vector<Sprite> m_sprites;
+    std::vector<Uint32> m_drawOrder;
+    //where each pass writes before it is swapped with m_drawOrder
+    std::vector<Uint32> m_sortBuffer;
+    std::vector<SDL_Vertex> m_vertices;
+    std::vector<Batch> m_batches;
+    //the same two triangles for every quad, as many as the largest batch has
+    std::vector<int> m_indices;
+    RenderStats m_stats;
+    float m_offsetX = 0.f;
+    SDL_FRect m_sceneRect = {0.f, 0.f, 0.f, 0.f};
+    bool m_isValid = false;
+};
@@ -2,6 +2,7 @@
 #include <iostream>
 #include "Entity.h"
 #include "EntityChooser.h"
+#include "Profiler.h"
 
 SDLHandler* SDLHandler::instance = nullptr;
 
@@ -14,6 +15,17 @@ SDLHandler* SDLHandler::getHandlerInstance()
 
 SDLHandler::~SDLHandler()
 {
+    if (m_inputRecorder.getIsRecording() &&
+        !m_inputRecorder.stop(m_recordingPath, m_gameloop->getEntityManager()->getTick()))
+        std::cerr << "Couldn't write the input recording" << std::endl;
+    if (m_networkSession.getIsOpen())
+    {
+        const NetworkStats stats = m_networkSession.getStats();
+        std::cout << "Network session: " << stats.m_ticks << " ticks, " << stats.m_stalls << " stalls, " <<
+            stats.m_rollbacks << " rollbacks resimulating " << stats.m_resimulatedTicks << " ticks (deepest " <<
+            stats.m_deepestRollback << ") in " << stats.m_rollbackTime << " ms, worst " << stats.m_worstRollbackTime
+            << " ms" << std::endl;
+    }
     SDL_DestroyWindow(m_window);
     SDL_DestroyRenderer(m_renderer);
     SDL_DestroyTexture(m_background);
@@ -29,6 +41,10 @@ SDLHandler::~SDLHandler()
     m_gameStateButtons = nullptr;
     delete m_inputManager;
     m_inputManager = nullptr;
+    delete m_performanceOverlay;
+    m_performanceOverlay = nullptr;
+    delete m_panelGlyphAtlas;
+    m_panelGlyphAtlas = nullptr;
     instance = nullptr;
 }
 
@@ -95,7 +111,8 @@ bool SDLHandler::initSDL()
     m_background = SDL_CreateTextureFromSurface(m_renderer, backgroundImage);
     if (!m_background) { std::cerr << "Couldn't create background texture" << std::endl; }
 
-    m_inspector = new Inspector(m_renderer, m_font);
+    m_panelGlyphAtlas = new GlyphAtlas(m_renderer, BASE_FONT, PANEL_FONT_SIZE);
+    m_inspector = new Inspector(m_renderer, m_font, m_panelGlyphAtlas);
     m_inputManager = new InputManager(&m_isActivated, m_inspector);
     m_gameloop = new Gameloop(m_inputManager, m_renderer, m_sceneRect, m_background);
     EntityManager* entityManager = m_gameloop->getEntityManager();
@@ -103,15 +120,31 @@ bool SDLHandler::initSDL()
     m_gameStateButtons = new GameStateButtons(m_renderer, m_gameloop);
     m_inputManager->setGameStateButtonsObject(m_gameStateButtons);
     m_entityChooser = new EntityChooser(m_renderer, entityManager);
-    m_hierarchy = new Hierarchy(m_renderer, m_font, entityManager);
+    m_hierarchy = new Hierarchy(m_renderer, m_font, m_panelGlyphAtlas, entityManager);
     m_inputManager->setEntityChooser(m_entityChooser);
     m_inputManager->setHierarchy(m_hierarchy);
     m_inputManager->setEntityManager(entityManager);
     m_gameloop->setCheckStateButtons(m_gameStateButtons);
-    m_entityChooser->setHierarchy(m_hierarchy);
-    m_inspector->setHierarchy(m_hierarchy);
+    m_inspector->setEntityManager(entityManager);
     m_hierarchy->setInspector(m_inspector);
     m_entityChooser->setInspector(m_inspector);
+    if (m_networkSession.getIsOpen())
+    {
+        m_gameloop->setNetworkSession(&m_networkSession);
+        m_inputManager->setNetworkSession(&m_networkSession);
+    }
+    if (m_worldPath && !m_gameloop->openStreamedWorld(m_worldPath))
+        std::cerr << "Couldn't open the streamed world " << m_worldPath << std::endl;
+    //a recording only holds the local controls, it couldn't replay a network session or a streamed world
+    if (m_recordingPath && (m_networkSession.getIsOpen() || m_gameloop->getWorldStreamer().getIsOpen()))
+        std::cerr << "Network sessions and streamed worlds aren't recorded" << std::endl;
+    else if (m_recordingPath)
+    {
+        m_inputRecorder.start();
+        entityManager->setInputRecorder(&m_inputRecorder);
+    }
+    m_performanceOverlay = new PerformanceOverlay(m_renderer, m_font, m_gameloop, entityManager);
+    m_inputManager->setPerformanceOverlay(m_performanceOverlay);
     return true;
 }
 
@@ -125,19 +158,50 @@ void SDLHandler::loop() const
 {
     while (m_isActivated)
     {
-        m_inputManager->checkInput();
-        m_inputManager->sendControls();
+        PROFILE_SCOPE("Frame");
+        {
+            PROFILE_SCOPE("Input");
+            m_inputManager->checkInput();
+            m_inputManager->sendControls();
+        }
         m_gameloop->updateDeltaTime();
-        m_gameloop->update();
-        m_gameloop->draw();
+        {
+            PROFILE_SCOPE("Update");
+            m_gameloop->update();
+        }
+        {
+            PROFILE_SCOPE("Draw");
+            m_gameloop->draw();
+        }
         if (!m_gameloop->getPlayingGame())
         {
-            m_inspector->displayInspector();
-            m_hierarchy->displayHierarchy();
-            m_entityChooser->displayEntityChooser();
+            PROFILE_SCOPE("Panels");
+            {
+                PROFILE_SCOPE("Inspector");
+                m_inspector->displayInspector();
+            }
+            {
+                PROFILE_SCOPE("Hierarchy");
+                m_hierarchy->displayHierarchy();
+            }
+            {
+                PROFILE_SCOPE("EntityChooser");
+                m_entityChooser->displayEntityChooser();
+            }
+        }
+        {
+            PROFILE_SCOPE("GameStateButtons");
+            m_gameStateButtons->displayGameStateButtons();
+        }
+        m_performanceOverlay->recordFrame();
+        {
+            PROFILE_SCOPE("PerformanceOverlay");
+            m_performanceOverlay->displayOverlay();
+        }
+        {
+            PROFILE_SCOPE("RenderPresent");
+            SDL_RenderPresent(m_renderer);
         }
-        m_gameStateButtons->displayGameStateButtons();
-        SDL_RenderPresent(m_renderer);
         SDL_Delay(0);
     }
     SDL_Quit();
@@ -7,6 +7,7 @@
 #include "InputManager.h"
 #include "Gameloop.h"
 #include "Hierarchy.h"
+#include "PerformanceOverlay.h"
 
 class SDLHandler
 {
@@ -16,11 +17,22 @@ public:
     bool loadFont();
     void loop() const;
     static SDLHandler* getHandlerInstance();
+    //records the session from the default level, written to p_path when the handler is deleted
+    void setRecordingPath(const char* p_path) { m_recordingPath = p_path; }
+    //plays the level with a second instance, each one controlling its player
+    bool openNetworkSession(const Uint16 p_localPort, const char* p_peerAddress, const Uint16 p_peerPort,
+                            const int p_localPlayer)
+    {
+        return m_networkSession.open(p_localPort, p_peerAddress, p_peerPort, p_localPlayer);
+    }
+    //opened in place of the default level once the gameloop exists
+    void setWorldPath(const char* p_path) { m_worldPath = p_path; }
     bool getIsActivated() const { return m_isActivated; }
 private:
     SDLHandler() : m_window(nullptr), m_renderer(nullptr), m_background(nullptr), m_isActivated(true),
                    m_inputManager(nullptr), m_gameloop(nullptr), m_inspector(nullptr), m_hierarchy(nullptr),
-                   m_gameStateButtons(nullptr), m_font(nullptr), m_entityChooser(nullptr)
+                   m_gameStateButtons(nullptr), m_font(nullptr), m_entityChooser(nullptr),
+                   m_performanceOverlay(nullptr), m_panelGlyphAtlas(nullptr)
     {
     }
 
@@ -40,4 +52,11 @@ private:
     SDL_Rect m_sceneRect = {HIERARCHY_WIDTH, 0, SCENE_WIDTH, SCENE_HEIGHT};
     TTF_Font* m_font;
     EntityChooser* m_entityChooser;
+    PerformanceOverlay* m_performanceOverlay;
+    //shared by the inspector and the hierarchy
+    GlyphAtlas* m_panelGlyphAtlas;
+    const char* m_recordingPath = nullptr;
+    const char* m_worldPath = nullptr;
+    InputRecorder m_inputRecorder;
+    NetworkSession m_networkSession;
 };
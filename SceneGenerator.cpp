@@ -0,0 +1,100 @@
+﻿#include "SceneGenerator.h"
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include "EntityManager.h"
+
+void SceneGenerator::generate(EntityManager& p_entityManager, const SceneDescription& p_description)
+{
+    //std::uniform_real_distribution differs between standard libraries, this keeps scenes identical everywhere
+    std::mt19937 generator(p_description.m_seed);
+    auto random = [&generator](const float p_min, const float p_max)
+    {
+        return p_min + (p_max - p_min) * static_cast<float>(generator() >> 8) / static_cast<float>(1 << 24);
+    };
+    const float width = p_description.m_width;
+    const float height = p_description.m_height;
+
+    const int tileSize = p_description.m_tileSize;
+    Tilemap* tilemap = nullptr;
+    if (tileSize > 0)
+    {
+        tilemap = p_entityManager.addTilemap(BASE_TEXTURE, 0.f, 0.f, static_cast<int>(std::ceil(width / tileSize)),
+            static_cast<int>(std::ceil(height / tileSize)), tileSize);
+    }
+    //snapped to the grid in a tilemap
+    auto addPlatform = [&p_entityManager, tilemap, tileSize](const FRect& p_rect)
+    {
+        if (!tilemap)
+        {
+            p_entityManager.addEntity(BASE_TEXTURE, p_rect);
+            return;
+        }
+        const float size = static_cast<float>(tileSize);
+        const int column = static_cast<int>(std::round(p_rect.x / size));
+        const int row = static_cast<int>(std::round(p_rect.y / size));
+        const int columns = std::max(static_cast<int>(std::round(p_rect.w / size)), 1);
+        const int rows = std::max(static_cast<int>(std::round(p_rect.h / size)), 1);
+        tilemap->fillTiles(column, row, columns, rows, 1);
+    };
+
+    addPlatform({0.f, height - 20.f, width, 20.f});
+    for (int i = 0; i < p_description.m_platforms; ++i)
+    {
+        const float platformWidth = random(60.f, 200.f);
+        addPlatform({random(0.f, width - platformWidth), random(60.f, height - 60.f), platformWidth, 16.f});
+    }
+    if (tilemap)
+        tilemap->rebuildDirtyChunks();
+    for (int i = 0; i < p_description.m_crates; ++i)
+    {
+        const float size = random(16.f, 40.f);
+        p_entityManager.addMoveableEntity(BASE_MOVEABLE_TEXTURE, {
+            random(0.f, width - size), random(0.f, height - 60.f), size, size
+        }, random(5.f, 50.f));
+    }
+    for (int i = 0; i < p_description.m_coins; ++i)
+    {
+        p_entityManager.addCollectible(BASE_COLLECTIBLE_TEXTURE, {
+            random(0.f, width - 20.f), random(0.f, height - 40.f), 20.f, 20.f
+        });
+    }
+    if (p_description.m_addPlayer)
+        p_entityManager.addPlayer(BASE_PLAYER_TEXTURE, {50.f, 30.f, 20.f, 40.f}, 80.f);
+}
+
+void SceneGenerator::generateDefaultLevel(EntityManager& p_entityManager)
+{
+    p_entityManager.addPlayer(BASE_PLAYER_TEXTURE, {50, 30, 20, 40}, 80);
+    p_entityManager.addEntity(BASE_TEXTURE, {10, 75, 100, 10});
+    p_entityManager.addEntity(BASE_TEXTURE, {10, 150, 100, 10});
+    p_entityManager.addCollectible(BASE_COLLECTIBLE_TEXTURE, {50, 130, 20, 20});
+
+    p_entityManager.addEntity(BASE_TEXTURE, {10, 225, 100, 10});
+    p_entityManager.addCollectible(BASE_COLLECTIBLE_TEXTURE, {50, 205, 20, 20});
+    p_entityManager.addEntity(BASE_TEXTURE, {10, 300, 100, 10});
+    p_entityManager.addCollectible(BASE_COLLECTIBLE_TEXTURE, {50, 280, 20, 20});
+    p_entityManager.addEntity(BASE_TEXTURE, {150, 0, 20, 300});
+    p_entityManager.addEntity(BASE_TEXTURE, {30, 400, 200, 20});
+    p_entityManager.addEntity(BASE_TEXTURE, {300, 400, 200, 20});
+    p_entityManager.addEntity(BASE_TEXTURE, {350, 380, 25, 20});
+    p_entityManager.addMoveableEntity(BASE_MOVEABLE_TEXTURE, {360, 365, 75, 15}, 10);
+    p_entityManager.addEntity(BASE_TEXTURE, {400, 380, 25, 20});
+    p_entityManager.addCollectible(BASE_COLLECTIBLE_TEXTURE, {380, 380, 20, 20});
+
+    p_entityManager.addEntity(BASE_TEXTURE, {550, 325, 100, 10});
+    p_entityManager.addCollectible(BASE_COLLECTIBLE_TEXTURE, {590, 305, 20, 20});
+    p_entityManager.addEntity(BASE_TEXTURE, {500, 250, 100, 10});
+    p_entityManager.addCollectible(BASE_COLLECTIBLE_TEXTURE, {540, 230, 20, 20});
+    p_entityManager.addEntity(BASE_TEXTURE, {400, 150, 100, 10});
+    p_entityManager.addCollectible(BASE_COLLECTIBLE_TEXTURE, {440, 130, 20, 20});
+    p_entityManager.addEntity(BASE_TEXTURE, {450, 75, 100, 10});
+    p_entityManager.addCollectible(BASE_COLLECTIBLE_TEXTURE, {490, 55, 20, 20});
+    p_entityManager.addTriggerZone(BASE_FINISH_FLAG_TEXTURE, {460, 360, 30, 40}, TRIGGER_FINISH);
+}
+
+void SceneGenerator::addNetworkPlayers(EntityManager& p_entityManager)
+{
+    for (float x = 80.f; p_entityManager.getPlayers().size() < NETWORK_PLAYER_COUNT; x += 30.f)
+        p_entityManager.addPlayer(BASE_PLAYER_TEXTURE, {x, 30.f, 20.f, 40.f}, 80.f);
+}
@@ -0,0 +1,29 @@
+﻿#pragma once
+#include <SDL_stdinc.h>
+
+class EntityManager;
+
+struct SceneDescription
+{
+    const char* m_name;
+    int m_platforms;
+    int m_crates;
+    int m_coins;
+    Uint32 m_seed;
+    float m_width;
+    float m_height;
+    bool m_addPlayer;
+    //the ground and the platforms are painted in a tilemap of this tile size, 0 keeps them as entities
+    int m_tileSize;
+};
+
+//Fills an entity manager with a random level, the same description always gives the same level
+class SceneGenerator
+{
+public:
+    static void generate(EntityManager& p_entityManager, const SceneDescription& p_description);
+    //the level the editor opens with, recordings are replayed on it
+    static void generateDefaultLevel(EntityManager& p_entityManager);
+    //up to NETWORK_PLAYER_COUNT players, next to the default level's one
+    static void addNetworkPlayers(EntityManager& p_entityManager);
+};
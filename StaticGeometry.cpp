@@ -0,0 +1,288 @@
+﻿#include "StaticGeometry.h"
+#include <algorithm>
+#include <numeric>
+
+bool StaticGeometry::update(EntityManager* p_entityManager, const std::vector<Entity*>& p_staticEntities)
+{
+    m_newEntries.clear();
+    for (Entity* entity : p_staticEntities)
+    {
+        const Collider* collider = entity->getCollider();
+        const bool isMergeable = collider->getShape() == ORIENTED_BOX && entity->getRotation() == 0.f &&
+            !collider->isTrigger();
+        m_newEntries.push_back({
+            entity, entity->getId(), collider->getAABB(), collider->getLayer(), collider->getMask(), isMergeable, -1
+        });
+    }
+
+    //both lists are in id order, an entity left as it was stays in its group
+    for (Group& group : m_groups)
+        group.m_isDirty = false;
+    m_changedRects.clear();
+    auto markRemoved = [this](const Entry& p_entry)
+    {
+        if (p_entry.m_group >= 0)
+            m_groups[p_entry.m_group].m_isDirty = true;
+    };
+    size_t oldEntry = 0;
+    for (Entry& entry : m_newEntries)
+    {
+        while (oldEntry < m_entries.size() && m_entries[oldEntry].m_id < entry.m_id)
+            markRemoved(m_entries[oldEntry++]);
+        if (oldEntry < m_entries.size() && m_entries[oldEntry].m_id == entry.m_id)
+        {
+            const Entry& old = m_entries[oldEntry++];
+            if (old.m_entity == entry.m_entity && old.m_isMergeable == entry.m_isMergeable &&
+                old.m_rect.x == entry.m_rect.x && old.m_rect.y == entry.m_rect.y && old.m_rect.w == entry.m_rect.w &&
+                old.m_rect.h == entry.m_rect.h && old.m_layer == entry.m_layer && old.m_mask == entry.m_mask)
+            {
+                entry.m_group = old.m_group;
+                continue;
+            }
+            markRemoved(old);
+        }
+        if (entry.m_isMergeable)
+            m_changedRects.push_back(entry.m_rect);
+    }
+    while (oldEntry < m_entries.size())
+        markRemoved(m_entries[oldEntry++]);
+
+    //a group touching an added or moved entity may take it in, the changes are usually in one place so most
+    //groups are ruled out by their bounds
+    FRect changedBounds = m_changedRects.empty() ? FRect{0.f, 0.f, 0.f, 0.f} : m_changedRects.front();
+    for (const FRect& rect : m_changedRects)
+        growBounds(changedBounds, rect);
+    bool hasDirtyGroups = false;
+    for (Group& group : m_groups)
+    {
+        if (!group.m_isDirty && !m_changedRects.empty() && touch(group.m_bounds, changedBounds))
+            for (size_t i = 0; i < m_changedRects.size() && !group.m_isDirty; ++i)
+                group.m_isDirty = touch(group.m_bounds, m_changedRects[i]);
+        hasDirtyGroups = hasDirtyGroups || group.m_isDirty;
+    }
+    m_entries.swap(m_newEntries);
+    if (!hasDirtyGroups && m_changedRects.empty())
+        return false;
+
+    bool haveBodiesChanged = false;
+    m_regroupedEntries.clear();
+    for (size_t i = 0; i < m_entries.size(); ++i)
+    {
+        Entry& entry = m_entries[i];
+        if (!entry.m_isMergeable || (entry.m_group >= 0 && !m_groups[entry.m_group].m_isDirty))
+            continue;
+        entry.m_group = -1;
+        m_regroupedEntries.push_back(static_cast<int>(i));
+    }
+    size_t keptGroups = 0;
+    for (Group& group : m_groups)
+    {
+        if (group.m_isDirty)
+        {
+            haveBodiesChanged = haveBodiesChanged || !group.m_bodies.empty();
+            deleteBodies(group);
+            continue;
+        }
+        if (&m_groups[keptGroups] != &group)
+            m_groups[keptGroups] = std::move(group);
+        ++keptGroups;
+    }
+    m_groups.resize(keptGroups);
+    const size_t bodyCount = m_bodies.size();
+    regroupEntries(p_entityManager);
+
+    //in the order of their first entity, as a build from scratch would give them
+    std::sort(m_groups.begin(), m_groups.end(), [](const Group& p_group, const Group& p_otherGroup)
+    {
+        return p_group.m_ids.front() < p_otherGroup.m_ids.front();
+    });
+    m_bodies.clear();
+    for (size_t group = 0; group < m_groups.size(); ++group)
+    {
+        for (const Uint16 id : m_groups[group].m_ids)
+        {
+            const auto entry = std::lower_bound(m_entries.begin(), m_entries.end(), id,
+                [](const Entry& p_entry, const Uint16 p_id) { return p_entry.m_id < p_id; });
+            entry->m_group = static_cast<int>(group);
+        }
+        m_bodies.insert(m_bodies.end(), m_groups[group].m_bodies.begin(), m_groups[group].m_bodies.end());
+    }
+    return haveBodiesChanged || m_bodies.size() != bodyCount;
+}
+
+void StaticGeometry::clear()
+{
+    for (Group& group : m_groups)
+        deleteBodies(group);
+    m_groups.clear();
+    m_entries.clear();
+    m_bodies.clear();
+}
+
+size_t StaticGeometry::getMergedEntityCount() const
+{
+    size_t mergedEntityCount = 0;
+    for (const Group& group : m_groups)
+        if (!group.m_bodies.empty())
+            mergedEntityCount += group.m_ids.size();
+    return mergedEntityCount;
+}
+
+void StaticGeometry::growBounds(FRect& p_bounds, const FRect& p_rect)
+{
+    const float right = std::max(p_bounds.x + p_bounds.w, p_rect.x + p_rect.w);
+    const float bottom = std::max(p_bounds.y + p_bounds.h, p_rect.y + p_rect.h);
+    p_bounds.x = std::min(p_bounds.x, p_rect.x);
+    p_bounds.y = std::min(p_bounds.y, p_rect.y);
+    p_bounds.w = right - p_bounds.x;
+    p_bounds.h = bottom - p_bounds.y;
+}
+
+void StaticGeometry::mergeRects(const std::vector<FRect>& p_rects, std::vector<FRect>& p_mergedRects)
+{
+    std::vector<float> xs;
+    std::vector<float> ys;
+    for (const FRect& rect : p_rects)
+    {
+        xs.push_back(rect.x);
+        xs.push_back(rect.x + rect.w);
+        ys.push_back(rect.y);
+        ys.push_back(rect.y + rect.h);
+    }
+    std::sort(xs.begin(), xs.end());
+    xs.erase(std::unique(xs.begin(), xs.end()), xs.end());
+    std::sort(ys.begin(), ys.end());
+    ys.erase(std::unique(ys.begin(), ys.end()), ys.end());
+    const int columns = static_cast<int>(xs.size()) - 1;
+    const int rows = static_cast<int>(ys.size()) - 1;
+    auto indexOf = [](const std::vector<float>& p_edges, const float p_edge)
+    {
+        return static_cast<int>(std::lower_bound(p_edges.begin(), p_edges.end(), p_edge) - p_edges.begin());
+    };
+
+    //0 outside of the rects, 1 covered, 2 taken by a merged rect
+    std::vector<Uint8> cells(static_cast<size_t>(columns) * rows, 0);
+    for (const FRect& rect : p_rects)
+    {
+        const int lastColumn = indexOf(xs, rect.x + rect.w);
+        const int lastRow = indexOf(ys, rect.y + rect.h);
+        for (int row = indexOf(ys, rect.y); row < lastRow; ++row)
+            for (int column = indexOf(xs, rect.x); column < lastColumn; ++column)
+                cells[row * columns + column] = 1;
+    }
+    auto isFree = [&cells, columns](const int p_column, const int p_row)
+    {
+        return p_column >= 0 && p_column < columns && cells[p_row * columns + p_column] == 1;
+    };
+    p_mergedRects.clear();
+    for (int row = 0; row < rows; ++row)
+    {
+        for (int column = 0; column < columns; ++column)
+        {
+            if (!isFree(column, row))
+                continue;
+            int width = 1;
+            while (isFree(column + width, row))
+                ++width;
+            int height = 1;
+            bool isRunSame = true;
+            while (isRunSame && row + height < rows)
+            {
+                const int nextRow = row + height;
+                isRunSame = !isFree(column - 1, nextRow) && !isFree(column + width, nextRow);
+                for (int i = 0; i < width && isRunSame; ++i)
+                    isRunSame = isFree(column + i, nextRow);
+                if (isRunSame)
+                    ++height;
+            }
+            for (int i = 0; i < height; ++i)
+                std::fill_n(&cells[(row + i) * columns + column], width, 2);
+            p_mergedRects.push_back({
+                xs[column], ys[row], xs[column + width] - xs[column], ys[row + height] - ys[row]
+            });
+            column += width - 1;
+        }
+    }
+}
+
+void StaticGeometry::regroupEntries(EntityManager* p_entityManager)
+{
+    //union-find over the regrouped entries, the touching pairs are found by sweeping them from left to right
+    const int count = static_cast<int>(m_regroupedEntries.size());
+    std::vector<int> parents(count);
+    std::iota(parents.begin(), parents.end(), 0);
+    auto findRoot = [&parents](int p_index)
+    {
+        while (parents[p_index] != p_index)
+            p_index = parents[p_index] = parents[parents[p_index]];
+        return p_index;
+    };
+    std::vector<int> sweepOrder(count);
+    std::iota(sweepOrder.begin(), sweepOrder.end(), 0);
+    std::sort(sweepOrder.begin(), sweepOrder.end(), [this](const int p_index, const int p_otherIndex)
+    {
+        return m_entries[m_regroupedEntries[p_index]].m_rect.x < m_entries[m_regroupedEntries[p_otherIndex]].m_rect.x;
+    });
+    for (int i = 0; i < count; ++i)
+    {
+        const Entry& entry = m_entries[m_regroupedEntries[sweepOrder[i]]];
+        const float right = entry.m_rect.x + entry.m_rect.w;
+        for (int j = i + 1; j < count; ++j)
+        {
+            const Entry& otherEntry = m_entries[m_regroupedEntries[sweepOrder[j]]];
+            if (otherEntry.m_rect.x > right)
+                break;
+            if (entry.m_layer == otherEntry.m_layer && entry.m_mask == otherEntry.m_mask &&
+                touch(entry.m_rect, otherEntry.m_rect))
+                parents[findRoot(sweepOrder[i])] = findRoot(sweepOrder[j]);
+        }
+    }
+
+    //the regrouped entries are in id order, so are the ids of each new group
+    std::vector<int> groupOfRoot(count, -1);
+    std::vector<std::vector<FRect>> groupRects;
+    std::vector<const Entry*> firstEntries;
+    const size_t firstNewGroup = m_groups.size();
+    for (int i = 0; i < count; ++i)
+    {
+        const Entry& entry = m_entries[m_regroupedEntries[i]];
+        int& group = groupOfRoot[findRoot(i)];
+        if (group < 0)
+        {
+            group = static_cast<int>(m_groups.size());
+            m_groups.push_back({{}, entry.m_rect, {}, false});
+            groupRects.emplace_back();
+            firstEntries.push_back(&entry);
+        }
+        Group& newGroup = m_groups[group];
+        newGroup.m_ids.push_back(entry.m_id);
+        groupRects[group - firstNewGroup].push_back(entry.m_rect);
+        growBounds(newGroup.m_bounds, entry.m_rect);
+    }
+
+    std::vector<FRect> mergedRects;
+    for (size_t group = firstNewGroup; group < m_groups.size(); ++group)
+    {
+        const std::vector<FRect>& rects = groupRects[group - firstNewGroup];
+        if (rects.size() < 2)
+            continue;
+        mergeRects(rects, mergedRects);
+        if (mergedRects.size() >= rects.size())
+            continue;
+        //the members share their layer and mask, the bodies take the first one's id like a tilemap's chunks
+        const Entry& firstEntry = *firstEntries[group - firstNewGroup];
+        for (const FRect& rect : mergedRects)
+        {
+            auto* body = new Entity(p_entityManager, firstEntry.m_id, nullptr, nullptr, rect);
+            body->getCollider()->setLayerAndMask(firstEntry.m_layer, firstEntry.m_mask);
+            m_groups[group].m_bodies.push_back(body);
+        }
+    }
+}
+
+void StaticGeometry::deleteBodies(Group& p_group)
+{
+    for (const Entity* body : p_group.m_bodies)
+        delete body;
+    p_group.m_bodies.clear();
+}
@@ -0,0 +1,74 @@
+﻿#pragma once
+#include <vector>
+#include "Entity.h"
+
+//The static boxes touching or overlapping each other, with the same layer and mask, collide as the fewest rects
+//covering them: a wall or a floor built from several boxes becomes one body without seams to catch on.
+//The bodies aren't in the entity list and never reach the queries, the entities keep their colliders for them.
+//update only merges again the groups holding or touching an entity that was added, removed or moved.
+class StaticGeometry
+{
+public:
+    StaticGeometry() = default;
+    ~StaticGeometry() { clear(); }
+    StaticGeometry(const StaticGeometry&) = delete;
+    StaticGeometry& operator=(const StaticGeometry&) = delete;
+
+    //p_staticEntities is in id order, returns whether the bodies changed.
+    //The deleted bodies may still be in a published broadphase, only as colliders the queries skip
+    bool update(EntityManager* p_entityManager, const std::vector<Entity*>& p_staticEntities);
+    void clear();
+    //p_staticIndex is the entity's index in the list given to the last update.
+    //A merged entity only answers the queries, its group's bodies collide instead
+    bool isMerged(const size_t p_staticIndex) const
+    {
+        const int group = m_entries[p_staticIndex].m_group;
+        return group >= 0 && !m_groups[group].m_bodies.empty();
+    }
+    const std::vector<Entity*>& getBodies() const { return m_bodies; }
+    size_t getMergedEntityCount() const;
+private:
+    struct Entry
+    {
+        Entity* m_entity;
+        Uint16 m_id;
+        FRect m_rect;
+        Uint32 m_layer;
+        Uint32 m_mask;
+        //unrotated box, not a trigger
+        bool m_isMergeable;
+        //in m_groups, -1 when not mergeable
+        int m_group;
+    };
+
+    struct Group
+    {
+        //in id order
+        std::vector<Uint16> m_ids;
+        FRect m_bounds;
+        //empty when merging wouldn't take any rect away, the entities collide themselves
+        std::vector<Entity*> m_bodies;
+        bool m_isDirty;
+    };
+
+    static bool touch(const FRect& p_rect, const FRect& p_otherRect)
+    {
+        return p_rect.x <= p_otherRect.x + p_otherRect.w && p_otherRect.x <= p_rect.x + p_rect.w &&
+            p_rect.y <= p_otherRect.y + p_otherRect.h && p_otherRect.y <= p_rect.y + p_rect.h;
+    }
+    static void growBounds(FRect& p_bounds, const FRect& p_rect);
+    //the union of p_rects cut along their edges, then covered row by row: a rect grows down only over the
+    //rows where its run is the same, so the floors stay whole and the walls are only merged when as wide
+    static void mergeRects(const std::vector<FRect>& p_rects, std::vector<FRect>& p_mergedRects);
+    //the connected entries among m_regroupedEntries become new groups
+    void regroupEntries(EntityManager* p_entityManager);
+    void deleteBodies(Group& p_group);
+
+    std::vector<Entry> m_entries;
+    std::vector<Group> m_groups;
+    std::vector<Entity*> m_bodies;
+    //reused between updates
+    std::vector<Entry> m_newEntries;
+    std::vector<FRect> m_changedRects;
+    std::vector<int> m_regroupedEntries;
+};
@@ -0,0 +1,309 @@
+﻿#include "Tilemap.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <tuple>
+#include "EntityManager.h"
+
+Tilemap::Tilemap(EntityManager* p_entityManager, const Uint16 p_id, SDL_Renderer* p_renderer,
+                 const char* p_tilesetPath, const float p_x, const float p_y, const int p_columns, const int p_rows,
+                 const int p_tileSize) : Entity(p_entityManager, p_id, p_renderer, p_tilesetPath, {
+                                             p_x, p_y, static_cast<float>(p_columns * p_tileSize),
+                                             static_cast<float>(p_rows * p_tileSize)
+                                         }), m_columns(p_columns), m_rows(p_rows), m_tileSize(p_tileSize)
+{
+    m_name = "Tilemap " + to_string(m_id);
+    //the tiles are drawn from the chunks' textures, never from the tileset itself
+    m_tileset = m_texture;
+    m_texture = nullptr;
+    m_chunkColumns = (m_columns + s_chunkTiles - 1) / s_chunkTiles;
+    m_chunkRows = (m_rows + s_chunkTiles - 1) / s_chunkTiles;
+    m_chunks.resize(static_cast<size_t>(m_chunkColumns) * m_chunkRows);
+    for (int chunkRow = 0; chunkRow < m_chunkRows; ++chunkRow)
+    {
+        for (int chunkColumn = 0; chunkColumn < m_chunkColumns; ++chunkColumn)
+        {
+            Chunk& chunk = m_chunks[chunkRow * m_chunkColumns + chunkColumn];
+            std::memset(chunk.m_tiles, 0, sizeof(chunk.m_tiles));
+            chunk.m_column = chunkColumn * s_chunkTiles;
+            chunk.m_row = chunkRow * s_chunkTiles;
+            chunk.m_solidTiles = 0;
+            chunk.m_texture = nullptr;
+            chunk.m_isDirty = false;
+        }
+    }
+}
+
+Tilemap::~Tilemap()
+{
+    deleteBodies();
+    for (Chunk& chunk : m_chunks)
+        SDL_DestroyTexture(chunk.m_texture);
+}
+
+Uint8 Tilemap::getTile(const int p_column, const int p_row) const
+{
+    if (p_column < 0 || p_column >= m_columns || p_row < 0 || p_row >= m_rows)
+        return 0;
+    const Chunk& chunk = getChunk(p_column, p_row);
+    return chunk.m_tiles[(p_row - chunk.m_row) * s_chunkTiles + p_column - chunk.m_column];
+}
+
+void Tilemap::setTile(const int p_column, const int p_row, const Uint8 p_tile)
+{
+    if (p_column < 0 || p_column >= m_columns || p_row < 0 || p_row >= m_rows)
+        return;
+    Chunk& chunk = getChunk(p_column, p_row);
+    Uint8& tile = chunk.m_tiles[(p_row - chunk.m_row) * s_chunkTiles + p_column - chunk.m_column];
+    if (tile == p_tile)
+        return;
+    chunk.m_solidTiles += (p_tile != 0) - (tile != 0);
+    tile = p_tile;
+    chunk.m_isDirty = true;
+    m_hasDirtyChunks = true;
+}
+
+void Tilemap::fillTiles(const int p_column, const int p_row, const int p_columns, const int p_rows,
+                        const Uint8 p_tile)
+{
+    const int lastColumn = std::min(p_column + p_columns, m_columns);
+    const int lastRow = std::min(p_row + p_rows, m_rows);
+    for (int row = std::max(p_row, 0); row < lastRow; ++row)
+        for (int column = std::max(p_column, 0); column < lastColumn; ++column)
+            setTile(column, row, p_tile);
+}
+
+void Tilemap::rebuildDirtyChunks()
+{
+    if (!m_hasDirtyChunks)
+        return;
+    for (Chunk& chunk : m_chunks)
+    {
+        if (!chunk.m_isDirty)
+            continue;
+        mergeTiles(chunk);
+        bakeTexture(chunk);
+        chunk.m_isDirty = false;
+    }
+    //a few rects per chunk, all of them are joined again
+    createBodies();
+    m_hasDirtyChunks = false;
+}
+
+void Tilemap::setPosition(const float p_x, const float p_y)
+{
+    Entity::setPosition(p_x, p_y);
+    //the bodies are only moved at the next sync point, the fixed update may be reading them
+    markChunksDirty();
+}
+
+void Tilemap::setTexture(const char* p_path)
+{
+    Entity::setTexture(p_path);
+    m_tileset = m_texture;
+    m_texture = nullptr;
+    markChunksDirty();
+}
+
+FRect Tilemap::getChunkRect(const size_t p_chunk) const
+{
+    const FRect rect = getEntityRect();
+    const float chunkSize = static_cast<float>(s_chunkTiles * m_tileSize);
+    return {
+        rect.x + static_cast<float>(m_chunks[p_chunk].m_column * m_tileSize),
+        rect.y + static_cast<float>(m_chunks[p_chunk].m_row * m_tileSize), chunkSize, chunkSize
+    };
+}
+
+size_t Tilemap::getSolidTileCount() const
+{
+    size_t solidTileCount = 0;
+    for (const Chunk& chunk : m_chunks)
+        solidTileCount += chunk.m_solidTiles;
+    return solidTileCount;
+}
+
+const PropertyTable& Tilemap::getPropertyTable() const
+{
+    static const EntityProperty properties[] = {
+        {
+            "Tiles", PROPERTY_TEXT,
+            [](const Entity& p_entity, PropertyValue& p_value)
+            {
+                const auto& tilemap = static_cast<const Tilemap&>(p_entity);
+                char buffer[48];
+                std::snprintf(buffer, sizeof(buffer), "%dx%d of %d px", tilemap.m_columns, tilemap.m_rows,
+                    tilemap.m_tileSize);
+                p_value.m_text = buffer;
+            },
+            nullptr
+        },
+        {
+            "Solid tiles", PROPERTY_INTEGER,
+            [](const Entity& p_entity, PropertyValue& p_value)
+            {
+                p_value.m_integer = static_cast<Sint64>(static_cast<const Tilemap&>(p_entity).getSolidTileCount());
+            },
+            nullptr
+        },
+        {
+            "Chunks", PROPERTY_INTEGER,
+            [](const Entity& p_entity, PropertyValue& p_value)
+            {
+                p_value.m_integer = static_cast<Sint64>(static_cast<const Tilemap&>(p_entity).m_chunks.size());
+            },
+            nullptr
+        },
+        {
+            "Merged colliders", PROPERTY_INTEGER,
+            [](const Entity& p_entity, PropertyValue& p_value)
+            {
+                p_value.m_integer = static_cast<Sint64>(static_cast<const Tilemap&>(p_entity).getBodyCount());
+            },
+            nullptr
+        }
+    };
+    static const PropertyTable table = {properties, SDL_arraysize(properties), &Entity::getPropertyTable()};
+    return table;
+}
+
+void Tilemap::markChunksDirty()
+{
+    for (Chunk& chunk : m_chunks)
+        chunk.m_isDirty = true;
+    m_hasDirtyChunks = true;
+}
+
+void Tilemap::mergeTiles(Chunk& p_chunk)
+{
+    p_chunk.m_rects.clear();
+    if (p_chunk.m_solidTiles == 0)
+        return;
+    bool isMerged[s_chunkTiles * s_chunkTiles] = {};
+    auto isFree = [&p_chunk, &isMerged](const int p_column, const int p_row)
+    {
+        const int tile = p_row * s_chunkTiles + p_column;
+        return p_chunk.m_tiles[tile] != 0 && !isMerged[tile];
+    };
+    for (int row = 0; row < s_chunkTiles; ++row)
+    {
+        for (int column = 0; column < s_chunkTiles; ++column)
+        {
+            if (!isFree(column, row))
+                continue;
+            int width = 1;
+            while (column + width < s_chunkTiles && isFree(column + width, row))
+                ++width;
+            int height = 1;
+            bool isRowWhole = true;
+            while (isRowWhole && row + height < s_chunkTiles)
+            {
+                for (int i = 0; i < width && isRowWhole; ++i)
+                    isRowWhole = isFree(column + i, row + height);
+                if (isRowWhole)
+                    ++height;
+            }
+            for (int i = 0; i < height; ++i)
+                std::fill_n(&isMerged[(row + i) * s_chunkTiles + column], width, true);
+            p_chunk.m_rects.push_back({p_chunk.m_column + column, p_chunk.m_row + row, width, height});
+            column += width - 1;
+        }
+    }
+}
+
+void Tilemap::createBodies()
+{
+    deleteBodies();
+    std::vector<SDL_Rect> rects;
+    for (const Chunk& chunk : m_chunks)
+        rects.insert(rects.end(), chunk.m_rects.begin(), chunk.m_rects.end());
+    //the runs cut by the vertical seams first, then the blocks cut by the horizontal ones
+    std::sort(rects.begin(), rects.end(), [](const SDL_Rect& p_rect, const SDL_Rect& p_otherRect)
+    {
+        return std::tie(p_rect.y, p_rect.h, p_rect.x) < std::tie(p_otherRect.y, p_otherRect.h, p_otherRect.x);
+    });
+    size_t joinedRects = 0;
+    for (const SDL_Rect& rect : rects)
+    {
+        SDL_Rect* previous = joinedRects > 0 ? &rects[joinedRects - 1] : nullptr;
+        if (previous && previous->y == rect.y && previous->h == rect.h && previous->x + previous->w == rect.x)
+            previous->w += rect.w;
+        else
+            rects[joinedRects++] = rect;
+    }
+    rects.resize(joinedRects);
+    std::sort(rects.begin(), rects.end(), [](const SDL_Rect& p_rect, const SDL_Rect& p_otherRect)
+    {
+        return std::tie(p_rect.x, p_rect.w, p_rect.y) < std::tie(p_otherRect.x, p_otherRect.w, p_otherRect.y);
+    });
+    joinedRects = 0;
+    for (const SDL_Rect& rect : rects)
+    {
+        SDL_Rect* previous = joinedRects > 0 ? &rects[joinedRects - 1] : nullptr;
+        if (previous && previous->x == rect.x && previous->w == rect.w && previous->y + previous->h == rect.y)
+            previous->h += rect.h;
+        else
+            rects[joinedRects++] = rect;
+    }
+    rects.resize(joinedRects);
+
+    const FRect rect = getEntityRect();
+    const float tileSize = static_cast<float>(m_tileSize);
+    m_bodies.reserve(rects.size());
+    for (const SDL_Rect& tiles : rects)
+    {
+        auto* body = new Entity(m_entityManager, m_id, nullptr, nullptr, {
+            rect.x + static_cast<float>(tiles.x) * tileSize, rect.y + static_cast<float>(tiles.y) * tileSize,
+            static_cast<float>(tiles.w) * tileSize, static_cast<float>(tiles.h) * tileSize
+        });
+        body->getCollider()->setLayerAndMask(m_collider->getLayer(), m_collider->getMask());
+        m_bodies.push_back(body);
+    }
+}
+
+void Tilemap::bakeTexture(Chunk& p_chunk) const
+{
+    SDL_DestroyTexture(p_chunk.m_texture);
+    p_chunk.m_texture = nullptr;
+    int tilesetWidth = 0;
+    int tilesetHeight = 0;
+    if (!m_renderer || p_chunk.m_solidTiles == 0 ||
+        SDL_QueryTexture(m_tileset, nullptr, nullptr, &tilesetWidth, &tilesetHeight) != 0 || tilesetHeight == 0)
+        return;
+    const int chunkSize = s_chunkTiles * m_tileSize;
+    p_chunk.m_texture = SDL_CreateTexture(m_renderer, SDL_PIXELFORMAT_RGBA8888, SDL_TEXTUREACCESS_TARGET, chunkSize,
+        chunkSize);
+    if (!p_chunk.m_texture)
+        return;
+    SDL_SetTextureBlendMode(p_chunk.m_texture, SDL_BLENDMODE_BLEND);
+
+    SDL_Texture* previousTarget = SDL_GetRenderTarget(m_renderer);
+    Uint8 red, green, blue, alpha;
+    SDL_GetRenderDrawColor(m_renderer, &red, &green, &blue, &alpha);
+    SDL_SetRenderTarget(m_renderer, p_chunk.m_texture);
+    SDL_SetRenderDrawColor(m_renderer, 0, 0, 0, 0);
+    SDL_RenderClear(m_renderer);
+    const int tileKinds = std::max(tilesetWidth / tilesetHeight, 1);
+    const int tileWidth = std::min(tilesetWidth, tilesetHeight);
+    for (int row = 0; row < s_chunkTiles; ++row)
+    {
+        for (int column = 0; column < s_chunkTiles; ++column)
+        {
+            const Uint8 tile = p_chunk.m_tiles[row * s_chunkTiles + column];
+            if (tile == 0)
+                continue;
+            const SDL_Rect source = {(tile - 1) % tileKinds * tilesetHeight, 0, tileWidth, tilesetHeight};
+            const SDL_Rect destination = {column * m_tileSize, row * m_tileSize, m_tileSize, m_tileSize};
+            SDL_RenderCopy(m_renderer, m_tileset, &source, &destination);
+        }
+    }
+    SDL_SetRenderTarget(m_renderer, previousTarget);
+    SDL_SetRenderDrawColor(m_renderer, red, green, blue, alpha);
+}
+
+void Tilemap::deleteBodies()
+{
+    for (const Entity* body : m_bodies)
+        delete body;
+    m_bodies.clear();
+}
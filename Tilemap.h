@@ -0,0 +1,81 @@
+﻿#pragma once
+#include <vector>
+#include "Entity.h"
+
+//A grid of square tiles kept in chunks of s_chunkTiles x s_chunkTiles. Each chunk is drawn from one texture
+//baked from the tileset, its solid tiles are merged into a few rects and the rects meeting across the chunks'
+//seams are joined into the tilemap's bodies. setTile only marks the chunk, rebuildDirtyChunks merges and bakes
+//it again (the entity manager's sync point calls it). A tilemap isn't rotated and its own collider never reaches
+//the broadphase.
+class Tilemap : public Entity
+{
+public:
+    static constexpr int s_chunkTiles = 32;
+
+    //the tileset is cut into squares as high as the image, tile n shows the n-th one
+    Tilemap(EntityManager* p_entityManager, Uint16 p_id, SDL_Renderer* p_renderer, const char* p_tilesetPath,
+            float p_x, float p_y, int p_columns, int p_rows, int p_tileSize);
+    ~Tilemap() override;
+
+    //0 is an empty tile, the other ones are solid
+    Uint8 getTile(int p_column, int p_row) const;
+    void setTile(int p_column, int p_row, Uint8 p_tile);
+    //clipped to the map
+    void fillTiles(int p_column, int p_row, int p_columns, int p_rows, Uint8 p_tile);
+    void rebuildDirtyChunks();
+    bool hasDirtyChunks() const { return m_hasDirtyChunks; }
+    void setPosition(float p_x, float p_y) override;
+    void setTexture(const char* p_path) override;
+    int getColumns() const { return m_columns; }
+    int getRows() const { return m_rows; }
+    int getTileSize() const { return m_tileSize; }
+    size_t getChunkCount() const { return m_chunks.size(); }
+    FRect getChunkRect(size_t p_chunk) const;
+    //nullptr when the chunk has no tile or there is no renderer
+    SDL_Texture* getChunkTexture(const size_t p_chunk) const { return m_chunks[p_chunk].m_texture; }
+    //static bodies standing for the merged rects, they aren't in the entity list
+    const std::vector<Entity*>& getBodies() const { return m_bodies; }
+    size_t getBodyCount() const { return m_bodies.size(); }
+    size_t getSolidTileCount() const;
+    const PropertyTable& getPropertyTable() const override;
+    const char* getTypeName() const override { return "Tilemap"; }
+private:
+    struct Chunk
+    {
+        Uint8 m_tiles[s_chunkTiles * s_chunkTiles];
+        //of the chunk's first tile in the map
+        int m_column;
+        int m_row;
+        int m_solidTiles;
+        SDL_Texture* m_texture;
+        //in tiles of the map, they stop at the chunk's edges
+        std::vector<SDL_Rect> m_rects;
+        bool m_isDirty;
+    };
+
+    Chunk& getChunk(const int p_column, const int p_row)
+    {
+        return m_chunks[p_row / s_chunkTiles * m_chunkColumns + p_column / s_chunkTiles];
+    }
+    const Chunk& getChunk(const int p_column, const int p_row) const
+    {
+        return m_chunks[p_row / s_chunkTiles * m_chunkColumns + p_column / s_chunkTiles];
+    }
+    void markChunksDirty();
+    //greedy meshing: the widest run of a row grown down while the rows below have it whole
+    static void mergeTiles(Chunk& p_chunk);
+    //the chunks' rects joined across the seams, the ones split there with the same span become one body
+    void createBodies();
+    void bakeTexture(Chunk& p_chunk) const;
+    void deleteBodies();
+
+    SDL_Texture* m_tileset = nullptr;
+    int m_columns;
+    int m_rows;
+    int m_tileSize;
+    int m_chunkColumns;
+    int m_chunkRows;
+    std::vector<Chunk> m_chunks;
+    std::vector<Entity*> m_bodies;
+    bool m_hasDirtyChunks = false;
+};
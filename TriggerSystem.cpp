@@ -0,0 +1,73 @@
+﻿#include "TriggerSystem.h"
+#include <algorithm>
+#include "Entity.h"
+#include "Narrowphase.h"
+
+void TriggerSystem::update(const Broadphase& p_broadphase, const Uint32 p_tick)
+{
+    m_currentOverlaps.clear();
+    for (const ColliderPair& pair : p_broadphase.getPairs())
+    {
+        //a trigger only reports solid colliders
+        if (pair.m_first->m_isTrigger == pair.m_second->m_isTrigger)
+            continue;
+        const BroadphaseProxy* trigger = pair.m_first->m_isTrigger ? pair.m_first : pair.m_second;
+        const BroadphaseProxy* other = pair.m_first->m_isTrigger ? pair.m_second : pair.m_first;
+
+        //broadphase AABBs are fattened, the real shapes decide
+        ContactManifold manifold;
+        if (!Narrowphase::collide(*trigger->m_collider, *other->m_collider, manifold))
+            continue;
+        m_currentOverlaps.push_back(makeKey(trigger->m_collider->getParent()->getId(),
+            other->m_collider->getParent()->getId()));
+    }
+    std::sort(m_currentOverlaps.begin(), m_currentOverlaps.end());
+
+    //both lists are sorted so one merge pass gives enter, stay and exit
+    m_tickEvents.clear();
+    auto previous = m_previousOverlaps.cbegin();
+    auto current = m_currentOverlaps.cbegin();
+    while (previous != m_previousOverlaps.cend() || current != m_currentOverlaps.cend())
+    {
+        TriggerEventType_e type;
+        Uint32 key;
+        if (current == m_currentOverlaps.cend() || (previous != m_previousOverlaps.cend() && *previous < *current))
+        {
+            type = TRIGGER_EXIT;
+            key = *previous++;
+        }
+        else if (previous == m_previousOverlaps.cend() || *current < *previous)
+        {
+            type = TRIGGER_ENTER;
+            key = *current++;
+        }
+        else
+        {
+            type = TRIGGER_STAY;
+            key = *current++;
+            ++previous;
+        }
+        m_tickEvents.push_back({type, static_cast<Uint16>(key >> 16), static_cast<Uint16>(key & 0xFFFF), p_tick});
+    }
+    m_previousOverlaps.swap(m_currentOverlaps);
+
+    if (m_tickEvents.empty())
+        return;
+    const std::lock_guard<std::mutex> queueGuard(m_queueMutex);
+    m_queuedEvents.insert(m_queuedEvents.end(), m_tickEvents.cbegin(), m_tickEvents.cend());
+}
+
+void TriggerSystem::drainEvents(std::vector<TriggerEvent>& p_events)
+{
+    p_events.clear();
+    const std::lock_guard<std::mutex> queueGuard(m_queueMutex);
+    m_queuedEvents.swap(p_events);
+}
+
+void TriggerSystem::clear()
+{
+    m_previousOverlaps.clear();
+    m_currentOverlaps.clear();
+    const std::lock_guard<std::mutex> queueGuard(m_queueMutex);
+    m_queuedEvents.clear();
+}
@@ -0,0 +1,49 @@
+﻿#pragma once
+#include <mutex>
+#include <vector>
+#include "Broadphase.h"
+
+enum TriggerEventType_e
+{
+    TRIGGER_ENTER,
+    TRIGGER_STAY,
+    TRIGGER_EXIT
+};
+
+struct TriggerEvent
+{
+    TriggerEventType_e m_type;
+    //entities are referred to by id, the other entity may already be deleted when the event is read
+    Uint16 m_triggerId;
+    Uint16 m_otherId;
+    Uint32 m_tick;
+};
+
+//Diffs the trigger overlaps of this tick against the previous one and queues the resulting events
+class TriggerSystem
+{
+public:
+    //called by the fixed update once the bodies have moved
+    void update(const Broadphase& p_broadphase, Uint32 p_tick);
+    //called by the main thread, gives every event queued since the last drain
+    void drainEvents(std::vector<TriggerEvent>& p_events);
+    void clear();
+    //sorted keys of the overlaps found by the last update, part of the world snapshots
+    const std::vector<Uint32>& getOverlaps() const { return m_previousOverlaps; }
+    void setOverlaps(const Uint32* p_overlaps, const size_t p_count)
+    {
+        m_previousOverlaps.assign(p_overlaps, p_overlaps + p_count);
+    }
+private:
+    static Uint32 makeKey(const Uint16 p_triggerId, const Uint16 p_otherId)
+    {
+        return static_cast<Uint32>(p_triggerId) << 16 | p_otherId;
+    }
+
+    std::vector<Uint32> m_previousOverlaps;
+    std::vector<Uint32> m_currentOverlaps;
+    std::vector<TriggerEvent> m_tickEvents;
+
+    std::mutex m_queueMutex;
+    std::vector<TriggerEvent> m_queuedEvents;
+};
@@ -0,0 +1,260 @@
+﻿#include "WorldSnapshot.h"
+#include <cstring>
+#include "EntityManager.h"
+
+//tick, entity count, overlap count
+static constexpr size_t s_headerSize = 3 * sizeof(Uint32);
+
+static Uint32 loadWord(const Uint8* p_bytes)
+{
+    Uint32 word;
+    std::memcpy(&word, p_bytes, sizeof(word));
+    return word;
+}
+
+static void storeWord(Uint8* p_bytes, const Uint32 p_word) { std::memcpy(p_bytes, &p_word, sizeof(p_word)); }
+
+static void writeVarint(std::vector<Uint8>& p_bytes, size_t p_value)
+{
+    while (p_value >= 0x80)
+    {
+        p_bytes.push_back(static_cast<Uint8>(p_value | 0x80));
+        p_value >>= 7;
+    }
+    p_bytes.push_back(static_cast<Uint8>(p_value));
+}
+
+static size_t readVarint(const std::vector<Uint8>& p_bytes, size_t& p_position)
+{
+    size_t value = 0;
+    for (int shift = 0; p_position < p_bytes.size(); shift += 7)
+    {
+        const Uint8 byte = p_bytes[p_position++];
+        value |= static_cast<size_t>(byte & 0x7F) << shift;
+        if ((byte & 0x80) == 0)
+            break;
+    }
+    return value;
+}
+
+void WorldSnapshot::capture(const EntityManager& p_entityManager, std::vector<Uint8>& p_buffer)
+{
+    const std::vector<Entity*>& entities = p_entityManager.getEntities();
+    const std::vector<Uint32>& overlaps = p_entityManager.getTriggerOverlaps();
+    //zeroed so the padding bytes never show up in the deltas
+    p_buffer.assign(s_headerSize + entities.size() * sizeof(EntityState) + overlaps.size() * sizeof(Uint32), 0);
+
+    Uint8* bytes = p_buffer.data();
+    storeWord(bytes, p_entityManager.getTick());
+    storeWord(bytes + sizeof(Uint32), static_cast<Uint32>(entities.size()));
+    storeWord(bytes + 2 * sizeof(Uint32), static_cast<Uint32>(overlaps.size()));
+    bytes += s_headerSize;
+
+    EntityState state;
+    for (const Entity* entity : entities)
+    {
+        std::memset(static_cast<void*>(&state), 0, sizeof(state));
+        entity->saveState(state);
+        std::memcpy(bytes, &state, sizeof(state));
+        bytes += sizeof(state);
+    }
+    if (!overlaps.empty())
+        std::memcpy(bytes, overlaps.data(), overlaps.size() * sizeof(Uint32));
+}
+
+bool WorldSnapshot::apply(EntityManager& p_entityManager, const std::vector<Uint8>& p_buffer,
+                          const bool p_restoreTick)
+{
+    if (p_buffer.size() < s_headerSize)
+        return false;
+    const Uint8* bytes = p_buffer.data();
+    const Uint32 tick = loadWord(bytes);
+    const size_t stateCount = loadWord(bytes + sizeof(Uint32));
+    const size_t overlapCount = loadWord(bytes + 2 * sizeof(Uint32));
+    if (p_buffer.size() != s_headerSize + stateCount * sizeof(EntityState) + overlapCount * sizeof(Uint32))
+        return false;
+    bytes += s_headerSize;
+
+    //both lists are in creation order, so ids only go up and one pass matches them
+    const std::vector<Entity*>& entities = p_entityManager.getEntities();
+    size_t entityIndex = 0;
+    EntityState state;
+    for (size_t i = 0; i < stateCount; ++i, bytes += sizeof(state))
+    {
+        std::memcpy(&state, bytes, sizeof(state));
+        while (entityIndex < entities.size() && entities[entityIndex]->getId() < state.m_id)
+            ++entityIndex;
+        if (entityIndex == entities.size())
+            break;
+        if (entities[entityIndex]->getId() == state.m_id)
+            entities[entityIndex]->restoreState(state);
+    }
+    bytes = p_buffer.data() + s_headerSize + stateCount * sizeof(EntityState);
+    p_entityManager.setTriggerOverlaps(reinterpret_cast<const Uint32*>(bytes), overlapCount);
+    if (p_restoreTick)
+        p_entityManager.setTick(tick);
+    return true;
+}
+
+Uint32 WorldSnapshot::getTick(const std::vector<Uint8>& p_buffer)
+{
+    return p_buffer.size() < s_headerSize ? 0 : loadWord(p_buffer.data());
+}
+
+SnapshotRing::SnapshotRing(const size_t p_capacity) : m_slots(p_capacity > 0 ? p_capacity : 1)
+{
+}
+
+void SnapshotRing::push(const EntityManager& p_entityManager)
+{
+    WorldSnapshot::capture(p_entityManager, m_scratch);
+    const Uint32 tick = WorldSnapshot::getTick(m_scratch);
+    while (m_count > 0 && getNewestTick() >= tick)
+        dropNewest();
+
+    if (m_count == m_slots.size())
+    {
+        //the next snapshot becomes the oldest one, its delta moves m_oldest forward
+        m_encodedSize -= m_slots[m_first].m_data.size();
+        m_first = slotIndex(1);
+        --m_count;
+        const Slot& oldest = m_slots[m_first];
+        if (m_count > 0)
+        {
+            if (oldest.m_isWhole)
+                m_oldest = oldest.m_data;
+            else
+                applyDelta(oldest.m_data, m_oldest);
+        }
+    }
+
+    Slot& slot = m_slots[slotIndex(m_count)];
+    slot.m_tick = tick;
+    slot.m_isWhole = m_count == 0 || m_newest.size() != m_scratch.size();
+    if (slot.m_isWhole)
+        slot.m_data = m_scratch;
+    else
+        encodeDelta(m_newest, m_scratch, slot.m_data);
+    if (m_count == 0)
+        m_oldest = m_scratch;
+    m_encodedSize += slot.m_data.size();
+    ++m_count;
+    m_newest.swap(m_scratch);
+}
+
+bool SnapshotRing::restore(EntityManager& p_entityManager, const Uint32 p_tick)
+{
+    if (m_count == 0 || p_tick < getOldestTick() || p_tick > getNewestTick())
+        return false;
+    size_t age = m_count - 1;
+    while (age > 0 && m_slots[slotIndex(age)].m_tick > p_tick)
+        --age;
+    if (m_slots[slotIndex(age)].m_tick != p_tick)
+        return false;
+    if (age == m_count - 1)
+        return WorldSnapshot::apply(p_entityManager, m_newest, true);
+    decode(age, m_scratch);
+    return WorldSnapshot::apply(p_entityManager, m_scratch, true);
+}
+
+void SnapshotRing::clear()
+{
+    m_first = 0;
+    m_count = 0;
+    m_encodedSize = 0;
+    m_oldest.clear();
+    m_newest.clear();
+}
+
+void SnapshotRing::encodeDelta(const std::vector<Uint8>& p_previous, const std::vector<Uint8>& p_current,
+                               std::vector<Uint8>& p_delta)
+{
+    //runs of unchanged words are skipped, the changed ones are stored XORed
+    p_delta.clear();
+    const size_t wordCount = p_current.size() / sizeof(Uint32);
+    size_t word = 0;
+    while (word < wordCount)
+    {
+        const size_t skipStart = word;
+        while (word < wordCount && loadWord(&p_previous[word * sizeof(Uint32)]) ==
+            loadWord(&p_current[word * sizeof(Uint32)]))
+            ++word;
+        if (word == wordCount)
+            break;
+        const size_t changedStart = word;
+        while (word < wordCount && loadWord(&p_previous[word * sizeof(Uint32)]) !=
+            loadWord(&p_current[word * sizeof(Uint32)]))
+            ++word;
+        writeVarint(p_delta, changedStart - skipStart);
+        writeVarint(p_delta, word - changedStart);
+        const size_t deltaSize = p_delta.size();
+        p_delta.resize(deltaSize + (word - changedStart) * sizeof(Uint32));
+        for (size_t i = changedStart; i < word; ++i)
+            storeWord(&p_delta[deltaSize + (i - changedStart) * sizeof(Uint32)],
+                loadWord(&p_previous[i * sizeof(Uint32)]) ^ loadWord(&p_current[i * sizeof(Uint32)]));
+    }
+}
+
+void SnapshotRing::applyDelta(const std::vector<Uint8>& p_delta, std::vector<Uint8>& p_buffer)
+{
+    size_t position = 0;
+    size_t word = 0;
+    while (position < p_delta.size())
+    {
+        word += readVarint(p_delta, position);
+        const size_t changedCount = readVarint(p_delta, position);
+        for (size_t i = 0; i < changedCount; ++i, ++word, position += sizeof(Uint32))
+        {
+            Uint8* bytes = &p_buffer[word * sizeof(Uint32)];
+            storeWord(bytes, loadWord(bytes) ^ loadWord(&p_delta[position]));
+        }
+    }
+}
+
+void SnapshotRing::dropNewest()
+{
+    if (m_count == 1)
+    {
+        clear();
+        return;
+    }
+    const Slot& newest = m_slots[slotIndex(m_count - 1)];
+    if (newest.m_isWhole)
+    {
+        //nothing goes back through a whole snapshot, the previous one is rebuilt from the older ones
+        decode(m_count - 2, m_scratch);
+        m_newest.swap(m_scratch);
+    }
+    else
+        applyDelta(newest.m_data, m_newest);
+    m_encodedSize -= newest.m_data.size();
+    --m_count;
+}
+
+void SnapshotRing::decode(const size_t p_age, std::vector<Uint8>& p_buffer) const
+{
+    size_t wholeAge = 0;
+    for (size_t age = p_age; age > 0; --age)
+    {
+        if (m_slots[slotIndex(age)].m_isWhole)
+        {
+            wholeAge = age;
+            break;
+        }
+    }
+    bool canGoBack = true;
+    for (size_t age = m_count - 1; age > p_age && canGoBack; --age)
+        canGoBack = !m_slots[slotIndex(age)].m_isWhole;
+
+    //from whichever end has the fewest deltas to apply
+    if (canGoBack && m_count - 1 - p_age < p_age - wholeAge)
+    {
+        p_buffer = m_newest;
+        for (size_t age = m_count - 1; age > p_age; --age)
+            applyDelta(m_slots[slotIndex(age)].m_data, p_buffer);
+        return;
+    }
+    p_buffer = wholeAge == 0 ? m_oldest : m_slots[slotIndex(wholeAge)].m_data;
+    for (size_t age = wholeAge + 1; age <= p_age; ++age)
+        applyDelta(m_slots[slotIndex(age)].m_data, p_buffer);
+}
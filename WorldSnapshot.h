@@ -0,0 +1,78 @@
+﻿#pragma once
+#include <SDL_stdinc.h>
+#include <vector>
+#include "Fixed.h"
+
+class EntityManager;
+
+enum EntityStateFlag_e : Uint8
+{
+    STATE_COLLECTED = 1 << 0,
+    STATE_ON_GROUND = 1 << 1
+};
+
+//Everything the simulation needs to continue from an entity, a snapshot is an array of them
+struct EntityState
+{
+    Rect<PhysicsScalar> m_rect;
+    Vec2<PhysicsScalar> m_velocity;
+    float m_rotation;
+    PhysicsScalar m_xCounterSpeed;
+    Uint16 m_id;
+    Uint8 m_flags;
+};
+
+//Writes and applies the whole simulation state as one contiguous buffer:
+//a header, one EntityState per entity in creation order, then the trigger overlaps
+class WorldSnapshot
+{
+public:
+    static void capture(const EntityManager& p_entityManager, std::vector<Uint8>& p_buffer);
+    //entities that are not in the snapshot keep their state, the snapshot's deleted ones are skipped.
+    //The tick only goes back for rollbacks, stopping the game keeps counting
+    static bool apply(EntityManager& p_entityManager, const std::vector<Uint8>& p_buffer, bool p_restoreTick);
+    static Uint32 getTick(const std::vector<Uint8>& p_buffer);
+};
+
+//The last snapshots, each one kept as the XOR with the previous one where only the changed words are stored.
+//A snapshot whose size differs from the previous one (an entity was added or deleted) is kept whole.
+class SnapshotRing
+{
+public:
+    explicit SnapshotRing(size_t p_capacity);
+    //the snapshots at p_entityManager's tick or after it are dropped first, the simulation took another path
+    void push(const EntityManager& p_entityManager);
+    bool restore(EntityManager& p_entityManager, Uint32 p_tick);
+    void clear();
+    bool isEmpty() const { return m_count == 0; }
+    Uint32 getOldestTick() const { return m_slots[m_first].m_tick; }
+    Uint32 getNewestTick() const { return m_slots[slotIndex(m_count - 1)].m_tick; }
+    size_t getCount() const { return m_count; }
+    //bytes used by the encoded snapshots
+    size_t getEncodedSize() const { return m_encodedSize; }
+private:
+    struct Slot
+    {
+        Uint32 m_tick = 0;
+        bool m_isWhole = false;
+        std::vector<Uint8> m_data;
+    };
+
+    size_t slotIndex(const size_t p_age) const { return (m_first + p_age) % m_slots.size(); }
+    static void encodeDelta(const std::vector<Uint8>& p_previous, const std::vector<Uint8>& p_current,
+                            std::vector<Uint8>& p_delta);
+    //XORs the delta in place, which goes from one snapshot to the other in both directions
+    static void applyDelta(const std::vector<Uint8>& p_delta, std::vector<Uint8>& p_buffer);
+    void dropNewest();
+    //rebuilds the snapshot at p_age, from the newest or from the closest whole one before it
+    void decode(size_t p_age, std::vector<Uint8>& p_buffer) const;
+
+    std::vector<Slot> m_slots;
+    size_t m_first = 0;
+    size_t m_count = 0;
+    size_t m_encodedSize = 0;
+    //decoded oldest and newest snapshots, the deltas are applied from them
+    std::vector<Uint8> m_oldest;
+    std::vector<Uint8> m_newest;
+    std::vector<Uint8> m_scratch;
+};
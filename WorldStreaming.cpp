@@ -0,0 +1,653 @@
+﻿#include "WorldStreaming.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <SDL_surface.h>
+#include "EntityManager.h"
+#include "Profiler.h"
+
+//file layout: magic, version, cell size, world size, columns, rows, id count, the texture paths, the property
+//names, the resident section, the offset, size and entity count of every cell, then the cells' sections
+static const char s_worldMagic[4] = {'E', '2', 'D', 'W'};
+static constexpr Uint8 s_worldVersion = 2;
+static constexpr size_t s_headerSize = sizeof(s_worldMagic) + 1 + 3 * sizeof(float) + 4 * sizeof(Uint32);
+//rect, id, texture, type, parameter and property count, the properties follow
+static constexpr size_t s_entitySize = 4 * sizeof(float) + 2 * sizeof(Uint16) + 3;
+static constexpr size_t s_cellEntrySize = 3 * sizeof(Uint32);
+
+template <typename T>
+static void appendValue(std::vector<Uint8>& p_bytes, const T& p_value)
+{
+    const auto* bytes = reinterpret_cast<const Uint8*>(&p_value);
+    p_bytes.insert(p_bytes.end(), bytes, bytes + sizeof(T));
+}
+
+template <typename T>
+static const Uint8* readValue(const Uint8* p_bytes, T& p_value)
+{
+    std::memcpy(&p_value, p_bytes, sizeof(T));
+    return p_bytes + sizeof(T);
+}
+
+static bool readBytes(std::ifstream& p_file, const size_t p_size, std::vector<Uint8>& p_bytes)
+{
+    p_bytes.resize(p_size);
+    return p_size == 0 || static_cast<bool>(p_file.read(reinterpret_cast<char*>(p_bytes.data()),
+        static_cast<std::streamsize>(p_size)));
+}
+
+//a Uint16 length then the characters
+static void appendString(std::vector<Uint8>& p_bytes, const std::string& p_string)
+{
+    appendValue(p_bytes, static_cast<Uint16>(p_string.size()));
+    p_bytes.insert(p_bytes.end(), p_string.begin(), p_string.end());
+}
+
+static bool readStrings(std::ifstream& p_file, const Uint32 p_count, std::vector<std::string>& p_strings)
+{
+    std::vector<Uint8> bytes;
+    for (Uint32 i = 0; i < p_count; ++i)
+    {
+        Uint16 length = 0;
+        if (!readBytes(p_file, sizeof(length), bytes))
+            return false;
+        readValue(bytes.data(), length);
+        if (!readBytes(p_file, length, bytes))
+            return false;
+        p_strings.emplace_back(bytes.begin(), bytes.end());
+    }
+    return true;
+}
+
+//the index of p_string in p_strings, added when missing
+static Uint16 findOrAdd(std::vector<std::string>& p_strings, const std::string& p_string)
+{
+    const size_t index = std::find(p_strings.begin(), p_strings.end(), p_string) - p_strings.begin();
+    if (index == p_strings.size())
+        p_strings.push_back(p_string);
+    return static_cast<Uint16>(index);
+}
+
+static void appendEntity(std::vector<Uint8>& p_bytes, const StreamedEntity& p_entity)
+{
+    appendValue(p_bytes, p_entity.m_rect);
+    appendValue(p_bytes, p_entity.m_id);
+    appendValue(p_bytes, p_entity.m_texture);
+    p_bytes.push_back(p_entity.m_type);
+    p_bytes.push_back(p_entity.m_parameter);
+    p_bytes.push_back(static_cast<Uint8>(p_entity.m_properties.size()));
+    for (const StreamedProperty& property : p_entity.m_properties)
+    {
+        appendValue(p_bytes, property.m_name);
+        p_bytes.push_back(static_cast<Uint8>(property.m_type));
+        if (property.m_type == PROPERTY_TEXT)
+            appendString(p_bytes, property.m_value.m_text);
+        else if (property.m_type == PROPERTY_FLOAT)
+            appendValue(p_bytes, property.m_value.m_float);
+        else
+            appendValue(p_bytes, property.m_value.m_integer);
+    }
+}
+
+//false when the entity runs past p_end
+static bool readEntity(const Uint8*& p_bytes, const Uint8* p_end, StreamedEntity& p_entity)
+{
+    if (static_cast<size_t>(p_end - p_bytes) < s_entitySize)
+        return false;
+    p_bytes = readValue(p_bytes, p_entity.m_rect);
+    p_bytes = readValue(p_bytes, p_entity.m_id);
+    p_bytes = readValue(p_bytes, p_entity.m_texture);
+    const Uint8 type = *p_bytes++;
+    p_entity.m_type = type < STREAMED_ENTITY_TYPES_NUMBER ? static_cast<StreamedEntityType_e>(type) : STREAMED_STATIC;
+    p_entity.m_parameter = *p_bytes++;
+    p_entity.m_properties.resize(*p_bytes++);
+    for (StreamedProperty& property : p_entity.m_properties)
+    {
+        if (static_cast<size_t>(p_end - p_bytes) < sizeof(property.m_name) + 1)
+            return false;
+        p_bytes = readValue(p_bytes, property.m_name);
+        const Uint8 propertyType = *p_bytes++;
+        if (propertyType >= PROPERTY_TYPES_NUMBER)
+            return false;
+        property.m_type = static_cast<PropertyType_e>(propertyType);
+        size_t valueSize = property.m_type == PROPERTY_FLOAT ? sizeof(float) : sizeof(Sint64);
+        Uint16 length = 0;
+        if (property.m_type == PROPERTY_TEXT)
+        {
+            if (static_cast<size_t>(p_end - p_bytes) < sizeof(length))
+                return false;
+            p_bytes = readValue(p_bytes, length);
+            valueSize = length;
+        }
+        if (static_cast<size_t>(p_end - p_bytes) < valueSize)
+            return false;
+        if (property.m_type == PROPERTY_TEXT)
+            property.m_value.m_text.assign(p_bytes, p_bytes + length);
+        else if (property.m_type == PROPERTY_FLOAT)
+            readValue(p_bytes, property.m_value.m_float);
+        else
+            readValue(p_bytes, property.m_value.m_integer);
+        p_bytes += valueSize;
+    }
+    return true;
+}
+
+bool WorldStreamer::writeWorld(const char* p_path, const EntityManager& p_entityManager, const float p_cellSize)
+{
+    if (p_cellSize <= 0.f)
+        return false;
+    const EcsWorld& world = p_entityManager.getWorld();
+    const std::vector<LoadedTexture>& loadedTextures = p_entityManager.getLoadedTextures();
+    std::vector<std::string> texturePaths;
+    std::vector<std::string> propertyNames;
+    std::vector<StreamedEntity> entities;
+    std::vector<const EntityProperty*> properties;
+    float worldWidth = 0.f;
+    float worldHeight = 0.f;
+    Uint32 idCount = 0;
+    for (const Entity* entity : p_entityManager.getEntities())
+    {
+        const EcsEntity ecsEntity = entity->getEcsEntity();
+        if (world.has<TileLayer>(ecsEntity))
+            continue;
+        StreamedEntity streamedEntity;
+        streamedEntity.m_rect = entity->getEntityRect();
+        streamedEntity.m_id = entity->getId();
+        streamedEntity.m_parameter = 0;
+        const char* defaultTexture = BASE_TEXTURE;
+        if (world.has<PlayerControl>(ecsEntity))
+        {
+            streamedEntity.m_type = STREAMED_PLAYER;
+            defaultTexture = BASE_PLAYER_TEXTURE;
+        }
+        else if (world.has<MoveableBody>(ecsEntity))
+        {
+            streamedEntity.m_type = STREAMED_MOVEABLE;
+            defaultTexture = BASE_MOVEABLE_TEXTURE;
+        }
+        else if (world.has<Pickup>(ecsEntity))
+        {
+            streamedEntity.m_type = STREAMED_COLLECTIBLE;
+            defaultTexture = BASE_COLLECTIBLE_TEXTURE;
+        }
+        else if (world.has<TriggerArea>(ecsEntity))
+        {
+            const TriggerAction_e action = static_cast<const TriggerZone*>(entity)->getAction();
+            streamedEntity.m_type = STREAMED_TRIGGER_ZONE;
+            streamedEntity.m_parameter = static_cast<Uint8>(action);
+            defaultTexture = action == TRIGGER_FINISH ? BASE_FINISH_FLAG_TEXTURE : BASE_KILL_ZONE_TEXTURE;
+        }
+        else if (entity->getCollider()->getShape() == CONVEX_POLYGON)
+        {
+            //the top vertex is on the right of a slope rising to the right
+            const auto* slope = static_cast<const ConvexPolygonCollider*>(entity->getCollider());
+            const FRect& rect = streamedEntity.m_rect;
+            streamedEntity.m_type = STREAMED_SLOPE;
+            streamedEntity.m_parameter = slope->getWorldVertices()[0].x > rect.x + rect.w / 2.f ? 1 : 0;
+        }
+        else
+            streamedEntity.m_type = STREAMED_STATIC;
+
+        const std::string texturePath = entity->getTexture() ?
+            loadedTextures[entity->getTextureId()].m_path : std::string(defaultTexture);
+        streamedEntity.m_texture = findOrAdd(texturePaths, texturePath);
+        //what the editor can set, the texture's path reads empty and is in the fixed part
+        properties.clear();
+        EntityProperties::collect(entity->getPropertyTable(), properties);
+        for (const EntityProperty* property : properties)
+        {
+            if (property->isReadOnly())
+                continue;
+            StreamedProperty streamedProperty;
+            streamedProperty.m_type = property->m_type;
+            property->m_get(*entity, streamedProperty.m_value);
+            if (property->m_type == PROPERTY_TEXT && streamedProperty.m_value.m_text.empty())
+                continue;
+            streamedProperty.m_name = findOrAdd(propertyNames, property->m_name);
+            streamedEntity.m_properties.push_back(std::move(streamedProperty));
+        }
+        worldWidth = std::max(worldWidth, streamedEntity.m_rect.x + streamedEntity.m_rect.w);
+        worldHeight = std::max(worldHeight, streamedEntity.m_rect.y + streamedEntity.m_rect.h);
+        idCount = std::max(idCount, static_cast<Uint32>(entity->getId()) + 1);
+        entities.push_back(std::move(streamedEntity));
+    }
+
+    const Uint32 columns = std::max(static_cast<Uint32>(std::ceil(worldWidth / p_cellSize)), 1u);
+    const Uint32 rows = std::max(static_cast<Uint32>(std::ceil(worldHeight / p_cellSize)), 1u);
+    std::vector<StreamedEntity> residentEntities;
+    std::vector<std::vector<StreamedEntity>> cells(static_cast<size_t>(columns) * rows);
+    for (const StreamedEntity& entity : entities)
+    {
+        const FRect& rect = entity.m_rect;
+        if (entity.m_type == STREAMED_PLAYER || rect.w > p_cellSize || rect.h > p_cellSize)
+        {
+            residentEntities.push_back(entity);
+            continue;
+        }
+        const int column = static_cast<int>(std::floor((rect.x + rect.w / 2.f) / p_cellSize));
+        const int row = static_cast<int>(std::floor((rect.y + rect.h / 2.f) / p_cellSize));
+        const Uint32 clampedColumn = static_cast<Uint32>(std::min(std::max(column, 0), static_cast<int>(columns) - 1));
+        const Uint32 clampedRow = static_cast<Uint32>(std::min(std::max(row, 0), static_cast<int>(rows) - 1));
+        cells[clampedRow * columns + clampedColumn].push_back(entity);
+    }
+
+    std::vector<Uint8> bytes(s_worldMagic, s_worldMagic + sizeof(s_worldMagic));
+    bytes.push_back(s_worldVersion);
+    appendValue(bytes, p_cellSize);
+    appendValue(bytes, worldWidth);
+    appendValue(bytes, worldHeight);
+    appendValue(bytes, columns);
+    appendValue(bytes, rows);
+    appendValue(bytes, idCount);
+    appendValue(bytes, static_cast<Uint32>(texturePaths.size()));
+    for (const std::string& texturePath : texturePaths)
+        appendString(bytes, texturePath);
+    appendValue(bytes, static_cast<Uint32>(propertyNames.size()));
+    for (const std::string& propertyName : propertyNames)
+        appendString(bytes, propertyName);
+    std::vector<Uint8> section;
+    for (const StreamedEntity& entity : residentEntities)
+        appendEntity(section, entity);
+    appendValue(bytes, static_cast<Uint32>(residentEntities.size()));
+    appendValue(bytes, static_cast<Uint32>(section.size()));
+    bytes.insert(bytes.end(), section.begin(), section.end());
+    //the entities' sizes vary with their properties, the sections are laid out before the table is written
+    section.clear();
+    std::vector<size_t> cellEnds;
+    cellEnds.reserve(cells.size());
+    for (const std::vector<StreamedEntity>& cell : cells)
+    {
+        for (const StreamedEntity& entity : cell)
+            appendEntity(section, entity);
+        cellEnds.push_back(section.size());
+    }
+    const size_t sectionsOffset = bytes.size() + cells.size() * s_cellEntrySize;
+    //the offsets are 32 bits
+    if (sectionsOffset + section.size() > 0xFFFFFFFFu)
+        return false;
+    size_t cellStart = 0;
+    for (size_t i = 0; i < cells.size(); ++i)
+    {
+        appendValue(bytes, static_cast<Uint32>(sectionsOffset + cellStart));
+        appendValue(bytes, static_cast<Uint32>(cellEnds[i] - cellStart));
+        appendValue(bytes, static_cast<Uint32>(cells[i].size()));
+        cellStart = cellEnds[i];
+    }
+    bytes.insert(bytes.end(), section.begin(), section.end());
+
+    std::ofstream file(p_path, std::ios::binary);
+    file.write(reinterpret_cast<const char*>(bytes.data()), static_cast<std::streamsize>(bytes.size()));
+    return static_cast<bool>(file);
+}
+
+bool WorldStreamer::open(const char* p_path, EntityManager& p_entityManager, JobSystem* p_jobSystem)
+{
+    close();
+    std::ifstream file(p_path, std::ios::binary);
+    std::vector<Uint8> bytes;
+    if (!readBytes(file, s_headerSize, bytes) ||
+        !std::equal(s_worldMagic, s_worldMagic + sizeof(s_worldMagic), bytes.begin()) ||
+        bytes[sizeof(s_worldMagic)] != s_worldVersion)
+    {
+        close();
+        return false;
+    }
+    const Uint8* header = bytes.data() + sizeof(s_worldMagic) + 1;
+    Uint32 columns, rows, idCount, textureCount;
+    header = readValue(header, m_cellSize);
+    header = readValue(header, m_worldWidth);
+    header = readValue(header, m_worldHeight);
+    header = readValue(header, columns);
+    header = readValue(header, rows);
+    header = readValue(header, idCount);
+    readValue(header, textureCount);
+    //a cell table larger than that is a broken file
+    if (!(m_cellSize > 0.f) || columns == 0 || rows == 0 || static_cast<Uint64>(columns) * rows > 1u << 24)
+    {
+        close();
+        return false;
+    }
+    m_columns = static_cast<int>(columns);
+    m_rows = static_cast<int>(rows);
+
+    Uint32 propertyCount = 0;
+    bool isValid = readStrings(file, textureCount, m_texturePaths) && readBytes(file, sizeof(propertyCount), bytes);
+    if (isValid)
+        readValue(bytes.data(), propertyCount);
+    isValid = isValid && readStrings(file, propertyCount, m_propertyNames);
+    Uint32 residentCount = 0;
+    Uint32 residentSize = 0;
+    isValid = isValid && readBytes(file, sizeof(residentCount) + sizeof(residentSize), bytes);
+    if (isValid)
+        readValue(readValue(bytes.data(), residentCount), residentSize);
+    std::vector<StreamedEntity> residentEntities;
+    isValid = isValid && readEntities(file, static_cast<Uint32>(file.tellg()), residentSize, residentCount,
+        residentEntities);
+    isValid = isValid && readBytes(file, m_columns * m_rows * s_cellEntrySize, bytes);
+    if (!isValid)
+    {
+        close();
+        return false;
+    }
+    m_cells.resize(static_cast<size_t>(m_columns) * m_rows);
+    const Uint8* cellEntry = bytes.data();
+    for (Cell& cell : m_cells)
+    {
+        cellEntry = readValue(cellEntry, cell.m_offset);
+        cellEntry = readValue(cellEntry, cell.m_size);
+        cellEntry = readValue(cellEntry, cell.m_entityCount);
+        cell.m_state = CELL_UNLOADED;
+        cell.m_lastWantedFrame = 0;
+    }
+    //without a renderer the entities show no image, the jobs have none to decode
+    m_requestedImages.reset(new std::atomic<bool>[m_texturePaths.size()]);
+    for (size_t i = 0; i < m_texturePaths.size(); ++i)
+        m_requestedImages[i].store(!p_entityManager.hasRenderer(), std::memory_order_relaxed);
+
+    m_entityManager = &p_entityManager;
+    m_jobSystem = p_jobSystem;
+    m_path = p_path;
+    p_entityManager.deleteEntities();
+    p_entityManager.reserveEntityIds(static_cast<Uint16>(std::min(idCount, 0xFFFFu)));
+    p_entityManager.beginBulkInsert();
+    Vec2<float> focus = {m_worldWidth / 2.f, m_worldHeight / 2.f};
+    bool hasFocus = false;
+    for (const StreamedEntity& entity : residentEntities)
+    {
+        addEntity(entity);
+        markImageLoaded(entity);
+        if (entity.m_type != STREAMED_PLAYER || hasFocus)
+            continue;
+        focus = {entity.m_rect.x + entity.m_rect.w / 2.f, entity.m_rect.y + entity.m_rect.h / 2.f};
+        hasFocus = true;
+    }
+    //the cells around the first player are read right away, the world starts whole around it
+    ++m_frame;
+    gatherWantedCells(focus, m_wantedCells);
+    std::vector<StreamedEntity> entities;
+    for (const int cellIndex : m_wantedCells)
+    {
+        Cell& cell = m_cells[cellIndex];
+        cell.m_lastWantedFrame = m_frame;
+        if (cell.m_entityCount == 0 || !readEntities(file, cell.m_offset, cell.m_size, cell.m_entityCount, entities))
+            continue;
+        for (const StreamedEntity& entity : entities)
+        {
+            addEntity(entity);
+            markImageLoaded(entity);
+            cell.m_ids.push_back(entity.m_id);
+        }
+        cell.m_state = CELL_RESIDENT;
+        ++m_residentCells;
+    }
+    p_entityManager.endBulkInsert();
+    m_stats = StreamingStats();
+    m_stats.m_residentCells = static_cast<Uint32>(m_residentCells);
+    return true;
+}
+
+void WorldStreamer::close()
+{
+    //the jobs still read the paths and hand in their cells
+    for (const JobHandle& loadJob : m_loadJobs)
+        m_jobSystem->wait(loadJob);
+    m_loadJobs.clear();
+    freeImages(m_loadedCells);
+    freeImages(m_readyCells);
+    m_loadedCells.clear();
+    m_readyCells.clear();
+    m_cells.clear();
+    m_texturePaths.clear();
+    m_propertyNames.clear();
+    m_propertyLookups.clear();
+    m_requestedImages.reset();
+    m_path.clear();
+    m_residentCells = 0;
+    m_totalLoadLatency = 0.0;
+    m_entityManager = nullptr;
+    m_jobSystem = nullptr;
+}
+
+void WorldStreamer::update(const Vec2<float>& p_focus)
+{
+    if (!getIsOpen())
+        return;
+    ++m_frame;
+    gatherWantedCells(p_focus, m_wantedCells);
+    const auto now = std::chrono::steady_clock::now();
+    m_loadJobs.erase(std::remove_if(m_loadJobs.begin(), m_loadJobs.end(), &JobSystem::isFinished), m_loadJobs.end());
+    for (const int cellIndex : m_wantedCells)
+    {
+        Cell& cell = m_cells[cellIndex];
+        cell.m_lastWantedFrame = m_frame;
+        if (cell.m_state != CELL_UNLOADED || cell.m_entityCount == 0)
+            continue;
+        cell.m_state = CELL_REQUESTED;
+        cell.m_requestTime = now;
+        ++m_stats.m_pendingCells;
+        const Uint32 offset = cell.m_offset;
+        const Uint32 size = cell.m_size;
+        const Uint32 entityCount = cell.m_entityCount;
+        Job* loadJob = m_jobSystem ? m_jobSystem->createJob("LoadCell",
+            [this, cellIndex, offset, size, entityCount] { loadCell(cellIndex, offset, size, entityCount); }) : nullptr;
+        if (!loadJob)
+        {
+            loadCell(cellIndex, offset, size, entityCount);
+            continue;
+        }
+        m_loadJobs.push_back(JobSystem::getHandle(loadJob));
+        m_jobSystem->run(loadJob);
+    }
+    //taken here so integrate doesn't wait for the jobs
+    std::lock_guard<std::mutex> loadedCellsGuard(m_loadedCellsMutex);
+    for (LoadedCell& loadedCell : m_loadedCells)
+        m_readyCells.push_back(std::move(loadedCell));
+    m_loadedCells.clear();
+}
+
+void WorldStreamer::integrate()
+{
+    if (!getIsOpen())
+        return;
+    PROFILE_SCOPE("IntegrateCells");
+    const auto start = std::chrono::steady_clock::now();
+    const size_t insertedCells = std::min(m_readyCells.size(), static_cast<size_t>(s_maxCellsPerIntegration));
+    if (insertedCells > 0)
+    {
+        m_entityManager->beginBulkInsert();
+        for (size_t i = 0; i < insertedCells; ++i)
+        {
+            const LoadedCell& loadedCell = m_readyCells[i];
+            Cell& cell = m_cells[loadedCell.m_cell];
+            //the entities then find their textures loaded
+            for (const DecodedImage& image : loadedCell.m_images)
+                m_entityManager->addDecodedTexture(m_texturePaths[image.m_texture], image.m_surface);
+            for (const StreamedEntity& entity : loadedCell.m_entities)
+            {
+                addEntity(entity);
+                cell.m_ids.push_back(entity.m_id);
+            }
+            cell.m_state = CELL_RESIDENT;
+            ++m_residentCells;
+
+            const float latency = std::chrono::duration<float, std::milli>(start - cell.m_requestTime).count();
+            ++m_stats.m_loadedCells;
+            --m_stats.m_pendingCells;
+            m_totalLoadLatency += latency;
+            m_stats.m_lastLoadLatency = latency;
+            m_stats.m_meanLoadLatency = static_cast<float>(m_totalLoadLatency / m_stats.m_loadedCells);
+            m_stats.m_worstLoadLatency = std::max(m_stats.m_worstLoadLatency, latency);
+        }
+        m_entityManager->endBulkInsert();
+        m_readyCells.erase(m_readyCells.begin(), m_readyCells.begin() + static_cast<std::ptrdiff_t>(insertedCells));
+    }
+    evictCells();
+
+    const float integrationTime = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).
+        count();
+    if (integrationTime > s_hitchTime)
+        ++m_stats.m_hitches;
+    m_stats.m_worstIntegrationTime = std::max(m_stats.m_worstIntegrationTime, integrationTime);
+    m_stats.m_residentCells = static_cast<Uint32>(m_residentCells);
+}
+
+void WorldStreamer::gatherWantedCells(const Vec2<float>& p_focus, std::vector<int>& p_cells) const
+{
+    p_cells.clear();
+    const int focusColumn = static_cast<int>(std::floor(p_focus.x / m_cellSize));
+    const int focusRow = static_cast<int>(std::floor(p_focus.y / m_cellSize));
+    for (int ring = 0; ring <= m_loadRadius; ++ring)
+    {
+        for (int row = std::max(focusRow - ring, 0); row <= std::min(focusRow + ring, m_rows - 1); ++row)
+        {
+            for (int column = std::max(focusColumn - ring, 0); column <= std::min(focusColumn + ring, m_columns - 1);
+                 ++column)
+            {
+                if (std::max(std::abs(column - focusColumn), std::abs(row - focusRow)) == ring)
+                    p_cells.push_back(row * m_columns + column);
+            }
+        }
+    }
+}
+
+bool WorldStreamer::readEntities(std::ifstream& p_file, const Uint32 p_offset, const Uint32 p_size,
+                                 const Uint32 p_count, std::vector<StreamedEntity>& p_entities)
+{
+    PROFILE_SCOPE("ReadCell");
+    p_entities.clear();
+    std::vector<Uint8> bytes;
+    if (static_cast<Uint64>(p_count) * s_entitySize > p_size || !p_file.seekg(p_offset) ||
+        !readBytes(p_file, p_size, bytes))
+    {
+        p_file.clear();
+        return false;
+    }
+    p_entities.resize(p_count);
+    const Uint8* entityBytes = bytes.data();
+    for (StreamedEntity& entity : p_entities)
+    {
+        if (!readEntity(entityBytes, bytes.data() + bytes.size(), entity))
+        {
+            p_entities.clear();
+            return false;
+        }
+    }
+    return true;
+}
+
+void WorldStreamer::addEntity(const StreamedEntity& p_entity)
+{
+    m_entityManager->setNextEntityId(p_entity.m_id);
+    const char* texturePath = p_entity.m_texture < m_texturePaths.size() ?
+        m_texturePaths[p_entity.m_texture].c_str() : BASE_TEXTURE;
+    const FRect& rect = p_entity.m_rect;
+    Entity* entity;
+    switch (p_entity.m_type)
+    {
+    case STREAMED_SLOPE:
+        entity = m_entityManager->addSlope(texturePath, rect, p_entity.m_parameter != 0);
+        break;
+    case STREAMED_MOVEABLE:
+        //the mass comes with the properties
+        entity = m_entityManager->addMoveableEntity(texturePath, rect, MoveableEntity::minMass);
+        break;
+    case STREAMED_PLAYER:
+        entity = m_entityManager->addPlayer(texturePath, rect, MoveableEntity::minMass);
+        break;
+    case STREAMED_COLLECTIBLE:
+        entity = m_entityManager->addCollectible(texturePath, rect);
+        break;
+    case STREAMED_TRIGGER_ZONE:
+        entity = m_entityManager->addTriggerZone(texturePath, rect, p_entity.m_parameter == TRIGGER_KILL ?
+            TRIGGER_KILL : TRIGGER_FINISH);
+        break;
+    default:
+        entity = m_entityManager->addEntity(texturePath, rect);
+        break;
+    }
+    //in the table's order, the ones of the entity's type it doesn't have are left out
+    const std::vector<const EntityProperty*>& properties = lookupProperties(entity->getPropertyTable());
+    PropertyValue value;
+    for (const StreamedProperty& streamedProperty : p_entity.m_properties)
+    {
+        const EntityProperty* property = streamedProperty.m_name < properties.size() ?
+            properties[streamedProperty.m_name] : nullptr;
+        if (!property || property->isReadOnly() || property->m_type != streamedProperty.m_type)
+            continue;
+        property->m_get(*entity, value);
+        if (!EntityProperties::equals(property->m_type, value, streamedProperty.m_value))
+            property->m_set(*entity, streamedProperty.m_value);
+    }
+}
+
+const std::vector<const EntityProperty*>& WorldStreamer::lookupProperties(const PropertyTable& p_table)
+{
+    for (const PropertyLookup& lookup : m_propertyLookups)
+        if (lookup.m_table == &p_table)
+            return lookup.m_properties;
+    PropertyLookup lookup;
+    lookup.m_table = &p_table;
+    for (const std::string& propertyName : m_propertyNames)
+        lookup.m_properties.push_back(EntityProperties::find(p_table, propertyName));
+    m_propertyLookups.push_back(std::move(lookup));
+    return m_propertyLookups.back().m_properties;
+}
+
+void WorldStreamer::evictCells()
+{
+    const size_t cellBudget = getCellBudget();
+    if (m_residentCells <= cellBudget)
+        return;
+    std::vector<Uint16> evictedIds;
+    while (m_residentCells > cellBudget)
+    {
+        //a few hundred cells for a large world, looked through for each eviction
+        int leastRecentCell = -1;
+        for (size_t i = 0; i < m_cells.size(); ++i)
+        {
+            const Cell& cell = m_cells[i];
+            if (cell.m_state != CELL_RESIDENT || cell.m_lastWantedFrame == m_frame)
+                continue;
+            if (leastRecentCell < 0 || cell.m_lastWantedFrame < m_cells[leastRecentCell].m_lastWantedFrame)
+                leastRecentCell = static_cast<int>(i);
+        }
+        if (leastRecentCell < 0)
+            break;
+        Cell& cell = m_cells[leastRecentCell];
+        evictedIds.insert(evictedIds.end(), cell.m_ids.begin(), cell.m_ids.end());
+        cell.m_ids.clear();
+        cell.m_state = CELL_UNLOADED;
+        --m_residentCells;
+        ++m_stats.m_evictedCells;
+    }
+    m_entityManager->removeEntities(evictedIds);
+}
+
+void WorldStreamer::loadCell(const int p_cell, const Uint32 p_offset, const Uint32 p_size, const Uint32 p_entityCount)
+{
+    LoadedCell loadedCell;
+    loadedCell.m_cell = p_cell;
+    std::ifstream file(m_path, std::ios::binary);
+    //a section that can't be read gives an empty cell
+    readEntities(file, p_offset, p_size, p_entityCount, loadedCell.m_entities);
+    //the decoding is most of an image's loading, integrate only makes the texture
+    for (const StreamedEntity& entity : loadedCell.m_entities)
+    {
+        if (entity.m_texture >= m_texturePaths.size() || m_requestedImages[entity.m_texture].exchange(true))
+            continue;
+        if (SDL_Surface* surface = EntityManager::decodeImage(m_texturePaths[entity.m_texture].c_str()))
+            loadedCell.m_images.push_back({entity.m_texture, surface});
+    }
+    std::lock_guard<std::mutex> loadedCellsGuard(m_loadedCellsMutex);
+    m_loadedCells.push_back(std::move(loadedCell));
+}
+
+void WorldStreamer::freeImages(std::vector<LoadedCell>& p_cells)
+{
+    for (LoadedCell& cell : p_cells)
+    {
+        for (const DecodedImage& image : cell.m_images)
+            SDL_FreeSurface(image.m_surface);
+        cell.m_images.clear();
+    }
+}
@@ -0,0 +1,207 @@
+﻿#pragma once
+#include <SDL_stdinc.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+#include "EntityProperties.h"
+#include "JobSystem.h"
+#include "utils.h"
+
+class EntityManager;
+struct SDL_Surface;
+
+enum StreamedEntityType_e : Uint8
+{
+    STREAMED_STATIC,
+    STREAMED_SLOPE,
+    STREAMED_MOVEABLE,
+    STREAMED_PLAYER,
+    STREAMED_COLLECTIBLE,
+    STREAMED_TRIGGER_ZONE,
+
+    //LEAVE THIS AT THE END FOR AUTOMATIC INCREMENT
+    STREAMED_ENTITY_TYPES_NUMBER
+};
+
+//A settable property of an entity's table as written in a world file
+struct StreamedProperty
+{
+    //index in the file's property names
+    Uint16 m_name;
+    PropertyType_e m_type;
+    PropertyValue m_value;
+};
+
+//An entity as written in a world file, it gets back its id when its cell is loaded again
+struct StreamedEntity
+{
+    FRect m_rect;
+    Uint16 m_id;
+    //index in the file's texture paths
+    Uint16 m_texture;
+    StreamedEntityType_e m_type;
+    //the trigger zone's action, 1 for a slope rising to the right
+    Uint8 m_parameter;
+    //set on the entity once created, the ones it already has are skipped
+    std::vector<StreamedProperty> m_properties;
+};
+
+struct StreamingStats
+{
+    Uint32 m_residentCells = 0;
+    //requested and not inserted yet
+    Uint32 m_pendingCells = 0;
+    Uint32 m_loadedCells = 0;
+    Uint32 m_evictedCells = 0;
+    //in milliseconds, from the request to the insertion
+    float m_lastLoadLatency = 0.f;
+    float m_meanLoadLatency = 0.f;
+    float m_worstLoadLatency = 0.f;
+    //integrations longer than WorldStreamer::s_hitchTime
+    Uint32 m_hitches = 0;
+    float m_worstIntegrationTime = 0.f;
+};
+
+//Streams a world file's cells around a focus point, the player in the editor. The cells within the load radius
+//are read, along with the images their entities show first, by jobs on the job system's workers, then inserted
+//in bulk by integrate between two ticks. The resident
+//cells out of the radius stay until there are more than the budget, the least recently wanted go first.
+//A cell comes back as it is in the file, what happened to its entities while it was resident is lost
+class WorldStreamer
+{
+public:
+    //in milliseconds, an integration taking longer shows as a stutter
+    static constexpr float s_hitchTime = 2.f;
+    //inserted by one integrate, the others wait for the next frames
+    static constexpr int s_maxCellsPerIntegration = 4;
+
+    WorldStreamer() = default;
+    ~WorldStreamer() { close(); }
+    WorldStreamer(const WorldStreamer&) = delete;
+    WorldStreamer& operator=(const WorldStreamer&) = delete;
+
+    //Every entity but the tilemaps, in the cell holding its center, with the settable properties of its table.
+    //The players and the entities larger than a cell are kept in the resident section, loaded with the world
+    static bool writeWorld(const char* p_path, const EntityManager& p_entityManager, float p_cellSize);
+    //replaces p_entityManager's entities with the resident section and the cells around its first player,
+    //read right away. The jobs read the other cells from then on, without a job system update reads them
+    bool open(const char* p_path, EntityManager& p_entityManager, JobSystem* p_jobSystem);
+    //waits for the cells being read, the loaded entities stay in the entity manager
+    void close();
+    bool getIsOpen() const { return m_entityManager != nullptr; }
+    //in cells around the focus' one, at least one so the entities reaching over their cell's edge are there
+    void setLoadRadius(const int p_loadRadius) { m_loadRadius = p_loadRadius > 1 ? p_loadRadius : 1; }
+    //0 keeps twice the cells of the loaded square, it never goes under them
+    void setCellBudget(const size_t p_cellBudget) { m_cellBudget = p_cellBudget; }
+    //requests the missing cells around p_focus and takes the loaded ones, called every frame
+    void update(const Vec2<float>& p_focus);
+    //loaded cells wait to be inserted or the resident ones are over the budget
+    bool hasPendingChanges() const { return !m_readyCells.empty() || m_residentCells > getCellBudget(); }
+    //the caller makes sure nothing reads the entity list meanwhile
+    void integrate();
+    float getWorldWidth() const { return m_worldWidth; }
+    float getWorldHeight() const { return m_worldHeight; }
+    float getCellSize() const { return m_cellSize; }
+    const StreamingStats& getStats() const { return m_stats; }
+private:
+    enum CellState_e
+    {
+        CELL_UNLOADED,
+        CELL_REQUESTED,
+        CELL_RESIDENT
+    };
+
+    struct Cell
+    {
+        //of its section in the file
+        Uint32 m_offset;
+        Uint32 m_size;
+        Uint32 m_entityCount;
+        CellState_e m_state;
+        Uint32 m_lastWantedFrame;
+        std::chrono::steady_clock::time_point m_requestTime;
+        //of its entities while resident
+        std::vector<Uint16> m_ids;
+    };
+
+    //an image decoded by a cell's job, the texture is made from it by integrate
+    struct DecodedImage
+    {
+        Uint16 m_texture;
+        SDL_Surface* m_surface;
+    };
+
+    //the file's property names resolved in an entity type's table, nullptr for the ones it doesn't have
+    struct PropertyLookup
+    {
+        const PropertyTable* m_table;
+        std::vector<const EntityProperty*> m_properties;
+    };
+
+    struct LoadedCell
+    {
+        int m_cell;
+        std::vector<StreamedEntity> m_entities;
+        std::vector<DecodedImage> m_images;
+    };
+
+    size_t getCellBudget() const
+    {
+        const size_t loadedCells = static_cast<size_t>((2 * m_loadRadius + 1) * (2 * m_loadRadius + 1));
+        return m_cellBudget != 0 ? std::max(m_cellBudget, loadedCells) : 2 * loadedCells;
+    }
+    //the cells around p_focus, the nearest first
+    void gatherWantedCells(const Vec2<float>& p_focus, std::vector<int>& p_cells) const;
+    static bool readEntities(std::ifstream& p_file, Uint32 p_offset, Uint32 p_size, Uint32 p_count,
+                             std::vector<StreamedEntity>& p_entities);
+    //between a beginBulkInsert and an endBulkInsert
+    void addEntity(const StreamedEntity& p_entity);
+    const std::vector<const EntityProperty*>& lookupProperties(const PropertyTable& p_table);
+    void evictCells();
+    //its image is already loaded, the jobs don't decode it
+    void markImageLoaded(const StreamedEntity& p_entity) const
+    {
+        if (p_entity.m_texture < m_texturePaths.size())
+            m_requestedImages[p_entity.m_texture].store(true, std::memory_order_relaxed);
+    }
+    //on a worker, or on the calling thread when the job system had no free slot
+    void loadCell(int p_cell, Uint32 p_offset, Uint32 p_size, Uint32 p_entityCount);
+    static void freeImages(std::vector<LoadedCell>& p_cells);
+
+    EntityManager* m_entityManager = nullptr;
+    JobSystem* m_jobSystem = nullptr;
+    //each job reads the file through its own stream
+    std::string m_path;
+    std::vector<std::string> m_texturePaths;
+    std::vector<std::string> m_propertyNames;
+    //one per entity type met
+    std::vector<PropertyLookup> m_propertyLookups;
+    std::vector<Cell> m_cells;
+    int m_columns = 0;
+    int m_rows = 0;
+    float m_cellSize = 0.f;
+    float m_worldWidth = 0.f;
+    float m_worldHeight = 0.f;
+    int m_loadRadius = 1;
+    size_t m_cellBudget = 0;
+    size_t m_residentCells = 0;
+    Uint32 m_frame = 0;
+    std::vector<int> m_wantedCells;
+    //taken from the loader by update, inserted by integrate
+    std::vector<LoadedCell> m_readyCells;
+    StreamingStats m_stats;
+    double m_totalLoadLatency = 0.0;
+
+    //set by the first job needing a texture's image, or by open for the ones it loaded
+    std::unique_ptr<std::atomic<bool>[]> m_requestedImages;
+    //the cells being read, close waits for them
+    std::vector<JobHandle> m_loadJobs;
+    std::mutex m_loadedCellsMutex;
+    //guarded by m_loadedCellsMutex
+    std::vector<LoadedCell> m_loadedCells;
+};
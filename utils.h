@@ -16,11 +16,23 @@ enum
     HIERARCHY_HEIGHT = SCREEN_HEIGHT,
     GAMESTATEBUTTONS_WIDTH = SCENE_WIDTH / 10,
     GAMESTATEBUTTONS_HEIGHT = SCENE_HEIGHT / 20,
+    PANEL_FONT_SIZE = SCREEN_HEIGHT * 167 / 10000,
+    // SCREEN_HEIGHT * 0.0167
     FIXED_UPDATE_TIME = 10,
     // ms
+    SNAPSHOT_RING_CAPACITY = 500,
+    // ticks, 5 seconds of fixed updates
+    NETWORK_PLAYER_COUNT = 2,
+    NETWORK_MAX_PREDICTION = 30,
+    // ticks the peer's controls are guessed before waiting for them
+    STREAMING_LOAD_RADIUS = 2,
+    // cells of a streamed world loaded on each side of the player's one
+    PARTICLE_BUDGET = 100000,
+    // live particles of every emitter together, the bursts going over it are cut
 };
 
 constexpr float g_epsilonValue = 0.75f;
+constexpr float g_pi = 3.14159265358979f;
 
 enum Axis_e
 {
@@ -29,12 +41,15 @@ enum Axis_e
 };
 #pragma region floating SDL_Rect
 
-struct FRect
+template <typename T>
+struct Rect
 {
-    float x, y;
-    float w, h;
+    T x, y;
+    T w, h;
 };
 
+using FRect = Rect<float>;
+
 inline SDL_Rect convertFRect(const FRect& p_rect)
 {
     const SDL_Rect rect = {
@@ -46,6 +61,13 @@ inline SDL_Rect convertFRect(const FRect& p_rect)
 
 #pragma region vec2 with operators
 
+//keeps the scalar parameters out of the deduction, Vec2<T> alone decides T
+template <typename T>
+struct NonDeduced
+{
+    using type = T;
+};
+
 template <typename T>
 struct Vec2
 {
@@ -77,16 +99,22 @@ Vec2<T> operator -=(const Vec2<T>& p_first, const Vec2<T>& p_second)
 }
 
 template <typename T>
-Vec2<T> operator*(float p_floatingPoint, const Vec2<T>& p_vec)
+Vec2<T> operator*(const typename NonDeduced<T>::type p_scalar, const Vec2<T>& p_vec)
 {
-    Vec2<T> result = Vec2<T>({p_vec.x * p_floatingPoint, p_vec.y * p_floatingPoint});
+    Vec2<T> result = Vec2<T>({p_vec.x * p_scalar, p_vec.y * p_scalar});
     return result;
 }
 
 template <typename T>
-Vec2<T> operator*(const Vec2<T>& p_vec, float p_floatingPoint) { return p_floatingPoint * p_vec; }
+Vec2<T> operator*(const Vec2<T>& p_vec, const typename NonDeduced<T>::type p_scalar) { return p_scalar * p_vec; }
+template <typename T>
+Vec2<T> operator/(const Vec2<T>& p_vec, const typename NonDeduced<T>::type p_scalar)
+{
+    return {p_vec.x / p_scalar, p_vec.y / p_scalar};
+}
+
 template <typename T>
-Vec2<T> operator/(const Vec2<T>& p_vec, float p_floatingPoint) { return p_vec * (1.f / p_floatingPoint); }
+T dot(const Vec2<T>& p_first, const Vec2<T>& p_second) { return p_first.x * p_second.x + p_first.y * p_second.y; }
 #pragma endregion
 
 #pragma region controls
@@ -113,9 +141,12 @@ enum Controls
 #define BASE_MOVEABLE_TEXTURE "./images/baseMoveableTexture.png"
 #define BASE_PLAYER_TEXTURE "./images/playerTexture.png"
 #define BASE_COLLECTIBLE_TEXTURE "./images/coin.png"
+#define BASE_FINISH_FLAG_TEXTURE "./images/finishFlag.png"
+#define BASE_KILL_ZONE_TEXTURE BASE_TEXTURE
 #pragma endregion
 
 #define BASE_FONT "./Font/segoeui.ttf"
+#define BASE_PROFILE_TRACE_PATH "./profileTrace.json"
 
 inline bool detectButtonClicked(const int p_x, const int p_y, const SDL_Rect& p_rect)
 {